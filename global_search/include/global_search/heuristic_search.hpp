@@ -7,14 +7,18 @@
 /// \brief A number used to represent a large cost
 #define BIG_NUM 10000.0
 
+#include <chrono>
 #include <cmath>
-#include <memory>
 #include <unordered_map>
 #include <vector>
 
+#include "global_search/search_core.hpp"
 #include "rigid2d/rigid2d.hpp"
+#include "roadmap/collision_world.hpp"
+#include "roadmap/graph.hpp"
 #include "roadmap/prm.hpp"
 #include "roadmap/grid.hpp"
+#include "roadmap/stats.hpp"
 
 namespace hsearch
 {
@@ -22,6 +26,13 @@ namespace hsearch
   /// \brief Used to track if a node is New, on the open, or on the closed list
   enum status {New, Open, Closed};
 
+  /// \brief Used to track if an edge of a lazy road map is unchecked, collision free, or in collision
+  enum validity : unsigned char {Unknown, Valid, Invalid};
+
+  /// \brief Used to choose the estimate of the cost to goal, the straight line distance, the octile distance of an 8 connected grid, or
+  /// no estimate
+  enum heuristic {Euclidean, Octile, Zero};
+
   /// \brief the key values for a given node
   struct Key
   {
@@ -39,62 +50,141 @@ namespace hsearch
     bool operator>(const Key &rhs) const;
   };
 
-  /// \brief Information used by a search algorithm
-  struct SearchNode
+  /// \brief A binary min heap of node IDs sorted by Key values. Each ID's position in the heap is tracked so
+  /// a node can be located in O(1) and have its key updated or be removed in O(log n).
+  class IndexedHeap
   {
-    std::shared_ptr<prm::Node> node_p = nullptr; ///< contains info about ID, location and, neighbors
+  public:
 
-    int search_id = 0; ///< a unique id for the search node created
+    /// \brief Default constructor
+    IndexedHeap() {};
+
+    /// \brief Empty the heap and size the position table for a new set of node IDs
+    /// \param n the number of nodes, valid IDs are 0 to n-1
+    void reset(int n);
+
+    /// \brief Check if there are any nodes in the heap
+    /// \returns True if the heap is empty
+    bool empty() const;
+
+    /// \brief Get the number of nodes in the heap
+    /// \returns the number of nodes in the heap
+    int size() const;
+
+    /// \brief Determine if a node is in the heap
+    /// \param id the ID of the node
+    /// \returns True if the node is in the heap
+    bool contains(int id) const;
+
+    /// \brief Get the node with the smallest key
+    /// \returns the ID of the node at the top of the heap
+    int top() const;
+
+    /// \brief Get the smallest key in the heap
+    /// \returns the key of the node at the top of the heap
+    Key top_key() const;
+
+    /// \brief Remove the node with the smallest key
+    /// \returns the ID of the removed node
+    int pop();
+
+    /// \brief Add a node to the heap, or update its key if the node is already in the heap
+    /// \param id the ID of the node
+    /// \param k the key value of the node
+    void push(int id, const Key & k);
+
+    /// \brief Remove a node from the heap, does nothing if the node is not in the heap
+    /// \param id the ID of the node
+    void remove(int id);
+
+    /// \brief Recompute the key of every node in the heap and restore the heap order in O(n), like after the weight of the heuristic changes
+    /// \param key_fn a callable taking a node ID and returning its new key
+    template <typename Fn>
+    void update_keys(Fn && key_fn)
+    {
+      for(auto & e : heap) e.key = key_fn(e.id);
+
+      for(int i = static_cast<int>(heap.size()) / 2 - 1; i >= 0; i--) sift_down(i);
+    }
+
+    /// \brief Get the number of insertions and key updates since the heap was created, which reset does not clear
+    /// \returns the number of pushes
+    unsigned long long get_push_count() const;
+
+    /// \brief Get the number of nodes removed since the heap was created, which reset does not clear
+    /// \returns the number of pops and removals of nodes in the heap
+    unsigned long long get_pop_count() const;
+
+    /// \brief Set the push and pop counts back to 0
+    void reset_counts();
+
+  private:
+
+    /// \brief An element of the heap
+    struct Entry
+    {
+      Key key; ///< sorting value of the node
+      int id = -1; ///< ID of the node
+    };
+
+    std::vector<Entry> heap; ///< the heap elements
+    std::vector<int> pos; ///< position of each node ID in the heap, -1 if the node is not in the heap
+
+    unsigned long long pushes = 0; ///< number of insertions and key updates
+    unsigned long long pops = 0; ///< number of nodes removed
+
+    /// \brief Move an element up the heap until the heap property is restored
+    /// \param i the heap position of the element
+    void sift_up(int i);
+
+    /// \brief Move an element down the heap until the heap property is restored
+    /// \param i the heap position of the element
+    void sift_down(int i);
+
+    /// \brief Place an element in a heap position and record the position
+    /// \param i the heap position
+    /// \param e the element to place
+    void place(int i, const Entry & e);
+  };
 
-    double f_val = BIG_NUM; ///< total node cost
-    double g_val = BIG_NUM; ///< path cost from start to this
-    double h_val = BIG_NUM; ///< estimated cost from this to goal
+  /// \brief The search values for every node of a graph during a single query, stored as a struct of arrays indexed by node ID.
+  /// Resetting the state for a new query reuses the existing storage.
+  struct SearchState
+  {
+    std::vector<double> g_val; ///< path cost from start to each node
+    std::vector<double> h_val; ///< estimated cost from each node to goal
+    std::vector<double> rhs_val; ///< another estimate of the start distance used for incremental search methods
 
-    double rhs_val = BIG_NUM; ///< another estimate of the start distance used for incremental search methods
+    std::vector<Key> key_val; ///< key values used to sort each node in the open list
 
-    Key key_val; ///< key values used to sort a SearchNode in open list
+    std::vector<int> parent; ///< the ID of the parent of each node, -1 if there is no parent
 
-    std::shared_ptr<prm::Node> parent_p = nullptr; ///< the parent of this node
+    std::vector<status> state; ///< current status of each node
 
-    status state = New; ///< current status of the node
+    /// \brief Set every node back to its initial values
+    /// \param n the number of nodes in the graph
+    void reset(int n);
 
-    /// \brief Default constructor
-    SearchNode() {};
-
-    /// \brief Create a new start node
-    /// \param n reference to a graph Node
-    SearchNode(const prm::Node & n);
+    /// \brief Get the number of nodes in the state
+    /// \returns the number of nodes
+    int size() const;
 
     /// \brief Update the key values for a node
+    /// \param id the ID of the node
     /// \param km (optional) the key modifier used in an incremental D* search, defaults to 0
-    void CalcKey(double km = 0);
-
-    /// \brief Custom function used for proper sorting of the open list by comparing the key values.
-    /// \param rhs another SearchNode to compare against
-    /// \returns True if this node is less than rhs
-    bool operator<(const SearchNode &rhs) const;
-
-    /// \brief Custom function used for proper sorting of the open list by comparing the key values.
-    /// \param rhs another SearchNode to compare against
-    /// \returns True if this node is greater than rhs
-    bool operator>(const SearchNode &rhs) const;
+    void CalcKey(int id, double km = 0);
   };
 
-  /// \brief Overload the cout operator to print the info in a SearchNode
-  /// \param os the output stream
-  /// \param n SearchNode reference
-  /// \returns an output stream
-  std::ostream & operator<<(std::ostream & os, const SearchNode & n);
-
   /// \brief Overload the cout operator to print the info in a Key
   /// \param os the output stream
   /// \param k a Key reference
   /// \returns an output stream
   std::ostream & operator<<(std::ostream & os, const Key & k);
 
-  /// \brief The base class to define a heuristic based search algorithm. This class has no ComputeCost funtion which is required to find
-  /// the shortest path. This function is defined in the derived class to determine the type of search. Some searched also have a different flow for
-  /// finding the shortest path, which is why the ComputeShortestPath method is virtual. Currently this class will only plan against a precontructed graph.
+  /// \brief The base class to define a heuristic based search algorithm. The A* main loop is a template, best_first_search, instantiated
+  /// by specialized_search for the graph type, the heuristic and an edge cost from search_core.hpp, so a search that follows A* only picks
+  /// its edge cost. Some searches have a different flow for finding the shortest path, which is why the ComputeShortestPath method is
+  /// virtual, and those relax their edges through the same policies with relax. Currently this class will only plan against a precontructed graph.
   class HSearch
   {
   public:
@@ -103,8 +193,8 @@ namespace hsearch
     HSearch() {};
 
     /// \brief Initialize the search with a precontructed graph
-    /// \param node_list a pointer to a graph
-    HSearch(std::vector<prm::Node>* node_list);
+    /// \param graph_p a pointer to a graph, which must outlive the search
+    HSearch(const graph::CSRGraph* graph_p);
 
     /// \brief Initialize the search with a precontructed graph
     /// \param map the known map used to create the graph
@@ -113,11 +203,25 @@ namespace hsearch
     /// \brief Use default destructor for this and all derived classes
     virtual ~HSearch() = default;
 
+    /// \brief The main routine for the search algorithm, by default A* with the edge weights as costs
+    /// \param s_start the ID of the starting node for the path
+    /// \param s_goal the ID of the goal node for the path
+    /// \returns True if a path was found, otherwise False
+    virtual bool ComputeShortestPath(int s_start, int s_goal);
+
     /// \brief The main routine for the search algorithm
     /// \param s_start the starting node for the path
     /// \param s_goal the goal node for the path
     /// \returns True if a path was found, otherwise False
-    virtual bool ComputeShortestPath(const prm::Node & s_start, const prm::Node & s_goal);
+    bool ComputeShortestPath(const prm::Node & s_start, const prm::Node & s_goal);
+
+    /// \brief Search a query graph, such as a road map with the start and goal attached by prm::RoadMap::attach. The search only
+    /// reads the query graph, so separate searches can share a base graph from different threads.
+    /// \param query the graph to search, its base should be the graph the search was created with
+    /// \param s_start the ID of the starting node for the path
+    /// \param s_goal the ID of the goal node for the path
+    /// \returns True if a path was found, otherwise False
+    bool ComputeShortestPath(const graph::QueryGraph & query, int s_start, int s_goal);
 
     /// \brief All the user to retrive the final path
     /// \returns the final path determined by the search
@@ -127,85 +231,500 @@ namespace hsearch
     /// \returns a vector of points that were expanded
     std::vector<rigid2d::Vector2D> get_expanded_nodes();
 
+    /// \brief Get the number of nodes expanded during the most recent search, which is counted even when the expanded nodes are not stored
+    /// \returns the number of nodes taken off the open list, or processed by an incremental search
+    int get_expansion_count() const;
+
+    /// \brief Get the statistics of every search since the search was created or reset: the expansions, the open list operations, the
+    /// collision and line of sight checks, and the wall time of the search and map change phases
+    /// \returns the statistics
+    stats::Stats get_stats() const;
+
+    /// \brief Set the statistics back to 0
+    void reset_stats();
+
+    /// \brief Choose the estimate of the cost to goal. The octile distance is the exact cost to goal on an 8 connected grid without
+    /// obstacles, so on the cell center graphs it expands fewer nodes than the Euclidean distance. It can overestimate the cost on a
+    /// road map, where the path found is then no longer guaranteed to be the shortest. Zero searches like Dijkstra's algorithm.
+    /// \param type the heuristic, Euclidean by default
+    void set_heuristic(heuristic type);
+
+    /// \brief Set the weights of the heuristic for an anytime search like ARAStar, LPAStar or DStarLite. The first search uses the first
+    /// weight and finds a path quickly, then each following weight improves the path while the time budget lasts. A path found with
+    /// weight e costs at most e times the shortest path. The other searches ignore the schedule.
+    /// \param weights the decreasing heuristic weights, each at least 1, usually ending with 1. An empty schedule is ignored.
+    void set_schedule(const std::vector<double> & weights);
+
+    /// \brief Limit the wall clock time of one call to ComputeShortestPath of an anytime search, the best path found in time is kept
+    /// \param seconds the time budget, 0 for no limit
+    void set_time_budget(double seconds);
+
+    /// \brief Get the weight of the heuristic the current path was found with
+    /// \returns the bound on the cost of the path relative to the shortest path, 1 for the shortest path
+    double get_epsilon() const;
+
   protected:
-    std::vector<prm::Node>* created_graph_p; ///< pointer to a vector of created nodes
+    const graph::CSRGraph* created_graph_p = nullptr; ///< pointer to the graph being searched
 
-    std::vector<SearchNode> open_list; ///< the open list for the current search
-    std::vector<SearchNode> closed_list; ///< the closed list for the current search
+    const graph::QueryGraph* query_graph_p = nullptr; ///< the query graph of the current search, null when searching the graph directly
 
-    std::vector<rigid2d::Vector2D> final_path; ///<assemble the final path based on the goal node
+    SearchState search_state; ///< the search values of every node in the graph for the current search
 
-    std::vector<rigid2d::Vector2D> expanded_nodes; ///< a list of points that were expanded (popped off the open list) during the most recent search
+    IndexedHeap open_list; ///< the open list for the current search
 
-    SearchNode start; ///< the start node for the current search
-    rigid2d::Vector2D goal_loc; ///< the goal node for the current search
+    std::vector<rigid2d::Vector2D> final_path; ///<assemble the final path based on the goal node
 
-    int id_cnt = 1; ///<tracks # nodes seen during search
+    std::vector<rigid2d::Vector2D> expanded_nodes; ///< a list of points that were expanded (popped off the open list) during the most recent search
 
-    /// \brief a function used to compute the cost for a pair of nodes
-    /// \param s the current node being expanded
-    /// \param sp the neighbor node being evaluated
-    virtual void ComputeCost(SearchNode &s, SearchNode &sp) = 0;
+    int expansions = 0; ///< number of nodes expanded during the most recent search
 
-    /// \brief build the final path based on all of the saved pointers
-    /// \param goal the goal node determined by the search
-    virtual void assemble_path(SearchNode goal);
+    stats::Stats search_stats; ///< statistics of every search, except the open list operations which the open list counts
 
-    /// \brief calculate the total cost of a node
-    /// \param s the potential parent node
-    /// \param sp the node to calculate the cost for
-    /// \returns the total cost
-    std::vector<double> f(SearchNode s, SearchNode sp);
+    rigid2d::Vector2D goal_loc; ///< the goal node for the current search
 
-    /// \brief calculate the actual path cost
-    /// \param s the potential parent node
-    /// \param sp the node to calculate the cost for
-    /// \returns the actual path cost from start to sp
-    double g(SearchNode s, SearchNode sp);
+    heuristic h_type = Euclidean; ///< the estimate of the cost to goal
+
+    std::vector<double> epsilons = {1.0}; ///< the heuristic weights of an anytime search
+    double time_budget = 0.0; ///< wall clock seconds for one call of an anytime search, 0 for no limit
+    double epsilon = 1.0; ///< the heuristic weight of the current pass of an anytime search
+    double path_epsilon = 1.0; ///< the heuristic weight the current path was found with
+
+    int start_id = -1; ///< ID of the node containing the start of the search
+    int goal_id = -1; ///< ID of the node containing the goal of the search
+
+    /// \brief Get the number of nodes in the graph being searched
+    /// \returns the number of nodes, including the query nodes during a query
+    int graph_size() const;
+
+    /// \brief Get the location of a node in the graph being searched
+    /// \param id the ID of the node
+    /// \returns the x,y location of the node
+    rigid2d::Vector2D graph_point(int id) const;
+
+    /// \brief Call a function for every neighbor of a node in the graph being searched
+    /// \param u the ID of the node
+    /// \param fn a callable taking the neighbor ID and the edge weight
+    template <typename Fn>
+    void graph_neighbors(int u, Fn && fn) const
+    {
+      if(query_graph_p) query_graph_p->for_each_neighbor(u, fn);
+      else created_graph_p->for_each_neighbor(u, fn);
+    }
+
+    /// \brief build the final path based on all of the saved parent IDs
+    /// \param goal the ID of the goal node determined by the search
+    virtual void assemble_path(int goal);
+
+    /// \brief Set the start and goal of a search and put the start on an empty open list
+    /// \param s_start the ID of the starting node for the path
+    /// \param s_goal the ID of the goal node for the path
+    void begin_search(int s_start, int s_goal);
+
+    /// \brief Call a function with the graph being searched as its concrete type
+    /// \param fn a callable taking the query graph or the created graph
+    /// \returns the result of fn
+    template <typename Fn>
+    auto visit_graph(Fn && fn) const
+    {
+      if(query_graph_p) return fn(*query_graph_p);
+      else return fn(*created_graph_p);
+    }
+
+    /// \brief Call a function with the current heuristic as its policy type
+    /// \param fn a callable taking a heuristic from search_core.hpp
+    /// \returns the result of fn
+    template <typename Fn>
+    auto visit_heuristic(Fn && fn) const
+    {
+      switch(h_type)
+      {
+        case Octile: return fn(OctileHeuristic());
+        case Zero: return fn(ZeroHeuristic());
+        default: return fn(EuclideanHeuristic());
+      }
+    }
+
+    /// \brief Update the cost, heuristic, key and parent of a node if the path through an edge is cheaper
+    /// \param graph the graph being searched
+    /// \param heuristic the estimate of the cost to goal
+    /// \param cost the cost of the edge
+    /// \param s the ID of the current node being expanded
+    /// \param sp the ID of the neighbor node being evaluated
+    /// \param w the weight of the edge from s to sp
+    /// \returns True if the cost of sp improved
+    template <typename Graph, typename Heuristic, typename Cost>
+    bool relax(const Graph & graph, const Heuristic & heuristic, Cost & cost, int s, int sp, double w)
+    {
+      double buf_g = 0.0;
+      int parent = -1;
+
+      if(!cost(graph, search_state, s, sp, w, buf_g, parent) || !(buf_g < search_state.g_val.at(sp))) return false;
+
+      // the heuristic of a node does not change during a search, so it is only computed when the node is first reached
+      if(search_state.h_val.at(sp) >= BIG_NUM) search_state.h_val.at(sp) = heuristic(graph.point(sp), goal_loc);
+
+      // If the path to s' is cheaper than the existing one, update it.
+      if(!(buf_g + search_state.h_val.at(sp) < search_state.key_val.at(sp).k1)) return false;
+
+      search_state.g_val.at(sp) = buf_g;
+      search_state.CalcKey(sp); // update the key values
+      search_state.parent.at(sp) = parent;
+
+      return true;
+    }
+
+    /// \brief The A* main loop after begin_search, instantiated for each graph, heuristic and edge cost so the neighbor evaluations are
+    /// inlined
+    /// \param graph the graph being searched
+    /// \param heuristic the estimate of the cost to goal
+    /// \param cost the cost of each edge
+    /// \returns True if a path was found, otherwise False
+    template <typename Graph, typename Heuristic, typename Cost>
+    bool best_first_search(const Graph & graph, const Heuristic & heuristic, Cost & cost)
+    {
+      while(!open_list.empty())
+      {
+        // Get the node with the minimum total cost
+        const int cur_id = open_list.pop();
+        expansions++;
+        STATS_ADD(search_stats.expansions, 1);
+
+        // check if cur_s is the goal
+        if(cur_id == goal_id)
+        {
+          assemble_path(cur_id);
+          return true;
+        }
+
+        // Add current node to the closed list
+        search_state.state.at(cur_id) = Closed;
+
+        // Expand the search to the neighbors of the current node
+        graph.for_each_neighbor(cur_id, [&](int node_id, double w)
+        {
+          // Skip nodes that are already on the closed list
+          if(search_state.state.at(node_id) == Closed) return;
+
+          // add the node to the heap or update its position in the heap when its cost improved
+          if(!relax(graph, heuristic, cost, cur_id, node_id, w)) return;
+
+          search_state.state.at(node_id) = Open;
+          open_list.push(node_id, search_state.key_val.at(node_id));
+        });
+      }
+
+      return false;
+    }
+
+    /// \brief Run an A* search with an edge cost, specialized for the graph being searched and the current heuristic
+    /// \param s_start the ID of the starting node for the path
+    /// \param s_goal the ID of the goal node for the path
+    /// \param cost the cost of each edge
+    /// \returns True if a path was found, otherwise False
+    template <typename Cost>
+    bool specialized_search(int s_start, int s_goal, Cost & cost)
+    {
+      STATS_PHASE(search_stats, "search");
+
+      begin_search(s_start, s_goal);
+
+      return visit_graph([&](const auto & graph)
+      {
+        return visit_heuristic([&](const auto & heuristic)
+        {
+          return best_first_search(graph, heuristic, cost);
+        });
+      });
+    }
 
     /// \brief calculate the estimated cost to goal (heuristic)
-    /// \param sp the node to estimate the cost from
+    /// \param pt the location to estimate the cost from
     /// \returns the estimated cost
-    double h(SearchNode sp);
+    double h(const rigid2d::Vector2D & pt) const;
   };
 
-  /// \brief A* Search class derived from the HSearch class
+  /// \brief A* Search class derived from the HSearch class, which searches with the edge weights as costs
   class AStar : public HSearch
   {
   public:
 
     /// \brief Initialize the search with the created graph
-    /// \param node_list pointer to a vector of Nodes that create a graph
-    AStar(std::vector<prm::Node> * node_list) : HSearch(node_list) {};
+    /// \param graph_p pointer to the graph to search
+    AStar(const graph::CSRGraph * graph_p) : HSearch(graph_p) {};
+  };
+
+  /// \brief Lazy A* for road maps built without edge collision checks, like prm::RoadMap::set_lazy, following LazySP. Each query searches
+  /// the graph optimistically, then checks the edges of the candidate path from the start until one is in collision. That edge is removed
+  /// and the query searches again, until a path with only valid edges is found. The validity of every checked edge is cached for the
+  /// lifetime of the search, so later queries on the same graph only check the edges no earlier query has reached.
+  class LazyAStar : public AStar
+  {
+  public:
+
+    /// \brief Initialize the search, edges are checked against the obstacles of the map
+    /// \param graph_p pointer to the graph to search
+    /// \param map a known the map used to create the graph
+    /// \param buffer a buffer radius to account for in the edge checks
+    LazyAStar(const graph::CSRGraph * graph_p, grid::Map map, double buffer);
+
+    using HSearch::ComputeShortestPath;
+
+    /// \brief Search until the shortest path with only collision free edges is found
+    /// \param s_start the ID of the starting node for the path
+    /// \param s_goal the ID of the goal node for the path
+    /// \returns True if a collision free path was found, otherwise False
+    bool ComputeShortestPath(int s_start, int s_goal) override;
+
+    /// \brief Forget the cached edge checks, needed after the obstacles change
+    void clear_edge_cache();
+
+    /// \brief Get the number of edges checked for collisions during the most recent query
+    /// \returns the number of collision checks
+    int get_edge_checks() const;
+
+    /// \brief Get the number of times the most recent query searched again after finding an edge in collision
+    /// \returns the number of repaired paths
+    int get_repairs() const;
 
   protected:
-    /// \brief calculates the path 1 cost between the two nodes
-    /// \param s the current node being expanded
-    /// \param sp the neighbor node being evaluated
-    void ComputeCost(SearchNode &s, SearchNode &sp);
+
+    collision::CollisionWorld obstacle_world; ///< the known obstacles prepared for the edge checks
+
+    std::vector<validity> edge_states; ///< the validity of each directed edge of the graph, indexed like graph::CSRGraph::find_edge
+
+    int edge_checks = 0; ///< number of edges checked during the most recent query
+    int repairs = 0; ///< number of repeated searches during the most recent query
+
+    /// \brief Get the validity of the edge between two nodes
+    /// \param a the ID of a node
+    /// \param b the ID of another node
+    /// \returns the cached validity, edges to query nodes are always valid since they are checked when the nodes are attached
+    validity edge_state(int a, int b) const;
+
+    /// \brief Check an edge for collisions and cache the result for both directions
+    /// \param a the ID of a node
+    /// \param b the ID of another node
+    /// \returns True if the edge is collision free
+    bool check_edge(int a, int b);
+  };
+
+  /// \brief Anytime Repairing A*, which finds a path quickly with an inflated heuristic and then improves it with each smaller weight of the
+  /// schedule until the time budget runs out. Each improvement only expands the nodes whose cost changed in the earlier passes, instead
+  /// of searching again from scratch.
+  class ARAStar : public HSearch
+  {
+  public:
+
+    /// \brief Initialize the search with the created graph, with a schedule of 3, 2, 1.5 and 1 and no time budget
+    /// \param graph_p pointer to the graph to search
+    ARAStar(const graph::CSRGraph * graph_p);
+
+    using HSearch::ComputeShortestPath;
+
+    /// \brief Search with each weight of the schedule until the path is found with the last weight or the time budget runs out
+    /// \param s_start the ID of the starting node for the path
+    /// \param s_goal the ID of the goal node for the path
+    /// \returns True if a path was found in time, otherwise False. get_epsilon gives the bound of the path.
+    bool ComputeShortestPath(int s_start, int s_goal) override;
+
+  protected:
+
+    std::vector<int> closed_nodes; ///< the nodes expanded during the current pass
+
+    std::vector<int> incons_nodes; ///< the nodes whose cost decreased after they were expanded in the current pass
+
+    std::vector<bool> inconsistent; ///< true for each node in incons_nodes
+
+    /// \brief Get the key of a node for the current weight
+    /// \param id the ID of the node
+    /// \returns the weighted total cost and the path cost
+    Key weighted_key(int id) const;
+
+    /// \brief Expand nodes until the goal has the smallest key or the time runs out
+    /// \param deadline the time the search has to stop
+    /// \returns False if the time ran out
+    bool ImprovePath(const std::chrono::steady_clock::time_point & deadline);
+
+    /// \brief Update the cost and parent of a node if the path through s is cheaper, and queue it on the open list, or on the
+    /// inconsistent list if it was already expanded in this pass
+    /// \param graph the graph being searched
+    /// \param cost the cost of the edge
+    /// \param s the ID of the current node being expanded
+    /// \param sp the ID of the neighbor node being evaluated
+    /// \param w the weight of the edge from s to sp
+    template <typename Graph, typename Cost>
+    void update_successor(const Graph & graph, Cost & cost, int s, int sp, double w)
+    {
+      double buf_g = 0.0;
+      int parent = -1;
+
+      if(!cost(graph, search_state, s, sp, w, buf_g, parent) || !(buf_g < search_state.g_val.at(sp))) return;
+
+      if(search_state.g_val.at(sp) >= BIG_NUM) search_state.h_val.at(sp) = h(graph.point(sp));
+
+      search_state.g_val.at(sp) = buf_g;
+      search_state.parent.at(sp) = parent;
+
+      if(search_state.state.at(sp) != Closed)
+      {
+        search_state.state.at(sp) = Open;
+        open_list.push(sp, weighted_key(sp));
+      }
+      else if(!inconsistent.at(sp))
+      {
+        inconsistent.at(sp) = true;
+        incons_nodes.push_back(sp);
+      }
+    }
   };
 
-  /// \brief Theta* any-angle path planner derived from the HSearch class
+  /// \brief Theta* any-angle path planner derived from the HSearch class. Line of sight results are cached by node ID pair for the
+  /// lifetime of the search, so repeated checks of the same pair, within one query or across queries on the same graph, are free.
+  /// Pairs with a query node are not cached, since query node IDs are reused by the next query.
   class ThetaStar : public HSearch
   {
   public:
 
-    /// \brief Constructor to initialize a Theta Star Search
-    /// \param node_list pointer to a vector of Nodes that create a graph
+    /// \brief Constructor to initialize a Theta Star Search, line of sight is checked against the obstacles of the map
+    /// \param graph_p pointer to the graph to search
     /// \param map a known the map used to create the graph
     /// \param buffer a buffer radius to account for in line of sight checks
-    ThetaStar(std::vector<prm::Node> * node_list, grid::Map map, double buffer);
+    ThetaStar(const graph::CSRGraph * graph_p, grid::Map map, double buffer);
+
+    /// \brief Constructor to initialize a Theta Star Search on the cell centers of a grid, line of sight is checked with a supercover
+    /// line over the occupancy data, so each check is bounded by the segment length instead of the number of obstacles
+    /// \param graph_p pointer to the graph to search, with node IDs matching the row major cell indices like Grid::get_graph
+    /// \param base_grid pointer to the grid, which must outlive the search
+    ThetaStar(const graph::CSRGraph * graph_p, const grid::Grid * base_grid);
+
+    /// \brief Forget the cached line of sight results, needed after the obstacles or the occupancy data change
+    void clear_los_cache();
+
+    /// \brief Also require line of sight for path 1 moves, needed when the edges of the graph were not checked for collisions like in a
+    /// lazy road map. Always on for a grid, since a grid graph connects every cell.
+    /// \param check true to check every edge the search moves along
+    void set_check_edges(bool check);
+
+    using HSearch::ComputeShortestPath;
+
+    /// \brief Search with the any angle edge cost, specialized for the graph and the heuristic
+    /// \param s_start the ID of the starting node for the path
+    /// \param s_goal the ID of the goal node for the path
+    /// \returns True if a path was found, otherwise False
+    bool ComputeShortestPath(int s_start, int s_goal) override;
 
   protected:
 
     grid::Map known_map; ///< Contains all known obstacles and the bounds of the map.
 
-    double buffer_radius; ///<buffer radius when considering line of sight
+    double buffer_radius = 0.0; ///<buffer radius when considering line of sight
+
+    collision::CollisionWorld obstacle_world; ///< the known obstacles prepared for line of sight checks
+
+    const grid::Grid * known_grid_p = nullptr; ///< the grid to check line of sight on, null to check against the obstacles
+
+    bool check_edges = false; ///< true to check line of sight along the graph edges as well as for path 2
+
+    std::unordered_map<unsigned long long, bool> los_cache; ///< line of sight results keyed by the smaller then larger node ID
+
+    /// \brief Check if there is line of sight between two nodes, using the cache when possible
+    /// \param a the ID of a node
+    /// \param b the ID of another node
+    /// \returns True if the segment between the nodes is free
+    bool line_of_sight(int a, int b);
+
+    /// \brief Get the any angle edge cost of this search
+    /// \returns the cost policy, which checks line of sight through the cache
+    auto any_angle_cost()
+    {
+      auto los = [this](int a, int b){ return line_of_sight(a, b); };
+
+      return AnyAngleCost<decltype(los)>(los, check_edges);
+    }
+  };
+
+  /// \brief Jump Point Search on the occupancy data of a grid. Every free cell costs the same, so most paths between two cells have many
+  /// symmetric versions of equal cost. JPS only puts the cells where a path may have to turn, the jump points, on the open list and skips
+  /// over the cells in between, which gives the same path cost as A* on the 8 connected cell center graph with far fewer expansions.
+  /// Moves follow the same rules as the grid graphs, a move is allowed when both cells are free, so a diagonal move may pass between two
+  /// occupied cells. With set_precompute the distance from every cell to the next jump point or wall in each direction is computed once,
+  /// like JPS+, so a search reads the jumps from a table instead of stepping over the cells.
+  class JPSStar : public HSearch
+  {
+  public:
+
+    /// \brief Initialize the search on a grid, no graph has to be generated for the grid
+    /// \param base_grid pointer to the grid, which must outlive the search
+    JPSStar(const grid::Grid * base_grid);
+
+    /// \brief The main routine for the search algorithm
+    /// \param s_start the row major index of the cell containing the start
+    /// \param s_goal the row major index of the cell containing the goal
+    /// \returns True if a path was found, otherwise False. The path contains the jump points, consecutive points are joined by a
+    /// horizontal, vertical or diagonal line of free cells.
+    bool ComputeShortestPath(int s_start, int s_goal) override;
+
+    /// \brief Read the jumps from precomputed distances. The distances are computed for the current occupancy data the first time they are
+    /// needed, and have to be computed again with update_jump_distances after the occupancy data changes.
+    /// \param precompute true to use the precomputed distances
+    void set_precompute(bool precompute);
+
+    /// \brief Compute the jump distances from the current occupancy data, in O(number of cells)
+    void update_jump_distances();
+
+  protected:
+
+    const grid::Grid * known_grid_p = nullptr; ///< the grid being searched
+
+    graph::GridGraph implicit_graph; ///< the location of each cell
+
+    grid::OccupancyView occupancy; ///< the occupancy data of the current search
+
+    bool use_jump_distances = false; ///< true to read the jumps from jump_distances
+
+    /// \brief The steps from a cell to the next jump point in each of the 8 directions, indexed by 8 * cell ID + direction. A step count
+    /// n > 0 means the jump ends at a jump point n cells away, n <= 0 means the jump hits an occupied cell or the edge of the grid after -n
+    /// free cells.
+    std::vector<int> jump_distances;
+
+    /// \brief Check if a cell can be moved through
+    /// \param x the x grid coordinate
+    /// \param y the y grid coordinate
+    /// \returns True if the cell is in the grid and free
+    bool passable(int x, int y) const;
+
+    /// \brief Check if a cell reached by moving in a direction has a neighbor whose shortest path must pass through the cell
+    /// \param x the x grid coordinate
+    /// \param y the y grid coordinate
+    /// \param dir the direction of the move, 0 is +x and the directions turn counter-clockwise in 45 degree steps
+    /// \returns True if the cell has a forced neighbor
+    bool forced(int x, int y, int dir) const;
+
+    /// \brief Step from a cell in a direction until reaching a jump point, the goal, or an occupied cell
+    /// \param x the x grid coordinate of the cell
+    /// \param y the y grid coordinate of the cell
+    /// \param dir the direction of the jump
+    /// \returns the ID of the cell the jump ends at, -1 if it hits an occupied cell or the edge of the grid
+    int jump(int x, int y, int dir) const;
+
+    /// \brief Find the end of a jump from a cell in a direction using the jump distances, stopping early at the goal, or for a diagonal
+    /// jump at the row or column of the goal
+    /// \param x the x grid coordinate of the cell
+    /// \param y the y grid coordinate of the cell
+    /// \param dir the direction of the jump
+    /// \returns the ID of the cell the jump ends at, -1 if there is none
+    int jump_precomputed(int x, int y, int dir) const;
+
+    /// \brief Expand jump points until the goal is reached, instantiated for the heuristic. Each jump is relaxed like an edge of the
+    /// implicit graph whose weight is the length of the jump.
+    /// \param heuristic the estimate of the cost to goal
+    /// \returns True if a path was found, otherwise False
+    template <typename Heuristic>
+    bool jump_search(const Heuristic & heuristic);
 
-    /// \brief calculates the path 1 or path 2 cost between the two nodes
-    /// \param s the current node being expanded
-    /// \param sp the neighbor node being evaluated
-    void ComputeCost(SearchNode &s, SearchNode &sp);
+    /// \brief build the final path of jump points based on all of the saved parent IDs
+    /// \param goal the ID of the goal cell
+    void assemble_path(int goal) override;
   };
 
   /// \brief a class to perform LPA* search
@@ -217,11 +736,18 @@ namespace hsearch
     LPAStar();
 
     /// \brief provide the search with the beginning state of the map
-    /// \param grid_graph reference to an existing grid
+    /// \param grid_graph pointer to the graph of the grid cells, with node IDs matching the row major cell indices
+    /// \param base_grid pointer to the Grid the search is using
+    /// \param start_loc the location of the starting point in integer coordinates on the provided grid
+    /// \param goal_loc the location of the goal point in integer coordinates on the provided grid
+    LPAStar(const graph::CSRGraph* grid_graph, grid::Grid* base_grid, rigid2d::Vector2D start_loc, rigid2d::Vector2D goal_loc);
+
+    /// \brief provide the search with the beginning state of the map, the neighbors of each cell are calculated
+    /// from the cell index so no graph has to be generated for the grid
     /// \param base_grid pointer to the Grid the search is using
     /// \param start_loc the location of the starting point in integer coordinates on the provided grid
     /// \param goal_loc the location of the goal point in integer coordinates on the provided grid
-    LPAStar(std::vector<std::vector<prm::Node>>* grid_graph, grid::Grid* base_grid, rigid2d::Vector2D start_loc, rigid2d::Vector2D goal_loc);
+    LPAStar(grid::Grid* base_grid, rigid2d::Vector2D start_loc, rigid2d::Vector2D goal_loc);
 
     /// \brief The main loop for to find the shortest path
     /// \returns True if a path was found, otherwise False
@@ -230,59 +756,147 @@ namespace hsearch
     /// \brief Take in simulated sensor information and determine if there is a change in the map
     /// \param points pairs of grid cell locations and new occupancy data to potentially update.
     /// \returns True if the information in points actually caused a change in the occupancy data from free to occupied, otherwise False.
+    /// With set_occupancy_cost, True if any occupancy value changed.
     bool MapChange(std::vector<std::pair<rigid2d::Vector2D, signed char>> points);
 
-  protected:
+    /// \brief Check if an anytime search ran out of time before finishing its schedule, so calling ComputeShortestPath again improves the
+    /// path while reusing the state of the interrupted pass
+    /// \returns True if the search can improve the path
+    bool can_improve() const;
+
+    /// \brief Take in a rectangular patch of occupancy data, like a costmap update, and update the verticies around the cells that changed.
+    /// The cost scales with the number of cells that changed from free to occupied or back rather than the size of the patch.
+    /// \param patch the new occupancy data in grid coordinates
+    /// \returns True if a cell changed from free to occupied or back, otherwise False. With set_occupancy_cost, True if any occupancy value
+    /// changed.
+    bool MapChange(const grid::OccupancyPatch & patch);
+
+    /// \brief Weight the edge costs by the occupancy of the cells, see OccupancyCost. By default only the free cells can be crossed and
+    /// every move costs its length. With a lethal value above 1 the cells of the buffer zone can be crossed, and a positive scale makes
+    /// the path keep away from them. Every cell is updated for the new costs, and MapChange then updates every cell whose occupancy
+    /// value changes instead of only the cells that change from free to occupied or back.
+    /// \param scale the extra cost of a move next to a fully occupied cell, relative to its length, at least 0
+    /// \param lethal the smallest occupancy value that can not be crossed, between 1 and 101
+    void set_occupancy_cost(double scale, signed char lethal);
 
-    std::vector<std::vector<prm::Node>>* created_graph_p; ///< pointer to a 2D vector of created nodes
+  protected:
 
     grid::Grid* known_grid_p; ///<pointer to the known grid containing current occupancy data
 
-    std::unordered_map<int, SearchNode> standby; ///< all nodes not on the open list
+    graph::GridGraph implicit_graph; ///< neighbors of the grid cells, used when no graph is provided
 
-    int start_id; ///< ID of the SearchNode conttaining the start of the search
-    int goal_id; ///< ID of the SearchNode conttaining the goal of the search
+    int grid_width = 0; ///< number of cells in each row of the grid
 
     double km = 0; ///<Key modifier used by D* Lite
 
-    /// \brief build the final path based on all of the saved pointers
-    /// \param goal the goal SearchNode
-    void assemble_path(SearchNode goal);
-
-    /// \brief Update a node
+    double occupancy_scale = 0.0; ///< the extra cost of a move next to a fully occupied cell, relative to its length
+    signed char lethal_occupancy = 1; ///< the smallest occupancy value that can not be crossed
+
+    unsigned int pass = 0; ///< the position of the current weight in the schedule, set back to the first weight when the map changes
+    bool interrupted = false; ///< true if the time budget ran out during the current pass
+    bool has_path = false; ///< true if a pass found a path since the map last changed
+
+    std::vector<bool> closed_set; ///< the nodes made consistent during the current pass, only used with a weight above 1
+    std::vector<int> incons_nodes; ///< the nodes that became inconsistent after they were made consistent in the current pass
+    std::vector<bool> inconsistent; ///< true for each node in incons_nodes
+
+    /// \brief Call a function for every neighbor of a node, using the provided graph if there is one
+    /// \param u the ID of the node
+    /// \param fn a callable taking the neighbor ID and the edge weight
+    template <typename Fn>
+    void for_each_neighbor(int u, Fn && fn) const
+    {
+      if(created_graph_p) created_graph_p->for_each_neighbor(u, fn);
+      else implicit_graph.for_each_neighbor(u, fn);
+    }
+
+    /// \brief Get the location of a node
+    /// \param id the ID of the node
+    /// \returns the world location of the cell center
+    rigid2d::Vector2D node_point(int id) const;
+
+    /// \brief build the final path by following the lowest cost neighbors from the goal back to the start
+    /// \param goal the ID of the goal node
+    void assemble_path(int goal) override;
+
+    /// \brief Expand nodes until the goal is consistent and has the smallest key or the time runs out
+    /// \param deadline the time the search has to stop
+    /// \returns False if the time ran out
+    bool ImprovePath(const std::chrono::steady_clock::time_point & deadline);
+
+    /// \brief Start a pass with the current weight of the schedule. The inconsistent nodes of the previous pass go back on the open list, the
+    /// keys of the open list are updated for the weight, and no node counts as made consistent yet.
+    void begin_pass();
+
+    /// \brief Recalculate the rhs value of a node and update its place in the open list
     /// \param u the id of a node to update
     void UpdateVertex(int u);
 
-    /// \brief a function used to compute the cost for a pair of nodes
-    /// \param s the current node being expanded
-    /// \param sp the neighbor node being evaluated
-    void ComputeCost(SearchNode &s, SearchNode &sp);
-
-    /// \brief a function used calculate traversal cost between 2 nodes based on the known_map.
-    /// Uses the stored point in each node to determine if a cell is free or occupied. If one is occupied the cost
-    /// is set to HUGE_VAL, otherwise use the straight line distance.
-    /// \param s the current node being expanded
-    /// \param sp the neighbor node being evaluated
-    /// \returns the cost to traverse from sp to s
-    double edge_cost(SearchNode &s, SearchNode &sp);
-
-    /// \brief Locate a node in the open list or standby
-    /// \param u_id the id of a node to find
-    /// \returns a pointer to the node
-    SearchNode* locate_node(int u_id);
-
-    /// \brief Get a reference to the goal node
+    /// \brief Get the edge cost of this search on the current occupancy data
+    /// \returns the cost policy, the node IDs are the row major indices of the grid cells
+    OccupancyCost cell_cost() const;
+
+    /// \brief Check if the edge costs depend on more than whether each cell is free
+    /// \returns True if a change between two values that are not free can change an edge cost
+    bool graded_cost() const;
+
+    /// \brief Set the rhs value and parent of a node from the cheapest path through its neighbors, instantiated for the graph type so
+    /// the edge costs are inlined
+    /// \param graph the provided graph or the implicit graph of the grid
+    /// \param u the id of the node
+    template <typename Graph>
+    void update_rhs(const Graph & graph, int u)
+    {
+      const OccupancyCost cost = cell_cost();
+
+      //Ensures the following loop will set the rhs to min given the most current info
+      search_state.rhs_val.at(u) = BIG_NUM;
+
+      graph.for_each_neighbor(u, [&](int sp, double w)
+      {
+        double buf = 0.0;
+        int parent = -1;
+
+        // the edges are undirected, so the path through sp ends with the edge from sp to u
+        if(cost(graph, search_state, sp, u, w, buf, parent) && buf < search_state.rhs_val.at(u))
+        {
+          search_state.rhs_val.at(u) = buf;
+          search_state.parent.at(u) = parent;
+        }
+      });
+    }
+
+    /// \brief Update every vertex whose edge costs changed, each cell that changed and its neighbors are updated once
+    /// \param changed_cells the IDs of the cells that changed from free to occupied or back
+    /// \returns True if there were any changed cells
+    bool UpdateChangedCells(const std::vector<int> & changed_cells);
+
+    /// \brief a function used calculate traversal cost between 2 nodes based on the known_map, with the same edge cost as update_rhs.
+    /// If the edge can not be crossed the cost is set to BIG_NUM.
+    /// \param sp the ID of the neighbor node being evaluated
+    /// \param u the ID of the node being updated
+    /// \param w the weight of the edge between sp and u
+    /// \returns the cost to traverse from sp to u
+    double edge_cost(int sp, int u, double w) const;
+
+    /// \brief Update the heuristic and key values of a node based on the current goal and key modifier. With a weight above 1 the
+    /// heuristic of an overconsistent node is inflated by the weight, like Anytime D*.
+    /// \param u the ID of the node
+    /// \returns the new key of the node
+    Key CalculateKey(int u);
+
+    /// \brief Get the current key of the goal node
     /// \returns goal key
     Key get_goal_key();
 
     /// \brief Check the local consistency of a node
     /// \returns true if the goal is locally consistent, otherwise false
-    bool goal_is_consistent();
+    bool goal_is_consistent() const;
 
     /// \brief Determine if a node is locally is consistent
-    /// \param u a node to evaluate
+    /// \param u the ID of a node to evaluate
     /// \returns True if the node is locally consistent
-    bool is_consistent(SearchNode u) const;
+    bool is_consistent(int u) const;
   };
 
   /// \brief a class to perform D* Lite search
@@ -294,11 +908,18 @@ namespace hsearch
     DStarLite();
 
     /// \brief provide the search with the beginning state of the map
-    /// \param grid_graph reference to an existing grid
+    /// \param grid_graph pointer to the graph of the grid cells, with node IDs matching the row major cell indices
+    /// \param base_grid pointer to the Grid the search is using
+    /// \param start_loc the location of the robot in integer coordinates on the provided grid
+    /// \param goal_loc the location of the goal point in integer coordinates on the provided grid
+    DStarLite(const graph::CSRGraph* grid_graph, grid::Grid* base_grid, rigid2d::Vector2D start_loc, rigid2d::Vector2D goal_loc);
+
+    /// \brief provide the search with the beginning state of the map, the neighbors of each cell are calculated
+    /// from the cell index so no graph has to be generated for the grid
     /// \param base_grid pointer to the Grid the search is using
     /// \param start_loc the location of the robot in integer coordinates on the provided grid
     /// \param goal_loc the location of the goal point in integer coordinates on the provided grid
-    DStarLite(std::vector<std::vector<prm::Node>>* grid_graph, grid::Grid* base_grid, rigid2d::Vector2D start_loc, rigid2d::Vector2D goal_loc);
+    DStarLite(grid::Grid* base_grid, rigid2d::Vector2D start_loc, rigid2d::Vector2D goal_loc);
 
     /// \brief update the location the search will plan to with the robot's current location, also updates km. Should be called directly before updating the map
     /// \param robot_loc the location of the robot in integer coordinates on the provided grid
@@ -0,0 +1,189 @@
+#ifndef HPASTAR_INCLUDE_GUARD_HPP
+#define HPASTAR_INCLUDE_GUARD_HPP
+/// \file
+/// \brief A hierarchical search over the clusters of a grid, following HPA*
+
+#include <unordered_map>
+#include <vector>
+
+#include "global_search/heuristic_search.hpp"
+#include "rigid2d/rigid2d.hpp"
+#include "roadmap/graph.hpp"
+#include "roadmap/grid.hpp"
+
+namespace hsearch
+{
+  /// \brief Hierarchical path planning on a large grid, following HPA*. The grid is split into square clusters. The free cells on
+  /// both sides of each cluster border are grouped into entrances, and the cost between every pair of entrances of a cluster is found
+  /// with a search inside the cluster. A query attaches the start and goal to the entrances of their clusters, searches this small
+  /// abstract graph with A*, then refines each step of the abstract path with a search inside one cluster. The paths are close to the
+  /// shortest path on the 8 connected grid, and a path is always found if one exists. After the occupancy data changes only the clusters
+  /// around the changed cells are built again.
+  class HPAStar : public HSearch
+  {
+  public:
+
+    /// \brief Build the clusters of a grid
+    /// \param base_grid pointer to the grid, which must outlive the search
+    /// \param cluster_size the side length of a cluster in cells, at least 2
+    HPAStar(const grid::Grid * base_grid, int cluster_size=16);
+
+    /// \brief Search the abstract graph and refine the path through each cluster
+    /// \param s_start the row major index of the cell containing the start
+    /// \param s_goal the row major index of the cell containing the goal
+    /// \returns True if a path was found, otherwise False. The path contains every cell from the goal to the start.
+    bool ComputeShortestPath(int s_start, int s_goal) override;
+
+    /// \brief Build the clusters around cells that changed, like the cells returned by grid::Grid::update_grid or
+    /// grid::Grid::update_patch. A cluster is built again when it contains a changed cell or when the entrances on one of its borders
+    /// changed.
+    /// \param changed_cells the row major indices of the cells that changed from free to not free or back
+    /// \returns the number of clusters that were built again
+    int update_cells(const std::vector<int> & changed_cells);
+
+    /// \brief Build every cluster from the current occupancy data, needed after the grid is rebuilt
+    void rebuild();
+
+    /// \brief Get the cluster a cell belongs to
+    /// \param cell the row major index of the cell
+    /// \returns the ID of the cluster
+    int get_cluster(int cell) const;
+
+    /// \brief Get the cells covered by a cluster
+    /// \param cluster the ID of the cluster
+    /// \returns the x and y grid coordinates of the lower left cell, the width, and the height in cells
+    std::vector<int> get_cluster_bounds(int cluster) const;
+
+    /// \brief Get the clusters the most recent path passes through, which bound the area an incremental search like LPA* has to cover
+    /// to follow the path
+    /// \returns the IDs of the clusters in the order the path from the start reaches them
+    std::vector<int> get_corridor() const;
+
+    /// \brief Get the abstract graph, which has one node per entrance cell
+    /// \returns a reference to the graph
+    const graph::CSRGraph & get_abstract_graph() const;
+
+  protected:
+
+    /// \brief A move between two free neighboring cells in different clusters
+    struct Crossing
+    {
+      int a = -1; ///< the cell in the cluster that owns the crossing
+      int b = -1; ///< the cell in the neighboring cluster
+      double w = 0.0; ///< the cost of the move
+
+      /// \brief Compare the cells of two crossings
+      /// \param rhs another crossing
+      /// \returns True if both crossings join the same cells
+      bool operator==(const Crossing & rhs) const;
+    };
+
+    /// \brief A rectangle of cells with its entrances. Each cluster owns the crossings to the clusters to the right, above, above and to
+    /// the right, and below and to the right of it, so every crossing is stored once.
+    struct Cluster
+    {
+      int x = 0; ///< x grid coordinate of the lower left cell
+      int y = 0; ///< y grid coordinate of the lower left cell
+      int width = 0; ///< number of cells in each row
+      int height = 0; ///< number of rows
+
+      std::vector<Crossing> crossings; ///< the crossings owned by the cluster
+      std::vector<int> entrances; ///< the cells of the cluster on any crossing, in ascending order
+      std::vector<double> costs; ///< the cost between each pair of entrances, indexed by i * entrances.size() + j, BIG_NUM if unreachable
+    };
+
+    const grid::Grid * known_grid_p = nullptr; ///< the grid being searched
+
+    graph::GridGraph implicit_graph; ///< the location of each cell
+
+    grid::OccupancyView occupancy; ///< the current occupancy data
+
+    int cluster_length = 16; ///< the side length of a cluster in cells
+    int clusters_x = 0; ///< number of clusters in each row
+    int clusters_y = 0; ///< number of rows of clusters
+
+    std::vector<Cluster> clusters; ///< every cluster in row major order
+
+    graph::CSRGraph abstract_graph; ///< one node per entrance cell, with edges inside each cluster and across the crossings
+    std::unordered_map<int, int> entrance_nodes; ///< the abstract node ID of each entrance cell
+
+    graph::QueryGraph query; ///< the abstract graph with the start and goal of the current query attached
+
+    AStar abstract_search; ///< the search on the abstract graph
+
+    std::vector<int> corridor; ///< the clusters of the most recent path
+
+    int local_x = 0; ///< x grid coordinate of the lower left cell of the area of the current local search
+    int local_y = 0; ///< y grid coordinate of the lower left cell of the area of the current local search
+    int local_width = 0; ///< number of cells in each row of the area of the current local search
+    int local_goal = -1; ///< the goal cell of the current local search, -1 for a Dijkstra search
+
+    /// \brief Check if a cell can be moved through
+    /// \param x the x grid coordinate
+    /// \param y the y grid coordinate
+    /// \returns True if the cell is in the grid and free
+    bool passable(int x, int y) const;
+
+    /// \brief Find the crossings a cluster owns with the current occupancy data. A straight run of crossings along a border gets one
+    /// crossing in its middle, or one at each end when the run is long. A diagonal move between two occupied cells is a crossing of its
+    /// own, every other diagonal move can be made through an entrance of a run.
+    /// \param c the ID of the cluster
+    /// \returns the crossings
+    std::vector<Crossing> find_crossings(int c) const;
+
+    /// \brief Collect the entrances of a cluster from its crossings and the crossings of its neighbors, and find the costs between them
+    /// \param c the ID of the cluster
+    void build_cluster(int c);
+
+    /// \brief Create the abstract graph from the entrances and crossings of every cluster
+    void assemble_graph();
+
+    /// \brief Search the cells of a cluster, an A* search to a goal or a Dijkstra search of the whole cluster. The results stay in the
+    /// search state, indexed by local_id.
+    /// \param c the ID of the cluster
+    /// \param s_start the row major index of the start cell, which must be in the cluster
+    /// \param s_goal the row major index of the goal cell in the cluster, or -1 to find the cost to every cell of the cluster
+    /// \returns True if the goal was reached, always True when there is no goal
+    bool local_search(int c, int s_start, int s_goal);
+
+    /// \brief Get the index of a cell in the area of the current local search
+    /// \param cell the row major index of the cell
+    /// \returns the local index
+    int local_id(int cell) const;
+
+    /// \brief Get the cell of an index in the area of the current local search
+    /// \param id the local index
+    /// \returns the row major index of the cell
+    int local_cell(int id) const;
+
+    /// \brief Connect a query node to the entrances its cell can reach in its cluster
+    /// \param node the ID of the query node
+    /// \param cell the row major index of its cell
+    void attach(int node, int cell);
+
+    /// \brief The cells of the area of the current local search, with their local indices as node IDs, so the moves of a local search
+    /// are relaxed like the edges of a graph
+    struct LocalCells
+    {
+      const HPAStar * search = nullptr; ///< the search doing the local search
+
+      /// \brief Get the location of a cell
+      /// \param id the local index of the cell
+      /// \returns the world location of the cell center
+      rigid2d::Vector2D point(int id) const
+      {
+        return search->implicit_graph.point(search->local_cell(id));
+      }
+    };
+
+    /// \brief The main loop of a local search after the start is on the open list, instantiated for the heuristic
+    /// \param heuristic the estimate of the cost to goal
+    /// \param c the ID of the cluster
+    /// \param goal the local index of the goal cell, or -1 to search the whole cluster
+    /// \returns True if the goal was reached, always True when there is no goal
+    template <typename Heuristic>
+    bool local_expand(const Heuristic & heuristic, int c, int goal);
+  };
+}
+
+#endif // HPASTAR_INCLUDE_GUARD_HPP
@@ -0,0 +1,117 @@
+#ifndef PLANNING_THREAD_INCLUDE_GUARD_HPP
+#define PLANNING_THREAD_INCLUDE_GUARD_HPP
+/// \file
+/// \brief Run an incremental search on its own thread, fed by map updates and publishing paths without blocking the caller
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "global_search/heuristic_search.hpp"
+#include "rigid2d/rigid2d.hpp"
+#include "roadmap/grid.hpp"
+#include "roadmap/spsc_queue.hpp"
+#include "roadmap/stats.hpp"
+
+namespace hsearch
+{
+  /// \brief New information about the map for the planning thread
+  struct MapDelta
+  {
+    std::vector<std::pair<rigid2d::Vector2D, signed char>> cells; ///< grid cell locations and their new occupancy data
+    std::vector<grid::OccupancyPatch> patches; ///< rectangular blocks of new occupancy data, applied after the cells
+    bool move_robot = false; ///< True to move the robot to robot_loc before updating the cells, only used by D* Lite
+    rigid2d::Vector2D robot_loc; ///< the location of the robot in integer coordinates on the grid
+  };
+
+  /// \brief A result published by the planning thread
+  struct Plan
+  {
+    unsigned long long revision = 0; ///< the number of map deltas the plan accounts for
+    bool replanned = false; ///< True if the search ran, False if the map deltas changed nothing so the previous path still holds
+    bool found = false; ///< True if the most recent search found a path
+    double epsilon = 1.0; ///< the heuristic weight the path was found with, the path costs at most this many times the shortest path
+    std::vector<rigid2d::Vector2D> path; ///< the path from the goal back to the start, empty if the search did not run
+    std::vector<rigid2d::Vector2D> expanded_nodes; ///< the nodes expanded by the search, empty if the search did not run
+    stats::Stats search_stats; ///< the statistics of the search after the plan
+  };
+
+  /// \brief Own an LPA* or D* Lite search while it runs on a dedicated thread. Map deltas are passed in through a lock free queue,
+  /// and every delta that arrives during a search is applied before the next search, with consecutive cell updates merged into a
+  /// single MapChange. Plans are passed out
+  /// through a double buffer that is only locked to swap the buffers. Once started, only the planning thread may use the search and
+  /// the grid it plans on, until the planning thread is stopped.
+  class PlanningThread
+  {
+  public:
+
+    /// \brief Prepare to plan with LPA*
+    /// \param search the search to run, which must outlive the planning thread
+    /// \param queue_size the maximum number of map deltas waiting for the planning thread
+    explicit PlanningThread(LPAStar & search, unsigned int queue_size=64);
+
+    /// \brief Prepare to plan with D* Lite, the robot location of each delta is passed to UpdateRobotLoc
+    /// \param search the search to run, which must outlive the planning thread
+    /// \param queue_size the maximum number of map deltas waiting for the planning thread
+    explicit PlanningThread(DStarLite & search, unsigned int queue_size=64);
+
+    /// \brief Stop the planning thread
+    ~PlanningThread();
+
+    PlanningThread(const PlanningThread &) = delete;
+    PlanningThread & operator=(const PlanningThread &) = delete;
+
+    /// \brief Start the planning thread, which searches the current map right away and then waits for map deltas
+    void start();
+
+    /// \brief Stop the planning thread after the current search, the map deltas still in the queue are dropped
+    void stop();
+
+    /// \brief Send a map delta to the planning thread, only call from one thread
+    /// \param delta the delta to move into the queue, left unchanged if the queue is full
+    /// \returns True if the delta was queued, False if the queue is full
+    bool submit(MapDelta && delta);
+
+    /// \brief Get the newest plan if one was published since the last call, only call from one thread
+    /// \param plan [out] swapped with the newest plan, left unchanged if there is no new plan
+    /// \returns True if there was a new plan
+    bool try_get_plan(Plan & plan);
+
+    /// \brief Get the number of map deltas queued with submit
+    /// \returns the number of deltas, which a plan accounts for all of once its revision matches
+    unsigned long long get_submitted() const;
+
+  private:
+    LPAStar * search_p = nullptr; ///< the search to run
+    DStarLite * robot_search_p = nullptr; ///< the search as D* Lite, null for LPA*
+
+    parallel::SPSCQueue<MapDelta> deltas; ///< map deltas waiting for the planning thread
+
+    std::thread worker; ///< the planning thread
+    std::atomic<bool> running{false}; ///< True while the planning thread should keep planning
+
+    std::mutex wake_mutex; ///< only guards the planning thread going to sleep
+    std::condition_variable wake; ///< wakes the planning thread for a new delta or to stop
+
+    std::mutex plan_mutex; ///< guards front_plan and fresh_plan
+    Plan front_plan; ///< the newest published plan
+    bool fresh_plan = false; ///< True if front_plan has not been taken by try_get_plan
+    Plan back_plan; ///< the plan being filled in by the planning thread
+    bool last_found = false; ///< result of the most recent search, only used by the planning thread
+
+    unsigned long long submitted = 0; ///< number of deltas queued, only used by the submitting thread
+
+    /// \brief The loop of the planning thread
+    void run();
+
+    /// \brief Fill in the back plan and publish it
+    /// \param replan True to run the search, False if the map did not change since the previous search
+    /// \param revision the number of map deltas applied to the search
+    void publish(bool replan, unsigned long long revision);
+  };
+}
+
+#endif //PLANNING_THREAD_INCLUDE_GUARD_HPP
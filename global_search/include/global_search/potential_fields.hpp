@@ -8,6 +8,7 @@
 #define BIG_NUM 10000.0
 
 #include "rigid2d/rigid2d.hpp"
+#include "roadmap/distance_field.hpp"
 #include "roadmap/grid.hpp"
 
 namespace pfield
@@ -30,11 +31,41 @@ namespace pfield
     /// \brief given the robots location, plan its next step
     /// \param cur_loc the current location of the robot
     /// \returns the next location to move to
-    rigid2d::Vector2D PlanOneStep(rigid2d::Vector2D cur_loc);
+    rigid2d::Vector2D PlanOneStep(rigid2d::Vector2D cur_loc) const;
+
+    /// \brief Plan a whole path by gradient descent and store it as the final path
+    /// \param start the starting location of the robot
+    /// \param epsilon the termination threshold for the distance to the goal
+    /// \param max_iters the maximum number of steps to take
+    /// \returns True if the path reached the goal within the step limit
+    bool PlanPath(rigid2d::Vector2D start, double epsilon, unsigned int max_iters);
+
+    /// \brief Plan a path to the goal from each of many starting locations. The locations are advanced together in blocks, each block is
+    /// stored as separate x and y arrays and stepped with SIMD instructions when available, and the blocks are split across threads.
+    /// The final path is not changed.
+    /// \param starts the starting locations
+    /// \param epsilon the termination threshold for the distance to the goal
+    /// \param max_iters the maximum number of steps to take from each start
+    /// \param threads the number of threads to use, 0 uses all available cores
+    /// \returns the path from each start, in the same order as the starts
+    std::vector<std::vector<rigid2d::Vector2D>> PlanPaths(const std::vector<rigid2d::Vector2D> & starts, double epsilon, unsigned int max_iters,
+                                                          unsigned int threads=1) const;
+
+    /// \brief Advance a batch of locations by one step in place
+    /// \param xs the x coordinates of the locations
+    /// \param ys the y coordinates of the locations
+    /// \param n the number of locations
+    void StepParticles(double * xs, double * ys, int n) const;
+
+    /// \brief Evaluate the repulsive gradient from a precomputed distance field of the map instead of the exact distance to every obstacle.
+    /// The field only accounts for the nearest obstacle, so nearby obstacles no longer add up.
+    /// \param resolution the side length of the field cells, use 0 to go back to the exact distances
+    /// \param threads the number of threads used to compute the field, 0 uses all available cores
+    void use_distance_field(double resolution, unsigned int threads=1);
 
     /// \brief retrieve the whole planned path
     /// \returns the planned path
-    std::vector<rigid2d::Vector2D> get_path();
+    std::vector<rigid2d::Vector2D> get_path() const;
 
   private:
     grid::Map known_map; ///< the known map
@@ -51,21 +82,29 @@ namespace pfield
 
     std::vector<rigid2d::Vector2D> final_path; ///< final path determined
 
+    raster::DistanceField dist_field; ///< distance to the nearest obstacle, empty when using the exact distances
+
     /// \brief Calculate the attractive component of the "force" based on the distance to goal
     /// \param cur_loc the current location of the robot
     /// \returns the total attrative gradient
-    rigid2d::Vector2D calculate_u_att(rigid2d::Vector2D cur_loc);
+    rigid2d::Vector2D calculate_u_att(rigid2d::Vector2D cur_loc) const;
 
     /// \brief Calculate the repulsive component of the "force" based on the distance to each obstacle
     /// \param cur_loc the current location of the robot
     /// \returns the total repulsive gradient
-    rigid2d::Vector2D calculate_u_rep(rigid2d::Vector2D cur_loc);
+    rigid2d::Vector2D calculate_u_rep(rigid2d::Vector2D cur_loc) const;
 
     /// \brief Calculate the repulsive component due to a given obstacle
     /// \param polygon a set of points that define a convex polygon
     /// \param cur_loc the current location of the robot
     /// \returns a vector of the repulsice gradient components for the provided obstacle
-    rigid2d::Vector2D u_rep_component(std::vector<rigid2d::Vector2D> polygon, rigid2d::Vector2D cur_loc);
+    rigid2d::Vector2D u_rep_component(const std::vector<rigid2d::Vector2D> & polygon, rigid2d::Vector2D cur_loc) const;
+
+    /// \brief Calculate the repulsive gradient for a given distance to the nearest obstacle
+    /// \param distance the distance to the obstacle
+    /// \param unit_distvec the unit vector pointing from the obstacle to the robot
+    /// \returns the repulsive gradient, which is 0 beyond the range of influence
+    rigid2d::Vector2D u_rep_gradient(double distance, rigid2d::Vector2D unit_distvec) const;
   };
 }
 
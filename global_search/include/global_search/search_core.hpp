@@ -0,0 +1,206 @@
+#ifndef SEARCH_CORE_INCLUDE_GUARD_HPP
+#define SEARCH_CORE_INCLUDE_GUARD_HPP
+/// \file
+/// \brief Policies that specialize the inner loop of a search at compile time. A search is instantiated on a graph type, a heuristic and
+/// an edge cost, so the compiler can inline every neighbor evaluation instead of making a virtual call per edge.
+///
+/// A graph is any type with size(), point(id) and for_each_neighbor(id, fn), like graph::CSRGraph, graph::QueryGraph and
+/// graph::GridGraph. A heuristic is called with a location and the goal. An edge cost is called with the graph, the search state, the
+/// node being expanded, its neighbor and the edge weight, and sets the cost of the path to the neighbor and its parent, or returns False
+/// if the edge can not be used.
+
+#include <algorithm>
+#include <cmath>
+
+#include "rigid2d/rigid2d.hpp"
+#include "roadmap/grid.hpp"
+
+namespace hsearch
+{
+  /// \brief The straight line distance to the goal
+  struct EuclideanHeuristic
+  {
+    /// \brief Estimate the cost to goal
+    /// \param pt the location to estimate the cost from
+    /// \param goal the location of the goal
+    /// \returns the distance
+    double operator()(const rigid2d::Vector2D & pt, const rigid2d::Vector2D & goal) const
+    {
+      return pt.distance(goal);
+    }
+  };
+
+  /// \brief The length of the shortest 8 connected path to the goal without obstacles
+  struct OctileHeuristic
+  {
+    /// \brief Estimate the cost to goal
+    /// \param pt the location to estimate the cost from
+    /// \param goal the location of the goal
+    /// \returns the octile distance
+    double operator()(const rigid2d::Vector2D & pt, const rigid2d::Vector2D & goal) const
+    {
+      const double dx = std::fabs(pt.x - goal.x);
+      const double dy = std::fabs(pt.y - goal.y);
+
+      return std::max(dx, dy) + (std::sqrt(2.0) - 1.0) * std::min(dx, dy);
+    }
+  };
+
+  /// \brief No estimate, which turns A* into Dijkstra's algorithm
+  struct ZeroHeuristic
+  {
+    /// \brief Estimate the cost to goal
+    /// \returns 0
+    double operator()(const rigid2d::Vector2D &, const rigid2d::Vector2D &) const
+    {
+      return 0.0;
+    }
+  };
+
+  /// \brief An edge filter that allows every edge
+  struct AnyEdge
+  {
+    /// \brief Check if an edge can be used
+    /// \returns True
+    bool operator()(int, int) const
+    {
+      return true;
+    }
+  };
+
+  /// \brief The cost of moving between the cells of a grid, weighted by their occupancy. Cells with an occupancy value below the lethal
+  /// value can be crossed and unknown cells (negative values) can not. An edge costs its weight times 1 + scale * occupancy / 100, using
+  /// the larger occupancy of its two cells, so with a positive scale a path keeps away from the buffer zone around the obstacles unless the
+  /// detour costs more. The cost is never below the weight, so the distance heuristics stay admissible. The defaults, a lethal value of 1
+  /// and no scale, only allow moves between free cells.
+  struct OccupancyCost
+  {
+    grid::OccupancyView occupancy; ///< the occupancy data, indexed by node ID
+    double scale = 0.0; ///< the extra cost of an edge next to a fully occupied cell, relative to its weight
+    signed char lethal = 1; ///< the smallest occupancy value that can not be crossed
+
+    /// \brief Create the edge cost
+    /// \param occ the occupancy data, indexed by node ID
+    /// \param occupancy_scale the extra cost of an edge next to a fully occupied cell, at least 0
+    /// \param lethal_value the smallest occupancy value that can not be crossed, between 1 and 101
+    OccupancyCost(grid::OccupancyView occ, double occupancy_scale = 0.0, signed char lethal_value = 1)
+      : occupancy(occ), scale(occupancy_scale), lethal(lethal_value) {}
+
+    /// \brief Check if the edge between two cells can be used
+    /// \param a the row major index of the cell at one end
+    /// \param b the row major index of the cell at the other end
+    /// \returns True if both cells are known and below the lethal value
+    bool traversable(int a, int b) const
+    {
+      const signed char va = occupancy.at(a), vb = occupancy.at(b);
+
+      return std::min(va, vb) >= 0 && std::max(va, vb) < lethal;
+    }
+
+    /// \brief Find the cost of moving along a traversable edge
+    /// \param a the row major index of the cell at one end
+    /// \param b the row major index of the cell at the other end
+    /// \param w the weight of the edge
+    /// \returns the weight scaled by the occupancy of the cells
+    double weight(int a, int b, double w) const
+    {
+      return w * (1.0 + scale * std::max(occupancy.at(a), occupancy.at(b)) / 100.0);
+    }
+
+    /// \brief Find the cost of reaching sp through s
+    /// \param state the search state, with the cost of s
+    /// \param s the ID of the node being expanded
+    /// \param sp the ID of the neighbor being evaluated
+    /// \param w the weight of the edge from s to sp
+    /// \param g [out] the cost of the path to sp
+    /// \param parent [out] the parent of sp on the path
+    /// \returns False if the edge can not be used
+    template <typename Graph, typename State>
+    bool operator()(const Graph &, const State & state, int s, int sp, double w, double & g, int & parent) const
+    {
+      if(!traversable(s, sp)) return false;
+
+      g = state.g_val.at(s) + weight(s, sp, w);
+      parent = s;
+
+      return true;
+    }
+  };
+
+  /// \brief The cost of moving along an edge is its weight, the path 1 cost of A*
+  template <typename Filter = AnyEdge>
+  struct DistanceCost
+  {
+    Filter allowed; ///< the edges that can be used
+
+    /// \brief Create the edge cost
+    /// \param filter a callable taking the IDs of the two nodes of an edge, True if the edge can be used
+    DistanceCost(Filter filter = Filter()) : allowed(filter) {}
+
+    /// \brief Find the cost of reaching sp through s
+    /// \param state the search state, with the cost of s
+    /// \param s the ID of the node being expanded
+    /// \param sp the ID of the neighbor being evaluated
+    /// \param w the weight of the edge from s to sp
+    /// \param g [out] the cost of the path to sp
+    /// \param parent [out] the parent of sp on the path
+    /// \returns False if the edge can not be used
+    template <typename Graph, typename State>
+    bool operator()(const Graph &, const State & state, int s, int sp, double w, double & g, int & parent)
+    {
+      if(!allowed(s, sp)) return false;
+
+      g = state.g_val.at(s) + w;
+      parent = s;
+
+      return true;
+    }
+  };
+
+  /// \brief The any angle cost of Theta*, a neighbor is reached straight from the parent of the expanded node when the line between
+  /// them is free (path 2), otherwise along the edge (path 1)
+  template <typename LineOfSight>
+  struct AnyAngleCost
+  {
+    LineOfSight line_of_sight; ///< a callable taking the IDs of two nodes, True if the segment between them is free
+    bool check_edges = false; ///< true to also require line of sight along the edge for path 1
+
+    /// \brief Create the edge cost
+    /// \param los the line of sight check
+    /// \param check true to require line of sight along every edge
+    AnyAngleCost(LineOfSight los, bool check) : line_of_sight(los), check_edges(check) {}
+
+    /// \brief Find the cost of reaching sp through s or the parent of s
+    /// \param graph the graph being searched
+    /// \param state the search state, with the cost and parent of s
+    /// \param s the ID of the node being expanded
+    /// \param sp the ID of the neighbor being evaluated
+    /// \param w the weight of the edge from s to sp
+    /// \param g [out] the cost of the path to sp
+    /// \param parent [out] the parent of sp on the path
+    /// \returns False if the edge can not be used
+    template <typename Graph, typename State>
+    bool operator()(const Graph & graph, const State & state, int s, int sp, double w, double & g, int & parent)
+    {
+      // a grid graph or a lazy road map connects nodes that are not in sight, so only move along the edges that are free
+      if(check_edges && !line_of_sight(s, sp)) return false;
+
+      const int grandparent = state.parent.at(s);
+
+      if(grandparent != -1 && line_of_sight(grandparent, sp))
+      {
+        g = state.g_val.at(grandparent) + graph.point(grandparent).distance(graph.point(sp));
+        parent = grandparent;
+      }
+      else
+      {
+        g = state.g_val.at(s) + w;
+        parent = s;
+      }
+
+      return true;
+    }
+  };
+}
+
+#endif // SEARCH_CORE_INCLUDE_GUARD_HPP
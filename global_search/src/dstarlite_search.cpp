@@ -8,40 +8,83 @@
 ///     robot_radius (double) buffer radius to avoid collisions with the robot body
 ///     cell_size (double) scaling factor for the map
 ///     grid_res (double) scaling factor for the grid cell size
+///     build_threads (unsigned int) number of threads used to build the grid, 0 uses all cores
+///     map_cache_dir (std::string) directory of the binary map cache, empty to build the maps on every launch
 ///     r (std::vector<int>) color values
 ///     g (std::vector<int>) color values
 ///     b (std::vector<int>) color values
 ///     start std::vector<double> two double values representing the x,y of the start point
 ///     goal std::vector<double> two double values representing the x,y of the goal point
 ///     sensor_range (double) double value representing the range of a simulated sensor fixed to the center of the robot
+///     simulate_sensor (bool) reveal the obstacles within the sensor range of the robot as it moves, turn off to only plan on the costmap
+///     occupied_threshold (int) costmap values at or above the threshold are occupied, lower values are free
+///     unknown_occupied (bool) treat unknown costmap values (-1) as occupied, otherwise they are free and the path may cross unexplored space
+///     octile_heuristic (bool) estimate the cost to goal with the octile distance of the 8 connected grid instead of the Euclidean distance
+///     anytime_epsilons (std::vector<double>) decreasing heuristic weights of the anytime search, [1.0] only finds the shortest path
+///     planning_budget (double) seconds each planning step may search before the best path so far is used, 0 for no limit
 /// PUBLISHES:
 ///     /visualization_marker_array (visualization_msgs::MarkerArray) markers
-///     /grid_map (nav_msgs::OccupancyGrid) occupancy data
-
+///     /grip_map (nav_msgs::OccupancyGrid) occupancy data, sent again when a subscriber connects
+///     /grip_map_updates (map_msgs::OccupancyGridUpdate) the rectangle of occupancy data that changed
+///     /planned_path (nav_msgs::Path) the current path from the robot to the goal
+///     /diagnostics (diagnostic_msgs::DiagnosticArray) statistics of the grid build and the searches so far
+/// SUBSCRIBES:
+///     /costmap (nav_msgs::OccupancyGrid) occupancy data to plan on, with the resolution of the grid
+///     /costmap_updates (map_msgs::OccupancyGridUpdate) rectangular updates of the costmap
+
+#include <string>
 #include <vector>
 #include <algorithm>
 #include <XmlRpcValue.h>
 
 #include <ros/ros.h>
 
+#include "diagnostic_msgs/DiagnosticArray.h"
 #include "geometry_msgs/Point.h"
+#include "map_msgs/OccupancyGridUpdate.h"
+#include "nav_msgs/OccupancyGrid.h"
 #include "visualization_msgs/MarkerArray.h"
 #include "visualization_msgs/Marker.h"
 
 #include "global_search/heuristic_search.hpp"
+#include "global_search/planning_thread.hpp"
 #include "rigid2d/rigid2d.hpp"
+#include "roadmap/marker_tracker.hpp"
 #include "roadmap/prm.hpp"
 #include "roadmap/utility.hpp"
 
+static nav_msgs::OccupancyGrid::ConstPtr costmap; ///< the newest costmap, null once it has been passed to the planner
+static std::vector<map_msgs::OccupancyGridUpdate::ConstPtr> costmap_updates; ///< costmap updates waiting for the planner
+
+/// \brief Save a new costmap, which replaces any updates that have not been passed to the planner
+/// \param msg the costmap
+static void callback_costmap(const nav_msgs::OccupancyGrid::ConstPtr & msg)
+{
+  costmap = msg;
+  costmap_updates.clear();
+}
+
+/// \brief Save a costmap update
+/// \param msg the update
+static void callback_costmap_update(const map_msgs::OccupancyGridUpdate::ConstPtr & msg)
+{
+  costmap_updates.push_back(msg);
+}
+
 int main(int argc, char** argv)
 {
   ros::init(argc, argv, "dstarlite_search");
   ros::NodeHandle n;
 
   ros::Publisher pub_map = n.advertise<nav_msgs::OccupancyGrid>("grip_map", 2);
+  ros::Publisher pub_map_updates = n.advertise<map_msgs::OccupancyGridUpdate>("grip_map_updates", 2);
   ros::Publisher pub_markers = n.advertise<visualization_msgs::MarkerArray>("visualization_marker_array", 2);
+  ros::Publisher pub_path = n.advertise<nav_msgs::Path>("planned_path", 2);
+  ros::Publisher pub_diagnostics = n.advertise<diagnostic_msgs::DiagnosticArray>("diagnostics", 2);
+
+  ros::Subscriber costmap_sub = n.subscribe("costmap", 1, callback_costmap);
+  ros::Subscriber costmap_update_sub = n.subscribe("costmap_updates", 10, callback_costmap_update);
 
-  std::vector<visualization_msgs::Marker> markers;
   visualization_msgs::MarkerArray pub_marks;
 
   std::vector<double> map_x_lims, map_y_lims;
@@ -49,9 +92,17 @@ int main(int argc, char** argv)
   XmlRpc::XmlRpcValue obstacles;
   double robot_radius = 0.0;
   int grid_res = 1;
+  int build_threads = 1;
+  std::string map_cache_dir;
   std::vector<double> r, g, b;
   double cell_size = 1.0;
   double sensor_range = cell_size*3;
+  bool simulate_sensor = true;
+  int occupied_threshold = 50;
+  bool unknown_occupied = false;
+  bool octile_heuristic = false;
+  std::vector<double> anytime_epsilons = {1.0};
+  double planning_budget = 0.0;
 
   n.getParam("obstacles", obstacles);
   n.getParam("map_x_lims", map_x_lims);
@@ -59,6 +110,8 @@ int main(int argc, char** argv)
   n.getParam("robot_radius", robot_radius);
   n.getParam("cell_size", cell_size);
   n.getParam("grid_res", grid_res);
+  n.getParam("build_threads", build_threads);
+  n.getParam("map_cache_dir", map_cache_dir);
   n.getParam("r", r);
   n.getParam("g", g);
   n.getParam("b", b);
@@ -66,6 +119,12 @@ int main(int argc, char** argv)
   n.getParam("start", start);
   n.getParam("goal", goal);
   n.getParam("sensor_range", sensor_range);
+  n.getParam("simulate_sensor", simulate_sensor);
+  n.getParam("occupied_threshold", occupied_threshold);
+  n.getParam("unknown_occupied", unknown_occupied);
+  n.getParam("octile_heuristic", octile_heuristic);
+  n.getParam("anytime_epsilons", anytime_epsilons);
+  n.getParam("planning_budget", planning_budget);
 
   std::vector<std::vector<double>> colors;
 
@@ -103,15 +162,16 @@ int main(int argc, char** argv)
 
   // Initialize Grid that represents the fully known map
   grid::Grid grid_world(polygons, map_x_lims, map_y_lims);
-  grid_world.build_grid(cell_size, grid_res, robot_radius);
-  grid_world.generate_centers_graph();
+
+  if(utility::load_or_build(grid_world, map_cache_dir, cell_size, grid_res, robot_radius, build_threads))
+  {
+    ROS_INFO_STREAM("GDSRCH: Loaded the grid from the map cache in " << map_cache_dir);
+  }
 
   // Initialize an empty grid of free cells
   grid::Grid free_grid(map_x_lims, map_y_lims);
-  free_grid.build_grid(cell_size, grid_res, robot_radius);
-  free_grid.generate_centers_graph();
+  free_grid.build_grid(cell_size, grid_res, robot_radius, build_threads);
 
-  auto grid_graph = free_grid.get_nodes();
   auto grid_dims = free_grid.get_grid_dimensions();
 
   // convert start/goal to vector2D
@@ -140,178 +200,218 @@ int main(int argc, char** argv)
   }
 
   // Initialize the search on the empty map
-  hsearch::DStarLite dsl_search(&grid_graph, &free_grid, start_pt, goal_pt);
+  hsearch::DStarLite dsl_search(&free_grid, start_pt, goal_pt);
+
+  if(octile_heuristic) dsl_search.set_heuristic(hsearch::Octile);
+
+  dsl_search.set_schedule(anytime_epsilons);
+  dsl_search.set_time_budget(planning_budget);
+
+  // The planning thread owns the search and free_grid from here on, so keep a copy of the grid to draw
+  grid::Grid display_grid = free_grid;
+  hsearch::PlanningThread planner(dsl_search);
+
+  // Only the markers that changed since the last frame are published
+  utility::MarkerTracker tracker;
+  unsigned int marker_subscribers = 0;
 
-  // Buffer variables to save all the markers to detele/update
-  std::vector<visualization_msgs::Marker> path_markers;
-  visualization_msgs::Marker exp_nodes;
+  prm::Node start_node, goal_node;
 
-  auto start_node = free_grid.get_nodes().at(start_pt.y).at(start_pt.x);
-  auto goal_node = free_grid.get_nodes().at(goal_pt.y).at(goal_pt.x);
+  start_node.id = start_pt.y * grid_dims.at(0) + start_pt.x;
+  start_node.point = display_grid.grid_to_world(start_pt);
+
+  goal_node.id = goal_pt.y * grid_dims.at(0) + goal_pt.x;
+  goal_node.point = display_grid.grid_to_world(goal_pt);
 
   rigid2d::Vector2D robot_pos = start_node.point; // set the robot position with the corrrect world coordinates
 
   ros::Rate frames(2);
 
-  bool new_info = true;
-
-  auto known_occ = grid_world.get_grid();
+  const auto known_occ = grid_world.get_occupancy();
 
   frames.sleep(); // short pause to give rviz to load
 
-  auto occ_msg = utility::make_grid_msg(&free_grid, cell_size, grid_res);
+  // The map message is patched in place as the grid changes, and only the changed rectangle is published
+  auto occ_msg = utility::make_grid_msg(&display_grid, cell_size, grid_res);
+  map_msgs::OccupancyGridUpdate occ_update;
+  unsigned int map_subscribers = pub_map.getNumSubscribers();
+
   pub_map.publish(occ_msg);
 
+  planner.start();
 
   std::vector<rigid2d::Vector2D> traversed_path;
   std::vector<rigid2d::Vector2D> dsl_path;
   std::vector<rigid2d::Vector2D> dsl_expands;
 
+  hsearch::Plan plan;
+  unsigned long long plan_revision = 0; // the number of sensor updates the current path accounts for
+
+  hsearch::MapDelta pending_update; // map updates waiting for room in the planning queue
+  bool update_pending = false;
+
+  grid::OccupancyPatch costmap_patch; // the costmap in grid coordinates, which the costmap updates are relative to
+  bool have_costmap = false;
+
   traversed_path.push_back(robot_pos);
 
   // Start loop
   while(ros::ok())
   {
-    // std::cout << i << "\tNew Info?: " << new_info << "\n";
-
-    // If there is new map information, update the path as needed
-    if(new_info)
+    // If the planning thread has published a new plan, update the path as needed
+    if(planner.try_get_plan(plan))
     {
-      // Plan path
-      bool dsl_res = dsl_search.ComputeShortestPath();
-      ROS_INFO_STREAM("GDSRCH: Search Complete!\n");
+      plan_revision = plan.revision;
 
-      // Check for failure
-      if(!dsl_res)
+      if(plan.replanned)
       {
-        ROS_FATAL_STREAM("GDSRCH: D* Lite Search failed to find a path for the current map configuration.\n");
-      }
+        ROS_INFO_STREAM("GDSRCH: Search Complete!\n");
 
-      // retrieve results
-      dsl_path = dsl_search.get_path();
-      dsl_expands = dsl_search.get_expanded_nodes();
+        // Check for failure
+        if(!plan.found)
+        {
+          ROS_FATAL_STREAM("GDSRCH: D* Lite Search failed to find a path for the current map configuration.\n");
+        }
 
-      ROS_INFO_STREAM("DSLSRCH: D* Lite Path has " << dsl_path.size() << " nodes.");
+        // retrieve results
+        dsl_path = plan.path;
+        dsl_expands = plan.expanded_nodes;
 
-      // Draw Expanded Nodes
-      exp_nodes = utility::make_marker(dsl_expands, cell_size/grid_res, colors.at(2));
-      markers.push_back(exp_nodes);
+        ROS_INFO_STREAM("DSLSRCH: D* Lite Path has " << dsl_path.size() << " nodes.");
 
-      std::reverse(dsl_path.begin(), dsl_path.end());
+        // Draw Expanded Nodes, until the next frame
+        tracker.draw(utility::make_marker(dsl_expands, cell_size/grid_res, colors.at(2)));
 
-      if(dsl_path.back() != robot_pos)
-      {
-        ROS_FATAL_STREAM("The robot has teleported between path searches!");
-        robot_pos = dsl_path.back();
+        std::reverse(dsl_path.begin(), dsl_path.end());
+
+        if(!dsl_path.empty() && dsl_path.back() != robot_pos)
+        {
+          ROS_FATAL_STREAM("The robot has teleported between path searches!");
+          robot_pos = dsl_path.back();
+        }
       }
     }
 
-    new_info = false;
-
     // VIZUALIZE THE RESULTS
 
     // Draw the robot
-    markers.push_back(utility::make_marker(robot_pos, cell_size*2, std::vector<double>({0, 0, 1})));
+    tracker.draw(utility::make_marker(robot_pos, cell_size*2, std::vector<double>({0, 0, 1})));
 
     // Draw Start and Goal
-    markers.push_back(utility::make_marker(start_node, cell_size*2, std::vector<double>({0, 1, 0})));
-    markers.push_back(utility::make_marker(goal_node, cell_size*2, std::vector<double>({1, 0, 0})));
+    tracker.draw(utility::make_marker(start_node, cell_size*2, std::vector<double>({0, 1, 0})));
+    tracker.draw(utility::make_marker(goal_node, cell_size*2, std::vector<double>({1, 0, 0})));
 
-    // Draw D* Lite path
-    for(auto it = dsl_path.begin(); it < dsl_path.end()-1; it++)
-    {
-      visualization_msgs::Marker buf = utility::make_marker(*it, *(it+1), it-dsl_path.begin(), cell_size, colors.at(4));
-      path_markers.push_back(buf);
-      markers.push_back(buf);
-    }
+    // Draw D* Lite path, there is none until the planning thread publishes the first plan
+    tracker.draw(utility::make_path_marker(dsl_path, 0, cell_size, colors.at(4)));
 
     // Draw the path that has been traversed by the robot
+    if(traversed_path.back() != robot_pos) traversed_path.push_back(robot_pos);
+    tracker.draw(utility::make_path_marker(traversed_path, 0, cell_size, std::vector<double>({0, 0, 0}), "Trav"));
+
+    // A new subscriber has not seen the markers that did not change, so send them all again
+    if(pub_markers.getNumSubscribers() > marker_subscribers) tracker.reset();
+    marker_subscribers = pub_markers.getNumSubscribers();
+
+    if(tracker.flush(pub_marks)) pub_markers.publish(pub_marks);
+
+    // vizualize map, a new subscriber needs the whole map before it can apply the updates
+    if(utility::update_grid_msg(display_grid, occ_msg, occ_update)) pub_map_updates.publish(occ_update);
+
+    if(pub_map.getNumSubscribers() > map_subscribers) pub_map.publish(occ_msg);
+    map_subscribers = pub_map.getNumSubscribers();
+
+    // the path is stored from the goal back to the robot
+    pub_path.publish(utility::make_path_msg(std::vector<rigid2d::Vector2D>(dsl_path.rbegin(), dsl_path.rend())));
+
+    // publish the planner statistics
+    diagnostic_msgs::DiagnosticArray diagnostics;
+    diagnostics.header.stamp = ros::Time::now();
+    diagnostics.status.push_back(utility::make_diagnostic_msg("dstarlite_search: grid", grid_world.get_stats()));
+    diagnostics.status.push_back(utility::make_diagnostic_msg("dstarlite_search: D* Lite", plan.search_stats));
+    pub_diagnostics.publish(diagnostics);
 
-    ROS_INFO_STREAM(traversed_path.size());
-    traversed_path.push_back(robot_pos);
-    if(traversed_path.size() > 1)
+    ros::spinOnce();
+
+    // sleep til next loop
+    frames.sleep();
+
+    // Pass the costmap and its updates to the planning thread
+    if(costmap)
     {
-      for(auto it = traversed_path.begin(); it < traversed_path.end()-1; it++)
+      if(utility::make_patch(*costmap, display_grid, costmap_patch, occupied_threshold, unknown_occupied))
       {
-        int ns_id = (it-traversed_path.begin());
+        have_costmap = true;
 
-        visualization_msgs::Marker buf = utility::make_marker(*it, *(it+1), ns_id, cell_size, std::vector<double>({0, 0, 0}), "Trav");
-        path_markers.push_back(buf);
-        markers.push_back(buf);
+        display_grid.update_patch(costmap_patch);
+        pending_update.patches.push_back(costmap_patch);
+        update_pending = true;
       }
+      else ROS_WARN_STREAM("GDSRCH: The costmap resolution does not match the grid resolution of " << display_grid.get_resolution());
+
+      costmap.reset();
     }
 
-    // clear expanded nodes if needed
-    if(dsl_expands.empty())
+    for(const auto & update : costmap_updates)
     {
-      exp_nodes.action = visualization_msgs::Marker::DELETE;
-      markers.push_back(exp_nodes);
-    }
+      if(!have_costmap) break;
 
-    pub_marks.markers = markers;
-    pub_markers.publish(pub_marks);
+      auto patch = utility::make_patch(*update, costmap_patch.x, costmap_patch.y, occupied_threshold, unknown_occupied);
 
-    // vizualize map
-    auto occ_msg = utility::make_grid_msg(&free_grid, cell_size, grid_res);
-    pub_map.publish(occ_msg);
+      display_grid.update_patch(patch);
+      pending_update.patches.push_back(std::move(patch));
+      update_pending = true;
+    }
 
-    ros::spinOnce();
+    costmap_updates.clear();
 
-    // sleep til next loop
-    frames.sleep();
+    // Hand the planning thread the map updates that did not fit in the queue last time
+    if(update_pending && planner.submit(std::move(pending_update)))
+    {
+      pending_update = hsearch::MapDelta();
+      update_pending = false;
+    }
 
-    // If the robot has not reached the goal yet, move and update the map
-    if(dsl_path.size() > 1)
+    // Only move along a path that accounts for every map update, the loop keeps drawing while the planner catches up
+    if(!update_pending && plan_revision == planner.get_submitted() && dsl_path.size() > 1)
     {
-      // traversed_path.push_back(robot_pos);
       dsl_path.pop_back();
       robot_pos = dsl_path.back();
 
-      // Check for map updates -- Update based on the sensor range param
-      std::vector<std::pair<rigid2d::Vector2D, signed char>> map_update;
+      hsearch::MapDelta map_update;
 
-      rigid2d::Vector2D robot_grid = free_grid.world_to_grid(robot_pos);
+      rigid2d::Vector2D robot_grid = display_grid.world_to_grid(robot_pos);
 
-      // Simulate a sensor by extracting information from the known grid
-      for(int j = -sensor_range_grid; j < sensor_range_grid; j++)
+      map_update.move_robot = true;
+      map_update.robot_loc = robot_grid;
+
+      // Simulate a sensor by copying the window of the known grid within the sensor range
+      if(simulate_sensor)
       {
-        int yi = robot_grid.y+j;
+        const int x_lo = std::max(static_cast<int>(robot_grid.x) - sensor_range_grid, 0);
+        const int x_hi = std::min(static_cast<int>(robot_grid.x) + sensor_range_grid, grid_dims.at(0));
+        const int y_lo = std::max(static_cast<int>(robot_grid.y) - sensor_range_grid, 0);
+        const int y_hi = std::min(static_cast<int>(robot_grid.y) + sensor_range_grid, grid_dims.at(1));
 
-        if(yi < 0 || yi >= grid_dims.at(1)) continue;
+        grid::OccupancyPatch sensed(x_lo, y_lo, x_hi - x_lo, y_hi - y_lo);
 
-        for(int k = -sensor_range_grid; k < sensor_range_grid; k++)
+        for(int yi = y_lo; yi < y_hi; yi++)
         {
+          const signed char * row = known_occ.data + known_occ.id(x_lo, yi);
+          std::copy(row, row + sensed.width, sensed.data.begin() + (yi - y_lo) * sensed.width);
+        }
 
-          int xi = robot_grid.x+k;
-          if(xi < 0 || xi >= grid_dims.at(0)) continue;
+        ROS_INFO_STREAM("Updating " << sensed.data.size() << " Cells.");
 
-          map_update.push_back(std::make_pair(rigid2d::Vector2D(xi, yi), known_occ.at(yi).at(xi)));
-        }
+        display_grid.update_patch(sensed);
+        map_update.patches.push_back(std::move(sensed));
       }
 
-      ROS_INFO_STREAM("Updating " << map_update.size() << " Cells.");
-
-      // Inform LPA* of the "sensor" readings and update all of the effected verticies
-      if(!map_update.empty())
+      // Inform D* Lite of the new robot location and the "sensor" readings, the planning thread updates all of the effected verticies
+      if(!planner.submit(std::move(map_update)))
       {
-        dsl_search.UpdateRobotLoc(robot_grid);
-        new_info = dsl_search.MapChange(map_update);
+        pending_update = std::move(map_update);
+        update_pending = true;
       }
     }
-
-    // Reset the paths
-    markers.clear();
-    for(auto & marker : path_markers)
-    {
-      marker.action = visualization_msgs::Marker::DELETE;
-      markers.push_back(marker);
-    }
-
-    pub_marks.markers = markers;
-    pub_markers.publish(pub_marks);
-
-    markers.clear();
-    dsl_expands.clear();
-    path_markers.clear();
   }
 }
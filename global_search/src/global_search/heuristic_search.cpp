@@ -2,9 +2,9 @@
 /// \brief A library containing classes to perform various types of search algorithms
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <iostream>
-#include <memory>
 #include <numeric>
 #include <unordered_map>
 #include <vector>
@@ -12,8 +12,11 @@
 #include "global_search/heuristic_search.hpp"
 #include "rigid2d/rigid2d.hpp"
 #include "roadmap/collision.hpp"
+#include "roadmap/collision_world.hpp"
+#include "roadmap/graph.hpp"
 #include "roadmap/prm.hpp"
 #include "roadmap/grid.hpp"
+#include "roadmap/stats.hpp"
 
 namespace hsearch
 {
@@ -30,178 +33,281 @@ namespace hsearch
     else return k1 > rhs.k1;
   }
 
-  SearchNode::SearchNode(const prm::Node & n)
+  std::ostream & operator<<(std::ostream & os, const Key & k)
   {
-    node_p = std::make_shared<prm::Node>(n);
+    os << "Key: " << k.k1 << ", " << k.k2 << std::endl;
+    return os;
   }
 
-  void SearchNode::CalcKey(double km)
+  /// \brief The x step of each of the 8 directions on a grid, starting at +x and turning counter-clockwise in 45 degree steps.
+  /// The even directions are horizontal or vertical and the odd directions are diagonal.
+  static constexpr int dir_x[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+
+  /// \brief The y step of each of the 8 directions on a grid
+  static constexpr int dir_y[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+
+  /// \brief The number of expansions between two reads of the clock by an anytime search with a time budget
+  static constexpr int clock_interval = 64;
+
+  /// \brief Get the time an anytime search has to stop
+  /// \param seconds the time budget, 0 for no limit
+  /// \returns the deadline
+  static std::chrono::steady_clock::time_point make_deadline(double seconds)
   {
-    auto buf = std::min(g_val, rhs_val);
-    key_val.k1 = buf + h_val + km;
-    key_val.k2 = buf;
+    if(seconds <= 0) return std::chrono::steady_clock::time_point::max();
+
+    const auto budget = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+
+    return std::chrono::steady_clock::now() + budget;
   }
 
-  bool SearchNode::operator>(const SearchNode &rhs) const
+  /// \brief Get the direction of a step between two neighboring cells
+  /// \param dx the x step, -1, 0 or 1
+  /// \param dy the y step, -1, 0 or 1
+  /// \returns the index of the direction in dir_x and dir_y
+  static int direction(int dx, int dy)
   {
-    if(rigid2d::almost_equal(key_val.k1, rhs.key_val.k1)) return key_val.k2 > rhs.key_val.k2;
-    else return key_val.k1 > rhs.key_val.k1;
+    for(int dir = 0; dir < 8; dir++)
+    {
+      if(dir_x[dir] == dx && dir_y[dir] == dy) return dir;
+    }
+
+    return 0;
   }
 
-  bool SearchNode::operator<(const SearchNode &rhs) const
+  // =========================== SearchState ===================================
+
+  void SearchState::reset(int n)
   {
-    if(rigid2d::almost_equal(key_val.k1, rhs.key_val.k1)) return key_val.k2 < rhs.key_val.k2;
-    else return key_val.k1 < rhs.key_val.k1;
+    // assign only allocates when the graph has grown since the last search
+    g_val.assign(n, BIG_NUM);
+    h_val.assign(n, BIG_NUM);
+    rhs_val.assign(n, BIG_NUM);
+    key_val.assign(n, Key());
+    parent.assign(n, -1);
+    state.assign(n, New);
   }
 
-  std::ostream & operator<<(std::ostream & os, const Key & k)
+  int SearchState::size() const
   {
-    os << "Key: " << k.k1 << ", " << k.k2 << std::endl;
-    return os;
+    return g_val.size();
   }
 
-  std::ostream & operator<<(std::ostream & os, const SearchNode & n)
+  void SearchState::CalcKey(int id, double km)
   {
+    auto buf = std::min(g_val.at(id), rhs_val.at(id));
+    key_val.at(id).k1 = buf + h_val.at(id) + km;
+    key_val.at(id).k2 = buf;
+  }
 
-    if(n.parent_p != nullptr) os << "Node ID: " << n.node_p->id << "\n\tPoint: " << n.node_p->point.x << ", " << n.node_p->point.y << "\n\t" << "G Val: " << n.g_val << "\n\t" << "RHS Val: " << n.rhs_val <<  "\n\t" << "Parent ID: " << n.parent_p->id << std::endl;
-    else os << "Node ID: " << n.node_p->id << "\n\tPoint: " << n.node_p->point.x << ", " << n.node_p->point.y << "\n\t" << "G Val: " << n.g_val << "\n\t" << "RHS Val: " << n.rhs_val << std::endl;
+  // =========================== IndexedHeap ===================================
 
-    return os;
+  void IndexedHeap::reset(int n)
+  {
+    heap.clear();
+    pos.assign(n, -1);
   }
 
-  // =========================== HSearch =======================================
-
-  HSearch::HSearch(std::vector<prm::Node>* node_list)
+  bool IndexedHeap::empty() const
   {
-    created_graph_p = node_list;
+    return heap.empty();
   }
 
-  bool HSearch::ComputeShortestPath(const prm::Node & s_start, const prm::Node & s_goal)
+  int IndexedHeap::size() const
   {
+    return heap.size();
+  }
 
-    goal_loc = s_goal.point;
+  bool IndexedHeap::contains(int id) const
+  {
+    return pos.at(id) != -1;
+  }
 
-    // Initialize the start node
-    start = SearchNode(s_start);
+  int IndexedHeap::top() const
+  {
+    return heap.front().id;
+  }
 
-    start.search_id = 0;
+  Key IndexedHeap::top_key() const
+  {
+    return heap.front().key;
+  }
 
-    start.state = Open;
-    start.g_val = 0;
-    start.h_val = h(start);
-    start.CalcKey();
+  int IndexedHeap::pop()
+  {
+    const int id = heap.front().id;
+    remove(id);
+    return id;
+  }
 
-    start.parent_p = nullptr;
+  void IndexedHeap::push(int id, const Key & k)
+  {
+    STATS_ADD(pushes, 1);
 
-    open_list.push_back(start);
-    std::make_heap(open_list.begin(), open_list.end(), std::greater<>{});
+    const int i = pos.at(id);
 
-    while(open_list.size() != 0)
+    if(i == -1) // add the new node to the bottom of the heap
+    {
+      heap.push_back({k, id});
+      pos.at(id) = heap.size() - 1;
+      sift_up(heap.size() - 1);
+    }
+    else // the node is already in the heap, move it based on the new key
     {
-      if(!std::is_heap(open_list.begin(), open_list.end(), std::greater<>{}))  std::make_heap(open_list.begin(), open_list.end(), std::greater<>{});
+      const bool decreased = k < heap.at(i).key;
+      heap.at(i).key = k;
 
-      // std::cout << "open_list size: " << open_list.size() << std::endl;
-      // Get the node with the minimum total cost
-      std::pop_heap(open_list.begin(), open_list.end(), std::greater<>{});
-      auto cur_s = open_list.back();
-      open_list.pop_back();
+      if(decreased) sift_up(i);
+      else sift_down(i);
+    }
+  }
 
-      // std::cout << "Current Node Cost: " << cur_s.f_val << std::endl;
-      // std::cout << "End Node Cost: " << open_list.back().f_val << std::endl;
-      // std::cout << "Current Node: " << cur_s.node_p->point << "\n";
+  void IndexedHeap::remove(int id)
+  {
+    const int i = pos.at(id);
+    if(i == -1) return;
 
-      // check if cur_s is the goal
-      if (cur_s.node_p->point == goal_loc)
-      {
-          assemble_path(cur_s);
-          return true;
-      }
+    STATS_ADD(pops, 1);
 
-      // Add current node to the closed list
-      closed_list.push_back(cur_s);
-      cur_s.state = Closed;
+    pos.at(id) = -1;
 
-      // Expand the search to the neighbors of the current node
-      for(auto node_id : cur_s.node_p->id_set)
-      {
+    // fill the hole with the last element and restore the heap property
+    const Entry last = heap.back();
+    heap.pop_back();
 
-        // std::cout << "s' ID: " << node_id << "\n";
+    if(i < static_cast<int>(heap.size()))
+    {
+      place(i, last);
+      if(i > 0 && last.key < heap.at((i - 1)/2).key) sift_up(i);
+      else sift_down(i);
+    }
+  }
 
-        auto result = std::find_if(closed_list.begin(), closed_list.end(), [node_id](SearchNode n) {return n.node_p->id == node_id;});
+  unsigned long long IndexedHeap::get_push_count() const
+  {
+    return pushes;
+  }
 
-        // std::cout << "On closed list? " << result - closed_list.begin() << "\n";
+  unsigned long long IndexedHeap::get_pop_count() const
+  {
+    return pops;
+  }
 
-        // Check if the node is not on the closed list and try to update/create it
-        if(result == closed_list.end())
-        {
+  void IndexedHeap::reset_counts()
+  {
+    pushes = 0;
+    pops = 0;
+  }
 
-          result = std::find_if(open_list.begin(), open_list.end(), [node_id](SearchNode n) {return n.node_p->id == node_id;});
+  void IndexedHeap::sift_up(int i)
+  {
+    const Entry e = heap.at(i);
 
-          // std::cout << "On open list? " << result - open_list.begin() << "\n";
+    while(i > 0)
+    {
+      const int parent = (i - 1)/2;
+      if(!(e.key < heap.at(parent).key)) break;
 
-          SearchNode neighbor;
+      place(i, heap.at(parent));
+      i = parent;
+    }
 
-          // check if the node is not on the open list and create it
-          if(result == open_list.end())
-          {
-            SearchNode buf(created_graph_p->at(node_id));
-            buf.search_id = id_cnt;
-            id_cnt++;
-            neighbor = buf;
-          }
-          else // otherwise use the
-          {
-            neighbor = *result;
-          }
+    place(i, e);
+  }
 
-          // calculate the cost and update the cost/parent if needed
-          ComputeCost(cur_s, neighbor);
+  void IndexedHeap::sift_down(int i)
+  {
+    const Entry e = heap.at(i);
+    const int n = heap.size();
 
-          if (neighbor.state == New) // add node to the heap
-          {
-            neighbor.state = Open;
-            open_list.push_back(neighbor);
-          }
-          else // update the node already in the heap
-          {
-            open_list.at(std::distance(open_list.begin(),result)) = neighbor;
-          }
-          // std::cout << neighbor;
-        }
-        // Update the heap order
-        push_heap(open_list.begin(), open_list.end(), std::greater<>{});
-      }
+    while(2*i + 1 < n)
+    {
+      // pick the smaller child
+      int child = 2*i + 1;
+      if(child + 1 < n && heap.at(child + 1).key < heap.at(child).key) child++;
+
+      if(!(heap.at(child).key < e.key)) break;
+
+      place(i, heap.at(child));
+      i = child;
     }
-    return false;
+
+    place(i, e);
   }
 
-  void HSearch::assemble_path(SearchNode goal)
+  void IndexedHeap::place(int i, const Entry & e)
   {
-    // add the goal to the path
-    final_path.push_back(goal.node_p->point);
+    heap.at(i) = e;
+    pos.at(e.id) = i;
+  }
 
-    auto cur_node = goal;
+  // =========================== HSearch =======================================
 
-    // follow the parent points back to the starting node and store each location
-    while (cur_node.parent_p != nullptr)
-    {
-      final_path.push_back(cur_node.parent_p->point);
+  HSearch::HSearch(const graph::CSRGraph* graph_p)
+  {
+    created_graph_p = graph_p;
+  }
 
-      auto next_id = cur_node.parent_p->id;
+  bool HSearch::ComputeShortestPath(const prm::Node & s_start, const prm::Node & s_goal)
+  {
+    return ComputeShortestPath(s_start.id, s_goal.id);
+  }
 
-      // search for the parent on the closed list
-      auto result = std::find_if(closed_list.begin(), closed_list.end(), [next_id](SearchNode n) {return n.node_p->id == next_id;});
+  bool HSearch::ComputeShortestPath(const graph::QueryGraph & query, int s_start, int s_goal)
+  {
+    query_graph_p = &query;
 
-      if(result != closed_list.end())
-      {
-        cur_node = *result;
-      }
-      else
-      {
-        // search for the parent on the open list
-        result = std::find_if(open_list.begin(), open_list.end(), [next_id](SearchNode n) {return n.node_p->id == next_id;});
-        cur_node = *result;
-      }
+    const bool result = ComputeShortestPath(s_start, s_goal);
+
+    query_graph_p = nullptr;
+
+    return result;
+  }
+
+  bool HSearch::ComputeShortestPath(int s_start, int s_goal)
+  {
+    DistanceCost<> cost;
+
+    return specialized_search(s_start, s_goal, cost);
+  }
+
+  void HSearch::begin_search(int s_start, int s_goal)
+  {
+    goal_loc = graph_point(s_goal);
+
+    start_id = s_start;
+    goal_id = s_goal;
+
+    final_path.clear();
+    expanded_nodes.clear();
+    expansions = 0;
+
+    // Reset the search state of every node in the graph
+    search_state.reset(graph_size());
+    open_list.reset(graph_size());
+
+    // Initialize the start node
+    search_state.state.at(start_id) = Open;
+    search_state.g_val.at(start_id) = 0;
+    search_state.h_val.at(start_id) = h(graph_point(start_id));
+    search_state.CalcKey(start_id);
+
+    open_list.push(start_id, search_state.key_val.at(start_id));
+  }
+
+  void HSearch::assemble_path(int goal)
+  {
+    // add the goal to the path
+    final_path.push_back(graph_point(goal));
+
+    int cur_id = goal;
+
+    // follow the parent IDs back to the starting node and store each location
+    while (search_state.parent.at(cur_id) != -1)
+    {
+      cur_id = search_state.parent.at(cur_id);
+
+      final_path.push_back(graph_point(cur_id));
     }
   }
 
@@ -215,465 +321,1003 @@ namespace hsearch
     return expanded_nodes;
   }
 
-  std::vector<double> HSearch::f(SearchNode s, SearchNode sp)
+  int HSearch::get_expansion_count() const
   {
-    double buf_h = h(sp);
-    double buf_g = g(s, sp);
-    double buf_f = buf_g + buf_h;
+    return expansions;
+  }
+
+  stats::Stats HSearch::get_stats() const
+  {
+    stats::Stats output = search_stats;
+
+    output.heap_pushes = open_list.get_push_count();
+    output.heap_pops = open_list.get_pop_count();
 
-    return {buf_f, buf_g, buf_h};
+    return output;
   }
 
-  double HSearch::g(SearchNode s, SearchNode sp)
+  void HSearch::reset_stats()
   {
-    return (s.g_val + sp.node_p->point.distance(s.node_p->point));
+    search_stats.reset();
+    open_list.reset_counts();
   }
 
-  double HSearch::h(SearchNode sp)
+  int HSearch::graph_size() const
   {
-    rigid2d::Vector2D pt1 = sp.node_p->point;
+    return query_graph_p ? query_graph_p->size() : created_graph_p->size();
+  }
 
-    return pt1.distance(goal_loc);
+  rigid2d::Vector2D HSearch::graph_point(int id) const
+  {
+    return query_graph_p ? query_graph_p->point(id) : created_graph_p->point(id);
   }
 
-  // =========================== A* ============================================
+  void HSearch::set_heuristic(heuristic type)
+  {
+    h_type = type;
+  }
 
-  void AStar::ComputeCost(SearchNode &s, SearchNode &sp)
+  void HSearch::set_schedule(const std::vector<double> & weights)
   {
-    auto cost = f(s, sp);
-    // If the path from s to s' is cheaper than the existing one, update it.
-    if(cost.at(0) < sp.key_val.k1)
-    {
-      sp.g_val = cost.at(1);
-      sp.h_val = cost.at(2);
+    if(weights.empty()) return;
 
-      sp.CalcKey(); // update the key values
+    epsilons.clear();
 
-      sp.parent_p = s.node_p;
-    }
+    // a weight below 1 would stop the search before the path is found
+    for(const double w : weights) epsilons.push_back(std::max(w, 1.0));
   }
 
-  // =========================== Theta* ========================================
+  void HSearch::set_time_budget(double seconds)
+  {
+    time_budget = seconds;
+  }
 
-  ThetaStar::ThetaStar(std::vector<prm::Node> * node_list, grid::Map map, double buffer) : HSearch(node_list)
+  double HSearch::get_epsilon() const
   {
-    known_map = map;
-    buffer_radius = buffer;
+    return path_epsilon;
+  }
+
+  double HSearch::h(const rigid2d::Vector2D & pt) const
+  {
+    return visit_heuristic([&](const auto & heuristic){ return heuristic(pt, goal_loc); });
+  }
+
+  // =========================== Lazy A* =======================================
+
+  LazyAStar::LazyAStar(const graph::CSRGraph * graph_p, grid::Map map, double buffer) : AStar(graph_p)
+  {
+    obstacle_world = collision::CollisionWorld(map.obstacles, buffer);
   }
 
-  void ThetaStar::ComputeCost(SearchNode &s, SearchNode &sp)
+  bool LazyAStar::ComputeShortestPath(int s_start, int s_goal)
   {
-    std::vector<double> cost;
+    edge_checks = 0;
+    repairs = 0;
 
-    bool collision = true;
+    if(static_cast<int>(edge_states.size()) != created_graph_p->num_edges()) edge_states.assign(created_graph_p->num_edges(), Unknown);
 
-    // Check for the start node
-    if(s.parent_p != nullptr)
+    // edges known to be in collision are skipped
+    auto valid = [this](int a, int b){ return edge_state(a, b) != Invalid; };
+    DistanceCost<decltype(valid)> cost(valid);
+
+    std::vector<int> path_ids;
+
+    while(specialized_search(s_start, s_goal, cost))
     {
-      for(auto obstacle : known_map.obstacles)
+      // the node IDs of the candidate path from the start to the goal
+      path_ids.clear();
+      for(int id = goal_id; id != -1; id = search_state.parent.at(id)) path_ids.push_back(id);
+      std::reverse(path_ids.begin(), path_ids.end());
+
+      // check the edges in order from the start, so the first edge in collision is found with the fewest checks
+      bool valid = true;
+
+      for(unsigned int i = 0; i + 1 < path_ids.size() && valid; i++)
       {
-        collision = collision::line_shape_intersection(s.parent_p->point, sp.node_p->point, obstacle, buffer_radius);
-        if(collision) break;
+        const int a = path_ids.at(i), b = path_ids.at(i + 1);
+
+        switch(edge_state(a, b))
+        {
+          case Valid: break;
+          case Invalid: valid = false; break;
+          case Unknown: valid = check_edge(a, b); break;
+        }
       }
+
+      if(valid) return true;
+
+      // search again without the edge in collision, the edges already checked are not checked again
+      repairs++;
     }
 
-    if(!collision) // there is line of sight, so evaluate path 2
-    {
+    return false;
+  }
 
-      // find the parent node
-      auto par_id = s.parent_p->id;
-      auto result = std::find_if(closed_list.begin(), closed_list.end(), [par_id](SearchNode n) {return n.node_p->id == par_id;});
+  void LazyAStar::clear_edge_cache()
+  {
+    edge_states.clear();
+  }
 
-      if(result == closed_list.end())
-      {
-        result = std::find_if(open_list.begin(), open_list.end(), [par_id](SearchNode n) {return n.node_p->id == par_id;});
-      }
+  int LazyAStar::get_edge_checks() const
+  {
+    return edge_checks;
+  }
+
+  int LazyAStar::get_repairs() const
+  {
+    return repairs;
+  }
+
+  validity LazyAStar::edge_state(int a, int b) const
+  {
+    // query nodes are connected after their edges are checked
+    if(query_graph_p && (query_graph_p->is_query_node(a) || query_graph_p->is_query_node(b))) return Valid;
+
+    const int e = created_graph_p->find_edge(a, b);
+
+    return (e == -1) ? Valid : edge_states.at(e);
+  }
+
+  bool LazyAStar::check_edge(int a, int b)
+  {
+    const bool collision_free = !obstacle_world.segment_collides(graph_point(a), graph_point(b));
+    edge_checks++;
+    STATS_ADD(search_stats.collision_checks, 1);
+
+    // the graph is undirected, so the result holds for both directions
+    const int forward = created_graph_p->find_edge(a, b);
+    const int backward = created_graph_p->find_edge(b, a);
+
+    if(forward != -1) edge_states.at(forward) = collision_free ? Valid : Invalid;
+    if(backward != -1) edge_states.at(backward) = collision_free ? Valid : Invalid;
+
+    return collision_free;
+  }
+
+  // =========================== ARA* ==========================================
+
+  ARAStar::ARAStar(const graph::CSRGraph * graph_p) : HSearch(graph_p)
+  {
+    epsilons = {3.0, 2.0, 1.5, 1.0};
+  }
+
+  bool ARAStar::ComputeShortestPath(int s_start, int s_goal)
+  {
+    STATS_PHASE(search_stats, "search");
+
+    const auto deadline = make_deadline(time_budget);
+
+    goal_loc = graph_point(s_goal);
+
+    start_id = s_start;
+    goal_id = s_goal;
+
+    final_path.clear();
+    expanded_nodes.clear();
+    expansions = 0;
+
+    // Reset the search state of every node in the graph
+    search_state.reset(graph_size());
+    open_list.reset(graph_size());
 
-      cost = f(*result, sp);
+    closed_nodes.clear();
+    incons_nodes.clear();
+    inconsistent.assign(graph_size(), false);
 
-      // If the path from par(s) to s' is cheaper than the existing one, update it.
-      if(cost.at(0) < sp.key_val.k1)
+    // Initialize the start node
+    epsilon = epsilons.front();
+
+    search_state.state.at(start_id) = Open;
+    search_state.g_val.at(start_id) = 0;
+    search_state.h_val.at(start_id) = h(graph_point(start_id));
+
+    open_list.push(start_id, weighted_key(start_id));
+
+    bool found = false;
+
+    for(unsigned int i = 0; i < epsilons.size(); i++)
+    {
+      if(i > 0)
       {
-        sp.g_val = cost.at(1);
-        sp.h_val = cost.at(2);
+        epsilon = epsilons.at(i);
 
-        sp.CalcKey(); // update the key values
+        // the nodes improved after their expansion in the last pass go back on the open list, and every key changes with the weight
+        for(const int id : incons_nodes)
+        {
+          inconsistent.at(id) = false;
+          search_state.state.at(id) = Open;
+          open_list.push(id, weighted_key(id));
+        }
 
-        sp.parent_p = s.parent_p;
+        incons_nodes.clear();
+        open_list.update_keys([&](int id){ return weighted_key(id); });
+
+        // the nodes expanded in the last pass can be expanded again
+        for(const int id : closed_nodes)
+        {
+          if(search_state.state.at(id) == Closed) search_state.state.at(id) = New;
+        }
+
+        closed_nodes.clear();
       }
+
+      if(!ImprovePath(deadline)) break;
+
+      // the goal can not be reached with any weight
+      if(search_state.g_val.at(goal_id) >= BIG_NUM) break;
+
+      final_path.clear();
+      assemble_path(goal_id);
+
+      path_epsilon = epsilon;
+      found = true;
     }
-    else // use path 1
+
+    return found;
+  }
+
+  Key ARAStar::weighted_key(int id) const
+  {
+    Key output;
+
+    output.k1 = search_state.g_val.at(id) + epsilon * search_state.h_val.at(id);
+    output.k2 = search_state.g_val.at(id);
+
+    return output;
+  }
+
+  bool ARAStar::ImprovePath(const std::chrono::steady_clock::time_point & deadline)
+  {
+    DistanceCost<> cost;
+
+    return visit_graph([&](const auto & graph)
     {
-      cost = f(s, sp);
+      Key goal_key;
+      goal_key.k1 = goal_key.k2 = search_state.g_val.at(goal_id);
 
-      // If the path from s to s' is cheaper than the existing one, update it.
-      if(cost.at(0) < sp.key_val.k1)
+      // stop once no node on the open list can lead to a cheaper path to the goal
+      while(!open_list.empty() && open_list.top_key() < goal_key)
       {
-        sp.g_val = cost.at(1);
-        sp.h_val = cost.at(2);
+        if(expansions % clock_interval == 0 && std::chrono::steady_clock::now() > deadline) return false;
+
+        const int cur_id = open_list.pop();
+        expansions++;
+        STATS_ADD(search_stats.expansions, 1);
 
-        sp.CalcKey(); // update the key values
+        search_state.state.at(cur_id) = Closed;
+        closed_nodes.push_back(cur_id);
 
-        sp.parent_p = s.node_p;
+        graph.for_each_neighbor(cur_id, [&](int node_id, double w)
+        {
+          update_successor(graph, cost, cur_id, node_id, w);
+        });
+
+        goal_key.k1 = goal_key.k2 = search_state.g_val.at(goal_id);
       }
-    }
 
+      return true;
+    });
   }
 
-  // =========================== LPA* ==========================================
+  // =========================== Theta* ========================================
 
-  LPAStar::LPAStar(std::vector<std::vector<prm::Node>>* grid_graph, grid::Grid* base_grid, rigid2d::Vector2D start_loc, rigid2d::Vector2D goal_loc) : HSearch()
+  ThetaStar::ThetaStar(const graph::CSRGraph * graph_p, grid::Map map, double buffer) : HSearch(graph_p)
+  {
+    known_map = map;
+    buffer_radius = buffer;
+    obstacle_world = collision::CollisionWorld(known_map.obstacles, buffer_radius);
+  }
+
+  ThetaStar::ThetaStar(const graph::CSRGraph * graph_p, const grid::Grid * base_grid) : HSearch(graph_p)
   {
-    // populate class attributes
-    created_graph_p = grid_graph;
     known_grid_p = base_grid;
+    check_edges = true;
+  }
 
-    this->goal_loc = known_grid_p->grid_to_world(goal_loc);
+  void ThetaStar::clear_los_cache()
+  {
+    los_cache.clear();
+  }
 
-    // Use the provided grid_world to create a graph of the cell centers and initialize a grid of SearchNodes
-    // Loop through each cell in the grid and create an unordered map of SearchNodes.
-    auto grid_dims = base_grid->get_grid_dimensions();
+  void ThetaStar::set_check_edges(bool check)
+  {
+    check_edges = check || known_grid_p;
+  }
+
+  bool ThetaStar::line_of_sight(int a, int b)
+  {
+    const unsigned long long key = (static_cast<unsigned long long>(std::min(a, b)) << 32) | static_cast<unsigned int>(std::max(a, b));
+
+    // the IDs of query nodes only mean something during the current query
+    const bool cacheable = !query_graph_p || (!query_graph_p->is_query_node(a) && !query_graph_p->is_query_node(b));
 
-    for(int i = 0 ; i < grid_dims.at(1); i++) // integer y-coord
+    if(cacheable)
     {
-      for(int j = 0 ; j < grid_dims.at(0); j++) //integer x-coord
+      const auto cached = los_cache.find(key);
+
+      if(cached != los_cache.end())
       {
-        SearchNode s(created_graph_p->at(i).at(j));
-        s.search_id = s.node_p->id;
-        s.h_val = h(s);
-        standby.insert({s.search_id, s});
+        STATS_ADD(search_stats.los_cache_hits, 1);
+        return cached->second;
       }
     }
 
-    // Get start Node ID
-    start_id = created_graph_p->at(start_loc.y).at(start_loc.x).id;
+    STATS_ADD(search_stats.los_checks, 1);
 
-    // Get goal Node ID
-    goal_id = created_graph_p->at(goal_loc.y).at(goal_loc.x).id;
+    bool visible = false;
 
-    // Get the start node from the standby list
-    start = standby.at(start_id);
-    standby.erase(start_id);
+    if(known_grid_p)
+    {
+      // the node IDs are the row major indices of the grid cells
+      const auto occ = known_grid_p->get_occupancy();
+      visible = occ.line_is_free(a % occ.width, a / occ.width, b % occ.width, b / occ.width);
+    }
+    else visible = !obstacle_world.segment_collides(graph_point(a), graph_point(b));
 
-    start.rhs_val = 0;
-    start.CalcKey(km);
-    start.state = Open;
+    if(cacheable) los_cache.emplace(key, visible);
 
-    // Add start node to the open list
-    open_list.push_back(start);
-    std::make_heap(open_list.begin(), open_list.end(), std::greater<>{});
+    return visible;
   }
 
-  bool LPAStar::ComputeShortestPath()
+  bool ThetaStar::ComputeShortestPath(int s_start, int s_goal)
   {
-    bool result = false;
+    auto cost = any_angle_cost();
+
+    return specialized_search(s_start, s_goal, cost);
+  }
+
+  // =========================== JPS ===========================================
 
+  JPSStar::JPSStar(const grid::Grid * base_grid) : HSearch()
+  {
+    known_grid_p = base_grid;
+    implicit_graph = known_grid_p->get_implicit_graph();
+    occupancy = known_grid_p->get_occupancy();
+  }
+
+  bool JPSStar::ComputeShortestPath(int s_start, int s_goal)
+  {
+    STATS_PHASE(search_stats, "search");
+
+    // the grid could have been rebuilt since the last search
+    implicit_graph = known_grid_p->get_implicit_graph();
+    occupancy = known_grid_p->get_occupancy();
+
+    if(use_jump_distances && jump_distances.size() != 8 * static_cast<std::size_t>(occupancy.size())) update_jump_distances();
+
+    start_id = s_start;
+    goal_id = s_goal;
+
+    final_path.clear();
     expanded_nodes.clear();
-    std::cout << "\n\nSTARTING NEW SEARCH =========================================== \n =============================================================== \n";
-    std::cout << "Start ID: " << start_id << "\n";
-    std::cout << "Goal ID: " << goal_id << "\n";
+    expansions = 0;
 
-    while(open_list.size() != 0)
-    {
+    if(start_id < 0 || start_id >= occupancy.size() || goal_id < 0 || goal_id >= occupancy.size()) return false;
+    else if(occupancy.at(start_id) != 0 || occupancy.at(goal_id) != 0) return false;
 
-      if(!std::is_heap(open_list.begin(), open_list.end(), std::greater<>{}))
-      {
-        std::make_heap(open_list.begin(), open_list.end(), std::greater<>{});
-      }
+    goal_loc = implicit_graph.point(goal_id);
 
-      // Get the node at the top of the open list
-      auto cur_s = open_list.at(0);
+    // Reset the search state of every cell in the grid
+    search_state.reset(occupancy.size());
+    open_list.reset(occupancy.size());
+
+    // Initialize the start node
+    search_state.state.at(start_id) = Open;
+    search_state.g_val.at(start_id) = 0;
+    search_state.h_val.at(start_id) = h(implicit_graph.point(start_id));
+    search_state.CalcKey(start_id);
 
-      bool cond1 = cur_s.key_val > get_goal_key();
-      bool cond2 = goal_is_consistent();
+    open_list.push(start_id, search_state.key_val.at(start_id));
 
-      // std::cout << "CSP: Open List Size: " << open_list.size() << "\n";
-      // std::cout << "Picked Node " << cur_s.search_id << " off the open list \n";
+    return visit_heuristic([&](const auto & heuristic){ return jump_search(heuristic); });
+  }
 
-      // std::cout << cur_s;
-      // std::cout << cur_s.key_val;
-      // std::cout << get_goal_key();
-      // std::cout << "K Condition:\t" << cond1 << std::endl;
-      // std::cout << "G Condition:\t" << cond2 << std::endl;
+  template <typename Heuristic>
+  bool JPSStar::jump_search(const Heuristic & heuristic)
+  {
+    DistanceCost<> cost;
 
-      // Check the exit condition
-      if(cond1 && cond2)
+    const double resolution = known_grid_p->get_resolution();
+
+    while(!open_list.empty())
+    {
+      // Get the node with the minimum total cost
+      const int cur_id = open_list.pop();
+      expansions++;
+      STATS_ADD(search_stats.expansions, 1);
+
+      // check if cur_s is the goal
+      if(cur_id == goal_id)
       {
-        auto g_fin = locate_node(goal_id);
-        assemble_path(*g_fin);
-        result = true;
-        break;
+        assemble_path(cur_id);
+        return true;
       }
 
-      //Remove the node from the open list and put it on standby
-      std::pop_heap(open_list.begin(), open_list.end(), std::greater<>{});
-      open_list.back();
-      open_list.pop_back();
+      // Add current node to the closed list
+      search_state.state.at(cur_id) = Closed;
 
-      cur_s.state = Closed;
-      standby.insert({cur_s.search_id, cur_s});
+      const int x = cur_id % occupancy.width;
+      const int y = cur_id / occupancy.width;
 
-      auto k_old = cur_s.key_val;
-      cur_s.h_val = h(cur_s);
-      cur_s.CalcKey(km);
+      // The start jumps in every direction, every other node continues in the direction it was reached from
+      unsigned int dirs = 0xFF;
+      const int parent_id = search_state.parent.at(cur_id);
 
-      if(k_old < cur_s.key_val)
-      {
-        cur_s.state = Open;
-        open_list.push_back(cur_s);
-        standby.erase(cur_s.search_id);
-        
-        push_heap(open_list.begin(), open_list.end(), std::greater<>{});
-      }
-      else if(cur_s.g_val > cur_s.rhs_val)
+      if(parent_id != -1)
       {
-        standby.at(cur_s.search_id).g_val = standby.at(cur_s.search_id).rhs_val;
+        const int px = parent_id % occupancy.width;
+        const int py = parent_id / occupancy.width;
+        const int dir = direction((x > px) - (x < px), (y > py) - (y < py));
 
-        // loop through neighbors
-        for(const auto & sp_id : cur_s.node_p->id_set)
+        dirs = 1u << dir;
+
+        if(dir % 2 == 0) // horizontal or vertical, an occupied cell beside the node forces the diagonal around it
         {
-          UpdateVertex(sp_id);
+          if(!passable(x + dir_x[(dir + 2) % 8], y + dir_y[(dir + 2) % 8])) dirs |= 1u << ((dir + 1) % 8);
+          if(!passable(x + dir_x[(dir + 6) % 8], y + dir_y[(dir + 6) % 8])) dirs |= 1u << ((dir + 7) % 8);
+        }
+        else // diagonal, also continue along both components of the move
+        {
+          dirs |= (1u << ((dir + 1) % 8)) | (1u << ((dir + 7) % 8));
+
+          if(!passable(x + dir_x[(dir + 3) % 8], y + dir_y[(dir + 3) % 8])) dirs |= 1u << ((dir + 2) % 8);
+          if(!passable(x + dir_x[(dir + 5) % 8], y + dir_y[(dir + 5) % 8])) dirs |= 1u << ((dir + 6) % 8);
         }
       }
-      else
+
+      for(int dir = 0; dir < 8; dir++)
       {
-        standby.at(cur_s.search_id).g_val = BIG_NUM;
+        if(!(dirs & (1u << dir))) continue;
 
-        // loop through neighbors and self
-        for(const auto & sp_id : cur_s.node_p->id_set)
-        {
-          UpdateVertex(sp_id);
-        }
+        const int node_id = use_jump_distances ? jump_precomputed(x, y, dir) : jump(x, y, dir);
 
-        UpdateVertex(cur_s.search_id);
+        // Skip jumps that hit an obstacle and nodes that are already on the closed list
+        if(node_id == -1 || search_state.state.at(node_id) == Closed) continue;
+
+        const double w = resolution * OctileHeuristic()(rigid2d::Vector2D(node_id % occupancy.width, node_id / occupancy.width), rigid2d::Vector2D(x, y));
+
+        // add the node to the heap or update its position in the heap when its cost improved
+        if(!relax(implicit_graph, heuristic, cost, cur_id, node_id, w)) continue;
+
+        search_state.state.at(node_id) = Open;
+        open_list.push(node_id, search_state.key_val.at(node_id));
       }
     }
-    return result;
+    return false;
   }
 
-  bool LPAStar::MapChange(std::vector<std::pair<rigid2d::Vector2D, signed char>> points)
+  void JPSStar::set_precompute(bool precompute)
   {
-    // make the updates to the occupancy data to effect the edge cost calculation
-    auto updates_made = known_grid_p->update_grid(points);
-
-    // determine if any changes were made
-    auto tot_chng = std::accumulate(updates_made.begin(), updates_made.end(), 0);
-
-    // std::cout << "Sum: " << tot_chng << "====================================" << std::endl;
+    use_jump_distances = precompute;
+  }
 
-    bool changed = false;
+  void JPSStar::update_jump_distances()
+  {
+    occupancy = known_grid_p->get_occupancy();
+    jump_distances.assign(8 * static_cast<std::size_t>(occupancy.size()), 0);
 
-    if(tot_chng > 0)
+    // The distance from a cell follows from the distance of the next cell in the same direction, so sweep the grid starting from
+    // the side the direction points to. The diagonal distances use the horizontal and vertical distances, so those go first.
+    for(const int dir : {0, 2, 4, 6, 1, 3, 5, 7})
     {
-      changed = true;
-
-      expanded_nodes.clear();
+      const int dx = dir_x[dir], dy = dir_y[dir];
 
-      for(auto it = updates_made.begin(); it < updates_made.end(); it++)
+      for(int j = 0; j < occupancy.height; j++)
       {
-        int i = std::distance(updates_made.begin(), it);
+        const int y = dy > 0 ? occupancy.height - 1 - j : j;
 
-        if(*it == 1)
+        for(int i = 0; i < occupancy.width; i++)
         {
-          const auto point = points.at(i);
+          const int x = dx > 0 ? occupancy.width - 1 - i : i;
+          const int nx = x + dx, ny = y + dy;
 
-          // std::cout << "Updating Nodes around Node: " << created_graph_p->at(point.first.y).at(point.first.x).id;
-          // std::cout << "\tGrid Coords: " << known_grid_p->world_to_grid(created_graph_p->at(point.first.y).at(point.first.x).point) << std::endl;
+          int & dist = jump_distances[8 * occupancy.id(x, y) + dir];
 
-          // Loop through all of the neighbors of the cell and find the new best connection given the map update
-          for(const auto& v_id : created_graph_p->at(point.first.y).at(point.first.x).id_set)
+          if(!passable(nx, ny))
           {
-            UpdateVertex(v_id);
+            dist = 0;
+            continue;
           }
-          // std::cout << "MU: Open List Size: " << open_list.size() << "\n";
-          // std::cout << "MU: Expd List Size: " << expanded_nodes.size() << "\n";
+
+          const int next = 8 * occupancy.id(nx, ny);
+
+          if(forced(nx, ny, dir)) dist = 1;
+          else if(dir % 2 == 1 && (jump_distances[next + (dir + 1) % 8] > 0 || jump_distances[next + (dir + 7) % 8] > 0)) dist = 1;
+          else if(jump_distances[next + dir] > 0) dist = jump_distances[next + dir] + 1;
+          else dist = jump_distances[next + dir] - 1;
         }
       }
     }
-    return changed;
   }
 
-  void LPAStar::assemble_path(SearchNode goal)
+  bool JPSStar::passable(int x, int y) const
   {
+    if(x < 0 || x >= occupancy.width || y < 0 || y >= occupancy.height) return false;
+    else return occupancy.at(x, y) == 0;
+  }
 
-    final_path.clear();
+  bool JPSStar::forced(int x, int y, int dir) const
+  {
+    // the neighbor beside an occupied cell can only be reached without a detour by passing through this cell
+    if(dir % 2 == 0)
+    {
+      return (!passable(x + dir_x[(dir + 2) % 8], y + dir_y[(dir + 2) % 8]) && passable(x + dir_x[(dir + 1) % 8], y + dir_y[(dir + 1) % 8]))
+          || (!passable(x + dir_x[(dir + 6) % 8], y + dir_y[(dir + 6) % 8]) && passable(x + dir_x[(dir + 7) % 8], y + dir_y[(dir + 7) % 8]));
+    }
+    else
+    {
+      return (!passable(x + dir_x[(dir + 3) % 8], y + dir_y[(dir + 3) % 8]) && passable(x + dir_x[(dir + 2) % 8], y + dir_y[(dir + 2) % 8]))
+          || (!passable(x + dir_x[(dir + 5) % 8], y + dir_y[(dir + 5) % 8]) && passable(x + dir_x[(dir + 6) % 8], y + dir_y[(dir + 6) % 8]));
+    }
+  }
 
-    // add the goal to the path
-    final_path.push_back(goal.node_p->point);
+  int JPSStar::jump(int x, int y, int dir) const
+  {
+    while(true)
+    {
+      x += dir_x[dir];
+      y += dir_y[dir];
+
+      if(!passable(x, y)) return -1;
 
-    auto cur_node = goal;
-    std::cout << "Assembling Path...\n";
+      const int id = occupancy.id(x, y);
+
+      if(id == goal_id || forced(x, y, dir)) return id;
+
+      // a diagonal jump stops where a horizontal or vertical jump from the cell finds a jump point
+      if(dir % 2 == 1 && (jump(x, y, (dir + 1) % 8) != -1 || jump(x, y, (dir + 7) % 8) != -1)) return id;
+    }
+  }
 
-    // follow the parent points back to the starting node and store each location
-    // Select the neighbor node with the minimum cost
-    while (cur_node.parent_p != nullptr)
+  int JPSStar::jump_precomputed(int x, int y, int dir) const
+  {
+    const int dist = jump_distances[8 * occupancy.id(x, y) + dir];
+    const int steps = dist > 0 ? dist : -dist;
+
+    const int dx = dir_x[dir], dy = dir_y[dir];
+
+    // the number of steps toward the goal along each axis, the goal is behind or beside the jump when it is not positive
+    const int goal_dx = (goal_id % occupancy.width - x) * dx;
+    const int goal_dy = (goal_id / occupancy.width - y) * dy;
+
+    if(dir % 2 == 0)
     {
-      // std::cout << "Scanning neighbors =========================================\n";
-      // std::cout << cur_node;
+      // the goal is on the line of the jump before it ends
+      const bool in_line = dx == 0 ? goal_id % occupancy.width == x : goal_id / occupancy.width == y;
+      const int goal_steps = dx == 0 ? goal_dy : goal_dx;
 
-      cur_node.rhs_val = BIG_NUM;
+      if(in_line && goal_steps > 0 && goal_steps <= steps) return goal_id;
+    }
+    else if(goal_dx > 0 && goal_dy > 0)
+    {
+      // stop at the row or column of the goal, where a horizontal or vertical jump can reach it
+      const int goal_steps = std::min(goal_dx, goal_dy);
 
-      for(const auto n_id : cur_node.node_p->id_set)
-      {
-        // std::cout << "\n\tLooking at Neighbor" << n_id << "...";
-        auto neighbor = *locate_node(n_id);
-        ComputeCost(neighbor, cur_node);
-      }
+      if(goal_steps <= steps) return occupancy.id(x + goal_steps * dx, y + goal_steps * dy);
+    }
+
+    if(dist > 0) return occupancy.id(x + dist * dx, y + dist * dy);
+    else return -1;
+  }
 
-      // std::cout << "\nAfter Update: \n";
-      // std::cout << cur_node;
+  void JPSStar::assemble_path(int goal)
+  {
+    // add the goal to the path
+    final_path.push_back(implicit_graph.point(goal));
 
-      final_path.push_back(cur_node.parent_p->point);
+    int cur_id = goal;
 
-      auto next_id = cur_node.parent_p->id;
+    // follow the parent IDs back to the starting node and store each location
+    while(search_state.parent.at(cur_id) != -1)
+    {
+      cur_id = search_state.parent.at(cur_id);
 
-      cur_node = *locate_node(next_id);
+      final_path.push_back(implicit_graph.point(cur_id));
     }
   }
 
-  void LPAStar::UpdateVertex(int u_id)
+  // =========================== LPA* ==========================================
+
+  LPAStar::LPAStar(const graph::CSRGraph* grid_graph, grid::Grid* base_grid, rigid2d::Vector2D start_loc, rigid2d::Vector2D goal_loc) : HSearch()
   {
-    // First get a pointer to the node in one of the lists
-    auto u = locate_node(u_id);
+    // populate class attributes
+    created_graph_p = grid_graph;
+    known_grid_p = base_grid;
+    implicit_graph = known_grid_p->get_implicit_graph();
 
-    expanded_nodes.push_back(u->node_p->point);
+    this->goal_loc = known_grid_p->grid_to_world(goal_loc);
 
-    // std::cout << "Evaluating Node " << u_id << "================= \n";
-    // std::cout << *u;
-    // std::cout << "Old Key: " << u->key_val;
+    // Create a search state for each cell in the grid, indexed by the row major cell ID
+    auto grid_dims = base_grid->get_grid_dimensions();
+    grid_width = grid_dims.at(0);
 
-    // Scan the predecessors of u and set the min cost to the rhs val
+    const int num_cells = grid_dims.at(0) * grid_dims.at(1);
 
-    if(u_id != start_id)
+    search_state.reset(num_cells);
+    open_list.reset(num_cells);
+
+    // Get start Node ID
+    start_id = start_loc.y * grid_width + start_loc.x;
+
+    // Get goal Node ID
+    goal_id = goal_loc.y * grid_width + goal_loc.x;
+
+    // Add start node to the open list
+    search_state.rhs_val.at(start_id) = 0;
+    search_state.state.at(start_id) = Open;
+
+    open_list.push(start_id, CalculateKey(start_id));
+  }
+
+  LPAStar::LPAStar(grid::Grid* base_grid, rigid2d::Vector2D start_loc, rigid2d::Vector2D goal_loc) : LPAStar(nullptr, base_grid, start_loc, goal_loc)
+  { }
+
+  bool LPAStar::ComputeShortestPath()
+  {
+    STATS_PHASE(search_stats, "search");
+
+    expanded_nodes.clear();
+    expansions = 0;
+
+    const auto deadline = make_deadline(time_budget);
+
+    while(true)
+    {
+      // an interrupted pass continues with the state it left behind
+      if(!interrupted) begin_pass();
+
+      interrupted = !ImprovePath(deadline);
+
+      // the path of the last complete pass still holds for the current map
+      if(interrupted) break;
+
+      // a path only exists if the goal was reached through traversable cells, a smaller weight will not find one either
+      has_path = goal_is_consistent() && search_state.g_val.at(goal_id) < BIG_NUM;
+
+      if(!has_path) break;
+
+      assemble_path(goal_id);
+      path_epsilon = epsilon;
+
+      if(pass + 1 >= epsilons.size()) break;
+
+      pass++;
+    }
+
+    return has_path;
+  }
+
+  bool LPAStar::ImprovePath(const std::chrono::steady_clock::time_point & deadline)
+  {
+    while(!open_list.empty())
     {
-      u->rhs_val = BIG_NUM; //Ensures the following for loop with set the rhs to min given the most current info
+      // Get the node at the top of the open list
+      const int u = open_list.top();
+      const Key k_old = open_list.top_key();
+
+      // Check the exit condition
+      if(!(k_old < get_goal_key()) && goal_is_consistent()) break;
+
+      if(expansions % clock_interval == 0 && std::chrono::steady_clock::now() > deadline) return false;
+
+      const Key k_new = CalculateKey(u);
+      expansions++;
+      STATS_ADD(search_stats.expansions, 1);
 
-      for(const auto sp_id : u->node_p->id_set)
+      if(k_old < k_new) // the key is out of date, so move the node to the correct place in the open list
+      {
+        open_list.push(u, k_new);
+      }
+      else if(search_state.g_val.at(u) > search_state.rhs_val.at(u)) // overconsistent, so lock in the rhs value
+      {
+        search_state.g_val.at(u) = search_state.rhs_val.at(u);
+
+        open_list.remove(u);
+        search_state.state.at(u) = Closed;
+
+        if(!closed_set.empty()) closed_set.at(u) = true;
+
+        // loop through neighbors
+        for_each_neighbor(u, [&](int sp_id, double)
+        {
+          UpdateVertex(sp_id);
+        });
+      }
+      else // underconsistent, so reset the g value and update the node and its neighbors
       {
-        // std::cout << "\n\tLooking at Neighbor" << sp_id << "...";
-        auto sp = locate_node(sp_id);
+        search_state.g_val.at(u) = BIG_NUM;
+
+        // loop through neighbors and self
+        for_each_neighbor(u, [&](int sp_id, double)
+        {
+          UpdateVertex(sp_id);
+        });
 
-        ComputeCost(*sp, *u);
+        UpdateVertex(u);
       }
+    }
 
-      // If rhs is INF set parent to null?
+    return true;
+  }
+
+  void LPAStar::begin_pass()
+  {
+    const double weight = epsilons.at(pass);
+
+    // with the default schedule the search is plain LPA* and nothing has to change
+    if(weight == epsilon && incons_nodes.empty() && closed_set.empty()) return;
 
-      u->h_val = h(*u);
-      u->CalcKey(km);
+    epsilon = weight;
+
+    for(const int u : incons_nodes)
+    {
+      inconsistent.at(u) = false;
+      open_list.push(u, CalculateKey(u));
     }
 
-    // std::cout << "\nAfter Update: \n";
-    // std::cout << *u;
-    // std::cout << "New Key: " << u->key_val;
+    incons_nodes.clear();
+    open_list.update_keys([&](int u){ return CalculateKey(u); });
 
-    // Check for consistency,
-    if(is_consistent(*u))
+    // only an inflated pass limits each node to one overconsistent expansion
+    if(epsilon > 1)
     {
-      // make sure the node is not on the open list, if it is remove it and place it in standby
-      auto it_vec = std::find_if(open_list.begin(), open_list.end(), [u_id](SearchNode n) {return n.search_id == u_id;});
-      if(it_vec != open_list.end())
+      closed_set.assign(search_state.size(), false);
+      inconsistent.resize(search_state.size(), false);
+    }
+    else closed_set.clear();
+  }
+
+  bool LPAStar::can_improve() const
+  {
+    return interrupted;
+  }
+
+  bool LPAStar::MapChange(std::vector<std::pair<rigid2d::Vector2D, signed char>> points)
+  {
+    STATS_PHASE(search_stats, "map_change");
+
+    std::vector<int> changed_cells;
+
+    if(graded_cost())
+    {
+      // any new value changes the edge costs, so compare the values before they are written
+      const auto occupancy = known_grid_p->get_occupancy();
+
+      for(const auto & point : points)
       {
-        u->state = Closed;
-        standby.insert({u->search_id, *u});
-        open_list.erase(it_vec); // this line deletes the node the pointer u, is pointing to. u is now no longer useable after this line
-        push_heap(open_list.begin(), open_list.end(), std::greater<>{});
+        const int id = point.first.y * grid_width + point.first.x;
+        if(occupancy.at(id) != point.second) changed_cells.push_back(id);
       }
+
+      known_grid_p->update_grid(points);
     }
-    else // the node is not consistent, and should be placed on the open list, if not already there
+    else
     {
-      auto it_map = standby.find(u_id);
-      if(it_map != standby.end())
+      // make the updates to the occupancy data to effect the edge cost calculation
+      const auto updates_made = known_grid_p->update_grid(points);
+
+      for(unsigned int i = 0; i < updates_made.size(); i++)
       {
-        u->state = Open;
-        open_list.push_back(*u);
-        standby.erase(u->search_id); // this line deletes the node the pointer u, is pointing to. u is now no longer useable after this line
+        if(updates_made.at(i) == 1) changed_cells.push_back(points.at(i).first.y * grid_width + points.at(i).first.x);
       }
     }
 
-    push_heap(open_list.begin(), open_list.end(), std::greater<>{});
+    return UpdateChangedCells(changed_cells);
   }
 
-  void LPAStar::ComputeCost(SearchNode &sp, SearchNode &u)
+  bool LPAStar::MapChange(const grid::OccupancyPatch & patch)
   {
-    double buf = sp.g_val + edge_cost(sp, u);
+    STATS_PHASE(search_stats, "map_change");
 
-    // std::cout << "G: " << sp.g_val << " Cost: " << edge_cost(sp, u) << " ...";
+    if(!graded_cost()) return UpdateChangedCells(known_grid_p->update_patch(patch));
+    else if(patch.data.size() != static_cast<unsigned int>(patch.width * patch.height)) return false;
 
-    if(buf < u.rhs_val)
+    // with a graded cost any new value changes the edge costs, so compare the values of the patch before they are written
+    std::vector<int> changed_cells;
+
+    const auto occupancy = known_grid_p->get_occupancy();
+
+    for(int i = std::max(patch.y, 0); i < std::min(patch.y + patch.height, occupancy.height); i++)
     {
-      // std::cout << "Updated RHS";
-      u.rhs_val = buf;
-      u.parent_p = sp.node_p;
+      for(int j = std::max(patch.x, 0); j < std::min(patch.x + patch.width, occupancy.width); j++)
+      {
+        if(occupancy.at(j, i) != patch.data.at((i - patch.y) * patch.width + j - patch.x)) changed_cells.push_back(occupancy.id(j, i));
+      }
     }
+
+    known_grid_p->update_patch(patch);
+
+    return UpdateChangedCells(changed_cells);
   }
 
-  double LPAStar::edge_cost(SearchNode &sp, SearchNode &u)
+  void LPAStar::set_occupancy_cost(double scale, signed char lethal)
   {
+    occupancy_scale = std::max(scale, 0.0);
+    lethal_occupancy = std::clamp<signed char>(lethal, 1, 101);
 
-    // convert the world coords stored in each node to grid coords
+    // every edge cost can change, so every vertex is updated like after a map change
+    expanded_nodes.clear();
 
-    auto sp_grid_pt = known_grid_p->world_to_grid(sp.node_p->point);
-    auto u_grid_pt = known_grid_p->world_to_grid(u.node_p->point);
+    for(int u = 0; u < search_state.size(); u++) UpdateVertex(u);
 
-    // retrieve the occupancy data
+    pass = 0;
+    interrupted = false;
+    has_path = false;
+  }
 
-    auto sp_occ = known_grid_p->get_grid().at(sp_grid_pt.y).at(sp_grid_pt.x);
-    auto u_occ = known_grid_p->get_grid().at(u_grid_pt.y).at(u_grid_pt.x);
+  OccupancyCost LPAStar::cell_cost() const
+  {
+    return OccupancyCost(known_grid_p->get_occupancy(), occupancy_scale, lethal_occupancy);
+  }
 
-    // std::cout << "Edge from " << sp_grid_pt.x << ", " << sp_grid_pt.y << " to "  << u_grid_pt.x << ", " << u_grid_pt.y << ": " << int(sp_occ) << ", " << int(u_occ) << std::endl;
+  bool LPAStar::graded_cost() const
+  {
+    return occupancy_scale > 0.0 || lethal_occupancy > 1;
+  }
 
-    // caculate the cost
-    if(sp_occ == 0 && u_occ == 0) return sp.node_p->point.distance(u.node_p->point);
-    else return BIG_NUM;
+  bool LPAStar::UpdateChangedCells(const std::vector<int> & changed_cells)
+  {
+    if(changed_cells.empty()) return false;
+
+    expanded_nodes.clear();
+
+    // Every edge to and from a changed cell changed cost, so find the new best connection for the cell and all of its neighbors.
+    // Neighboring cells share neighbors, so collect the verticies first and update each one once.
+    std::vector<int> verticies;
+    verticies.reserve(9 * changed_cells.size());
+
+    for(const int cell_id : changed_cells)
+    {
+      verticies.push_back(cell_id);
+
+      for_each_neighbor(cell_id, [&](int v_id, double)
+      {
+        verticies.push_back(v_id);
+      });
+    }
+
+    std::sort(verticies.begin(), verticies.end());
+    verticies.erase(std::unique(verticies.begin(), verticies.end()), verticies.end());
+
+    for(const int v_id : verticies) UpdateVertex(v_id);
+
+    // a changed map starts the schedule over, to find a path quickly again
+    pass = 0;
+    interrupted = false;
+    has_path = false;
+
+    return true;
   }
 
-  bool LPAStar::goal_is_consistent()
+  rigid2d::Vector2D LPAStar::node_point(int id) const
   {
-    return is_consistent( *locate_node(goal_id) );
+    if(created_graph_p) return created_graph_p->point(id);
+    else return implicit_graph.point(id);
   }
 
-  bool LPAStar::is_consistent(SearchNode u) const
+  void LPAStar::assemble_path(int goal)
   {
-    // if(u.g_val == BIG_NUM && u.rhs_val == BIG_NUM) return true;
-    return rigid2d::almost_equal(u.g_val, u.rhs_val);
+    final_path.clear();
+
+    // add the goal to the path
+    final_path.push_back(node_point(goal));
+
+    int cur_id = goal;
+
+    // follow the neighbors with the minimum cost back to the starting node and store each location,
+    // a path can visit each node at most once.
+    for(int step = 0; cur_id != start_id && step < search_state.size(); step++)
+    {
+      double min_cost = BIG_NUM;
+      int next_id = -1;
+
+      for_each_neighbor(cur_id, [&](int n_id, double w)
+      {
+        const double cost = search_state.g_val.at(n_id) + edge_cost(n_id, cur_id, w);
+
+        if(cost < min_cost)
+        {
+          min_cost = cost;
+          next_id = n_id;
+        }
+      });
+
+      if(next_id == -1) break;
+
+      search_state.parent.at(cur_id) = next_id;
+      cur_id = next_id;
+
+      final_path.push_back(node_point(cur_id));
+    }
   }
 
-  SearchNode* LPAStar::locate_node(int u_id)
+  void LPAStar::UpdateVertex(int u_id)
   {
-    auto it_map = standby.find(u_id);
+    expanded_nodes.push_back(node_point(u_id));
 
-    if(it_map == standby.end())
+    // Scan the predecessors of u and set the min cost to the rhs val
+    if(u_id != start_id)
     {
-      auto it_vec = std::find_if(open_list.begin(), open_list.end(), [u_id](SearchNode n) {return n.search_id == u_id;});
-      return &(*it_vec);
+      if(created_graph_p) update_rhs(*created_graph_p, u_id);
+      else update_rhs(implicit_graph, u_id);
     }
-    else
+
+    // Check for consistency,
+    if(is_consistent(u_id))
+    {
+      // make sure the node is not on the open list
+      open_list.remove(u_id);
+      search_state.state.at(u_id) = Closed;
+    }
+    else if(!closed_set.empty() && closed_set.at(u_id)) // already made consistent in this inflated pass, so wait for the next pass
     {
-      return &(it_map->second);
+      open_list.remove(u_id);
+      search_state.state.at(u_id) = Open;
+
+      if(!inconsistent.at(u_id))
+      {
+        inconsistent.at(u_id) = true;
+        incons_nodes.push_back(u_id);
+      }
+    }
+    else // the node is not consistent, and should be placed on the open list or have its key updated
+    {
+      open_list.push(u_id, CalculateKey(u_id));
+      search_state.state.at(u_id) = Open;
     }
   }
 
-  Key LPAStar::get_goal_key()
+  double LPAStar::edge_cost(int sp, int u, double w) const
   {
-    SearchNode* g = locate_node(goal_id);
+    const OccupancyCost cost = cell_cost();
 
-    g->h_val = h(*g);
-    g->CalcKey(km);
+    if(cost.traversable(sp, u)) return cost.weight(sp, u, w);
+    else return BIG_NUM;
+  }
 
-    return g->key_val;
+  Key LPAStar::CalculateKey(int u)
+  {
+    search_state.h_val.at(u) = h(node_point(u));
+
+    if(epsilon > 1 && search_state.g_val.at(u) > search_state.rhs_val.at(u))
+    {
+      search_state.key_val.at(u).k1 = search_state.rhs_val.at(u) + epsilon * search_state.h_val.at(u) + km;
+      search_state.key_val.at(u).k2 = search_state.rhs_val.at(u);
+    }
+    else search_state.CalcKey(u, km);
+
+    return search_state.key_val.at(u);
+  }
+
+  bool LPAStar::goal_is_consistent() const
+  {
+    return is_consistent(goal_id);
+  }
+
+  bool LPAStar::is_consistent(int u) const
+  {
+    return rigid2d::almost_equal(search_state.g_val.at(u), search_state.rhs_val.at(u));
+  }
+
+  Key LPAStar::get_goal_key()
+  {
+    return CalculateKey(goal_id);
   }
 
   // =========================== D* Lite =======================================
 
-  DStarLite::DStarLite(std::vector<std::vector<prm::Node>>* grid_graph, grid::Grid* base_grid, rigid2d::Vector2D start_loc, rigid2d::Vector2D goal_loc) : LPAStar(grid_graph, base_grid, goal_loc, start_loc)
+  DStarLite::DStarLite(const graph::CSRGraph* grid_graph, grid::Grid* base_grid, rigid2d::Vector2D start_loc, rigid2d::Vector2D goal_loc) : LPAStar(grid_graph, base_grid, goal_loc, start_loc)
+  { }
+
+  DStarLite::DStarLite(grid::Grid* base_grid, rigid2d::Vector2D start_loc, rigid2d::Vector2D goal_loc) : LPAStar(nullptr, base_grid, goal_loc, start_loc)
   { }
 
   void DStarLite::UpdateRobotLoc(rigid2d::Vector2D robot_loc)
   {
     // update the robot location
-    auto old_goal = *locate_node(goal_id);
+    const auto old_goal = node_point(goal_id);
 
-    goal_id = created_graph_p->at(robot_loc.y).at(robot_loc.x).id;
+    goal_id = robot_loc.y * grid_width + robot_loc.x;
     goal_loc = known_grid_p->grid_to_world(robot_loc);
 
     // update the stored km value
@@ -0,0 +1,535 @@
+/// \file
+/// \brief A hierarchical search over the clusters of a grid, following HPA*
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "global_search/heuristic_search.hpp"
+#include "global_search/hierarchical_search.hpp"
+#include "rigid2d/rigid2d.hpp"
+#include "roadmap/graph.hpp"
+#include "roadmap/grid.hpp"
+#include "roadmap/stats.hpp"
+
+namespace hsearch
+{
+  /// \brief A straight run of crossings this long or longer gets an entrance at each end instead of one in the middle
+  static constexpr int entrance_split = 6;
+
+  bool HPAStar::Crossing::operator==(const Crossing & rhs) const
+  {
+    return a == rhs.a && b == rhs.b;
+  }
+
+  HPAStar::HPAStar(const grid::Grid * base_grid, int cluster_size) : HSearch(), abstract_search(&abstract_graph)
+  {
+    known_grid_p = base_grid;
+    cluster_length = std::max(cluster_size, 2);
+
+    rebuild();
+  }
+
+  bool HPAStar::ComputeShortestPath(int s_start, int s_goal)
+  {
+    STATS_PHASE(search_stats, "search");
+
+    // the grid could have been rebuilt since the clusters were built
+    if(known_grid_p->get_occupancy().size() != occupancy.size()) rebuild();
+
+    occupancy = known_grid_p->get_occupancy();
+
+    start_id = s_start;
+    goal_id = s_goal;
+
+    final_path.clear();
+    expanded_nodes.clear();
+    corridor.clear();
+    expansions = 0;
+
+    if(start_id < 0 || start_id >= occupancy.size() || goal_id < 0 || goal_id >= occupancy.size()) return false;
+    else if(occupancy.at(start_id) != 0 || occupancy.at(goal_id) != 0) return false;
+
+    // Attach the start and goal to the entrances they can reach in their clusters
+    query.reset(&abstract_graph);
+
+    const int start_node = query.add_node(implicit_graph.point(start_id));
+    const int goal_node = query.add_node(implicit_graph.point(goal_id));
+
+    attach(start_node, start_id);
+    attach(goal_node, goal_id);
+
+    // the shortest path could stay inside the cluster without passing an entrance
+    if(get_cluster(start_id) == get_cluster(goal_id) && local_search(get_cluster(start_id), start_id, goal_id))
+    {
+      query.add_edge(start_node, goal_node, search_state.g_val.at(local_id(goal_id)));
+    }
+
+    abstract_search.set_heuristic(h_type);
+    const bool found = abstract_search.ComputeShortestPath(query, start_node, goal_node);
+    expansions += abstract_search.get_expansion_count();
+
+    if(!found)
+    {
+      STATS_ADD(search_stats.expansions, expansions);
+      return false;
+    }
+
+    // The abstract path runs from the goal to the start, list its cells from the start
+    const auto abstract_path = abstract_search.get_path();
+    const double resolution = known_grid_p->get_resolution();
+
+    std::vector<int> waypoints;
+
+    for(auto it = abstract_path.rbegin(); it != abstract_path.rend(); it++)
+    {
+      const int cell = static_cast<int>(std::floor(it->y / resolution)) * occupancy.width + static_cast<int>(std::floor(it->x / resolution));
+
+      if(waypoints.empty() || waypoints.back() != cell) waypoints.push_back(cell);
+    }
+
+    // Refine each step, a crossing is a move to a neighboring cell and any other step stays inside one cluster
+    std::vector<int> cells = {waypoints.front()};
+
+    for(unsigned int i = 1; i < waypoints.size(); i++)
+    {
+      const int from = waypoints.at(i - 1);
+      const int to = waypoints.at(i);
+      const int c = get_cluster(from);
+
+      if(c != get_cluster(to) || !local_search(c, from, to))
+      {
+        cells.push_back(to);
+        continue;
+      }
+
+      std::vector<int> segment;
+
+      for(int id = local_id(to); id != -1; id = search_state.parent.at(id)) segment.push_back(local_cell(id));
+
+      // the segment starts with the cell already on the path
+      cells.insert(cells.end(), segment.rbegin() + 1, segment.rend());
+    }
+
+    STATS_ADD(search_stats.expansions, expansions);
+
+    for(auto it = cells.rbegin(); it != cells.rend(); it++) final_path.push_back(implicit_graph.point(*it));
+
+    for(const int cell : cells)
+    {
+      const int c = get_cluster(cell);
+
+      if(std::find(corridor.begin(), corridor.end(), c) == corridor.end()) corridor.push_back(c);
+    }
+
+    return true;
+  }
+
+  int HPAStar::update_cells(const std::vector<int> & changed_cells)
+  {
+    STATS_PHASE(search_stats, "map_change");
+
+    occupancy = known_grid_p->get_occupancy();
+
+    const int query_expansions = expansions;
+
+    // The crossings next to a changed cell are owned by the clusters of the cell and its neighbors
+    std::vector<bool> touched(clusters.size(), false);
+    std::vector<bool> dirty(clusters.size(), false);
+
+    for(const int cell : changed_cells)
+    {
+      if(cell < 0 || cell >= occupancy.size()) continue;
+
+      dirty.at(get_cluster(cell)) = true;
+
+      const int x = cell % occupancy.width;
+      const int y = cell / occupancy.width;
+
+      for(int m = -1; m < 2; m++)
+      {
+        for(int n = -1; n < 2; n++)
+        {
+          if(x + n < 0 || x + n >= occupancy.width || y + m < 0 || y + m >= occupancy.height) continue;
+
+          touched.at(get_cluster(occupancy.id(x + n, y + m))) = true;
+        }
+      }
+    }
+
+    // A cluster with new crossings changes the entrances of the neighbors the crossings lead to
+    for(unsigned int c = 0; c < clusters.size(); c++)
+    {
+      if(!touched.at(c)) continue;
+
+      auto crossings = find_crossings(c);
+
+      if(crossings == clusters.at(c).crossings) continue;
+
+      clusters.at(c).crossings = std::move(crossings);
+      dirty.at(c) = true;
+
+      const int cx = c % clusters_x;
+      const int cy = c / clusters_x;
+
+      for(const auto & offset : {std::make_pair(1, 0), std::make_pair(0, 1), std::make_pair(1, 1), std::make_pair(1, -1)})
+      {
+        const int nx = cx + offset.first, ny = cy + offset.second;
+
+        if(nx < clusters_x && ny >= 0 && ny < clusters_y) dirty.at(ny * clusters_x + nx) = true;
+      }
+    }
+
+    int rebuilt = 0;
+
+    for(unsigned int c = 0; c < clusters.size(); c++)
+    {
+      if(!dirty.at(c)) continue;
+
+      build_cluster(c);
+      rebuilt++;
+    }
+
+    if(rebuilt > 0) assemble_graph();
+
+    // the local searches of the build are not part of a query
+    expansions = query_expansions;
+
+    return rebuilt;
+  }
+
+  void HPAStar::rebuild()
+  {
+    STATS_PHASE(search_stats, "build");
+
+    implicit_graph = known_grid_p->get_implicit_graph();
+    occupancy = known_grid_p->get_occupancy();
+
+    const int query_expansions = expansions;
+
+    clusters_x = (occupancy.width + cluster_length - 1) / cluster_length;
+    clusters_y = (occupancy.height + cluster_length - 1) / cluster_length;
+
+    clusters.assign(clusters_x * clusters_y, Cluster());
+
+    for(unsigned int c = 0; c < clusters.size(); c++)
+    {
+      auto & cluster = clusters.at(c);
+
+      cluster.x = (c % clusters_x) * cluster_length;
+      cluster.y = (c / clusters_x) * cluster_length;
+      cluster.width = std::min(cluster_length, occupancy.width - cluster.x);
+      cluster.height = std::min(cluster_length, occupancy.height - cluster.y);
+    }
+
+    // every crossing has to be known before the entrances of the clusters it leads into
+    for(unsigned int c = 0; c < clusters.size(); c++) clusters.at(c).crossings = find_crossings(c);
+
+    for(unsigned int c = 0; c < clusters.size(); c++) build_cluster(c);
+
+    assemble_graph();
+
+    expansions = query_expansions;
+  }
+
+  int HPAStar::get_cluster(int cell) const
+  {
+    return (cell / occupancy.width / cluster_length) * clusters_x + (cell % occupancy.width) / cluster_length;
+  }
+
+  std::vector<int> HPAStar::get_cluster_bounds(int cluster) const
+  {
+    const auto & c = clusters.at(cluster);
+
+    return {c.x, c.y, c.width, c.height};
+  }
+
+  std::vector<int> HPAStar::get_corridor() const
+  {
+    return corridor;
+  }
+
+  const graph::CSRGraph & HPAStar::get_abstract_graph() const
+  {
+    return abstract_graph;
+  }
+
+  bool HPAStar::passable(int x, int y) const
+  {
+    if(x < 0 || x >= occupancy.width || y < 0 || y >= occupancy.height) return false;
+    else return occupancy.at(x, y) == 0;
+  }
+
+  std::vector<HPAStar::Crossing> HPAStar::find_crossings(int c) const
+  {
+    const auto & cluster = clusters.at(c);
+
+    const double straight = known_grid_p->get_resolution();
+    const double diagonal = std::sqrt(2.0) * straight;
+
+    const int right = cluster.x + cluster.width - 1;
+    const int top = cluster.y + cluster.height - 1;
+
+    std::vector<Crossing> output;
+
+    // Add a crossing for each run of free cell pairs along a border, given the first cell of the cluster and of the neighbor and
+    // the step along the border
+    auto add_runs = [&](int ax, int ay, int bx, int by, int sx, int sy, int length)
+    {
+      int run_start = 0;
+
+      for(int i = 0; i <= length; i++)
+      {
+        const bool open = i < length && passable(ax + i * sx, ay + i * sy) && passable(bx + i * sx, by + i * sy);
+
+        if(open) continue;
+
+        const int run = i - run_start;
+
+        if(run >= entrance_split)
+        {
+          for(const int j : {run_start, i - 1})
+          {
+            output.push_back({occupancy.id(ax + j * sx, ay + j * sy), occupancy.id(bx + j * sx, by + j * sy), straight});
+          }
+        }
+        else if(run > 0)
+        {
+          const int j = run_start + run / 2;
+          output.push_back({occupancy.id(ax + j * sx, ay + j * sy), occupancy.id(bx + j * sx, by + j * sy), straight});
+        }
+
+        run_start = i + 1;
+      }
+    };
+
+    // Add a diagonal crossing when the move passes between two occupied cells, so it can not be made through a straight crossing
+    auto add_squeeze = [&](int ax, int ay, int bx, int by)
+    {
+      if(!passable(ax, ay) || !passable(bx, by)) return;
+      else if(passable(bx, ay) || passable(ax, by)) return;
+
+      output.push_back({occupancy.id(ax, ay), occupancy.id(bx, by), diagonal});
+    };
+
+    if(right + 1 < occupancy.width) // the cluster to the right
+    {
+      add_runs(right, cluster.y, right + 1, cluster.y, 0, 1, cluster.height);
+
+      for(int y = cluster.y; y < top; y++) add_squeeze(right, y, right + 1, y + 1);
+      for(int y = cluster.y + 1; y <= top; y++) add_squeeze(right, y, right + 1, y - 1);
+    }
+
+    if(top + 1 < occupancy.height) // the cluster above
+    {
+      add_runs(cluster.x, top, cluster.x, top + 1, 1, 0, cluster.width);
+
+      for(int x = cluster.x; x < right; x++) add_squeeze(x, top, x + 1, top + 1);
+      for(int x = cluster.x + 1; x <= right; x++) add_squeeze(x, top, x - 1, top + 1);
+    }
+
+    // the clusters diagonal to the top right and bottom right corners
+    if(right + 1 < occupancy.width && top + 1 < occupancy.height) add_squeeze(right, top, right + 1, top + 1);
+    if(right + 1 < occupancy.width && cluster.y > 0) add_squeeze(right, cluster.y, right + 1, cluster.y - 1);
+
+    return output;
+  }
+
+  void HPAStar::build_cluster(int c)
+  {
+    auto & cluster = clusters.at(c);
+
+    cluster.entrances.clear();
+
+    for(const auto & crossing : cluster.crossings) cluster.entrances.push_back(crossing.a);
+
+    // the crossings into this cluster are owned by the clusters to the left, below, below and to the left, and above and to the left
+    const int cx = c % clusters_x;
+    const int cy = c / clusters_x;
+
+    for(const auto & offset : {std::make_pair(-1, 0), std::make_pair(0, -1), std::make_pair(-1, -1), std::make_pair(-1, 1)})
+    {
+      const int nx = cx + offset.first, ny = cy + offset.second;
+
+      if(nx < 0 || ny < 0 || ny >= clusters_y) continue;
+
+      for(const auto & crossing : clusters.at(ny * clusters_x + nx).crossings)
+      {
+        if(get_cluster(crossing.b) == c) cluster.entrances.push_back(crossing.b);
+      }
+    }
+
+    std::sort(cluster.entrances.begin(), cluster.entrances.end());
+    cluster.entrances.erase(std::unique(cluster.entrances.begin(), cluster.entrances.end()), cluster.entrances.end());
+
+    // Find the cost from each entrance to every other one
+    const int n = cluster.entrances.size();
+    cluster.costs.assign(n * n, BIG_NUM);
+
+    for(int i = 0; i < n; i++)
+    {
+      local_search(c, cluster.entrances.at(i), -1);
+
+      for(int j = 0; j < n; j++) cluster.costs.at(i * n + j) = search_state.g_val.at(local_id(cluster.entrances.at(j)));
+    }
+  }
+
+  void HPAStar::assemble_graph()
+  {
+    // Number the entrances of every cluster
+    entrance_nodes.clear();
+    std::vector<int> node_cells;
+
+    for(const auto & cluster : clusters)
+    {
+      for(const int cell : cluster.entrances)
+      {
+        entrance_nodes[cell] = node_cells.size();
+        node_cells.push_back(cell);
+      }
+    }
+
+    std::vector<std::vector<std::pair<int, double>>> adjacency(node_cells.size());
+
+    for(const auto & cluster : clusters)
+    {
+      const int n = cluster.entrances.size();
+
+      for(int i = 0; i < n; i++)
+      {
+        const int u = entrance_nodes.at(cluster.entrances.at(i));
+
+        for(int j = 0; j < n; j++)
+        {
+          const double w = cluster.costs.at(i * n + j);
+
+          if(i != j && w < BIG_NUM) adjacency.at(u).push_back({entrance_nodes.at(cluster.entrances.at(j)), w});
+        }
+      }
+
+      for(const auto & crossing : cluster.crossings)
+      {
+        const int a = entrance_nodes.at(crossing.a), b = entrance_nodes.at(crossing.b);
+
+        adjacency.at(a).push_back({b, crossing.w});
+        adjacency.at(b).push_back({a, crossing.w});
+      }
+    }
+
+    int n_edges = 0;
+    for(const auto & edges : adjacency) n_edges += edges.size();
+
+    abstract_graph.clear();
+    abstract_graph.reserve(node_cells.size(), n_edges);
+
+    for(unsigned int u = 0; u < node_cells.size(); u++)
+    {
+      abstract_graph.add_node(implicit_graph.point(node_cells.at(u)));
+
+      for(const auto & edge : adjacency.at(u)) abstract_graph.add_edge(edge.first, edge.second);
+    }
+
+    query.reset(&abstract_graph);
+  }
+
+  bool HPAStar::local_search(int c, int s_start, int s_goal)
+  {
+    const auto & cluster = clusters.at(c);
+
+    local_x = cluster.x;
+    local_y = cluster.y;
+    local_width = cluster.width;
+    local_goal = s_goal;
+
+    if(local_goal != -1) goal_loc = implicit_graph.point(local_goal);
+
+    const int start = local_id(s_start);
+    const int goal = local_goal == -1 ? -1 : local_id(local_goal);
+
+    search_state.reset(cluster.width * cluster.height);
+    open_list.reset(cluster.width * cluster.height);
+
+    search_state.state.at(start) = Open;
+    search_state.g_val.at(start) = 0;
+    search_state.h_val.at(start) = local_goal == -1 ? 0 : h(implicit_graph.point(s_start));
+    search_state.CalcKey(start);
+
+    open_list.push(start, search_state.key_val.at(start));
+
+    // without a goal the search finds the cost to every cell of the cluster, like Dijkstra's algorithm
+    if(local_goal == -1) return local_expand(ZeroHeuristic(), c, -1);
+    else return visit_heuristic([&](const auto & heuristic){ return local_expand(heuristic, c, goal); });
+  }
+
+  template <typename Heuristic>
+  bool HPAStar::local_expand(const Heuristic & heuristic, int c, int goal)
+  {
+    const auto & cluster = clusters.at(c);
+    const LocalCells cells{this};
+    DistanceCost<> cost;
+
+    const double straight = known_grid_p->get_resolution();
+    const double diagonal = std::sqrt(2.0) * straight;
+
+    while(!open_list.empty())
+    {
+      const int cur_id = open_list.pop();
+      expansions++;
+
+      if(cur_id == goal) return true;
+
+      search_state.state.at(cur_id) = Closed;
+
+      const int x = cur_id % cluster.width;
+      const int y = cur_id / cluster.width;
+
+      for(int m = -1; m < 2; m++) //y shift
+      {
+        for(int n = -1; n < 2; n++) //x shift
+        {
+          // skip over the 0 shift and any cell outside of the cluster or not free
+          if(m == 0 && n == 0) continue;
+          else if(x + n < 0 || x + n >= cluster.width || y + m < 0 || y + m >= cluster.height) continue;
+          else if(!passable(local_x + x + n, local_y + y + m)) continue;
+
+          const int node_id = cur_id + m * cluster.width + n;
+
+          if(search_state.state.at(node_id) == Closed) continue;
+
+          if(!relax(cells, heuristic, cost, cur_id, node_id, (m != 0 && n != 0) ? diagonal : straight)) continue;
+
+          search_state.state.at(node_id) = Open;
+          open_list.push(node_id, search_state.key_val.at(node_id));
+        }
+      }
+    }
+
+    return goal == -1;
+  }
+
+  int HPAStar::local_id(int cell) const
+  {
+    return (cell / occupancy.width - local_y) * local_width + cell % occupancy.width - local_x;
+  }
+
+  int HPAStar::local_cell(int id) const
+  {
+    return occupancy.id(local_x + id % local_width, local_y + id / local_width);
+  }
+
+  void HPAStar::attach(int node, int cell)
+  {
+    const int c = get_cluster(cell);
+
+    local_search(c, cell, -1);
+
+    for(const int entrance : clusters.at(c).entrances)
+    {
+      const double w = search_state.g_val.at(local_id(entrance));
+
+      if(w < BIG_NUM) query.add_edge(node, entrance_nodes.at(entrance), w);
+    }
+  }
+}
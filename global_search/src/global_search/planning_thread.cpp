@@ -0,0 +1,169 @@
+/// \file
+/// \brief Run an incremental search on its own thread, fed by map updates and publishing paths without blocking the caller
+
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "global_search/planning_thread.hpp"
+#include "global_search/heuristic_search.hpp"
+
+namespace hsearch
+{
+  PlanningThread::PlanningThread(LPAStar & search, unsigned int queue_size) : search_p(&search), deltas(queue_size) {}
+
+  PlanningThread::PlanningThread(DStarLite & search, unsigned int queue_size) : search_p(&search), robot_search_p(&search),
+                                                                                deltas(queue_size) {}
+
+  PlanningThread::~PlanningThread()
+  {
+    stop();
+  }
+
+  void PlanningThread::start()
+  {
+    if(running.exchange(true)) return;
+
+    worker = std::thread(&PlanningThread::run, this);
+  }
+
+  void PlanningThread::stop()
+  {
+    if(!running.exchange(false)) return;
+
+    {
+      std::lock_guard<std::mutex> lock(wake_mutex);
+    }
+    wake.notify_one();
+
+    worker.join();
+  }
+
+  bool PlanningThread::submit(MapDelta && delta)
+  {
+    if(!deltas.try_push(std::move(delta))) return false;
+
+    submitted++;
+
+    // take the lock so the planning thread is either awake or already waiting, otherwise the notification could be missed
+    {
+      std::lock_guard<std::mutex> lock(wake_mutex);
+    }
+    wake.notify_one();
+
+    return true;
+  }
+
+  bool PlanningThread::try_get_plan(Plan & plan)
+  {
+    std::lock_guard<std::mutex> lock(plan_mutex);
+
+    if(!fresh_plan) return false;
+
+    std::swap(plan, front_plan);
+    fresh_plan = false;
+
+    return true;
+  }
+
+  unsigned long long PlanningThread::get_submitted() const
+  {
+    return submitted;
+  }
+
+  void PlanningThread::run()
+  {
+    unsigned long long revision = 0;
+
+    MapDelta delta;
+    std::vector<MapDelta> batch;
+    std::vector<std::pair<rigid2d::Vector2D, signed char>> cells;
+
+    publish(true, revision);
+
+    while(true)
+    {
+      {
+        std::unique_lock<std::mutex> lock(wake_mutex);
+        // an anytime search that ran out of time keeps improving its path until new deltas arrive
+        wake.wait(lock, [this]{ return !running || !deltas.empty() || search_p->can_improve(); });
+      }
+
+      if(!running) return;
+
+      // take every delta that arrived during the last search
+      batch.clear();
+
+      while(deltas.try_pop(delta)) batch.push_back(std::move(delta));
+
+      revision += batch.size();
+
+      // D* Lite only needs the latest robot location, the key modifier grows by the heuristic from the previous one
+      for(auto it = batch.rbegin(); robot_search_p && it < batch.rend(); it++)
+      {
+        if(it->move_robot)
+        {
+          robot_search_p->UpdateRobotLoc(it->robot_loc);
+          break;
+        }
+      }
+
+      // apply the updates in order, with the cells of consecutive deltas merged into one map change
+      bool changed = false;
+      cells.clear();
+
+      for(const auto & update : batch)
+      {
+        cells.insert(cells.end(), update.cells.begin(), update.cells.end());
+
+        if(update.patches.empty()) continue;
+
+        if(!cells.empty()) changed = search_p->MapChange(cells) || changed;
+        cells.clear();
+
+        for(const auto & patch : update.patches) changed = search_p->MapChange(patch) || changed;
+      }
+
+      if(!cells.empty()) changed = search_p->MapChange(cells) || changed;
+
+      publish(changed || search_p->can_improve(), revision);
+    }
+  }
+
+  void PlanningThread::publish(bool replan, unsigned long long revision)
+  {
+    back_plan.revision = revision;
+    back_plan.replanned = replan;
+
+    if(replan)
+    {
+      last_found = search_p->ComputeShortestPath();
+      back_plan.path = search_p->get_path();
+      back_plan.expanded_nodes = search_p->get_expanded_nodes();
+      back_plan.epsilon = search_p->get_epsilon();
+    }
+    else
+    {
+      back_plan.path.clear();
+      back_plan.expanded_nodes.clear();
+    }
+
+    back_plan.found = last_found;
+    back_plan.search_stats = search_p->get_stats();
+
+    std::lock_guard<std::mutex> lock(plan_mutex);
+
+    // a plan without a search must not hide a new path that has not been taken yet
+    if(!replan && fresh_plan)
+    {
+      front_plan.revision = back_plan.revision;
+      std::swap(front_plan.search_stats, back_plan.search_stats);
+    }
+    else
+    {
+      std::swap(front_plan, back_plan);
+      fresh_plan = true;
+    }
+  }
+}
@@ -1,15 +1,25 @@
 /// \file
 /// \brief A library to plan based on a potential field
 
+#include <algorithm>
+#include <cmath>
 #include <vector>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "global_search/potential_fields.hpp"
 #include "rigid2d/rigid2d.hpp"
 #include "roadmap/collision.hpp"
+#include "roadmap/distance_field.hpp"
 #include "roadmap/grid.hpp"
+#include "roadmap/parallel.hpp"
 
 namespace pfield
 {
+  /// \brief The number of locations advanced together by the batch planner
+  static constexpr int particle_block = 64;
 
   PtField::PtField(grid::Map map, rigid2d::Vector2D goal, double z, double aw, double dg, double rw, double Qs)
   {
@@ -25,7 +35,7 @@ namespace pfield
     Qstar = Qs;
   }
 
-  rigid2d::Vector2D PtField::PlanOneStep(rigid2d::Vector2D cur_loc)
+  rigid2d::Vector2D PtField::PlanOneStep(rigid2d::Vector2D cur_loc) const
   {
     rigid2d::Vector2D next_loc = cur_loc;
 
@@ -44,12 +54,149 @@ namespace pfield
     return next_loc;
   }
 
-  std::vector<rigid2d::Vector2D> PtField::get_path()
+  bool PtField::PlanPath(rigid2d::Vector2D start, double epsilon, unsigned int max_iters)
+  {
+    final_path = {start};
+
+    auto cur_loc = start;
+
+    // Search for the path while the robot is beyond the termination threshold
+    for(unsigned int i = 0; i < max_iters && cur_loc.distance(goal_loc) > epsilon; i++)
+    {
+      cur_loc = PlanOneStep(cur_loc);
+      final_path.push_back(cur_loc);
+    }
+
+    return cur_loc.distance(goal_loc) <= epsilon;
+  }
+
+  std::vector<std::vector<rigid2d::Vector2D>> PtField::PlanPaths(const std::vector<rigid2d::Vector2D> & starts, double epsilon, unsigned int max_iters,
+                                                                 unsigned int threads) const
+  {
+    std::vector<std::vector<rigid2d::Vector2D>> paths(starts.size());
+
+    const int n_blocks = (starts.size() + particle_block - 1) / particle_block;
+
+    parallel::parallel_for(0, n_blocks, threads, [&](int b)
+    {
+      double xs[particle_block], ys[particle_block];
+      int ids[particle_block];
+      int cnt = 0;
+
+      // load the starts that are not already at the goal
+      for(int k = b * particle_block; k < std::min<int>(starts.size(), (b + 1) * particle_block); k++)
+      {
+        paths.at(k).push_back(starts.at(k));
+
+        if(starts.at(k).distance(goal_loc) > epsilon)
+        {
+          xs[cnt] = starts.at(k).x;
+          ys[cnt] = starts.at(k).y;
+          ids[cnt] = k;
+          cnt++;
+        }
+      }
+
+      for(unsigned int i = 0; i < max_iters && cnt > 0; i++)
+      {
+        StepParticles(xs, ys, cnt);
+
+        // record the new locations and keep the paths that have not reached the goal packed at the front
+        int active = 0;
+
+        for(int p = 0; p < cnt; p++)
+        {
+          const rigid2d::Vector2D loc(xs[p], ys[p]);
+          paths.at(ids[p]).push_back(loc);
+
+          if(loc.distance(goal_loc) > epsilon)
+          {
+            xs[active] = xs[p];
+            ys[active] = ys[p];
+            ids[active] = ids[p];
+            active++;
+          }
+        }
+
+        cnt = active;
+      }
+    });
+
+    return paths;
+  }
+
+  void PtField::StepParticles(double * xs, double * ys, int n) const
+  {
+    double rep_x[particle_block], rep_y[particle_block];
+
+    for(int start = 0; start < n; start += particle_block)
+    {
+      const int cnt = std::min(particle_block, n - start);
+      double * bx = xs + start, * by = ys + start;
+
+      // the repulsive gradient depends on the obstacles near each location, so it is looked up one location at a time
+      for(int p = 0; p < cnt; p++)
+      {
+        const auto rep_grad = calculate_u_rep(rigid2d::Vector2D(bx[p], by[p]));
+        rep_x[p] = rep_grad.x;
+        rep_y[p] = rep_grad.y;
+      }
+
+      int p = 0;
+
+#if defined(__SSE2__)
+      // advance two locations at a time
+      const __m128d goal_x = _mm_set1_pd(goal_loc.x), goal_y = _mm_set1_pd(goal_loc.y);
+      const __m128d aw = _mm_set1_pd(att_weight), dg = _mm_set1_pd(dg_star), step = _mm_set1_pd(zeta);
+
+      for(; p + 1 < cnt; p += 2)
+      {
+        const __m128d x = _mm_loadu_pd(bx + p), y = _mm_loadu_pd(by + p);
+
+        // attractive gradient, using the conic well outside of the threshold
+        const __m128d dx = _mm_sub_pd(x, goal_x), dy = _mm_sub_pd(y, goal_y);
+        const __m128d dist = _mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)));
+
+        __m128d att_x = _mm_mul_pd(dx, aw), att_y = _mm_mul_pd(dy, aw);
+
+        const __m128d conic = _mm_cmpgt_pd(dist, dg);
+        att_x = _mm_or_pd(_mm_and_pd(conic, _mm_div_pd(_mm_mul_pd(dg, att_x), dist)), _mm_andnot_pd(conic, att_x));
+        att_y = _mm_or_pd(_mm_and_pd(conic, _mm_div_pd(_mm_mul_pd(dg, att_y), dist)), _mm_andnot_pd(conic, att_y));
+
+        // step along the normalized total gradient
+        const __m128d tot_x = _mm_add_pd(att_x, _mm_loadu_pd(rep_x + p)), tot_y = _mm_add_pd(att_y, _mm_loadu_pd(rep_y + p));
+        const __m128d len = _mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(tot_x, tot_x), _mm_mul_pd(tot_y, tot_y)));
+
+        _mm_storeu_pd(bx + p, _mm_sub_pd(x, _mm_mul_pd(step, _mm_div_pd(tot_x, len))));
+        _mm_storeu_pd(by + p, _mm_sub_pd(y, _mm_mul_pd(step, _mm_div_pd(tot_y, len))));
+      }
+#endif
+
+      for(; p < cnt; p++)
+      {
+        const rigid2d::Vector2D cur_loc(bx[p], by[p]);
+
+        auto tot_grad = calculate_u_att(cur_loc) + rigid2d::Vector2D(rep_x[p], rep_y[p]);
+        auto next_loc = cur_loc - zeta*tot_grad.normalize();
+
+        bx[p] = next_loc.x;
+        by[p] = next_loc.y;
+      }
+    }
+  }
+
+  void PtField::use_distance_field(double resolution, unsigned int threads)
+  {
+    if(resolution > 0) dist_field = raster::DistanceField(known_map, resolution, threads);
+    else dist_field = raster::DistanceField();
+  }
+
+  std::vector<rigid2d::Vector2D> PtField::get_path() const
   {
     return final_path;
   }
 
-  rigid2d::Vector2D PtField::calculate_u_att(rigid2d::Vector2D cur_loc)
+  rigid2d::Vector2D PtField::calculate_u_att(rigid2d::Vector2D cur_loc) const
   {
     double dist = cur_loc.distance(goal_loc);
     rigid2d::Vector2D att_grad = (cur_loc - goal_loc)*att_weight;
@@ -63,12 +210,24 @@ namespace pfield
     return att_grad;
   }
 
-  rigid2d::Vector2D PtField::calculate_u_rep(rigid2d::Vector2D cur_loc)
+  rigid2d::Vector2D PtField::calculate_u_rep(rigid2d::Vector2D cur_loc) const
   {
     rigid2d::Vector2D rep_grad;
 
+    // look up the nearest obstacle or boarder in the distance field
+    if(!dist_field.empty())
+    {
+      rigid2d::Vector2D dist_grad;
+      const double dist = dist_field.distance(cur_loc, dist_grad);
+
+      // the gradient vanishes on the ridges between obstacles
+      if(dist_grad.x == 0 && dist_grad.y == 0) return rep_grad;
+
+      return u_rep_gradient(dist, dist_grad.normalize());
+    }
+
     // loop through each obstacle and find the distance to the nearest point
-    for(auto obstacle : known_map.obstacles)
+    for(const auto & obstacle : known_map.obstacles)
     {
       rep_grad += u_rep_component(obstacle, cur_loc);
     }
@@ -79,34 +238,39 @@ namespace pfield
     return rep_grad;
   }
 
-  rigid2d::Vector2D PtField::u_rep_component(std::vector<rigid2d::Vector2D> polygon, rigid2d::Vector2D cur_loc)
+  rigid2d::Vector2D PtField::u_rep_component(const std::vector<rigid2d::Vector2D> & polygon, rigid2d::Vector2D cur_loc) const
   {
-    // add the first vertex to the end to close the loop of line segments
-    polygon.push_back(polygon.at(0));
-
     collision::DistRes min_loc;
     min_loc.distance = BIG_NUM;
 
-    collision::DistRes res;
-
-    // calculate the distance to each line segment and save the minimum distance
-    for(auto it = polygon.begin(); it < polygon.end()-1; it++)
+    // calculate the distance to each line segment, the last vertex connects back to the first, and save the minimum distance
+    for(unsigned int i = 0; i < polygon.size(); i++)
     {
-      res = collision::point_to_line_distance(*it, *(it+1), cur_loc);
+      const auto res = collision::point_to_line_distance(polygon.at(i), polygon.at((i + 1) % polygon.size()), cur_loc);
 
       if(res.distance < min_loc.distance) min_loc = res;
     }
 
+    if(min_loc.distance >= Qstar) return rigid2d::Vector2D(0, 0);
+
+    // the vector that goes from the nearest point on the obstacle to the cur_loc. This is the nearest point of the nearest edge, so the
+    // push is the negative gradient of the distance, like the distance field. The original code pointed away from the nearest point of
+    // the last edge it checked, which is only the nearest edge beside the closing edge of the polygon.
+    return u_rep_gradient(min_loc.distance, (cur_loc - min_loc.point).normalize());
+  }
+
+  rigid2d::Vector2D PtField::u_rep_gradient(double distance, rigid2d::Vector2D unit_distvec) const
+  {
     rigid2d::Vector2D buf(0,0);
 
     // calculate the component of the repulsive gradient based on the range of influence
-    if(min_loc.distance < Qstar)
+    if(distance < Qstar)
     {
-      // First get the vector that goes from the point on obstacle to the cur_loc
-      auto unit_distvec = (cur_loc - res.point).normalize();
+      // keep the gradient finite when touching an obstacle
+      distance = std::max(distance, 1e-6);
 
       // calculate the gradient
-      buf = rep_weight * ((1.0/Qstar) - (1.0/min_loc.distance)) * (1.0/(min_loc.distance*min_loc.distance)) * unit_distvec;
+      buf = rep_weight * ((1.0/Qstar) - (1.0/distance)) * (1.0/(distance*distance)) * unit_distvec;
     }
 
     return buf;
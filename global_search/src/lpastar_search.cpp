@@ -8,39 +8,82 @@
 ///     robot_radius (double) buffer radius to avoid collisions with the robot body
 ///     cell_size (double) scaling factor for the map
 ///     grid_res (double) scaling factor for the grid cell size
+///     build_threads (unsigned int) number of threads used to build the grid, 0 uses all cores
+///     map_cache_dir (std::string) directory of the binary map cache, empty to build the maps on every launch
 ///     r (std::vector<int>) color values
 ///     g (std::vector<int>) color values
 ///     b (std::vector<int>) color values
 ///     start std::vector<double> two double values representing the x,y of the start point
 ///     goal std::vector<double> two double values representing the x,y of the goal point
+///     simulate_sensor (bool) reveal the obstacles one grid row at a time, turn off to only plan on the costmap
+///     occupied_threshold (int) costmap values at or above the threshold are occupied, lower values are free
+///     unknown_occupied (bool) treat unknown costmap values (-1) as occupied, otherwise they are free and the path may cross unexplored space
+///     octile_heuristic (bool) estimate the cost to goal with the octile distance of the 8 connected grid instead of the Euclidean distance
+///     anytime_epsilons (std::vector<double>) decreasing heuristic weights of the anytime search, [1.0] only finds the shortest path
+///     planning_budget (double) seconds each planning step may search before the best path so far is used, 0 for no limit
 /// PUBLISHES:
 ///     /visualization_marker_array (visualization_msgs::MarkerArray) markers
-///     /grid_map (nav_msgs::OccupancyGrid) occupancy data
-
+///     /grip_map (nav_msgs::OccupancyGrid) occupancy data, sent again when a subscriber connects
+///     /grip_map_updates (map_msgs::OccupancyGridUpdate) the rectangle of occupancy data that changed
+///     /planned_path (nav_msgs::Path) the current path from the robot to the goal
+///     /diagnostics (diagnostic_msgs::DiagnosticArray) statistics of the grid build and the searches so far
+/// SUBSCRIBES:
+///     /costmap (nav_msgs::OccupancyGrid) occupancy data to plan on, with the resolution of the grid
+///     /costmap_updates (map_msgs::OccupancyGridUpdate) rectangular updates of the costmap
+
+#include <string>
 #include <vector>
 #include <algorithm>
 #include <XmlRpcValue.h>
 
 #include <ros/ros.h>
 
+#include "diagnostic_msgs/DiagnosticArray.h"
 #include "geometry_msgs/Point.h"
+#include "map_msgs/OccupancyGridUpdate.h"
+#include "nav_msgs/OccupancyGrid.h"
 #include "visualization_msgs/MarkerArray.h"
 #include "visualization_msgs/Marker.h"
 
 #include "global_search/heuristic_search.hpp"
+#include "global_search/planning_thread.hpp"
 #include "rigid2d/rigid2d.hpp"
+#include "roadmap/marker_tracker.hpp"
 #include "roadmap/prm.hpp"
 #include "roadmap/utility.hpp"
 
+static nav_msgs::OccupancyGrid::ConstPtr costmap; ///< the newest costmap, null once it has been passed to the planner
+static std::vector<map_msgs::OccupancyGridUpdate::ConstPtr> costmap_updates; ///< costmap updates waiting for the planner
+
+/// \brief Save a new costmap, which replaces any updates that have not been passed to the planner
+/// \param msg the costmap
+static void callback_costmap(const nav_msgs::OccupancyGrid::ConstPtr & msg)
+{
+  costmap = msg;
+  costmap_updates.clear();
+}
+
+/// \brief Save a costmap update
+/// \param msg the update
+static void callback_costmap_update(const map_msgs::OccupancyGridUpdate::ConstPtr & msg)
+{
+  costmap_updates.push_back(msg);
+}
+
 int main(int argc, char** argv)
 {
   ros::init(argc, argv, "lpastar_search");
   ros::NodeHandle n;
 
   ros::Publisher pub_map = n.advertise<nav_msgs::OccupancyGrid>("grip_map", 2);
+  ros::Publisher pub_map_updates = n.advertise<map_msgs::OccupancyGridUpdate>("grip_map_updates", 2);
   ros::Publisher pub_markers = n.advertise<visualization_msgs::MarkerArray>("visualization_marker_array", 2);
+  ros::Publisher pub_path = n.advertise<nav_msgs::Path>("planned_path", 2);
+  ros::Publisher pub_diagnostics = n.advertise<diagnostic_msgs::DiagnosticArray>("diagnostics", 2);
+
+  ros::Subscriber costmap_sub = n.subscribe("costmap", 1, callback_costmap);
+  ros::Subscriber costmap_update_sub = n.subscribe("costmap_updates", 10, callback_costmap_update);
 
-  std::vector<visualization_msgs::Marker> markers;
   visualization_msgs::MarkerArray pub_marks;
 
   std::vector<double> map_x_lims, map_y_lims;
@@ -48,8 +91,16 @@ int main(int argc, char** argv)
   XmlRpc::XmlRpcValue obstacles;
   double robot_radius = 0.0;
   int grid_res = 1;
+  int build_threads = 1;
+  std::string map_cache_dir;
   std::vector<double> r, g, b;
   double cell_size = 1.0;
+  bool simulate_sensor = true;
+  int occupied_threshold = 50;
+  bool unknown_occupied = false;
+  bool octile_heuristic = false;
+  std::vector<double> anytime_epsilons = {1.0};
+  double planning_budget = 0.0;
 
   n.getParam("obstacles", obstacles);
   n.getParam("map_x_lims", map_x_lims);
@@ -57,12 +108,20 @@ int main(int argc, char** argv)
   n.getParam("robot_radius", robot_radius);
   n.getParam("cell_size", cell_size);
   n.getParam("grid_res", grid_res);
+  n.getParam("build_threads", build_threads);
+  n.getParam("map_cache_dir", map_cache_dir);
   n.getParam("r", r);
   n.getParam("g", g);
   n.getParam("b", b);
 
   n.getParam("start", start);
   n.getParam("goal", goal);
+  n.getParam("simulate_sensor", simulate_sensor);
+  n.getParam("occupied_threshold", occupied_threshold);
+  n.getParam("unknown_occupied", unknown_occupied);
+  n.getParam("octile_heuristic", octile_heuristic);
+  n.getParam("anytime_epsilons", anytime_epsilons);
+  n.getParam("planning_budget", planning_budget);
 
   std::vector<std::vector<double>> colors;
 
@@ -90,15 +149,16 @@ int main(int argc, char** argv)
 
   // Initialize Grid that represents the fully known map
   grid::Grid grid_world(polygons, map_x_lims, map_y_lims);
-  grid_world.build_grid(cell_size, grid_res, robot_radius);
-  grid_world.generate_centers_graph();
+
+  if(utility::load_or_build(grid_world, map_cache_dir, cell_size, grid_res, robot_radius, build_threads))
+  {
+    ROS_INFO_STREAM("GDSRCH: Loaded the grid from the map cache in " << map_cache_dir);
+  }
 
   // Initialize an empty grid of free cells
   grid::Grid free_grid(map_x_lims, map_y_lims);
-  free_grid.build_grid(cell_size, grid_res, robot_radius);
-  free_grid.generate_centers_graph();
+  free_grid.build_grid(cell_size, grid_res, robot_radius, build_threads);
 
-  auto grid_graph = free_grid.get_nodes();
   auto grid_dims = free_grid.get_grid_dimensions();
 
   // convert start/goal to vector2D
@@ -127,114 +187,156 @@ int main(int argc, char** argv)
   }
 
   // Initialize the search on the empty map
-  hsearch::LPAStar lpa_search(&grid_graph, &free_grid, start_pt, goal_pt);
+  hsearch::LPAStar lpa_search(&free_grid, start_pt, goal_pt);
 
-  // Buffer variables to save all the markers to detele/update
-  std::vector<visualization_msgs::Marker> path_markers;
-  visualization_msgs::Marker exp_nodes;
+  if(octile_heuristic) lpa_search.set_heuristic(hsearch::Octile);
 
-  auto start_node = free_grid.get_nodes().at(start_pt.y).at(start_pt.x);
-  auto goal_node = free_grid.get_nodes().at(goal_pt.y).at(goal_pt.x);
+  lpa_search.set_schedule(anytime_epsilons);
+  lpa_search.set_time_budget(planning_budget);
 
-  ros::Rate frames(2);
+  // The planning thread owns the search and free_grid from here on, so keep a copy of the grid to draw
+  grid::Grid display_grid = free_grid;
+  hsearch::PlanningThread planner(lpa_search);
+
+  // Only the markers that changed since the last frame are published
+  utility::MarkerTracker tracker;
+  unsigned int marker_subscribers = 0;
+
+  prm::Node start_node, goal_node;
 
-  bool new_info = true;
+  start_node.id = start_pt.y * grid_dims.at(0) + start_pt.x;
+  start_node.point = display_grid.grid_to_world(start_pt);
+
+  goal_node.id = goal_pt.y * grid_dims.at(0) + goal_pt.x;
+  goal_node.point = display_grid.grid_to_world(goal_pt);
+
+  ros::Rate frames(2);
 
-  auto known_occ = grid_world.get_grid();
+  const auto known_occ = grid_world.get_occupancy();
 
   int i = 0;
 
   frames.sleep(); // short pause to give rviz to load
 
-  auto occ_msg = utility::make_grid_msg(&free_grid, cell_size, grid_res);
+  // The map message is patched in place as the grid changes, and only the changed rectangle is published
+  auto occ_msg = utility::make_grid_msg(&display_grid, cell_size, grid_res);
+  map_msgs::OccupancyGridUpdate occ_update;
+  unsigned int map_subscribers = pub_map.getNumSubscribers();
+
   pub_map.publish(occ_msg);
 
+  planner.start();
+
   std::vector<rigid2d::Vector2D> lpa_path;
   std::vector<rigid2d::Vector2D> lpa_expands;
 
+  hsearch::Plan plan;
+
+  hsearch::MapDelta pending_update; // map updates waiting for room in the planning queue
+
+  grid::OccupancyPatch costmap_patch; // the costmap in grid coordinates, which the costmap updates are relative to
+  bool have_costmap = false;
+
   // Start loop
   while(ros::ok())
   {
-    // std::cout << i << "\tNew Info?: " << new_info << "\n";
-
-    // If there is new map information, update the path as needed
-    if(new_info)
+    // If the planning thread has published a new path, update the path as needed
+    if(planner.try_get_plan(plan) && plan.replanned)
     {
-      // Plan path
-      bool lpa_res = lpa_search.ComputeShortestPath();
       ROS_INFO_STREAM("GDSRCH: Search Complete!\n");
 
       // Check for failure
-      if(!lpa_res)
+      if(!plan.found)
       {
         ROS_FATAL_STREAM("GDSRCH: LPA* Search failed to find a path for the current map configuration.\n");
       }
 
       // retrieve results
-      lpa_path = lpa_search.get_path();
-      lpa_expands = lpa_search.get_expanded_nodes();
+      lpa_path = plan.path;
+      lpa_expands = plan.expanded_nodes;
 
-      // Draw Expanded Nodes
-      exp_nodes = utility::make_marker(lpa_expands, cell_size/grid_res, colors.at(2));
-      markers.push_back(exp_nodes);
+      // Draw Expanded Nodes, until the next frame
+      tracker.draw(utility::make_marker(lpa_expands, cell_size/grid_res, colors.at(2)));
     }
 
-    new_info = false;
-
     // VIZUALIZE THE RESULTS
 
     // Draw Start and Goal
-    markers.push_back(utility::make_marker(start_node, cell_size*2, std::vector<double>({0, 1, 0})));
-    markers.push_back(utility::make_marker(goal_node, cell_size*2, std::vector<double>({1, 0, 0})));
+    tracker.draw(utility::make_marker(start_node, cell_size*2, std::vector<double>({0, 1, 0})));
+    tracker.draw(utility::make_marker(goal_node, cell_size*2, std::vector<double>({1, 0, 0})));
 
-    // Draw LPA* path
-    for(auto it = lpa_path.begin(); it < lpa_path.end()-1; it++)
-    {
-      visualization_msgs::Marker buf = utility::make_marker(*it, *(it+1), it-lpa_path.begin(), cell_size, std::vector<double>({0, 0, 0}));
-      path_markers.push_back(buf);
-      markers.push_back(buf);
-    }
+    // Draw LPA* path, there is none until the planning thread publishes the first plan
+    tracker.draw(utility::make_path_marker(lpa_path, 0, cell_size, std::vector<double>({0, 0, 0})));
 
-    // clear blue squares if needed
-    if(lpa_expands.empty())
-    {
-      exp_nodes.action = visualization_msgs::Marker::DELETE;
-      markers.push_back(exp_nodes);
-    }
+    // A new subscriber has not seen the markers that did not change, so send them all again
+    if(pub_markers.getNumSubscribers() > marker_subscribers) tracker.reset();
+    marker_subscribers = pub_markers.getNumSubscribers();
 
-    pub_marks.markers = markers;
-    pub_markers.publish(pub_marks);
+    if(tracker.flush(pub_marks)) pub_markers.publish(pub_marks);
 
-    // vizualize map
-    auto occ_msg = utility::make_grid_msg(&free_grid, cell_size, grid_res);
-    pub_map.publish(occ_msg);
+    // vizualize map, a new subscriber needs the whole map before it can apply the updates
+    if(utility::update_grid_msg(display_grid, occ_msg, occ_update)) pub_map_updates.publish(occ_update);
+
+    if(pub_map.getNumSubscribers() > map_subscribers) pub_map.publish(occ_msg);
+    map_subscribers = pub_map.getNumSubscribers();
+
+    // the path is stored from the goal back to the robot
+    pub_path.publish(utility::make_path_msg(std::vector<rigid2d::Vector2D>(lpa_path.rbegin(), lpa_path.rend())));
+
+    // publish the planner statistics
+    diagnostic_msgs::DiagnosticArray diagnostics;
+    diagnostics.header.stamp = ros::Time::now();
+    diagnostics.status.push_back(utility::make_diagnostic_msg("lpastar_search: grid", grid_world.get_stats()));
+    diagnostics.status.push_back(utility::make_diagnostic_msg("lpastar_search: LPA*", plan.search_stats));
+    pub_diagnostics.publish(diagnostics);
 
     ros::spinOnce();
 
     // sleep til next loop
     frames.sleep();
 
-    // Check for map updates -- Update LPA* one grid row at a time
-    if(i < grid_dims.at(1))
+    // Pass the costmap and its updates to the planning thread
+    if(costmap)
     {
-      std::vector<std::pair<rigid2d::Vector2D, signed char>> map_update;
-
-      // Simulate a sensor by extracting information from the known grid 1 rows at a time
-      auto row = known_occ.at(i);
-      for(auto it = row.begin(); it < row.end(); it++)
+      if(utility::make_patch(*costmap, display_grid, costmap_patch, occupied_threshold, unknown_occupied))
       {
-        int k = std::distance(row.begin(), it);
+        have_costmap = true;
 
-        map_update.push_back(std::make_pair(rigid2d::Vector2D(k, i), *it));
+        display_grid.update_patch(costmap_patch);
+        pending_update.patches.push_back(costmap_patch);
       }
+      else ROS_WARN_STREAM("GDSRCH: The costmap resolution does not match the grid resolution of " << display_grid.get_resolution());
 
-      // Inform LPA* of the "sensor" readings and update all of the effected verticies
-      if(!map_update.empty()) new_info = lpa_search.MapChange(map_update);
+      costmap.reset();
     }
 
-    markers.clear();
-    lpa_expands.clear();
-    path_markers.clear();
+    for(const auto & update : costmap_updates)
+    {
+      if(!have_costmap) break;
+
+      auto patch = utility::make_patch(*update, costmap_patch.x, costmap_patch.y, occupied_threshold, unknown_occupied);
+
+      display_grid.update_patch(patch);
+      pending_update.patches.push_back(std::move(patch));
+    }
+
+    costmap_updates.clear();
+
+    // Check for map updates -- Update LPA* one grid row at a time
+    if(simulate_sensor && i < grid_dims.at(1))
+    {
+      // Simulate a sensor by copying the next row of the known grid
+      grid::OccupancyPatch row(0, i, grid_dims.at(0), 1);
+      std::copy(known_occ.data + known_occ.id(0, i), known_occ.data + known_occ.id(0, i + 1), row.data.begin());
+
+      display_grid.update_patch(row);
+      pending_update.patches.push_back(std::move(row));
+    }
+
+    // Inform LPA* of the "sensor" readings, the planning thread updates all of the effected verticies. Updates that do not fit in the
+    // queue are sent with the next ones.
+    if(!pending_update.patches.empty() && planner.submit(std::move(pending_update))) pending_update = hsearch::MapDelta();
+
     i++;
   }
 }
@@ -0,0 +1,671 @@
+/// \file
+/// \brief Benchmarks of the road map builders and the global search algorithms, built with Google Benchmark and independent of ROS
+///
+/// The scenario is the map from roadmap/config/map_params.yaml with the "Hard" start and goal from global_search/config/search_params.yaml.
+/// Grids are benchmarked at several grid resolutions and road maps at several sample counts. Besides the time, each benchmark
+/// reports counters for the nodes expanded, the latency percentiles of the individual queries and the peak resident memory of the process.
+///
+/// USAGE:
+///     planner_benchmark [--benchmark_filter=<regex>] [--benchmark_repetitions=<n>] [--benchmark_format=<console|json|csv>]
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include <benchmark/benchmark.h>
+
+#include "global_search/heuristic_search.hpp"
+#include "global_search/hierarchical_search.hpp"
+#include "global_search/potential_fields.hpp"
+#include "rigid2d/rigid2d.hpp"
+#include "roadmap/graph.hpp"
+#include "roadmap/grid.hpp"
+#include "roadmap/map_cache.hpp"
+#include "roadmap/prm.hpp"
+
+/// \brief The obstacles of map_params.yaml in map units, the verticies of each polygon in counter-clockwise order
+static const std::vector<std::vector<std::vector<double>>> obstacle_data = {
+  {{12.0, 6.0}, {14.5, 3.5}, {17.0, 5.5}, {17.0, 8.5}, {14.0, 8.0}},
+  {{24.0, 6.0}, {26.0, 3.5}, {31.0, 7.5}, {24.5, 9.5}},
+  {{34.0, 26.0}, {10.0, 26.0}, {10.0, 12.0}, {34.0, 12.0}},
+  {{0.0, 26.0}, {0.0, 6.0}, {4.0, 6.0}, {4.0, 26.0}},
+  {{4.0, 32.0}, {6.0, 30.0}, {8.0, 32.0}},
+  {{17.0, 32.0}, {18.0, 30.0}, {19.0, 32.0}},
+  {{0.0, 36.0}, {0.0, 32.0}, {29.0, 32.0}, {29.0, 36.0}},
+  {{34.0, 36.0}, {33.0, 34.0}, {34.0, 32.0}},
+  {{6.0, 44.0}, {2.0, 43.0}, {2.0, 39.0}, {6.0, 38.0}, {8.0, 41.0}},
+  {{11.0, 48.0}, {17.0, 41.0}, {14.0, 48.0}},
+  {{30.0, 48.0}, {22.0, 40.0}, {32.0, 48.0}}};
+
+static constexpr double map_x_max = 34; ///< upper x bound of the map in map units
+static constexpr double map_y_max = 48; ///< upper y bound of the map in map units
+
+static constexpr double cell_size = 0.2; ///< meters per map unit
+static constexpr double robot_radius = 0.15; ///< buffer radius around the robot in meters
+static constexpr unsigned int k_nearest = 10; ///< neighbors each road map node tries to connect to
+static constexpr unsigned int prm_seed = 0; ///< fixed seed so every run builds the same road maps
+
+static constexpr double start_x = 7; ///< x location of the start in map units
+static constexpr double start_y = 3; ///< y location of the start in map units
+static constexpr double goal_x = 31; ///< x location of the goal in map units
+static constexpr double goal_y = 43; ///< y location of the goal in map units
+
+static constexpr double sensor_range = 0.6; ///< range of the simulated sensor for the D* Lite replans in meters
+
+static constexpr double att_weight = 0.6; ///< weighting factor of the attractive potential
+static constexpr double dgstar = 3; ///< piecewise threshold of the attractive potential
+static constexpr double rep_weight = 0.1; ///< weighting factor of the repulsive potential
+static constexpr double Qstar = 0.4; ///< obstacle range of influence
+static constexpr double epsilon = 0.05; ///< potential field termination threshold
+static constexpr double zeta = 0.01; ///< potential field step size
+static constexpr unsigned int max_iters = 20000; ///< maximum number of potential field steps
+static constexpr double field_start_x = 31; ///< x location of the potential field start in map units
+static constexpr double field_start_y = 38; ///< y location of the potential field start in map units
+static constexpr double field_goal_x = 8; ///< x location of the potential field goal in map units
+static constexpr double field_goal_y = 10; ///< y location of the potential field goal in map units
+static constexpr double field_resolution = 0.05; ///< cell size of the distance field option of the potential field
+
+/// \brief Build the obstacle polygons
+/// \param scale meters per map unit
+/// \returns the scaled polygons
+static std::vector<std::vector<rigid2d::Vector2D>> make_polygons(double scale)
+{
+  std::vector<std::vector<rigid2d::Vector2D>> polygons;
+
+  for(const auto & obstacle : obstacle_data)
+  {
+    std::vector<rigid2d::Vector2D> polygon;
+    for(const auto & vertex : obstacle) polygon.push_back(rigid2d::Vector2D(vertex.at(0) * scale, vertex.at(1) * scale));
+
+    polygons.push_back(polygon);
+  }
+
+  return polygons;
+}
+
+/// \brief Build a grid the same way as the grid nodes, with the obstacles in map units
+/// \param grid_res the grid resolution
+/// \param with_obstacles false for a grid of only free cells
+/// \returns the built grid
+static grid::Grid make_grid(unsigned int grid_res, bool with_obstacles=true)
+{
+  const std::vector<double> x_lims = {0, map_x_max}, y_lims = {0, map_y_max};
+
+  grid::Grid output = with_obstacles ? grid::Grid(make_polygons(1), x_lims, y_lims) : grid::Grid(x_lims, y_lims);
+  output.build_grid(cell_size, grid_res, robot_radius);
+
+  return output;
+}
+
+/// \brief Build a road map the same way as prm_search, with the obstacles in meters
+/// \param samples the number of nodes
+/// \param lazy true to skip the edge collision checks
+/// \returns the built road map
+static prm::RoadMap make_road_map(unsigned int samples, bool lazy=false)
+{
+  prm::RoadMap output(make_polygons(cell_size), {0, map_x_max * cell_size}, {0, map_y_max * cell_size});
+
+  output.set_seed(prm_seed);
+  output.set_lazy(lazy);
+  output.build_map(samples, k_nearest, robot_radius);
+
+  return output;
+}
+
+/// \brief Get the map used by the searches that check against the obstacles directly
+/// \returns the map in meters
+static grid::Map make_map()
+{
+  return grid::Map(make_polygons(cell_size), {0, map_x_max * cell_size}, {0, map_y_max * cell_size});
+}
+
+/// \brief Record the peak resident memory of the process, which only grows as the benchmarks run
+/// \param state the benchmark to add the counter to
+static void report_memory(benchmark::State & state)
+{
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  // linux reports the maximum resident set size in kilobytes
+  state.counters["peak_MB"] = usage.ru_maxrss / 1024.0;
+}
+
+/// \brief Collect the latency of every query in a benchmark and report the percentiles
+class Latencies
+{
+public:
+
+  /// \brief Time a call and record its latency
+  /// \param fn the call to time
+  /// \returns the latency in seconds
+  template <typename Fn>
+  double time(Fn && fn)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    samples.push_back(elapsed);
+
+    return elapsed;
+  }
+
+  /// \brief Add the 50th, 90th and 99th percentiles in microseconds to the counters of a benchmark
+  /// \param state the benchmark to add the counters to
+  void report(benchmark::State & state)
+  {
+    if(samples.empty()) return;
+
+    std::sort(samples.begin(), samples.end());
+
+    state.counters["p50_us"] = percentile(0.50) * 1e6;
+    state.counters["p90_us"] = percentile(0.90) * 1e6;
+    state.counters["p99_us"] = percentile(0.99) * 1e6;
+  }
+
+private:
+  std::vector<double> samples; ///< the recorded latencies in seconds
+
+  /// \brief Get a percentile of the sorted samples
+  /// \param p the fraction of the samples at or below the result
+  /// \returns the latency of the nearest sample
+  double percentile(double p) const
+  {
+    const int i = static_cast<int>(std::ceil(p * samples.size())) - 1;
+    return samples.at(std::min(std::max(i, 0), static_cast<int>(samples.size()) - 1));
+  }
+};
+
+// ===========================================================================
+// MAP BUILDING ==============================================================
+// ===========================================================================
+
+/// \brief Build the occupancy data of a grid, range(0) is the grid resolution
+static void BM_BuildGrid(benchmark::State & state)
+{
+  grid::Grid test_grid(make_polygons(1), {0, map_x_max}, {0, map_y_max});
+  Latencies latencies;
+
+  for(auto _ : state)
+  {
+    latencies.time([&]{ test_grid.build_grid(cell_size, state.range(0), robot_radius); });
+    benchmark::ClobberMemory();
+  }
+
+  const auto dims = test_grid.get_grid_dimensions();
+  state.counters["cells"] = dims.at(0) * dims.at(1);
+
+  latencies.report(state);
+  report_memory(state);
+}
+BENCHMARK(BM_BuildGrid)->ArgName("grid_res")->Arg(1)->Arg(2)->Arg(5)->Unit(benchmark::kMicrosecond);
+
+/// \brief Build the graph of the grid cell centers, range(0) is the grid resolution
+static void BM_GenerateCentersGraph(benchmark::State & state)
+{
+  grid::Grid test_grid = make_grid(state.range(0));
+  Latencies latencies;
+
+  for(auto _ : state)
+  {
+    latencies.time([&]{ test_grid.generate_centers_graph(); });
+    benchmark::ClobberMemory();
+  }
+
+  state.counters["edges"] = test_grid.get_graph().num_edges();
+
+  latencies.report(state);
+  report_memory(state);
+}
+BENCHMARK(BM_GenerateCentersGraph)->ArgName("grid_res")->Arg(1)->Arg(2)->Arg(5)->Unit(benchmark::kMicrosecond);
+
+/// \brief Sample and connect a road map, range(0) is the number of samples and range(1) is 1 for a lazy road map
+static void BM_BuildMap(benchmark::State & state)
+{
+  Latencies latencies;
+  unsigned int edges = 0;
+
+  for(auto _ : state)
+  {
+    latencies.time([&]{ edges = make_road_map(state.range(0), state.range(1)).get_edges().size(); });
+  }
+
+  state.counters["edges"] = edges;
+
+  latencies.report(state);
+  report_memory(state);
+}
+BENCHMARK(BM_BuildMap)->ArgNames({"samples", "lazy"})->ArgsProduct({{500, 1000, 2000}, {0, 1}})->Unit(benchmark::kMillisecond);
+
+/// \brief Load a grid and its centers graph from the map cache, range(0) is the grid resolution
+static void BM_LoadGrid(benchmark::State & state)
+{
+  grid::Grid built = make_grid(state.range(0));
+  built.generate_centers_graph();
+
+  const auto key = built.get_cache_key(cell_size, state.range(0), robot_radius);
+  const auto file_name = cache::cache_file("/tmp", "planner_benchmark_grid", key);
+
+  if(!built.save(file_name, key))
+  {
+    state.SkipWithError("could not write the map cache");
+    return;
+  }
+
+  grid::Grid test_grid(make_polygons(1), {0, map_x_max}, {0, map_y_max});
+  Latencies latencies;
+
+  for(auto _ : state)
+  {
+    latencies.time([&]{ benchmark::DoNotOptimize(test_grid.load(file_name, key)); });
+    benchmark::ClobberMemory();
+  }
+
+  std::remove(file_name.c_str());
+
+  latencies.report(state);
+  report_memory(state);
+}
+BENCHMARK(BM_LoadGrid)->ArgName("grid_res")->Arg(1)->Arg(2)->Arg(5)->Unit(benchmark::kMicrosecond);
+
+/// \brief Load a road map from the map cache, range(0) is the number of samples
+static void BM_LoadMap(benchmark::State & state)
+{
+  const prm::RoadMap built = make_road_map(state.range(0));
+
+  const auto key = built.get_cache_key(state.range(0), k_nearest, robot_radius);
+  const auto file_name = cache::cache_file("/tmp", "planner_benchmark_roadmap", key);
+
+  if(!built.save(file_name, key))
+  {
+    state.SkipWithError("could not write the map cache");
+    return;
+  }
+
+  Latencies latencies;
+
+  for(auto _ : state)
+  {
+    prm::RoadMap test_map(make_polygons(cell_size), {0, map_x_max * cell_size}, {0, map_y_max * cell_size});
+    test_map.set_seed(prm_seed);
+
+    latencies.time([&]{ benchmark::DoNotOptimize(test_map.load(file_name, key)); });
+  }
+
+  std::remove(file_name.c_str());
+
+  latencies.report(state);
+  report_memory(state);
+}
+BENCHMARK(BM_LoadMap)->ArgName("samples")->Arg(500)->Arg(1000)->Arg(2000)->Unit(benchmark::kMillisecond);
+
+// ===========================================================================
+// ROAD MAP QUERIES ==========================================================
+// ===========================================================================
+
+/// \brief Repeat a search between the start and goal attached to a road map and report the expansions and latencies
+/// \param state the benchmark, range(0) is the number of samples
+/// \param search the search to run, created on the graph of the road map
+/// \param query the query graph with the start and goal attached
+/// \param start_id the ID of the start in the query graph
+/// \param goal_id the ID of the goal in the query graph
+static void run_queries(benchmark::State & state, hsearch::HSearch & search, const graph::QueryGraph & query, int start_id, int goal_id)
+{
+  Latencies latencies;
+  bool found = false;
+
+  for(auto _ : state)
+  {
+    latencies.time([&]{ found = search.ComputeShortestPath(query, start_id, goal_id); });
+  }
+
+  if(!found) state.SkipWithError("No path between the start and goal.");
+
+  state.counters["expansions"] = search.get_expansion_count();
+  state.counters["path_nodes"] = search.get_path().size();
+
+  latencies.report(state);
+  report_memory(state);
+}
+
+/// \brief A* on a road map, range(0) is the number of samples
+static void BM_AStarPRM(benchmark::State & state)
+{
+  const auto road_map = make_road_map(state.range(0));
+  const auto prm_graph = road_map.get_graph();
+
+  graph::QueryGraph query(&prm_graph);
+  const int start_id = road_map.attach(query, rigid2d::Vector2D(start_x * cell_size, start_y * cell_size));
+  const int goal_id = road_map.attach(query, rigid2d::Vector2D(goal_x * cell_size, goal_y * cell_size));
+
+  hsearch::AStar search(&prm_graph);
+  run_queries(state, search, query, start_id, goal_id);
+}
+BENCHMARK(BM_AStarPRM)->ArgName("samples")->Arg(500)->Arg(1000)->Arg(2000)->Unit(benchmark::kMicrosecond);
+
+/// \brief Theta* on a road map, range(0) is the number of samples. The line of sight cache is warm after the first query.
+static void BM_ThetaStarPRM(benchmark::State & state)
+{
+  const auto road_map = make_road_map(state.range(0));
+  const auto prm_graph = road_map.get_graph();
+
+  graph::QueryGraph query(&prm_graph);
+  const int start_id = road_map.attach(query, rigid2d::Vector2D(start_x * cell_size, start_y * cell_size));
+  const int goal_id = road_map.attach(query, rigid2d::Vector2D(goal_x * cell_size, goal_y * cell_size));
+
+  hsearch::ThetaStar search(&prm_graph, make_map(), robot_radius);
+  run_queries(state, search, query, start_id, goal_id);
+}
+BENCHMARK(BM_ThetaStarPRM)->ArgName("samples")->Arg(500)->Arg(1000)->Arg(2000)->Unit(benchmark::kMicrosecond);
+
+/// \brief Lazy A* on a lazy road map, range(0) is the number of samples. Only the first query checks edges, later queries reuse them.
+static void BM_LazyAStarPRM(benchmark::State & state)
+{
+  const auto road_map = make_road_map(state.range(0), true);
+  const auto prm_graph = road_map.get_graph();
+
+  graph::QueryGraph query(&prm_graph);
+  const int start_id = road_map.attach(query, rigid2d::Vector2D(start_x * cell_size, start_y * cell_size));
+  const int goal_id = road_map.attach(query, rigid2d::Vector2D(goal_x * cell_size, goal_y * cell_size));
+
+  hsearch::LazyAStar search(&prm_graph, make_map(), robot_radius);
+  run_queries(state, search, query, start_id, goal_id);
+}
+BENCHMARK(BM_LazyAStarPRM)->ArgName("samples")->Arg(500)->Arg(1000)->Arg(2000)->Unit(benchmark::kMicrosecond);
+
+/// \brief ARA* on a road map, range(0) is the number of samples and range(1) is 1 to start at a weight of 3 and run every pass of
+/// the default schedule, or 0 to only run the final pass
+static void BM_ARAStarPRM(benchmark::State & state)
+{
+  const auto road_map = make_road_map(state.range(0));
+  const auto prm_graph = road_map.get_graph();
+
+  graph::QueryGraph query(&prm_graph);
+  const int start_id = road_map.attach(query, rigid2d::Vector2D(start_x * cell_size, start_y * cell_size));
+  const int goal_id = road_map.attach(query, rigid2d::Vector2D(goal_x * cell_size, goal_y * cell_size));
+
+  hsearch::ARAStar search(&prm_graph);
+  if(!state.range(1)) search.set_schedule({1.0});
+
+  run_queries(state, search, query, start_id, goal_id);
+}
+BENCHMARK(BM_ARAStarPRM)->ArgNames({"samples", "anytime"})->ArgsProduct({{500, 1000, 2000}, {0, 1}})->Unit(benchmark::kMicrosecond);
+
+// ===========================================================================
+// GRID QUERIES ==============================================================
+// ===========================================================================
+
+/// \brief Theta* on the cell centers of a grid, range(0) is the grid resolution
+static void BM_ThetaStarGrid(benchmark::State & state)
+{
+  const int grid_res = state.range(0);
+
+  grid::Grid test_grid = make_grid(grid_res);
+  test_grid.generate_centers_graph();
+
+  const int width = test_grid.get_grid_dimensions().at(0);
+  const int start_id = start_y * grid_res * width + start_x * grid_res;
+  const int goal_id = goal_y * grid_res * width + goal_x * grid_res;
+
+  hsearch::ThetaStar search(&test_grid.get_graph(), &test_grid);
+  Latencies latencies;
+  bool found = false;
+
+  for(auto _ : state)
+  {
+    latencies.time([&]{ found = search.ComputeShortestPath(start_id, goal_id); });
+  }
+
+  if(!found) state.SkipWithError("No path between the start and goal.");
+
+  state.counters["expansions"] = search.get_expansion_count();
+  state.counters["path_nodes"] = search.get_path().size();
+
+  latencies.report(state);
+  report_memory(state);
+}
+BENCHMARK(BM_ThetaStarGrid)->ArgName("grid_res")->Arg(1)->Arg(2)->Arg(5)->Unit(benchmark::kMicrosecond);
+
+/// \brief Jump Point Search on the occupancy data of a grid, range(0) is the grid resolution and range(1) is 1 to read the jumps from the
+/// precomputed JPS+ distances, which are computed before the timed queries
+static void BM_JPSGrid(benchmark::State & state)
+{
+  const int grid_res = state.range(0);
+
+  const grid::Grid test_grid = make_grid(grid_res);
+
+  const int width = test_grid.get_grid_dimensions().at(0);
+  const int start_id = start_y * grid_res * width + start_x * grid_res;
+  const int goal_id = goal_y * grid_res * width + goal_x * grid_res;
+
+  hsearch::JPSStar search(&test_grid);
+  search.set_heuristic(hsearch::Octile);
+  search.set_precompute(state.range(1));
+
+  if(state.range(1)) search.update_jump_distances();
+
+  Latencies latencies;
+  bool found = false;
+
+  for(auto _ : state)
+  {
+    latencies.time([&]{ found = search.ComputeShortestPath(start_id, goal_id); });
+  }
+
+  if(!found) state.SkipWithError("No path between the start and goal.");
+
+  state.counters["expansions"] = search.get_expansion_count();
+  state.counters["path_nodes"] = search.get_path().size();
+
+  latencies.report(state);
+  report_memory(state);
+}
+BENCHMARK(BM_JPSGrid)->ArgNames({"grid_res", "precompute"})->ArgsProduct({{1, 2, 5}, {0, 1}})->Unit(benchmark::kMicrosecond);
+
+/// \brief HPA* on the clusters of a grid, range(0) is the grid resolution. Building the clusters is not timed, the time to build them
+/// again after a one cell change is reported as a counter.
+static void BM_HPAStarGrid(benchmark::State & state)
+{
+  const int grid_res = state.range(0);
+
+  grid::Grid test_grid = make_grid(grid_res);
+
+  const int width = test_grid.get_grid_dimensions().at(0);
+  const int start_id = start_y * grid_res * width + start_x * grid_res;
+  const int goal_id = goal_y * grid_res * width + goal_x * grid_res;
+
+  hsearch::HPAStar search(&test_grid);
+  Latencies latencies;
+  bool found = false;
+
+  for(auto _ : state)
+  {
+    latencies.time([&]{ found = search.ComputeShortestPath(start_id, goal_id); });
+  }
+
+  if(!found) state.SkipWithError("No path between the start and goal.");
+
+  state.counters["expansions"] = search.get_expansion_count();
+  state.counters["path_nodes"] = search.get_path().size();
+  state.counters["abstract_nodes"] = search.get_abstract_graph().size();
+
+  // close a free cell between the start and goal
+  const auto changed = test_grid.update_grid({{rigid2d::Vector2D(start_x * grid_res, goal_y * grid_res), 100}});
+
+  const auto start = std::chrono::steady_clock::now();
+  state.counters["rebuilt_clusters"] = search.update_cells(changed);
+  state.counters["update_us"] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1e6;
+
+  latencies.report(state);
+  report_memory(state);
+}
+BENCHMARK(BM_HPAStarGrid)->ArgName("grid_res")->Arg(1)->Arg(2)->Arg(5)->Unit(benchmark::kMicrosecond);
+
+/// \brief The initial search of an incremental planner on a fully known grid, creating the search is not timed
+/// \param state the benchmark, range(0) is the grid resolution
+template <typename Search>
+static void BM_InitialSearch(benchmark::State & state)
+{
+  const int grid_res = state.range(0);
+
+  grid::Grid test_grid = make_grid(grid_res);
+
+  const rigid2d::Vector2D start_pt(start_x * grid_res, start_y * grid_res);
+  const rigid2d::Vector2D goal_pt(goal_x * grid_res, goal_y * grid_res);
+
+  Latencies latencies;
+  int expansions = 0;
+  int path_nodes = 0;
+  bool found = false;
+
+  for(auto _ : state)
+  {
+    Search search(&test_grid, start_pt, goal_pt);
+
+    state.SetIterationTime(latencies.time([&]{ found = search.ComputeShortestPath(); }));
+
+    expansions = search.get_expansion_count();
+    path_nodes = search.get_path().size();
+  }
+
+  if(!found) state.SkipWithError("No path between the start and goal.");
+
+  state.counters["expansions"] = expansions;
+  state.counters["path_nodes"] = path_nodes;
+
+  latencies.report(state);
+  report_memory(state);
+}
+BENCHMARK_TEMPLATE(BM_InitialSearch, hsearch::LPAStar)->ArgName("grid_res")->Arg(1)->Arg(2)->Arg(5)->UseManualTime()->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_InitialSearch, hsearch::DStarLite)->ArgName("grid_res")->Arg(1)->Arg(2)->Arg(5)->UseManualTime()->Unit(benchmark::kMicrosecond);
+
+/// \brief Drive the robot from the start to the goal with D* Lite on a grid that starts empty, like dstarlite_search. A simulated sensor
+/// reveals the known cells around the robot after every step, and each map change is followed by a replan. Only the map changes and
+/// replans are timed, the latency percentiles are per replan. range(0) is the grid resolution.
+static void BM_DStarLiteReplan(benchmark::State & state)
+{
+  const int grid_res = state.range(0);
+
+  const grid::Grid known_grid = make_grid(grid_res);
+  const grid::Grid empty_grid = make_grid(grid_res, false);
+
+  const auto known_occ = known_grid.get_occupancy();
+  const auto dims = known_grid.get_grid_dimensions();
+
+  const rigid2d::Vector2D start_pt(start_x * grid_res, start_y * grid_res);
+  const rigid2d::Vector2D goal_pt(goal_x * grid_res, goal_y * grid_res);
+
+  const int range = std::max(static_cast<int>(std::ceil(sensor_range * grid_res / cell_size)), 2);
+
+  Latencies latencies;
+  int replans = 0;
+  long expansions = 0;
+  bool reached = false;
+
+  for(auto _ : state)
+  {
+    grid::Grid free_grid = empty_grid;
+    hsearch::DStarLite search(&free_grid, start_pt, goal_pt);
+
+    search.ComputeShortestPath();
+
+    replans = 0;
+    expansions = 0;
+    reached = false;
+
+    double run_time = 0;
+    grid::OccupancyPatch map_update;
+
+    // the path is stored from the robot to the goal, and only changes when the search replans
+    auto path = search.get_path();
+    unsigned int robot = 0;
+
+    // a step moves the robot to the next cell of the path, so the robot can take at most one step per cell
+    for(int step = 0; step < dims.at(0) * dims.at(1); step++)
+    {
+      if(robot + 1 >= path.size())
+      {
+        reached = !path.empty();
+        break;
+      }
+
+      robot++;
+      const rigid2d::Vector2D robot_grid = free_grid.world_to_grid(path.at(robot));
+
+      // simulate a sensor by copying the window of known cells around the robot
+      const int x_lo = std::max(static_cast<int>(robot_grid.x) - range, 0);
+      const int x_hi = std::min(static_cast<int>(robot_grid.x) + range, dims.at(0));
+      const int y_lo = std::max(static_cast<int>(robot_grid.y) - range, 0);
+      const int y_hi = std::min(static_cast<int>(robot_grid.y) + range, dims.at(1));
+
+      map_update = grid::OccupancyPatch(x_lo, y_lo, x_hi - x_lo, y_hi - y_lo);
+
+      for(int yi = y_lo; yi < y_hi; yi++)
+      {
+        const signed char * row = known_occ.data + known_occ.id(x_lo, yi);
+        std::copy(row, row + map_update.width, map_update.data.begin() + (yi - y_lo) * map_update.width);
+      }
+
+      run_time += latencies.time([&]
+      {
+        search.UpdateRobotLoc(robot_grid);
+
+        if(search.MapChange(map_update))
+        {
+          search.ComputeShortestPath();
+          replans++;
+          expansions += search.get_expansion_count();
+
+          path = search.get_path();
+          robot = 0;
+        }
+      });
+    }
+
+    state.SetIterationTime(run_time);
+  }
+
+  if(!reached) state.SkipWithError("The robot did not reach the goal.");
+
+  state.counters["replans"] = replans;
+  state.counters["expansions"] = expansions;
+
+  latencies.report(state);
+  report_memory(state);
+}
+BENCHMARK(BM_DStarLiteReplan)->ArgName("grid_res")->Arg(1)->Arg(2)->UseManualTime()->Unit(benchmark::kMillisecond);
+
+// ===========================================================================
+// POTENTIAL FIELDS ==========================================================
+// ===========================================================================
+
+/// \brief Plan a path with the potential field, range(0) is 1 to use the distance field for the repulsive gradient. The field gets stuck
+/// in a local minimum between the start and goal of the searches, so it plans through the gaps of both walls from the other side.
+static void BM_PtField(benchmark::State & state)
+{
+  pfield::PtField planner(make_map(), rigid2d::Vector2D(field_goal_x * cell_size, field_goal_y * cell_size), zeta, att_weight, dgstar, rep_weight,
+                          Qstar);
+  if(state.range(0)) planner.use_distance_field(field_resolution);
+
+  const rigid2d::Vector2D start_pt(field_start_x * cell_size, field_start_y * cell_size);
+
+  Latencies latencies;
+  bool found = false;
+
+  for(auto _ : state)
+  {
+    latencies.time([&]{ found = planner.PlanPath(start_pt, epsilon, max_iters); });
+  }
+
+  state.counters["success"] = found;
+  state.counters["steps"] = planner.get_path().size();
+
+  latencies.report(state);
+  report_memory(state);
+}
+BENCHMARK(BM_PtField)->ArgName("field")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
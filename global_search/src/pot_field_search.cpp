@@ -12,6 +12,8 @@
 ///     b (std::vector<int>) color values
 ///     start std::vector<double> two double values representing the x,y of the start point
 ///     goal std::vector<double> two double values representing the x,y of the goal point
+///     max_iters (int) maximum number of gradient descent steps
+///     field_resolution (double) cell size of the distance field used for the repulsive gradient, 0 uses the exact obstacle distances
 /// PUBLISHES:
 ///     /visualization_marker_array (visualization_msgs::MarkerArray) markers
 
@@ -47,6 +49,8 @@ int main(int argc, char** argv)
   double att_weight = 1.0, dgstar = 1.0;
   double rep_weight = 1.0, Qstar = 1.0;
   double epsilon = 0.1, zeta = 0.1;
+  double field_resolution = 0.0;
+  int max_iters = 20000;
 
   n.getParam("obstacles", obstacles);
   n.getParam("map_x_lims", map_x_lims);
@@ -59,6 +63,8 @@ int main(int argc, char** argv)
   n.getParam("Qstar", Qstar);
   n.getParam("epsilon", epsilon);
   n.getParam("zeta", zeta);
+  n.getParam("field_resolution", field_resolution);
+  n.getParam("max_iters", max_iters);
   n.getParam("r", r);
   n.getParam("g", g);
   n.getParam("b", b);
@@ -104,6 +110,8 @@ int main(int argc, char** argv)
   ROS_INFO_STREAM("PFSRCH: Q*: " << Qstar);
   ROS_INFO_STREAM("PFSRCH: epsilon: " << epsilon);
   ROS_INFO_STREAM("PFSRCH: zeta: " << zeta);
+  ROS_INFO_STREAM("PFSRCH: max iters: " << max_iters);
+  ROS_INFO_STREAM("PFSRCH: field resolution: " << field_resolution);
   ROS_INFO_STREAM("PFSRCH: start coordinate: " << start_pt);
   ROS_INFO_STREAM("PFSRCH: goal coordinate: " << goal_pt);
   ROS_INFO_STREAM("PFSRCH: Loaded Params");
@@ -113,10 +121,7 @@ int main(int argc, char** argv)
 
   // Configure Potential Field
   pfield::PtField pot_field_search(map, goal_pt, zeta, att_weight, dgstar, rep_weight, Qstar);
-
-  std::vector<rigid2d::Vector2D> path = {start_pt};
-
-  auto cur_pos = start_pt;
+  pot_field_search.use_distance_field(field_resolution);
 
   std::vector<visualization_msgs::Marker> markers;
   visualization_msgs::MarkerArray pub_marks;
@@ -131,31 +136,19 @@ int main(int argc, char** argv)
   markers.push_back(utility::make_marker(start_node, cell_size*2, std::vector<double>({0, 1, 0}))); // start
   markers.push_back(utility::make_marker(goal_node, cell_size*2, std::vector<double>({1, 0, 0}))); // goal
 
-  ros::Rate frames(1);
-
   ros::Duration(3).sleep(); // wait for rviz
 
   // Search for the path while the robot is beyond the termination threshold
-  while(cur_pos.distance(goal_pt) > epsilon && ros::ok())
-  {
-    ROS_INFO_STREAM("Distance to Go: " << cur_pos.distance(goal_pt));
+  if(pot_field_search.PlanPath(start_pt, epsilon, max_iters)) ROS_INFO_STREAM("PFSRCH: Reached the goal");
+  else ROS_WARN_STREAM("PFSRCH: Stopped after " << max_iters << " steps without reaching the goal");
 
-    cur_pos = pot_field_search.PlanOneStep(cur_pos);
+  const auto path = pot_field_search.get_path();
 
-    path.push_back(cur_pos);
+  // Draw path
+  markers.push_back(utility::make_path_marker(path, 0, cell_size, colors.at(4)));
 
-    // Draw path
-    for(auto it = path.begin(); it < path.end()-1; it++)
-    {
-      markers.push_back(utility::make_marker(*it, *(it+1), it-path.begin(), cell_size, colors.at(4)));
-    }
+  pub_marks.markers = markers;
+  pub_markers.publish(pub_marks);
 
-    pub_marks.markers = markers;
-    pub_markers.publish(pub_marks);
-
-    markers.clear();
-
-    ros::spinOnce();
-    ros::Duration(0.01).sleep();
-  }
+  ros::spin();
 }
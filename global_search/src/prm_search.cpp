@@ -8,6 +8,10 @@
 ///     robot_radius (double) buffer radius to avoid collisions with the robot body
 ///     k_nearest (unsigned int) number of neighboring verticies to match to
 ///     graph_size (unsigned int) number of nodes to use to build the graph
+///     build_threads (unsigned int) number of threads used to build the graph, 0 uses all cores
+///     prm_seed (int) seed for sampling the graph, -1 for a random seed
+///     map_cache_dir (std::string) directory of the binary map cache, empty to build the road map on every launch
+///     lazy_prm (bool) build the graph without edge collision checks and check the edges during the searches instead
 ///     r (std::vector<int>) color values
 ///     g (std::vector<int>) color values
 ///     b (std::vector<int>) color values
@@ -16,12 +20,16 @@
 /// PUBLISHES:
 ///     /visualization_marker_array (visualization_msgs::MarkerArray) markers
 ///     /grid_map (nav_msgs::OccupancyGrid) occupancy data
+///     /planned_path (nav_msgs::Path) the Theta* path from the start to the goal
+///     /diagnostics (diagnostic_msgs::DiagnosticArray) statistics of the road map build and the searches
+#include <string>
 #include <vector>
 #include <algorithm>
 #include <XmlRpcValue.h>
 
 #include <ros/ros.h>
 
+#include "diagnostic_msgs/DiagnosticArray.h"
 #include "geometry_msgs/Point.h"
 #include "visualization_msgs/MarkerArray.h"
 #include "visualization_msgs/Marker.h"
@@ -40,6 +48,8 @@ int main(int argc, char** argv)
   ros::NodeHandle n;
 
   ros::Publisher pub_markers = n.advertise<visualization_msgs::MarkerArray>("visualization_marker_array", 1, true);
+  ros::Publisher pub_path = n.advertise<nav_msgs::Path>("planned_path", 1, true);
+  ros::Publisher pub_diagnostics = n.advertise<diagnostic_msgs::DiagnosticArray>("diagnostics", 1, true);
 
   std::vector<double> map_x_lims, map_y_lims;
   std::vector<double> start, goal;
@@ -47,6 +57,10 @@ int main(int argc, char** argv)
   double robot_radius = 0.0;
   int k_nearest = 5;
   int graph_size = 100;
+  int build_threads = 1;
+  int prm_seed = -1;
+  std::string map_cache_dir;
+  bool lazy_prm = false;
 
   n.getParam("obstacles", obstacles);
   n.getParam("map_x_lims", map_x_lims);
@@ -54,6 +68,10 @@ int main(int argc, char** argv)
   n.getParam("robot_radius", robot_radius);
   n.getParam("k_nearest", k_nearest);
   n.getParam("graph_size", graph_size);
+  n.getParam("build_threads", build_threads);
+  n.getParam("prm_seed", prm_seed);
+  n.getParam("map_cache_dir", map_cache_dir);
+  n.getParam("lazy_prm", lazy_prm);
   n.getParam("cell_size", cell_size);
   n.getParam("r", r);
   n.getParam("g", g);
@@ -95,6 +113,7 @@ int main(int argc, char** argv)
   ROS_INFO_STREAM("PRMSRCH: k_nearest: " << k_nearest);
   ROS_INFO_STREAM("PRMSRCH: graph_size: " << graph_size);
   ROS_INFO_STREAM("PRMSRCH: robot_radius: " << robot_radius);
+  ROS_INFO_STREAM("PRMSRCH: lazy_prm: " << lazy_prm);
   ROS_INFO_STREAM("PRMSRCH: cell size: " << cell_size);
   ROS_INFO_STREAM("PRMSRCH: start coordinate: " << start_pt);
   ROS_INFO_STREAM("PRMSRCH: goal coordinate: " << goal_pt);
@@ -102,47 +121,79 @@ int main(int argc, char** argv)
 
   // Create the PRM
   prm::RoadMap prob_road_map(polygons, map_x_lims, map_y_lims);
-  prob_road_map.build_map(graph_size, k_nearest, robot_radius);
+  if(prm_seed >= 0) prob_road_map.set_seed(prm_seed);
+  prob_road_map.set_lazy(lazy_prm);
 
-  bool resultS, resultG = 0;
+  // a road map without a seed is different every launch, so there is nothing to cache
+  if(prm_seed < 0 && !map_cache_dir.empty())
+  {
+    ROS_WARN_STREAM("PRMSRCH: The map cache needs a prm_seed >= 0, building a random road map.");
+    map_cache_dir.clear();
+  }
 
-  // Add in the start and goal
-  resultS = prob_road_map.add_node(start_pt);
-  resultG = prob_road_map.add_node(goal_pt);
+  if(utility::load_or_build(prob_road_map, map_cache_dir, graph_size, k_nearest, robot_radius, build_threads))
+  {
+    ROS_INFO_STREAM("PRMSRCH: Loaded the road map from the map cache in " << map_cache_dir);
+  }
 
-  if(!resultS)
+  // Retrieve the PRM
+  auto all_nodes = prob_road_map.get_nodes();
+  auto all_edges = prob_road_map.get_edges();
+
+  grid::Map map(polygons, map_x_lims, map_y_lims);
+
+  // Configure the A* and Theta* searches on the compact graph
+  const auto prm_graph = prob_road_map.get_graph();
+
+  // Attach the start and goal to a query over the graph, which leaves the road map unchanged for later queries
+  graph::QueryGraph query(&prm_graph);
+
+  const int start_id = prob_road_map.attach(query, start_pt);
+  const int goal_id = prob_road_map.attach(query, goal_pt);
+
+  if(start_id == -1)
   {
     ROS_FATAL_STREAM("PRMSRCH: Invalid start node. \n Given start: " << start_pt);
     ros::shutdown();
+    return 1;
   }
 
-  if(!resultG)
+  if(goal_id == -1)
   {
     ROS_FATAL_STREAM("PRMSRCH: Invalid goal node. \n Given goal: " << goal_pt);
     ros::shutdown();
+    return 1;
   }
 
-  // Retrieve the PRM
-  auto all_nodes = prob_road_map.get_nodes();
-  auto all_edges = prob_road_map.get_edges();
-  unsigned int node_cnt = all_nodes.size();
+  prm::Node start_node, goal_node;
 
-  prm::Node start_node = all_nodes.at(node_cnt-2);
-  prm::Node goal_node = all_nodes.at(node_cnt-1);
+  start_node.id = start_id;
+  start_node.point = start_pt;
 
-  grid::Map map(polygons, map_x_lims, map_y_lims);
+  goal_node.id = goal_id;
+  goal_node.point = goal_pt;
 
-  // Configure the A* and Theta* searches
-  hsearch::AStar a_star_search(&all_nodes);
+  hsearch::AStar eager_search(&prm_graph);
+  hsearch::LazyAStar lazy_search(&prm_graph, map, robot_radius);
 
-  hsearch::ThetaStar t_star_search(&all_nodes, map, robot_radius);
+  // the edges of a lazy road map are checked by the searches
+  hsearch::AStar & a_star_search = lazy_prm ? lazy_search : eager_search;
+
+  hsearch::ThetaStar t_star_search(&prm_graph, map, robot_radius);
+  t_star_search.set_check_edges(lazy_prm);
 
   // conduct A* search
-  bool search_result_astar = a_star_search.ComputeShortestPath(start_node, goal_node);
+  bool search_result_astar = a_star_search.ComputeShortestPath(query, start_id, goal_id);
   ROS_INFO_STREAM("PRMSRCH: A* Search Complete!\n");
 
+  if(lazy_prm)
+  {
+    ROS_INFO_STREAM("PRMSRCH: Lazy A* checked " << lazy_search.get_edge_checks() << " of " << all_edges.size() << " edges and repaired the path "
+                    << lazy_search.get_repairs() << " times.");
+  }
+
   // conduct Theta* search
-  bool search_result_tstar = t_star_search.ComputeShortestPath(start_node, goal_node);
+  bool search_result_tstar = t_star_search.ComputeShortestPath(query, start_id, goal_id);
   ROS_INFO_STREAM("PRMSRCH: Theta* Search Complete!\n");
 
   // Check for failure
@@ -167,38 +218,33 @@ int main(int argc, char** argv)
   std::vector<visualization_msgs::Marker> markers;
   visualization_msgs::MarkerArray pub_marks;
 
-  // Put a spherical marker at each node
-  for(auto it = all_nodes.begin(); it < all_nodes.end()-2; it++)
-  {
-    markers.push_back(utility::make_marker(*it, cell_size, colors.at(0)));
-  }
+  // Put a spherical marker at each node, all in one marker
+  markers.push_back(utility::make_marker(all_nodes, cell_size, colors.at(0)));
 
-  // Draw a line to show all connections.
-  for(auto edge : all_edges)
-  {
-    markers.push_back(utility::make_marker(edge, cell_size/2, colors.at(2)));
-  }
+  // Draw a line to show all connections, for a lazy road map these include the edges that were never checked
+  markers.push_back(utility::make_marker(all_edges, cell_size/2, colors.at(2)));
 
   // Draw Start and Goal
   markers.push_back(utility::make_marker(start_node, cell_size*2, std::vector<double>({0, 1, 0}))); // start
   markers.push_back(utility::make_marker(goal_node, cell_size*2, std::vector<double>({1, 0, 0}))); // goal
 
-  // Draw A* path
-  for(auto it = a_path.begin(); it < a_path.end()-1; it++)
-  {
-    markers.push_back(utility::make_marker(*it, *(it+1), it-a_path.begin(), cell_size, std::vector<double>({0, 0, 0})));
-  }
-
-  auto start_id = a_path.size();
-
-  // Draw Theta* path
-  for(auto it = t_path.begin(); it < t_path.end()-1; it++)
-  {
-    markers.push_back(utility::make_marker(*it, *(it+1), start_id + (it-t_path.begin()), cell_size, colors.at(4)));
-  }
+  // Draw A* and Theta* paths
+  markers.push_back(utility::make_path_marker(a_path, 0, cell_size, std::vector<double>({0, 0, 0})));
+  markers.push_back(utility::make_path_marker(t_path, 1, cell_size, colors.at(4)));
 
   pub_marks.markers = markers;
   pub_markers.publish(pub_marks);
 
+  // the path is stored from the goal back to the start
+  pub_path.publish(utility::make_path_msg(std::vector<rigid2d::Vector2D>(t_path.rbegin(), t_path.rend())));
+
+  // publish the planner statistics
+  diagnostic_msgs::DiagnosticArray diagnostics;
+  diagnostics.header.stamp = ros::Time::now();
+  diagnostics.status.push_back(utility::make_diagnostic_msg("prm_search: road map", prob_road_map.get_stats()));
+  diagnostics.status.push_back(utility::make_diagnostic_msg("prm_search: A*", a_star_search.get_stats()));
+  diagnostics.status.push_back(utility::make_diagnostic_msg("prm_search: Theta*", t_star_search.get_stats()));
+  pub_diagnostics.publish(diagnostics);
+
   ros::spin();
 }
@@ -0,0 +1,134 @@
+#ifndef RANDOM_GRID_INCLUDE_GUARD_HPP
+#define RANDOM_GRID_INCLUDE_GUARD_HPP
+/// \file
+/// \brief Random grids and a plain Dijkstra search on them, used by the tests to check the path costs of the grid searches
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "rigid2d/rigid2d.hpp"
+#include "roadmap/grid.hpp"
+
+namespace testing_grid
+{
+  /// \brief The cost of a query with no path
+  static constexpr double no_path = std::numeric_limits<double>::infinity();
+
+  /// \brief Build a grid with cells of side length 1 and fill it with randomly occupied cells
+  /// \param width number of cells in each row
+  /// \param height number of rows
+  /// \param density the chance of each cell being occupied
+  /// \param rng the random number generator
+  /// \returns the grid
+  inline grid::Grid make_random_grid(int width, int height, double density, std::mt19937 & rng)
+  {
+    grid::Grid output(std::vector<double>{0, static_cast<double>(width)}, std::vector<double>{0, static_cast<double>(height)});
+    output.build_grid(1.0, 1, 0.0);
+
+    const auto dims = output.get_grid_dimensions();
+    grid::OccupancyPatch patch(0, 0, dims.at(0), dims.at(1));
+
+    std::bernoulli_distribution occupied(density);
+    for(auto & cell : patch.data) cell = occupied(rng) ? 100 : 0;
+
+    output.update_patch(patch);
+
+    return output;
+  }
+
+  /// \brief Pick a random free cell
+  /// \param occupancy the occupancy data of the grid, with at least one free cell
+  /// \param rng the random number generator
+  /// \returns the row major index of the cell
+  inline int random_free_cell(const grid::OccupancyView & occupancy, std::mt19937 & rng)
+  {
+    std::uniform_int_distribution<int> cell(0, occupancy.size() - 1);
+
+    while(true)
+    {
+      const int id = cell(rng);
+      if(occupancy.at(id) == 0) return id;
+    }
+  }
+
+  /// \brief Find the cost of the shortest 8 connected path between two cells with Dijkstra's algorithm. Like the grid searches, a move
+  /// is allowed when both cells are free and costs the distance between the cell centers. With a lethal value above 1, a move is allowed
+  /// when both cells are known and below the lethal value, and it costs the distance times 1 + scale * the larger occupancy / 100.
+  /// \param occupancy the occupancy data of the grid
+  /// \param resolution the side length of a cell
+  /// \param start the row major index of the start cell
+  /// \param goal the row major index of the goal cell
+  /// \param scale the extra cost of a move next to a fully occupied cell, relative to its length
+  /// \param lethal the smallest occupancy value that can not be crossed
+  /// \returns the cost of the path, no_path if there is none
+  inline double shortest_path_cost(const grid::OccupancyView & occupancy, double resolution, int start, int goal, double scale = 0.0,
+                                   signed char lethal = 1)
+  {
+    auto crossable = [&](int id){ return occupancy.at(id) >= 0 && occupancy.at(id) < lethal; };
+
+    if(!crossable(start) || !crossable(goal)) return no_path;
+
+    using Entry = std::pair<double, int>;
+
+    std::vector<double> cost(occupancy.size(), no_path);
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+
+    cost.at(start) = 0;
+    open.push(Entry(0, start));
+
+    while(!open.empty())
+    {
+      const auto [c, id] = open.top();
+      open.pop();
+
+      if(id == goal) return c;
+      if(c > cost.at(id)) continue;
+
+      const int x = id % occupancy.width, y = id / occupancy.width;
+
+      for(int dy = -1; dy < 2; dy++)
+      {
+        for(int dx = -1; dx < 2; dx++)
+        {
+          const int nx = x + dx, ny = y + dy;
+
+          if((dx == 0 && dy == 0) || nx < 0 || ny < 0 || nx >= occupancy.width || ny >= occupancy.height) continue;
+
+          const int n = occupancy.id(nx, ny);
+          if(!crossable(n)) continue;
+
+          const double weight = 1.0 + scale * std::max(occupancy.at(id), occupancy.at(n)) / 100.0;
+          const double nc = c + ((dx != 0 && dy != 0) ? std::sqrt(2.0) : 1.0) * resolution * weight;
+
+          if(nc < cost.at(n))
+          {
+            cost.at(n) = nc;
+            open.push(Entry(nc, n));
+          }
+        }
+      }
+    }
+
+    return no_path;
+  }
+
+  /// \brief Find the length of a path
+  /// \param path the points of the path in order
+  /// \returns the sum of the distances between consecutive points
+  inline double path_length(const std::vector<rigid2d::Vector2D> & path)
+  {
+    double length = 0;
+
+    for(unsigned int i = 1; i < path.size(); i++) length += path.at(i - 1).distance(path.at(i));
+
+    return length;
+  }
+}
+
+#endif // RANDOM_GRID_INCLUDE_GUARD_HPP
@@ -0,0 +1,450 @@
+/// \file
+/// \brief Tests that ARA* and Anytime D* stay within the bound of each pass and end at the cost of the shortest path, and that LPA* and
+/// D* Lite find the cheapest path with occupancy weighted edge costs
+
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "global_search/heuristic_search.hpp"
+#include "random_grid.hpp"
+#include "roadmap/graph.hpp"
+#include "roadmap/grid.hpp"
+
+/// \brief The schedule of the anytime tests, from a large weight down to the shortest path
+static const std::vector<double> schedule = {3.0, 2.0, 1.5, 1.0};
+
+/// \brief The most calls an interrupted search may take to finish its schedule
+static constexpr int max_calls = 100000;
+
+/// \brief Build the 8 connected graph of the free cells of a grid, with the same moves as the grid searches
+/// \param test_grid the grid
+/// \returns a graph with node IDs matching the row major indices of the grid cells
+static graph::CSRGraph make_free_graph(const grid::Grid & test_grid)
+{
+  const auto occupancy = test_grid.get_occupancy();
+
+  graph::CSRGraph output;
+
+  for(int i = 0; i < occupancy.height; i++)
+  {
+    for(int j = 0; j < occupancy.width; j++)
+    {
+      const auto point = test_grid.grid_to_world(rigid2d::Vector2D(j, i));
+      output.add_node(point);
+
+      if(occupancy.at(j, i) != 0) continue;
+
+      for(int m = -1; m < 2; m++)
+      {
+        for(int n = -1; n < 2; n++)
+        {
+          if((m == 0 && n == 0) || j + n < 0 || j + n >= occupancy.width || i + m < 0 || i + m >= occupancy.height) continue;
+          if(occupancy.at(j + n, i + m) != 0) continue;
+
+          output.add_edge(occupancy.id(j + n, i + m), point.distance(test_grid.grid_to_world(rigid2d::Vector2D(j + n, i + m))));
+        }
+      }
+    }
+  }
+
+  return output;
+}
+
+/// \brief Get the grid coordinates of a cell
+/// \param occupancy the occupancy data of the grid
+/// \param id the row major index of the cell
+/// \returns the x and y grid coordinates
+static rigid2d::Vector2D cell_coords(const grid::OccupancyView & occupancy, int id)
+{
+  return rigid2d::Vector2D(id % occupancy.width, id / occupancy.width);
+}
+
+TEST(ARAStar, EndsAtShortestPath)
+{
+  std::mt19937 rng(13);
+
+  for(const double density : {0.0, 0.2, 0.35})
+  {
+    for(int trial = 0; trial < 5; trial++)
+    {
+      const grid::Grid test_grid = testing_grid::make_random_grid(45, 35, density, rng);
+      const auto occupancy = test_grid.get_occupancy();
+      const auto free_graph = make_free_graph(test_grid);
+
+      hsearch::ARAStar search(&free_graph);
+      search.set_schedule(schedule);
+
+      for(int query = 0; query < 10; query++)
+      {
+        const int start = testing_grid::random_free_cell(occupancy, rng);
+        const int goal = testing_grid::random_free_cell(occupancy, rng);
+
+        if(start == goal) continue;
+
+        const double shortest = testing_grid::shortest_path_cost(occupancy, test_grid.get_resolution(), start, goal);
+        const bool found = search.ComputeShortestPath(start, goal);
+
+        ASSERT_EQ(found, shortest != testing_grid::no_path) << "density " << density;
+
+        if(!found) continue;
+
+        EXPECT_DOUBLE_EQ(search.get_epsilon(), 1.0);
+        EXPECT_NEAR(testing_grid::path_length(search.get_path()), shortest, 1e-9) << "density " << density;
+      }
+    }
+  }
+}
+
+TEST(ARAStar, EachPassStaysWithinItsBound)
+{
+  std::mt19937 rng(17);
+
+  for(int trial = 0; trial < 10; trial++)
+  {
+    const grid::Grid test_grid = testing_grid::make_random_grid(45, 35, 0.25, rng);
+    const auto occupancy = test_grid.get_occupancy();
+    const auto free_graph = make_free_graph(test_grid);
+
+    const int start = testing_grid::random_free_cell(occupancy, rng);
+    const int goal = testing_grid::random_free_cell(occupancy, rng);
+
+    const double shortest = testing_grid::shortest_path_cost(occupancy, test_grid.get_resolution(), start, goal);
+    if(start == goal || shortest == testing_grid::no_path) continue;
+
+    // a schedule ending at each weight stops after the pass of that weight
+    for(unsigned int last = 0; last < schedule.size(); last++)
+    {
+      hsearch::ARAStar search(&free_graph);
+      search.set_schedule(std::vector<double>(schedule.begin(), schedule.begin() + last + 1));
+
+      ASSERT_TRUE(search.ComputeShortestPath(start, goal));
+
+      EXPECT_DOUBLE_EQ(search.get_epsilon(), schedule.at(last));
+      EXPECT_LE(testing_grid::path_length(search.get_path()), schedule.at(last) * shortest + 1e-9) << "weight " << schedule.at(last);
+    }
+
+    // a path found before the time runs out is within the weight it reports
+    hsearch::ARAStar budgeted(&free_graph);
+    budgeted.set_schedule(schedule);
+    budgeted.set_time_budget(1e-5);
+
+    if(budgeted.ComputeShortestPath(start, goal))
+    {
+      EXPECT_LE(testing_grid::path_length(budgeted.get_path()), budgeted.get_epsilon() * shortest + 1e-9);
+    }
+  }
+}
+
+/// \brief Run an anytime incremental search on random grids and compare the final paths against Dijkstra's algorithm
+template <typename Search>
+static void check_converges(unsigned int seed)
+{
+  std::mt19937 rng(seed);
+
+  for(const double density : {0.0, 0.2, 0.35})
+  {
+    for(int trial = 0; trial < 10; trial++)
+    {
+      grid::Grid test_grid = testing_grid::make_random_grid(45, 35, density, rng);
+      const auto occupancy = test_grid.get_occupancy();
+
+      const int start = testing_grid::random_free_cell(occupancy, rng);
+      const int goal = testing_grid::random_free_cell(occupancy, rng);
+
+      if(start == goal) continue;
+
+      const double shortest = testing_grid::shortest_path_cost(occupancy, test_grid.get_resolution(), start, goal);
+
+      Search search(&test_grid, cell_coords(occupancy, start), cell_coords(occupancy, goal));
+      search.set_schedule(schedule);
+
+      const bool found = search.ComputeShortestPath();
+
+      ASSERT_EQ(found, shortest != testing_grid::no_path) << "density " << density;
+      EXPECT_FALSE(search.can_improve());
+
+      if(!found) continue;
+
+      EXPECT_DOUBLE_EQ(search.get_epsilon(), 1.0);
+      EXPECT_NEAR(testing_grid::path_length(search.get_path()), shortest, 1e-9) << "density " << density;
+    }
+  }
+}
+
+TEST(AnytimeLPAStar, EndsAtShortestPath)
+{
+  check_converges<hsearch::LPAStar>(19);
+}
+
+TEST(AnytimeDStarLite, EndsAtShortestPath)
+{
+  check_converges<hsearch::DStarLite>(23);
+}
+
+/// \brief Reveal a random grid one row at a time to a search that starts on a free grid. After each row the search is called with a
+/// small time budget until it can not improve its path, which must then be the shortest path on the cells revealed so far.
+template <typename Search>
+static void check_revealed_rows(unsigned int seed)
+{
+  std::mt19937 rng(seed);
+
+  for(int trial = 0; trial < 5; trial++)
+  {
+    const grid::Grid known_grid = testing_grid::make_random_grid(81, 61, 0.3, rng);
+    grid::Grid free_grid = testing_grid::make_random_grid(81, 61, 0.0, rng);
+
+    const auto known = known_grid.get_occupancy();
+
+    const int start = testing_grid::random_free_cell(known, rng);
+    const int goal = testing_grid::random_free_cell(known, rng);
+
+    if(start == goal) continue;
+
+    Search search(&free_grid, cell_coords(known, start), cell_coords(known, goal));
+    search.set_schedule(schedule);
+    search.set_time_budget(1e-5);
+
+    for(int row = 0; row <= known.height; row++)
+    {
+      if(row > 0)
+      {
+        grid::OccupancyPatch patch(0, row - 1, known.width, 1);
+        patch.data.assign(known.data + known.id(0, row - 1), known.data + known.id(0, row));
+
+        search.MapChange(patch);
+      }
+
+      bool found = search.ComputeShortestPath();
+
+      for(int calls = 0; search.can_improve() && calls < max_calls; calls++) found = search.ComputeShortestPath();
+
+      ASSERT_FALSE(search.can_improve()) << "row " << row;
+
+      const auto occupancy = free_grid.get_occupancy();
+      const double shortest = testing_grid::shortest_path_cost(occupancy, free_grid.get_resolution(), start, goal);
+
+      ASSERT_EQ(found, shortest != testing_grid::no_path) << "row " << row;
+
+      if(!found) continue;
+
+      EXPECT_DOUBLE_EQ(search.get_epsilon(), 1.0) << "row " << row;
+      EXPECT_NEAR(testing_grid::path_length(search.get_path()), shortest, 1e-9) << "row " << row;
+    }
+  }
+}
+
+TEST(AnytimeLPAStar, ConvergesAfterEveryRevealedRow)
+{
+  check_revealed_rows<hsearch::LPAStar>(29);
+}
+
+TEST(AnytimeDStarLite, ConvergesAfterEveryRevealedRow)
+{
+  check_revealed_rows<hsearch::DStarLite>(31);
+}
+
+/// \brief The occupancy weighted edge costs of the tests, as the scale and the lethal value. The first is the default.
+static const std::vector<std::pair<double, signed char>> occupancy_costs = {{0.0, 1}, {0.0, 100}, {2.0, 100}, {5.0, 51}};
+
+/// \brief Fill a grid with random free, buffer zone and occupied cells
+/// \param width number of cells in each row
+/// \param height number of rows
+/// \param rng the random number generator
+/// \returns the grid
+static grid::Grid make_graded_grid(int width, int height, std::mt19937 & rng)
+{
+  grid::Grid output = testing_grid::make_random_grid(width, height, 0.0, rng);
+
+  const auto dims = output.get_grid_dimensions();
+  grid::OccupancyPatch patch(0, 0, dims.at(0), dims.at(1));
+
+  std::discrete_distribution<int> value({6, 3, 1});
+  for(auto & cell : patch.data) cell = 50 * value(rng);
+
+  output.update_patch(patch);
+
+  return output;
+}
+
+/// \brief Find the occupancy weighted cost of a path of neighboring cells
+/// \param test_grid the grid that was searched
+/// \param path the cells of the path
+/// \param scale the extra cost of a move next to a fully occupied cell
+/// \returns the cost of the path
+static double weighted_cost(const grid::Grid & test_grid, const std::vector<rigid2d::Vector2D> & path, double scale)
+{
+  const auto occupancy = test_grid.get_occupancy();
+
+  auto value = [&](const rigid2d::Vector2D & pt)
+  {
+    const auto g = test_grid.world_to_grid(pt);
+    return occupancy.at(static_cast<int>(g.x), static_cast<int>(g.y));
+  };
+
+  double cost = 0;
+
+  for(unsigned int i = 1; i < path.size(); i++)
+  {
+    cost += path.at(i - 1).distance(path.at(i)) * (1.0 + scale * std::max(value(path.at(i - 1)), value(path.at(i))) / 100.0);
+  }
+
+  return cost;
+}
+
+/// \brief Search random graded grids with each occupancy weighted cost, set after a first search with the default cost, and compare
+/// the paths against Dijkstra's algorithm with the same costs
+template <typename Search>
+static void check_occupancy_costs(unsigned int seed)
+{
+  std::mt19937 rng(seed);
+
+  for(int trial = 0; trial < 10; trial++)
+  {
+    grid::Grid test_grid = make_graded_grid(45, 35, rng);
+    const auto occupancy = test_grid.get_occupancy();
+
+    const int start = testing_grid::random_free_cell(occupancy, rng);
+    const int goal = testing_grid::random_free_cell(occupancy, rng);
+
+    if(start == goal) continue;
+
+    for(const auto & [scale, lethal] : occupancy_costs)
+    {
+      Search search(&test_grid, cell_coords(occupancy, start), cell_coords(occupancy, goal));
+      search.ComputeShortestPath();
+
+      search.set_occupancy_cost(scale, lethal);
+
+      const double shortest = testing_grid::shortest_path_cost(occupancy, test_grid.get_resolution(), start, goal, scale, lethal);
+
+      ASSERT_EQ(search.ComputeShortestPath(), shortest != testing_grid::no_path) << "scale " << scale << " lethal " << int(lethal);
+
+      if(shortest == testing_grid::no_path) continue;
+
+      EXPECT_NEAR(weighted_cost(test_grid, search.get_path(), scale), shortest, 1e-9) << "scale " << scale << " lethal " << int(lethal);
+    }
+  }
+}
+
+TEST(LPAStar, OccupancyCostMatchesDijkstra)
+{
+  check_occupancy_costs<hsearch::LPAStar>(37);
+}
+
+TEST(DStarLite, OccupancyCostMatchesDijkstra)
+{
+  check_occupancy_costs<hsearch::DStarLite>(41);
+}
+
+/// \brief Change random blocks of a graded grid between free, buffer zone and occupied cells, which also changes cells between two values
+/// that are not free, and check the path after each change against Dijkstra's algorithm with the same costs
+template <typename Search>
+static void check_graded_changes(unsigned int seed)
+{
+  std::mt19937 rng(seed);
+
+  const double scale = 2.0;
+  const signed char lethal = 100;
+
+  for(int trial = 0; trial < 5; trial++)
+  {
+    grid::Grid test_grid = make_graded_grid(41, 33, rng);
+    auto occupancy = test_grid.get_occupancy();
+
+    const int start = testing_grid::random_free_cell(occupancy, rng);
+    const int goal = testing_grid::random_free_cell(occupancy, rng);
+
+    if(start == goal) continue;
+
+    Search search(&test_grid, cell_coords(occupancy, start), cell_coords(occupancy, goal));
+    search.set_occupancy_cost(scale, lethal);
+
+    for(int change = 0; change < 20; change++)
+    {
+      if(change > 0)
+      {
+        const auto dims = test_grid.get_grid_dimensions();
+        std::uniform_int_distribution<int> size(1, 6);
+
+        const int w = size(rng), h = size(rng);
+        std::uniform_int_distribution<int> x(0, dims.at(0) - w), y(0, dims.at(1) - h);
+
+        grid::OccupancyPatch patch(x(rng), y(rng), w, h);
+
+        std::uniform_int_distribution<int> value(0, 2);
+        for(auto & cell : patch.data) cell = 50 * value(rng);
+
+        // keep the start and goal crossable
+        for(const int id : {start, goal})
+        {
+          const int px = id % occupancy.width - patch.x, py = id / occupancy.width - patch.y;
+          if(px >= 0 && px < w && py >= 0 && py < h) patch.data.at(py * w + px) = 0;
+        }
+
+        search.MapChange(patch);
+      }
+
+      occupancy = test_grid.get_occupancy();
+      const double shortest = testing_grid::shortest_path_cost(occupancy, test_grid.get_resolution(), start, goal, scale, lethal);
+
+      ASSERT_EQ(search.ComputeShortestPath(), shortest != testing_grid::no_path) << "change " << change;
+
+      if(shortest == testing_grid::no_path) continue;
+
+      EXPECT_NEAR(weighted_cost(test_grid, search.get_path(), scale), shortest, 1e-9) << "change " << change;
+    }
+  }
+}
+
+TEST(LPAStar, OccupancyCostFollowsGradedChanges)
+{
+  check_graded_changes<hsearch::LPAStar>(43);
+}
+
+TEST(DStarLite, OccupancyCostFollowsGradedChanges)
+{
+  check_graded_changes<hsearch::DStarLite>(47);
+}
+
+/// \brief Close and open the only gap of a wall by changing it between the buffer zone and occupied, which a search that only updates
+/// the cells changing from free to occupied or back would miss
+template <typename Search>
+static void check_gap_changes()
+{
+  std::mt19937 rng(53);
+  grid::Grid test_grid = testing_grid::make_random_grid(21, 9, 0.0, rng);
+
+  grid::OccupancyPatch wall(10, 0, 1, 9);
+  for(auto & cell : wall.data) cell = 100;
+  wall.data.at(4) = 50;
+
+  test_grid.update_patch(wall);
+
+  Search search(&test_grid, rigid2d::Vector2D(2, 4), rigid2d::Vector2D(18, 4));
+  search.set_occupancy_cost(1.0, 100);
+
+  ASSERT_TRUE(search.ComputeShortestPath());
+
+  for(const signed char value : {100, 50, 100})
+  {
+    grid::OccupancyPatch gap(10, 4, 1, 1);
+    gap.data.at(0) = value;
+
+    EXPECT_TRUE(search.MapChange(gap));
+    EXPECT_EQ(search.ComputeShortestPath(), value == 50) << "gap " << int(value);
+  }
+}
+
+TEST(LPAStar, OccupancyCostFollowsGapChanges)
+{
+  check_gap_changes<hsearch::LPAStar>();
+}
+
+TEST(DStarLite, OccupancyCostFollowsGapChanges)
+{
+  check_gap_changes<hsearch::DStarLite>();
+}
@@ -0,0 +1,137 @@
+/// \file
+/// \brief Tests that HPA* finds valid paths whenever the grid has one, and that updating its clusters gives the same results as building
+/// them again
+
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "global_search/hierarchical_search.hpp"
+#include "random_grid.hpp"
+#include "roadmap/grid.hpp"
+
+/// \brief Check that a path moves between free neighboring cells from one cell to another
+/// \param test_grid the grid that was searched
+/// \param path the cells of the path
+/// \param first the row major index of the cell the path starts at
+/// \param last the row major index of the cell the path ends at
+/// \returns True if every step of the path is a move the grid searches allow
+static bool path_is_free(const grid::Grid & test_grid, const std::vector<rigid2d::Vector2D> & path, int first, int last)
+{
+  const auto occupancy = test_grid.get_occupancy();
+
+  auto cell = [&](const rigid2d::Vector2D & pt)
+  {
+    const auto g = test_grid.world_to_grid(pt);
+    return occupancy.id(static_cast<int>(g.x), static_cast<int>(g.y));
+  };
+
+  if(path.empty() || cell(path.front()) != first || cell(path.back()) != last) return false;
+
+  for(unsigned int i = 0; i < path.size(); i++)
+  {
+    if(occupancy.at(cell(path.at(i))) != 0) return false;
+
+    if(i == 0) continue;
+
+    const auto a = test_grid.world_to_grid(path.at(i - 1)), b = test_grid.world_to_grid(path.at(i));
+    if(std::abs(a.x - b.x) > 1.5 || std::abs(a.y - b.y) > 1.5 || cell(path.at(i - 1)) == cell(path.at(i))) return false;
+  }
+
+  return true;
+}
+
+TEST(HPAStar, FindsPathWhenOneExists)
+{
+  std::mt19937 rng(3);
+
+  for(const int cluster_size : {4, 8, 16})
+  {
+    for(const double density : {0.0, 0.15, 0.3, 0.4})
+    {
+      for(int trial = 0; trial < 5; trial++)
+      {
+        const grid::Grid test_grid = testing_grid::make_random_grid(53, 37, density, rng);
+        const auto occupancy = test_grid.get_occupancy();
+
+        hsearch::HPAStar search(&test_grid, cluster_size);
+
+        for(int query = 0; query < 10; query++)
+        {
+          const int start = testing_grid::random_free_cell(occupancy, rng);
+          const int goal = testing_grid::random_free_cell(occupancy, rng);
+
+          if(start == goal) continue;
+
+          const double shortest = testing_grid::shortest_path_cost(occupancy, test_grid.get_resolution(), start, goal);
+          const bool found = search.ComputeShortestPath(start, goal);
+
+          ASSERT_EQ(found, shortest != testing_grid::no_path) << "cluster " << cluster_size << " density " << density;
+
+          if(!found) continue;
+
+          // the path is stored from the goal to the start
+          const auto path = search.get_path();
+
+          EXPECT_TRUE(path_is_free(test_grid, path, goal, start)) << "cluster " << cluster_size << " density " << density;
+          EXPECT_GE(testing_grid::path_length(path), shortest - 1e-9) << "cluster " << cluster_size << " density " << density;
+        }
+      }
+    }
+  }
+}
+
+TEST(HPAStar, UpdateCellsMatchesRebuild)
+{
+  std::mt19937 rng(5);
+
+  for(const int cluster_size : {4, 8})
+  {
+    grid::Grid test_grid = testing_grid::make_random_grid(48, 40, 0.2, rng);
+
+    hsearch::HPAStar updated(&test_grid, cluster_size);
+
+    for(int change = 0; change < 20; change++)
+    {
+      // close or open a random rectangle of cells, which can straddle the cluster borders
+      const auto dims = test_grid.get_grid_dimensions();
+      std::uniform_int_distribution<int> size(1, 6);
+
+      const int w = size(rng), h = size(rng);
+      std::uniform_int_distribution<int> x(0, dims.at(0) - w), y(0, dims.at(1) - h);
+
+      grid::OccupancyPatch patch(x(rng), y(rng), w, h);
+      std::bernoulli_distribution occupied(change % 2 == 0 ? 0.8 : 0.1);
+      for(auto & cell : patch.data) cell = occupied(rng) ? 100 : 0;
+
+      updated.update_cells(test_grid.update_patch(patch));
+
+      hsearch::HPAStar fresh(&test_grid, cluster_size);
+
+      EXPECT_EQ(updated.get_abstract_graph().size(), fresh.get_abstract_graph().size()) << "change " << change;
+      EXPECT_EQ(updated.get_abstract_graph().num_edges(), fresh.get_abstract_graph().num_edges()) << "change " << change;
+
+      const auto occupancy = test_grid.get_occupancy();
+
+      for(int query = 0; query < 5; query++)
+      {
+        const int start = testing_grid::random_free_cell(occupancy, rng);
+        const int goal = testing_grid::random_free_cell(occupancy, rng);
+
+        if(start == goal) continue;
+
+        const bool found = fresh.ComputeShortestPath(start, goal);
+
+        ASSERT_EQ(updated.ComputeShortestPath(start, goal), found) << "change " << change;
+
+        if(!found) continue;
+
+        EXPECT_NEAR(testing_grid::path_length(updated.get_path()), testing_grid::path_length(fresh.get_path()), 1e-9) << "change " << change;
+        EXPECT_TRUE(path_is_free(test_grid, updated.get_path(), goal, start)) << "change " << change;
+      }
+    }
+  }
+}
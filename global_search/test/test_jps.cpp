@@ -0,0 +1,136 @@
+/// \file
+/// \brief Tests that Jump Point Search and JPS+ find paths as short as a plain search of the 8 connected grid
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "global_search/heuristic_search.hpp"
+#include "random_grid.hpp"
+#include "roadmap/grid.hpp"
+
+/// \brief Check that consecutive jump points are joined by a horizontal, vertical or diagonal line of free cells
+/// \param test_grid the grid that was searched
+/// \param path the jump points
+/// \returns True if every step of the path is a move the grid searches allow
+static bool path_is_free(const grid::Grid & test_grid, const std::vector<rigid2d::Vector2D> & path)
+{
+  const auto occupancy = test_grid.get_occupancy();
+
+  for(unsigned int i = 1; i < path.size(); i++)
+  {
+    const auto a = test_grid.world_to_grid(path.at(i - 1)), b = test_grid.world_to_grid(path.at(i));
+
+    const int dx = static_cast<int>(b.x - a.x), dy = static_cast<int>(b.y - a.y);
+
+    if(dx != 0 && dy != 0 && std::abs(dx) != std::abs(dy)) return false;
+
+    const int steps = std::max(std::abs(dx), std::abs(dy));
+    const int sx = (dx > 0) - (dx < 0), sy = (dy > 0) - (dy < 0);
+
+    for(int k = 0; k <= steps; k++)
+    {
+      if(occupancy.at(static_cast<int>(a.x) + k * sx, static_cast<int>(a.y) + k * sy) != 0) return false;
+    }
+  }
+
+  return true;
+}
+
+/// \brief Run queries between random free cells of random grids and compare JPS against Dijkstra's algorithm
+/// \param precompute true to read the jumps from the JPS+ distances
+/// \param type the heuristic of the search
+static void check_random_grids(bool precompute, hsearch::heuristic type)
+{
+  std::mt19937 rng(7);
+
+  for(const double density : {0.0, 0.15, 0.3, 0.4})
+  {
+    for(int trial = 0; trial < 10; trial++)
+    {
+      const grid::Grid test_grid = testing_grid::make_random_grid(41, 29, density, rng);
+      const auto occupancy = test_grid.get_occupancy();
+
+      hsearch::JPSStar search(&test_grid);
+      search.set_heuristic(type);
+      search.set_precompute(precompute);
+
+      for(int query = 0; query < 10; query++)
+      {
+        const int start = testing_grid::random_free_cell(occupancy, rng);
+        const int goal = testing_grid::random_free_cell(occupancy, rng);
+
+        if(start == goal) continue;
+
+        const double expected = testing_grid::shortest_path_cost(occupancy, test_grid.get_resolution(), start, goal);
+        const bool found = search.ComputeShortestPath(start, goal);
+
+        ASSERT_EQ(found, expected != testing_grid::no_path) << "density " << density << " start " << start << " goal " << goal;
+
+        if(!found) continue;
+
+        const auto path = search.get_path();
+
+        EXPECT_NEAR(testing_grid::path_length(path), expected, 1e-9) << "density " << density << " start " << start << " goal " << goal;
+        EXPECT_TRUE(path_is_free(test_grid, path)) << "density " << density << " start " << start << " goal " << goal;
+      }
+    }
+  }
+}
+
+TEST(JPSStar, MatchesDijkstraOnRandomGrids)
+{
+  check_random_grids(false, hsearch::Euclidean);
+}
+
+TEST(JPSStar, MatchesDijkstraWithOctileHeuristic)
+{
+  check_random_grids(false, hsearch::Octile);
+}
+
+TEST(JPSStar, PrecomputedMatchesDijkstraOnRandomGrids)
+{
+  check_random_grids(true, hsearch::Octile);
+}
+
+TEST(JPSStar, PrecomputedFollowsGridChanges)
+{
+  std::mt19937 rng(11);
+
+  grid::Grid test_grid = testing_grid::make_random_grid(33, 33, 0.2, rng);
+
+  hsearch::JPSStar search(&test_grid);
+  search.set_precompute(true);
+
+  for(int change = 0; change < 10; change++)
+  {
+    // close and open a block of cells, the distances are computed again for the new occupancy data
+    const auto dims = test_grid.get_grid_dimensions();
+    std::uniform_int_distribution<int> corner(0, dims.at(0) - 6);
+
+    grid::OccupancyPatch patch(corner(rng), corner(rng), 5, 5);
+    for(auto & cell : patch.data) cell = (change % 2 == 0) ? 100 : 0;
+
+    test_grid.update_patch(patch);
+    search.update_jump_distances();
+
+    const auto occupancy = test_grid.get_occupancy();
+    const int start = testing_grid::random_free_cell(occupancy, rng);
+    const int goal = testing_grid::random_free_cell(occupancy, rng);
+
+    if(start == goal) continue;
+
+    const double expected = testing_grid::shortest_path_cost(occupancy, test_grid.get_resolution(), start, goal);
+
+    ASSERT_EQ(search.ComputeShortestPath(start, goal), expected != testing_grid::no_path);
+
+    if(expected != testing_grid::no_path)
+    {
+      EXPECT_NEAR(testing_grid::path_length(search.get_path()), expected, 1e-9);
+    }
+  }
+}
@@ -0,0 +1,79 @@
+/// \file
+/// \brief Tests that the repulsive gradient of the potential field pushes straight away from the nearest point of the nearest obstacle,
+/// with the exact distances and with the distance field
+
+#include <cmath>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "global_search/potential_fields.hpp"
+#include "rigid2d/rigid2d.hpp"
+#include "roadmap/grid.hpp"
+
+/// \brief The step size of the tests
+static constexpr double zeta = 0.01;
+
+/// \brief The range of influence of the obstacles, the map border is further than this from the test locations
+static constexpr double Qstar = 0.4;
+
+/// \brief Build a map with a unit square obstacle in the middle of a large border
+/// \returns the map
+static grid::Map make_square_map()
+{
+  const std::vector<std::vector<rigid2d::Vector2D>> obstacles = {
+    {rigid2d::Vector2D(0, 0), rigid2d::Vector2D(1, 0), rigid2d::Vector2D(1, 1), rigid2d::Vector2D(0, 1)}};
+
+  return grid::Map(obstacles, {-2, 3}, {-2, 3});
+}
+
+/// \brief Take one step with only the repulsive gradient, by placing the goal at the location
+/// \param field_resolution the cell size of the distance field, 0 for the exact distances
+/// \param loc the location to step from
+/// \returns the direction of the step
+static rigid2d::Vector2D repulsion_step(double field_resolution, const rigid2d::Vector2D & loc)
+{
+  pfield::PtField planner(make_square_map(), loc, zeta, 1.0, 1.0, 0.1, Qstar);
+  if(field_resolution > 0) planner.use_distance_field(field_resolution);
+
+  return (planner.PlanOneStep(loc) - loc) * (1.0 / zeta);
+}
+
+/// \brief Locations within the range of influence of the square, each with the direction away from its nearest point on the square
+struct Case
+{
+  rigid2d::Vector2D loc; ///< the location
+  rigid2d::Vector2D away; ///< the unit vector pointing away from the nearest point
+};
+
+/// \brief Locations beside each edge of the square, away from the vertices, so the nearest point is on a different edge than the last
+/// edge of the polygon for all but the left side, and locations off each vertex
+static const std::vector<Case> cases = {
+  {rigid2d::Vector2D(0.5, -0.1), rigid2d::Vector2D(0, -1)},
+  {rigid2d::Vector2D(1.2, 0.3), rigid2d::Vector2D(1, 0)},
+  {rigid2d::Vector2D(0.7, 1.1), rigid2d::Vector2D(0, 1)},
+  {rigid2d::Vector2D(-0.15, 0.6), rigid2d::Vector2D(-1, 0)},
+  {rigid2d::Vector2D(1.1, 1.2), rigid2d::Vector2D(0.1, 0.2).normalize()},
+  {rigid2d::Vector2D(-0.2, -0.1), rigid2d::Vector2D(-0.2, -0.1).normalize()}};
+
+TEST(PtField, RepulsionPointsAwayFromNearestPoint)
+{
+  for(const auto & c : cases)
+  {
+    const auto step = repulsion_step(0.0, c.loc);
+
+    EXPECT_NEAR(step.x, c.away.x, 1e-9) << "location " << c.loc.x << ", " << c.loc.y;
+    EXPECT_NEAR(step.y, c.away.y, 1e-9) << "location " << c.loc.x << ", " << c.loc.y;
+  }
+}
+
+TEST(PtField, DistanceFieldRepulsionMatchesExact)
+{
+  for(const auto & c : cases)
+  {
+    const auto step = repulsion_step(0.01, c.loc);
+
+    // the field gradient is interpolated between the cell centers, so the direction is only close
+    EXPECT_GT(step.x * c.away.x + step.y * c.away.y, std::cos(0.05)) << "location " << c.loc.x << ", " << c.loc.y;
+  }
+}
@@ -0,0 +1,156 @@
+#ifndef COST_MAP_INCLUDE_GUARD_HPP
+#define COST_MAP_INCLUDE_GUARD_HPP
+/// \file
+/// \brief A precomputed map of the obstacle and path tracking costs looked up by the MPPI rollouts
+
+#include <algorithm>
+#include <vector>
+
+namespace mppi
+{
+  /// \brief Everything the rollouts look up about a cell, packed so a lookup touches a single 8 byte slot
+  struct CostCell
+  {
+    float obstacle = 0; ///< obstacle cost, 0 in free space, 0.5 in the buffer zone or unknown space, 1 in or outside of the obstacles
+    int segment = -1; ///< the segment of the reference path closest to the cell center, -1 if there is no path
+  };
+
+  /// \brief A segment of the reference path, stored so projecting onto it is a few multiplies
+  struct PathSegment
+  {
+    double x = 0; ///< x position of the first vertex
+    double y = 0; ///< y position of the first vertex
+    double dx = 0; ///< x component of the segment
+    double dy = 0; ///< y component of the segment
+    double len = 0; ///< length of the segment
+    double inv_len2 = 0; ///< 1 / the squared length of the segment, 0 for a segment of zero length
+    double start = 0; ///< distance along the path to the first vertex
+  };
+
+  /// \brief A 2D point on a reference path
+  struct PathPoint
+  {
+    double x = 0; ///< x position
+    double y = 0; ///< y position
+
+    /// \brief default constructor, the origin
+    PathPoint() {};
+
+    /// \brief Create a point
+    /// \param x x position
+    /// \param y y position
+    PathPoint(double x, double y) : x(x), y(y) {};
+  };
+
+  /// \brief Costs sampled from an occupancy grid, like the 0/50/100 grids built by grid::Grid, and the distance to a reference path,
+  /// like the paths found by the global_search planners. Each cell stores its obstacle cost and the path segment closest to it, so a lookup
+  /// is a bounds check and one load, and the distance to the path is an exact projection onto that segment rather than a per cell constant.
+  class CostMap
+  {
+  public:
+
+    /// \brief Create an empty map, every lookup is outside of the map
+    CostMap() {};
+
+    /// \brief Create the map from occupancy data
+    /// \param occupancy the occupancy of each cell in row major order with the first element at the lower left corner, 0 is free,
+    /// 100 is occupied, values in between scale the cost and negative values are unknown
+    /// \param width the number of cells in each row
+    /// \param height the number of rows
+    /// \param resolution the side length of each cell
+    /// \param x_origin x coordinate of the lower left corner of the map
+    /// \param y_origin y coordinate of the lower left corner of the map
+    CostMap(const signed char * occupancy, int width, int height, double resolution, double x_origin=0, double y_origin=0);
+
+    /// \brief Set the reference path, the closest segment to every cell is found with two raster sweeps
+    /// \param path the verticies of the path in order
+    void set_path(const std::vector<PathPoint> & path);
+
+    /// \brief Check if the map has a reference path
+    /// \returns True if a path with at least one point was set
+    bool has_path() const;
+
+    /// \brief Get the length of the reference path
+    /// \returns the sum of the segment lengths
+    double get_path_length() const;
+
+    /// \brief Get the number of cells in each row
+    /// \returns the width of the map
+    int get_width() const;
+
+    /// \brief Get the number of rows
+    /// \returns the height of the map
+    int get_height() const;
+
+    /// \brief Get the side length of the cells
+    /// \returns the resolution of the map
+    double get_resolution() const;
+
+    /// \brief Get the lower left corner of the map
+    /// \param x [out] x coordinate of the corner
+    /// \param y [out] y coordinate of the corner
+    void get_origin(double & x, double & y) const;
+
+    /// \brief Get the cells
+    /// \returns the width * height cells in row major order
+    const CostCell * get_cells() const;
+
+    /// \brief Get the segments of the reference path
+    /// \returns the segments in order, a path with a single point has one segment of zero length
+    const std::vector<PathSegment> & get_segments() const;
+
+    /// \brief Look up the costs of the cell containing a point
+    /// \param x x position
+    /// \param y y position
+    /// \returns the cell, or a fully occupied cell if the point is outside of the map
+    const CostCell & at(double x, double y) const
+    {
+      const double u = (x - x_origin) * inv_res, v = (y - y_origin) * inv_res;
+
+      // also rejects NaN
+      if(!(u >= 0 && v >= 0 && u < width && v < height)) return outside;
+
+      return cells[static_cast<int>(v) * width + static_cast<int>(u)];
+    }
+
+    /// \brief Measure a point against the path segment closest to its cell
+    /// \param cell the cell containing the point, from at
+    /// \param x x position
+    /// \param y y position
+    /// \param progress [out] distance along the path to the closest point, 0 if the cell has no segment
+    /// \returns the squared distance to the path, 0 if the cell has no segment
+    double path_distance2(const CostCell & cell, double x, double y, double & progress) const
+    {
+      if(cell.segment < 0)
+      {
+        progress = 0;
+        return 0;
+      }
+
+      const PathSegment & seg = segments[cell.segment];
+      const double t = std::min(std::max(((x - seg.x) * seg.dx + (y - seg.y) * seg.dy) * seg.inv_len2, 0.0), 1.0);
+      const double ex = x - (seg.x + t * seg.dx), ey = y - (seg.y + t * seg.dy);
+
+      progress = seg.start + t * seg.len;
+
+      return ex * ex + ey * ey;
+    }
+
+  private:
+    double x_origin = 0; ///< x coordinate of the lower left corner
+    double y_origin = 0; ///< y coordinate of the lower left corner
+    double res = 1.0; ///< side length of a cell
+    double inv_res = 1.0; ///< 1 / res
+
+    int width = 0; ///< number of cells in each row
+    int height = 0; ///< number of rows
+
+    std::vector<CostCell> cells; ///< the costs of each cell in row major order
+    CostCell outside; ///< the costs returned for points outside of the map
+
+    std::vector<PathSegment> segments; ///< segments of the reference path
+    double path_length = 0; ///< length of the reference path
+  };
+}
+
+#endif //COST_MAP_INCLUDE_GUARD_HPP
@@ -0,0 +1,91 @@
+#ifndef DIFF_DRIVE_INCLUDE_GUARD_HPP
+#define DIFF_DRIVE_INCLUDE_GUARD_HPP
+/// \file
+/// \brief The kinematic model of the diff drive robot controlled by MPPI
+
+#include <cmath>
+
+namespace mppi
+{
+  /// \brief The pose of the robot in the plane
+  struct Pose
+  {
+    double x = 0; ///< x position
+    double y = 0; ///< y position
+    double th = 0; ///< heading
+
+    /// \brief default constructor, the origin
+    Pose() {};
+
+    /// \brief Create a pose
+    /// \param x x position
+    /// \param y y position
+    /// \param th heading
+    Pose(double x, double y, double th) : x(x), y(y), th(th) {};
+  };
+
+  /// \brief Wheel velocities to apply to the robot
+  struct Action
+  {
+    double right = 0; ///< right wheel velocity
+    double left = 0; ///< left wheel velocity
+
+    /// \brief default constructor, both wheels stopped
+    Action() {};
+
+    /// \brief Create an action
+    /// \param right right wheel velocity
+    /// \param left left wheel velocity
+    Action(double right, double left) : right(right), left(left) {};
+  };
+
+  /// \brief A simple diff drive robot
+  class DiffDriveRobot
+  {
+  public:
+
+    /// \brief default constructor
+    DiffDriveRobot() {};
+
+    /// \brief Create the robot
+    /// \param radius the wheel radius
+    /// \param wheel_base the distance from the centerline to the wheel
+    /// \param wheel_speed_limit the max velocity the wheel can spin
+    DiffDriveRobot(double radius, double wheel_base, double wheel_speed_limit);
+
+    /// \brief The differential drive kinematic model
+    /// \param th the heading of the robot
+    /// \param right the right wheel velocity
+    /// \param left the left wheel velocity
+    /// \param xdot [out] the x velocity of the robot
+    /// \param ydot [out] the y velocity of the robot
+    /// \param thdot [out] the angular velocity of the robot
+    void model(double th, double right, double left, double & xdot, double & ydot, double & thdot) const
+    {
+      const double forward = (radius / 2.0) * (right + left);
+
+      xdot = forward * std::cos(th);
+      ydot = forward * std::sin(th);
+      thdot = (radius / wheel_base) * (right - left);
+    }
+
+    /// \brief Get the wheel radius
+    /// \returns the wheel radius
+    double get_radius() const;
+
+    /// \brief Get the distance from the centerline to the wheel
+    /// \returns the wheel base
+    double get_wheel_base() const;
+
+    /// \brief Get the speed limit of the wheels
+    /// \returns the max wheel velocity
+    double get_speed_limit() const;
+
+  private:
+    double radius = 0.033; ///< Wheel radius of the robot
+    double wheel_base = 0.08; ///< Distance between the centerline and the wheels of the robot
+    double wheel_speed_limit = 6.35; ///< Speed limit of the wheels
+  };
+}
+
+#endif //DIFF_DRIVE_INCLUDE_GUARD_HPP
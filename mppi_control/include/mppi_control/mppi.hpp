@@ -0,0 +1,148 @@
+#ifndef MPPI_INCLUDE_GUARD_HPP
+#define MPPI_INCLUDE_GUARD_HPP
+/// \file
+/// \brief A library to perform model predictive path integral (MPPI) control with a diff drive robot
+
+#include <memory>
+#include <vector>
+
+#include "mppi_control/cost_map.hpp"
+#include "mppi_control/diff_drive.hpp"
+#include "mppi_control/rollout.hpp"
+
+namespace mppi
+{
+  /// \brief Savitzky-Golay smoothing filter. Each output is the value of a least squares polynomial fit to the window of samples centered on it.
+  /// The first and last half windows are evaluated from the fit to the first and last full window, which matches the "interp" mode of scipy.signal.savgol_filter.
+  class SavitzkyGolay
+  {
+  public:
+
+    /// \brief default constructor, a filter that does not change the samples
+    SavitzkyGolay() {};
+
+    /// \brief Create the filter
+    /// \param window the number of samples in the window, must be odd and larger than the order
+    /// \param order the order of the fitted polynomial
+    SavitzkyGolay(int window, int order);
+
+    /// \brief Get the window length
+    /// \returns the number of samples in the window
+    int get_window() const;
+
+    /// \brief Smooth a sequence of samples
+    /// \param samples the samples to smooth, at least as many as the window length
+    /// \param n the number of samples
+    /// \param output [out] room for n smoothed samples, must not overlap the input
+    void filter(const double * samples, int n, double * output) const;
+
+  private:
+    int window = 1; ///< the number of samples in the window
+    int half = 0; ///< the number of samples on each side of the center of the window
+
+    std::vector<double> coeffs = {1.0}; ///< row p holds the weights of the window samples to evaluate the fit at window position p
+  };
+
+  /// \brief MPPI controller for a diff drive robot. The rollouts are simulated by a pluggable backend, see rollout.hpp.
+  /// Every buffer is allocated when the controller is created, so get_control does not allocate with the CPU backends.
+  class MPPI
+  {
+  public:
+
+    /// \brief Create the controller
+    /// \param initial_action an inital guess at the controls for the first horizon, one action for each horizon step
+    /// \param goal target waypoint
+    /// \param horizon_time defines the time to compute the control over
+    /// \param horizon_steps defines the number of descrete steps during the time horizon
+    /// \param lambda mppi parameter
+    /// \param sigma standard deviation of the sampled control pertubations
+    /// \param N number of rollouts/samples
+    /// \param Q the diagonal of the 3x3 cost function state weights
+    /// \param R the diagonal of the 2x2 cost function control weights
+    /// \param P1 the diagonal of the 3x3 terminal cost function state weights
+    /// \param robot the robot model
+    MPPI(std::vector<Action> initial_action, Pose goal, double horizon_time, int horizon_steps, double lambda, double sigma, int N,
+         std::vector<double> Q, std::vector<double> R, std::vector<double> P1, DiffDriveRobot robot);
+
+    /// \brief Change the backend that simulates the rollouts, the default is a single thread with the vectorized kernel
+    /// \param backend the new backend, ignored if it is null
+    void set_rollouts(std::unique_ptr<RolloutBackend> backend);
+
+    /// \brief Add obstacle and path tracking costs to the rollouts
+    /// \param cost_map the costs to look up, null removes them
+    /// \param obstacle_weight weight of the obstacle cost at each step
+    /// \param path_weight weight of the squared distance to the reference path at each step
+    /// \param progress_weight terminal weight of the distance left along the reference path
+    void set_cost_map(std::shared_ptr<const CostMap> cost_map, double obstacle_weight, double path_weight, double progress_weight);
+
+    /// \brief Change the target waypoint
+    /// \param goal target waypoint
+    void set_goal(Pose goal);
+
+    /// \brief Change the target waypoint and the inital action
+    /// \param goal target waypoint
+    /// \param action_seq the inital guess for the new target, one action for each horizon step
+    void set_goal(Pose goal, std::vector<Action> action_seq);
+
+    /// \brief Seed the sampling of the control pertubations to make the controller repeatable
+    /// \param seed the seed
+    void set_seed(unsigned int seed);
+
+    /// \brief The main MPPI alogrithm
+    /// \param cur_state the current pose of the robot
+    /// \param cur_time the current time
+    /// \returns wheel velocities to apply to the robot
+    Action get_control(Pose cur_state, double cur_time);
+
+    /// \brief Determine if the robot is at the goal location
+    /// \param cur_state the current pose of the robot
+    /// \param lim the threshold to determine if the goal has been met
+    /// \returns True if the robot has arrived at the goal, otherwise False
+    bool made_it(Pose cur_state, double lim) const;
+
+    /// \brief Get the current action sequence
+    /// \returns one action for each horizon step
+    std::vector<Action> get_action_sequence() const;
+
+  private:
+    double lam; ///< mppi parameter
+    double sig; ///< standard deviation of the sampled control pertubations
+
+    int horizon; ///< the number of descrete steps during the time horizon
+    double dt; ///< the time between each step in the horizon
+    double last_time = 0; ///< last time an action was sent to the robot
+
+    /// The action sequence is kept in one of two pairs of buffers of horizon + 1 values starting at index 1. Smoothing writes the next sequence
+    /// into the other pair starting at index 0, which advances the sequence by a step, and the last slot gets a0.
+    std::vector<double> right_buffers[2]; ///< the right wheel velocity at each step in the action sequence
+    std::vector<double> left_buffers[2]; ///< the left wheel velocity at each step in the action sequence
+    int active = 0; ///< the buffers holding the current action sequence
+
+    std::vector<double> delta_right; ///< the update to the right wheel velocities
+    std::vector<double> delta_left; ///< the update to the left wheel velocities
+    Action a0; ///< The action to append to the sequence after robot has been issued a control
+
+    int N; ///< Number of rollouts/samples
+
+    Pose goal; ///< Target waypoint
+
+    std::vector<double> Q; ///< diagonal of the cost function state weights
+    std::vector<double> R; ///< diagonal of the cost function control weights
+    std::vector<double> P1; ///< diagonal of the terminal cost function state weights
+
+    DiffDriveRobot diff_drive; ///< The robot model
+
+    SavitzkyGolay smoother; ///< filter to smooth the control
+
+    std::unique_ptr<RolloutBackend> rollouts; ///< simulates the rollouts and samples the control pertubations
+    RolloutProblem problem; ///< the parameters passed to the backend
+
+    std::shared_ptr<const CostMap> cost_map; ///< obstacle and path tracking costs, kept alive while the backend uses them
+
+    /// \brief Load an action sequence
+    /// \param action_seq one action for each horizon step
+    void set_actions(const std::vector<Action> & action_seq);
+  };
+}
+
+#endif //MPPI_INCLUDE_GUARD_HPP
@@ -0,0 +1,67 @@
+#ifndef NOISE_INCLUDE_GUARD_HPP
+#define NOISE_INCLUDE_GUARD_HPP
+/// \file
+/// \brief Bulk sampling of the normally distributed control pertubations
+
+namespace mppi
+{
+  /// \brief Fills whole buffers with normally distributed samples. The uniform samples come from xoshiro256** and are transformed in pairs
+  /// with the Box-Muller transform, so a buffer costs one log and one vectorized sine and cosine per pair and never allocates.
+  class NormalSampler
+  {
+  public:
+
+    /// \brief Create the sampler
+    /// \param seed the seed of the generator
+    explicit NormalSampler(unsigned long long seed=0);
+
+    /// \brief Restart the generator
+    /// \param seed the seed of the generator
+    void seed(unsigned long long seed);
+
+    /// \brief Fill a buffer with independent samples of a zero mean normal distribution
+    /// \param out [out] room for n samples
+    /// \param n the number of samples
+    /// \param sigma the standard deviation
+    void fill(double * out, int n, double sigma);
+
+  private:
+    unsigned long long state[4]; ///< state of the generator
+
+    /// \brief Advance the generator
+    /// \returns 64 random bits
+    unsigned long long next()
+    {
+      const unsigned long long result = rotl(state[1] * 5, 7) * 9;
+      const unsigned long long t = state[1] << 17;
+
+      state[2] ^= state[0];
+      state[3] ^= state[1];
+      state[1] ^= state[2];
+      state[0] ^= state[3];
+
+      state[2] ^= t;
+      state[3] = rotl(state[3], 45);
+
+      return result;
+    }
+
+    /// \brief Draw a uniform sample
+    /// \returns a sample in the open interval (0, 1)
+    double uniform()
+    {
+      return ((next() >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+    }
+
+    /// \brief Rotate the bits of a word to the left
+    /// \param x the word
+    /// \param k the number of bits to rotate by
+    /// \returns the rotated word
+    static unsigned long long rotl(unsigned long long x, int k)
+    {
+      return (x << k) | (x >> (64 - k));
+    }
+  };
+}
+
+#endif //NOISE_INCLUDE_GUARD_HPP
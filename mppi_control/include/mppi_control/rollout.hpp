@@ -0,0 +1,135 @@
+#ifndef ROLLOUT_INCLUDE_GUARD_HPP
+#define ROLLOUT_INCLUDE_GUARD_HPP
+/// \file
+/// \brief Backends that simulate the MPPI rollouts and reduce them to an update of the action sequence
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mppi_control/cost_map.hpp"
+#include "mppi_control/diff_drive.hpp"
+#include "mppi_control/noise.hpp"
+#include "mppi_control/thread_pool.hpp"
+
+namespace mppi
+{
+  /// \brief Everything a backend needs to simulate the rollouts of one control update
+  struct RolloutProblem
+  {
+    Pose start; ///< the current pose of the robot
+    Pose goal; ///< target waypoint
+
+    const double * a_right = nullptr; ///< the mean right wheel velocity at each horizon step
+    const double * a_left = nullptr; ///< the mean left wheel velocity at each horizon step
+
+    int horizon = 0; ///< the number of descrete steps during the time horizon
+    int samples = 0; ///< number of rollouts
+    double dt = 0; ///< the time between each step in the horizon
+
+    double lambda = 1.0; ///< mppi parameter
+    double sigma = 0.0; ///< standard deviation of the sampled control pertubations
+
+    double Q[3] = {0, 0, 0}; ///< diagonal of the cost function state weights
+    double R[2] = {0, 0}; ///< diagonal of the cost function control weights
+    double P1[3] = {0, 0, 0}; ///< diagonal of the terminal cost function state weights
+
+    DiffDriveRobot robot; ///< The robot model
+
+    const CostMap * cost_map = nullptr; ///< obstacle and path tracking costs, not used when null
+    unsigned long long cost_map_revision = 0; ///< changes whenever a different cost map is set, so backends know to copy it again
+    double obstacle_weight = 0; ///< weight of the obstacle cost at each step
+    double path_weight = 0; ///< weight of the squared distance to the reference path at each step
+    double progress_weight = 0; ///< terminal weight of the distance left along the reference path
+  };
+
+  /// \brief Interface to the rollout backends. A backend samples the control pertubations, simulates every rollout,
+  /// and reduces the rollouts to the cost weighted average pertubation at each step of the horizon.
+  class RolloutBackend
+  {
+  public:
+    virtual ~RolloutBackend() {};
+
+    /// \brief Seed the sampling of the control pertubations to make the rollouts repeatable
+    /// \param seed the seed
+    virtual void set_seed(unsigned int seed) = 0;
+
+    /// \brief Allocate everything needed for a problem size up front, so calls to compute with that size do not allocate
+    /// \param horizon the number of descrete steps during the time horizon
+    /// \param samples number of rollouts
+    virtual void reserve(int horizon, int samples) { (void)horizon; (void)samples; };
+
+    /// \brief Simulate the rollouts and compute the update to the action sequence
+    /// \param problem the rollouts to simulate
+    /// \param delta_right [out] room for horizon values, the weighted average right wheel pertubation at each step
+    /// \param delta_left [out] room for horizon values, the weighted average left wheel pertubation at each step
+    virtual void compute(const RolloutProblem & problem, double * delta_right, double * delta_left) = 0;
+  };
+
+  /// \brief Which kernel the CPU backend uses to simulate the rollouts
+  enum class RolloutKernel
+  {
+    scalar, ///< one sample at a time
+    simd ///< several samples at a time with vector instructions, falls back to scalar when they are not available
+  };
+
+  /// \brief Rollouts on the CPU. The samples are split into one contiguous chunk per thread and each chunk has its own random number generator,
+  /// so the rollouts are repeatable for a fixed seed and thread count. The weighted average is a parallel reduction of the per chunk partial sums.
+  class CpuRollouts : public RolloutBackend
+  {
+  public:
+
+    /// \brief Create the backend
+    /// \param threads the number of threads to use, 0 uses one thread per available core
+    /// \param kernel the kernel used to simulate the rollouts
+    CpuRollouts(unsigned int threads=1, RolloutKernel kernel=RolloutKernel::simd);
+
+    void set_seed(unsigned int seed) override;
+
+    void reserve(int horizon, int samples) override;
+
+    void compute(const RolloutProblem & problem, double * delta_right, double * delta_left) override;
+
+  private:
+    /// \brief The samples simulated by one thread
+    struct Chunk
+    {
+      int begin = 0; ///< first sample
+      int size = 0; ///< number of samples
+
+      NormalSampler noise; ///< source of the control pertubations of the chunk
+
+      std::vector<double> eps_right; ///< right wheel pertubations, horizon x size in step major order
+      std::vector<double> eps_left; ///< left wheel pertubations, horizon x size in step major order
+      std::vector<double> cost; ///< cost to go, (horizon + 1) x size in step major order
+      std::vector<double> x, y, th; ///< the state of each rollout
+
+      std::vector<double> min_cost; ///< the smallest cost to go of the chunk at each step
+      std::vector<double> sums; ///< the weight and weighted pertubation sums of the chunk at each step
+    };
+
+    ThreadPool pool; ///< the threads running the chunks
+    RolloutKernel kernel; ///< the kernel used to simulate the rollouts
+
+    std::vector<Chunk> chunks; ///< one chunk per thread
+
+    /// \brief Simulate the rollouts of a chunk and compute the cost to go
+    /// \param problem the rollouts to simulate
+    /// \param chunk the samples to simulate
+    void simulate(const RolloutProblem & problem, Chunk & chunk) const;
+
+    /// \brief Simulate the rollouts of a chunk two samples at a time with SSE2
+    /// \param problem the rollouts to simulate
+    /// \param chunk the samples to simulate
+    /// \returns the number of samples simulated, the rest are left for the scalar kernel
+    int simulate_simd(const RolloutProblem & problem, Chunk & chunk) const;
+  };
+
+  /// \brief Create a rollout backend by name
+  /// \param name "cpu" for the scalar kernel, "simd" for the vectorized kernel, or "cuda" for the GPU when the package was built with CUDA
+  /// \param threads the number of threads used by the CPU backends, 0 uses one thread per available core
+  /// \returns the backend, or nullptr if the name is unknown or the backend was not built
+  std::unique_ptr<RolloutBackend> make_rollouts(const std::string & name, unsigned int threads=1);
+}
+
+#endif //ROLLOUT_INCLUDE_GUARD_HPP
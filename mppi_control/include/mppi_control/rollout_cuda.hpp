@@ -0,0 +1,58 @@
+#ifndef ROLLOUT_CUDA_INCLUDE_GUARD_HPP
+#define ROLLOUT_CUDA_INCLUDE_GUARD_HPP
+/// \file
+/// \brief MPPI rollouts on the GPU, only built when CUDA is found
+
+#include "mppi_control/rollout.hpp"
+
+namespace mppi
+{
+  /// \brief Rollouts on the GPU. Each CUDA thread simulates one sample with its own counter based random number stream,
+  /// and each step of the horizon is reduced to the weighted average pertubation by one thread block.
+  class CudaRollouts : public RolloutBackend
+  {
+  public:
+
+    /// \brief Create the backend on the current CUDA device
+    CudaRollouts();
+
+    /// \brief Free the device buffers
+    ~CudaRollouts();
+
+    CudaRollouts(const CudaRollouts &) = delete;
+    CudaRollouts & operator=(const CudaRollouts &) = delete;
+
+    void set_seed(unsigned int seed) override;
+
+    void reserve(int horizon, int samples) override;
+
+    void compute(const RolloutProblem & problem, double * delta_right, double * delta_left) override;
+
+  private:
+    unsigned long long seed = 0; ///< seed of the random number streams
+    unsigned long long calls = 0; ///< number of updates so far, each update uses a new part of the streams
+
+    int horizon = 0; ///< the horizon the buffers were allocated for
+    int samples = 0; ///< the number of samples the buffers were allocated for
+
+    double * d_actions = nullptr; ///< the mean right then left wheel velocities on the device, 2 x horizon
+    double * d_eps = nullptr; ///< the right then left wheel pertubations on the device, 2 x horizon x samples
+    double * d_cost = nullptr; ///< the cost to go on the device, (horizon + 1) x samples
+    double * d_delta = nullptr; ///< the right then left weighted average pertubations on the device, 2 x horizon
+
+    CostCell * d_cells = nullptr; ///< the cells of the cost map on the device
+    PathSegment * d_segments = nullptr; ///< the segments of the reference path on the device
+    int cell_count = 0; ///< the number of cells d_cells has room for
+    int segment_count = 0; ///< the number of segments d_segments has room for
+    unsigned long long cost_map_revision = 0; ///< revision of the cost map on the device, 0 if none was copied
+
+    /// \brief Free the device buffers
+    void release();
+
+    /// \brief Copy the cost map of a problem to the device if it changed
+    /// \param problem the problem with the cost map
+    void upload(const RolloutProblem & problem);
+  };
+}
+
+#endif //ROLLOUT_CUDA_INCLUDE_GUARD_HPP
@@ -0,0 +1,94 @@
+#ifndef SIMD_INCLUDE_GUARD_HPP
+#define SIMD_INCLUDE_GUARD_HPP
+/// \file
+/// \brief Vectorized math functions shared by the rollout kernels and the noise sampler
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+
+namespace mppi
+{
+  /// \brief Sine and cosine of two angles. The angles are reduced to [-pi/4, pi/4] and evaluated with polynomials that are accurate to a few ulps there.
+  /// \param a the angles
+  /// \param s [out] the sines
+  /// \param c [out] the cosines
+  inline void sincos_pd(__m128d a, __m128d & s, __m128d & c)
+  {
+    // nearest multiple of pi/2, with pi/2 split in two so the reduction stays exact for the angles a rollout reaches
+    const __m128i q = _mm_cvtpd_epi32(_mm_mul_pd(a, _mm_set1_pd(0.63661977236758134308)));
+    const __m128d qd = _mm_cvtepi32_pd(q);
+
+    __m128d r = _mm_sub_pd(a, _mm_mul_pd(qd, _mm_set1_pd(1.57079632673412561417e+00)));
+    r = _mm_sub_pd(r, _mm_mul_pd(qd, _mm_set1_pd(6.07710050650619224932e-11)));
+
+    const __m128d r2 = _mm_mul_pd(r, r);
+
+    // taylor series, the first omitted terms are below 1e-16 on [-pi/4, pi/4]
+    __m128d ps = _mm_set1_pd(-1.0 / 1307674368000.0);
+    ps = _mm_add_pd(_mm_mul_pd(ps, r2), _mm_set1_pd(1.0 / 6227020800.0));
+    ps = _mm_add_pd(_mm_mul_pd(ps, r2), _mm_set1_pd(-1.0 / 39916800.0));
+    ps = _mm_add_pd(_mm_mul_pd(ps, r2), _mm_set1_pd(1.0 / 362880.0));
+    ps = _mm_add_pd(_mm_mul_pd(ps, r2), _mm_set1_pd(-1.0 / 5040.0));
+    ps = _mm_add_pd(_mm_mul_pd(ps, r2), _mm_set1_pd(1.0 / 120.0));
+    ps = _mm_add_pd(_mm_mul_pd(ps, r2), _mm_set1_pd(-1.0 / 6.0));
+    ps = _mm_add_pd(_mm_mul_pd(_mm_mul_pd(ps, r2), r), r);
+
+    __m128d pc = _mm_set1_pd(1.0 / 20922789888000.0);
+    pc = _mm_add_pd(_mm_mul_pd(pc, r2), _mm_set1_pd(-1.0 / 87178291200.0));
+    pc = _mm_add_pd(_mm_mul_pd(pc, r2), _mm_set1_pd(1.0 / 479001600.0));
+    pc = _mm_add_pd(_mm_mul_pd(pc, r2), _mm_set1_pd(-1.0 / 3628800.0));
+    pc = _mm_add_pd(_mm_mul_pd(pc, r2), _mm_set1_pd(1.0 / 40320.0));
+    pc = _mm_add_pd(_mm_mul_pd(pc, r2), _mm_set1_pd(-1.0 / 720.0));
+    pc = _mm_add_pd(_mm_mul_pd(pc, r2), _mm_set1_pd(1.0 / 24.0));
+    pc = _mm_add_pd(_mm_mul_pd(pc, r2), _mm_set1_pd(-0.5));
+    pc = _mm_add_pd(_mm_mul_pd(pc, r2), _mm_set1_pd(1.0));
+
+    // spread the two 32 bit quadrants into the two 64 bit lanes
+    const __m128i q64 = _mm_shuffle_epi32(q, _MM_SHUFFLE(1, 1, 0, 0));
+
+    // odd quadrants swap the sine and cosine
+    const __m128d swap = _mm_castsi128_pd(_mm_cmpeq_epi32(_mm_and_si128(q64, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+
+    s = _mm_or_pd(_mm_and_pd(swap, pc), _mm_andnot_pd(swap, ps));
+    c = _mm_or_pd(_mm_and_pd(swap, ps), _mm_andnot_pd(swap, pc));
+
+    // the sine is negative in quadrants 2 and 3, the cosine in quadrants 1 and 2
+    const __m128d sin_sign = _mm_castsi128_pd(_mm_slli_epi64(_mm_and_si128(q64, _mm_set1_epi64x(2)), 62));
+    const __m128d cos_sign = _mm_castsi128_pd(_mm_slli_epi64(_mm_and_si128(_mm_add_epi32(q64, _mm_set1_epi32(1)), _mm_set1_epi64x(2)), 62));
+
+    s = _mm_xor_pd(s, sin_sign);
+    c = _mm_xor_pd(c, cos_sign);
+  }
+
+  /// \brief Natural log of two positive normal numbers, accurate to a few ulps
+  /// \param a the numbers
+  /// \returns the logs
+  inline __m128d log_pd(__m128d a)
+  {
+    // split into a mantissa in [sqrt(1/2), sqrt(2)) and a power of 2
+    const __m128i bits = _mm_castpd_si128(a);
+    const __m128i exponent = _mm_sub_epi32(_mm_srli_epi64(bits, 52), _mm_set1_epi32(1023));
+
+    __m128d e = _mm_cvtepi32_pd(_mm_shuffle_epi32(exponent, _MM_SHUFFLE(3, 3, 2, 0)));
+    __m128d m = _mm_or_pd(_mm_and_pd(a, _mm_castsi128_pd(_mm_set1_epi64x(0x000fffffffffffffll))), _mm_set1_pd(1.0));
+
+    const __m128d big = _mm_cmpgt_pd(m, _mm_set1_pd(1.41421356237309504880));
+    m = _mm_or_pd(_mm_and_pd(big, _mm_mul_pd(m, _mm_set1_pd(0.5))), _mm_andnot_pd(big, m));
+    e = _mm_add_pd(e, _mm_and_pd(big, _mm_set1_pd(1.0)));
+
+    // log(m) = 2 atanh(f) with |f| < 0.172, the first omitted term of the series is below 1e-17
+    const __m128d f = _mm_div_pd(_mm_sub_pd(m, _mm_set1_pd(1.0)), _mm_add_pd(m, _mm_set1_pd(1.0)));
+    const __m128d f2 = _mm_mul_pd(f, f);
+
+    __m128d p = _mm_set1_pd(1.0 / 19.0);
+
+    for(int k = 17; k >= 1; k -= 2) p = _mm_add_pd(_mm_mul_pd(p, f2), _mm_set1_pd(1.0 / k));
+
+    const __m128d log_m = _mm_mul_pd(_mm_mul_pd(_mm_set1_pd(2.0), f), p);
+
+    return _mm_add_pd(_mm_mul_pd(e, _mm_set1_pd(0.69314718055994530942)), log_m);
+  }
+}
+#endif
+
+#endif //SIMD_INCLUDE_GUARD_HPP
@@ -0,0 +1,68 @@
+#ifndef THREAD_POOL_INCLUDE_GUARD_HPP
+#define THREAD_POOL_INCLUDE_GUARD_HPP
+/// \file
+/// \brief A fixed set of threads that are started once and reused for every control update
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace mppi
+{
+  /// \brief A fixed set of worker threads. Starting threads costs more than a control period allows, so the workers wait between jobs.
+  class ThreadPool
+  {
+  public:
+
+    /// \brief Start the workers
+    /// \param threads the number of threads to run jobs on including the calling thread, 0 uses one thread per available core
+    explicit ThreadPool(unsigned int threads=1);
+
+    /// \brief Stop and join the workers
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool & operator=(const ThreadPool &) = delete;
+
+    /// \brief Get the number of threads a job runs on
+    /// \returns the number of workers plus the calling thread
+    unsigned int size() const;
+
+    /// \brief Run a job on every thread and wait for all of them to finish. The calling thread runs task 0.
+    /// The task is passed by reference rather than wrapped in a std::function, so running a job never allocates.
+    /// \param task callable with each task index in [0, size())
+    template <typename Task>
+    void run(Task && task)
+    {
+      using TaskType = typename std::remove_reference<Task>::type;
+
+      dispatch([](void * context, unsigned int index){ (*static_cast<TaskType *>(context))(index); }, &task);
+    }
+
+  private:
+    std::vector<std::thread> workers; ///< the threads besides the calling thread
+
+    std::mutex mutex; ///< protects the job state
+    std::condition_variable start_cv; ///< wakes the workers for a new job
+    std::condition_variable done_cv; ///< wakes the caller when the workers finish
+
+    void (*job)(void *, unsigned int) = nullptr; ///< calls the task of the current job
+    void * context = nullptr; ///< the task of the current job
+    unsigned long generation = 0; ///< incremented for every job
+    unsigned int pending = 0; ///< the number of workers still running the current job
+    bool stop = false; ///< tells the workers to exit
+
+    /// \brief Run a type erased job on every thread and wait for all of them to finish
+    /// \param call calls the task with an index
+    /// \param task the task
+    void dispatch(void (*call)(void *, unsigned int), void * task);
+
+    /// \brief The loop each worker runs
+    /// \param index the task index of the worker
+    void work(unsigned int index);
+  };
+}
+
+#endif //THREAD_POOL_INCLUDE_GUARD_HPP
@@ -0,0 +1,198 @@
+/// \file
+/// \brief A precomputed map of the obstacle and path tracking costs looked up by the MPPI rollouts
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "mppi_control/cost_map.hpp"
+
+namespace mppi
+{
+  /// \brief Obstacle cost of unknown cells
+  static constexpr float unknown_cost = 0.5f;
+
+  CostMap::CostMap(const signed char * occupancy, int width, int height, double resolution, double x_origin, double y_origin)
+                   : x_origin(x_origin), y_origin(y_origin), res(resolution), inv_res(1.0 / resolution), width(width), height(height)
+  {
+    cells.resize(width * height);
+
+    for(int k = 0; k < width * height; k++)
+    {
+      const signed char occ = occupancy[k];
+      cells[k].obstacle = (occ < 0) ? unknown_cost : std::min(occ, static_cast<signed char>(100)) / 100.0f;
+    }
+
+    outside.obstacle = 1.0f;
+  }
+
+  void CostMap::set_path(const std::vector<PathPoint> & path)
+  {
+    segments.clear();
+    path_length = 0;
+
+    for(auto & cell : cells) cell.segment = -1;
+
+    if(path.empty()) return;
+
+    // a single point is a segment of zero length
+    const unsigned int count = std::max(static_cast<unsigned int>(path.size()) - 1, 1u);
+
+    for(unsigned int s = 0; s < count; s++)
+    {
+      const PathPoint & a = path.at(s);
+      const PathPoint & b = path.at(std::min(s + 1, static_cast<unsigned int>(path.size()) - 1));
+
+      PathSegment seg;
+      seg.x = a.x;
+      seg.y = a.y;
+      seg.dx = b.x - a.x;
+      seg.dy = b.y - a.y;
+      seg.len = std::hypot(seg.dx, seg.dy);
+      seg.inv_len2 = (seg.len > 0) ? 1.0 / (seg.len * seg.len) : 0.0;
+      seg.start = path_length;
+
+      path_length += seg.len;
+      segments.push_back(seg);
+    }
+
+    if(cells.empty()) return;
+
+    std::vector<double> best(width * height, 0.0);
+
+    // try a segment for the cell (j, i), measured from the cell center
+    auto offer = [&](int j, int i, int s)
+    {
+      CostCell & cell = cells[i * width + j];
+
+      CostCell candidate;
+      candidate.segment = s;
+
+      double progress = 0;
+      const double d2 = path_distance2(candidate, x_origin + (j + 0.5) * res, y_origin + (i + 0.5) * res, progress);
+
+      if(cell.segment == -1 || d2 < best[i * width + j])
+      {
+        cell.segment = s;
+        best[i * width + j] = d2;
+      }
+    };
+
+    // seed the cells each segment passes through
+    bool seeded = false;
+
+    for(unsigned int s = 0; s < segments.size(); s++)
+    {
+      const PathSegment & seg = segments.at(s);
+      const int steps = static_cast<int>(std::ceil(2.0 * seg.len * inv_res)) + 1;
+
+      for(int k = 0; k <= steps; k++)
+      {
+        const double f = static_cast<double>(k) / steps;
+        const int j = static_cast<int>(std::floor((seg.x + f * seg.dx - x_origin) * inv_res));
+        const int i = static_cast<int>(std::floor((seg.y + f * seg.dy - y_origin) * inv_res));
+
+        if(j >= 0 && i >= 0 && j < width && i < height)
+        {
+          offer(j, i, s);
+          seeded = true;
+        }
+      }
+    }
+
+    // a path entirely outside of the map is closest to the border cells
+    if(!seeded)
+    {
+      for(unsigned int s = 0; s < segments.size(); s++)
+      {
+        for(int j = 0; j < width; j++)
+        {
+          offer(j, 0, s);
+          offer(j, height - 1, s);
+        }
+
+        for(int i = 0; i < height; i++)
+        {
+          offer(0, i, s);
+          offer(width - 1, i, s);
+        }
+      }
+    }
+
+    // propagate the closest segment from the neighbors, which is exact except for rare cells near equidistant segments
+    auto pull = [&](int j, int i, int nj, int ni)
+    {
+      if(nj < 0 || ni < 0 || nj >= width || ni >= height) return;
+
+      const int s = cells[ni * width + nj].segment;
+      if(s != -1) offer(j, i, s);
+    };
+
+    for(int i = 0; i < height; i++)
+    {
+      for(int j = 0; j < width; j++)
+      {
+        pull(j, i, j - 1, i);
+        pull(j, i, j - 1, i - 1);
+        pull(j, i, j, i - 1);
+        pull(j, i, j + 1, i - 1);
+      }
+
+      for(int j = width - 1; j >= 0; j--) pull(j, i, j + 1, i);
+    }
+
+    for(int i = height - 1; i >= 0; i--)
+    {
+      for(int j = width - 1; j >= 0; j--)
+      {
+        pull(j, i, j + 1, i);
+        pull(j, i, j + 1, i + 1);
+        pull(j, i, j, i + 1);
+        pull(j, i, j - 1, i + 1);
+      }
+
+      for(int j = 0; j < width; j++) pull(j, i, j - 1, i);
+    }
+  }
+
+  bool CostMap::has_path() const
+  {
+    return !segments.empty();
+  }
+
+  double CostMap::get_path_length() const
+  {
+    return path_length;
+  }
+
+  int CostMap::get_width() const
+  {
+    return width;
+  }
+
+  int CostMap::get_height() const
+  {
+    return height;
+  }
+
+  double CostMap::get_resolution() const
+  {
+    return res;
+  }
+
+  void CostMap::get_origin(double & x, double & y) const
+  {
+    x = x_origin;
+    y = y_origin;
+  }
+
+  const CostCell * CostMap::get_cells() const
+  {
+    return cells.data();
+  }
+
+  const std::vector<PathSegment> & CostMap::get_segments() const
+  {
+    return segments;
+  }
+}
@@ -0,0 +1,25 @@
+/// \file
+/// \brief The kinematic model of the diff drive robot controlled by MPPI
+
+#include "mppi_control/diff_drive.hpp"
+
+namespace mppi
+{
+  DiffDriveRobot::DiffDriveRobot(double radius, double wheel_base, double wheel_speed_limit) : radius(radius), wheel_base(wheel_base),
+                                                                                              wheel_speed_limit(wheel_speed_limit) {}
+
+  double DiffDriveRobot::get_radius() const
+  {
+    return radius;
+  }
+
+  double DiffDriveRobot::get_wheel_base() const
+  {
+    return wheel_base;
+  }
+
+  double DiffDriveRobot::get_speed_limit() const
+  {
+    return wheel_speed_limit;
+  }
+}
@@ -0,0 +1,296 @@
+/// \file
+/// \brief A library to perform model predictive path integral (MPPI) control with a diff drive robot
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "mppi_control/mppi.hpp"
+#include "mppi_control/rollout.hpp"
+
+namespace mppi
+{
+  /// \brief Order of the polynomial used to smooth the action sequence
+  static constexpr int smoothing_order = 3;
+
+  /// \brief Solve a small dense linear system with gaussian elimination and partial pivoting
+  /// \param A the n x n matrix in row major order, overwritten
+  /// \param b the right hand side, overwritten with the solution
+  /// \param n the size of the system
+  static void solve(std::vector<double> & A, std::vector<double> & b, int n)
+  {
+    for(int col = 0; col < n; col++)
+    {
+      int pivot = col;
+
+      for(int row = col + 1; row < n; row++)
+      {
+        if(std::fabs(A.at(row * n + col)) > std::fabs(A.at(pivot * n + col))) pivot = row;
+      }
+
+      if(A.at(pivot * n + col) == 0) throw std::invalid_argument("Singular system in the smoothing filter.");
+
+      for(int k = 0; k < n; k++) std::swap(A.at(col * n + k), A.at(pivot * n + k));
+      std::swap(b.at(col), b.at(pivot));
+
+      for(int row = col + 1; row < n; row++)
+      {
+        const double f = A.at(row * n + col) / A.at(col * n + col);
+
+        for(int k = col; k < n; k++) A.at(row * n + k) -= f * A.at(col * n + k);
+        b.at(row) -= f * b.at(col);
+      }
+    }
+
+    for(int row = n - 1; row >= 0; row--)
+    {
+      for(int k = row + 1; k < n; k++) b.at(row) -= A.at(row * n + k) * b.at(k);
+      b.at(row) /= A.at(row * n + row);
+    }
+  }
+
+  SavitzkyGolay::SavitzkyGolay(int window, int order) : window(window), half(window / 2)
+  {
+    if(window < 1 || window % 2 == 0) throw std::invalid_argument("The smoothing window must be odd.");
+    if(order < 0 || order >= window) throw std::invalid_argument("The smoothing order must be less than the window.");
+
+    // window positions scaled to [-1, 1] to keep the normal equations well conditioned
+    const double scale = (half > 0) ? 1.0 / half : 1.0;
+    const int terms = order + 1;
+
+    std::vector<double> powers(window * terms);
+
+    for(int k = 0; k < window; k++)
+    {
+      const double z = (k - half) * scale;
+      double p = 1.0;
+
+      for(int j = 0; j < terms; j++)
+      {
+        powers.at(k * terms + j) = p;
+        p *= z;
+      }
+    }
+
+    // the normal equations of the least squares fit
+    std::vector<double> normal(terms * terms, 0.0);
+
+    for(int i = 0; i < terms; i++)
+    {
+      for(int j = 0; j < terms; j++)
+      {
+        for(int k = 0; k < window; k++) normal.at(i * terms + j) += powers.at(k * terms + i) * powers.at(k * terms + j);
+      }
+    }
+
+    // the value of the fit at position q is a weighted sum of the window samples
+    coeffs.assign(window * window, 0.0);
+
+    for(int q = 0; q < window; q++)
+    {
+      std::vector<double> A = normal;
+      std::vector<double> c(powers.begin() + q * terms, powers.begin() + (q + 1) * terms);
+
+      solve(A, c, terms);
+
+      for(int k = 0; k < window; k++)
+      {
+        for(int j = 0; j < terms; j++) coeffs.at(q * window + k) += powers.at(k * terms + j) * c.at(j);
+      }
+    }
+  }
+
+  int SavitzkyGolay::get_window() const
+  {
+    return window;
+  }
+
+  void SavitzkyGolay::filter(const double * samples, int n, double * output) const
+  {
+    if(n < window)
+    {
+      std::copy(samples, samples + n, output);
+      return;
+    }
+
+    // the start of the sequence from the fit to the first window
+    for(int i = 0; i < half; i++)
+    {
+      const double * c = coeffs.data() + i * window;
+      double sum = 0;
+
+      for(int k = 0; k < window; k++) sum += c[k] * samples[k];
+      output[i] = sum;
+    }
+
+    // the interior from the fit centered on each sample
+    const double * center = coeffs.data() + half * window;
+
+    for(int i = half; i < n - half; i++)
+    {
+      const double * s = samples + i - half;
+      double sum = 0;
+
+      for(int k = 0; k < window; k++) sum += center[k] * s[k];
+      output[i] = sum;
+    }
+
+    // the end of the sequence from the fit to the last window
+    const double * last = samples + n - window;
+
+    for(int i = n - half; i < n; i++)
+    {
+      const double * c = coeffs.data() + (i - (n - window)) * window;
+      double sum = 0;
+
+      for(int k = 0; k < window; k++) sum += c[k] * last[k];
+      output[i] = sum;
+    }
+  }
+
+  MPPI::MPPI(std::vector<Action> initial_action, Pose goal, double horizon_time, int horizon_steps, double lambda, double sigma, int N,
+             std::vector<double> Q, std::vector<double> R, std::vector<double> P1, DiffDriveRobot robot) : lam(lambda), sig(sigma),
+             horizon(horizon_steps), N(N), goal(goal), Q(Q), R(R), P1(P1), diff_drive(robot),
+             rollouts(new CpuRollouts())
+  {
+    if(horizon_steps < 1) throw std::invalid_argument("The horizon needs at least one step.");
+    if(N < 1) throw std::invalid_argument("MPPI needs at least one sample.");
+    if(Q.size() != 3 || R.size() != 2 || P1.size() != 3) throw std::invalid_argument("The cost weights must be the diagonals of Q (3), R (2) and P1 (3).");
+
+    dt = horizon_time / horizon_steps;
+
+    // every buffer the control loop needs is allocated here
+    for(int i = 0; i < 2; i++)
+    {
+      right_buffers[i].assign(horizon + 1, 0.0);
+      left_buffers[i].assign(horizon + 1, 0.0);
+    }
+
+    delta_right.assign(horizon, 0.0);
+    delta_left.assign(horizon, 0.0);
+
+    set_actions(initial_action);
+
+    problem.horizon = horizon;
+    problem.samples = N;
+    problem.dt = dt;
+    problem.lambda = lam;
+    problem.sigma = sig;
+    std::copy(Q.begin(), Q.end(), problem.Q);
+    std::copy(R.begin(), R.end(), problem.R);
+    std::copy(P1.begin(), P1.end(), problem.P1);
+    problem.robot = diff_drive;
+
+    rollouts->reserve(horizon, N);
+
+    // smooth over the horizon with a cubic, the window has to be odd
+    int window = std::max(horizon - 1, 1);
+    if(window % 2 == 0) window--;
+
+    smoother = SavitzkyGolay(window, std::min(smoothing_order, window - 1));
+  }
+
+  void MPPI::set_rollouts(std::unique_ptr<RolloutBackend> backend)
+  {
+    if(!backend) return;
+
+    rollouts = std::move(backend);
+    rollouts->reserve(horizon, N);
+  }
+
+  void MPPI::set_cost_map(std::shared_ptr<const CostMap> new_cost_map, double obstacle_weight, double path_weight, double progress_weight)
+  {
+    cost_map = std::move(new_cost_map);
+
+    problem.cost_map = cost_map.get();
+    problem.cost_map_revision++;
+    problem.obstacle_weight = obstacle_weight;
+    problem.path_weight = path_weight;
+    problem.progress_weight = progress_weight;
+  }
+
+  void MPPI::set_goal(Pose new_goal)
+  {
+    goal = new_goal;
+  }
+
+  void MPPI::set_goal(Pose new_goal, std::vector<Action> action_seq)
+  {
+    goal = new_goal;
+    set_actions(action_seq);
+  }
+
+  void MPPI::set_seed(unsigned int seed)
+  {
+    rollouts->set_seed(seed);
+  }
+
+  Action MPPI::get_control(Pose cur_state, double cur_time)
+  {
+    double * a_right = right_buffers[active].data() + 1;
+    double * a_left = left_buffers[active].data() + 1;
+
+    problem.start = cur_state;
+    problem.goal = goal;
+    problem.a_right = a_right;
+    problem.a_left = a_left;
+
+    // update the actions with the cost weighted average of the pertubations
+    rollouts->compute(problem, delta_right.data(), delta_left.data());
+
+    for(int t = 0; t < horizon; t++)
+    {
+      a_right[t] += delta_right[t];
+      a_left[t] += delta_left[t];
+    }
+
+    // filter to smooth the control into the other buffers, one slot early to advance the sequence without moving it
+    std::vector<double> & next_right = right_buffers[1 - active];
+    std::vector<double> & next_left = left_buffers[1 - active];
+
+    smoother.filter(a_right, horizon, next_right.data());
+    smoother.filter(a_left, horizon, next_left.data());
+
+    const Action cmd(next_right[0], next_left[0]);
+
+    next_right[horizon] = a0.right;
+    next_left[horizon] = a0.left;
+
+    active = 1 - active;
+
+    last_time = cur_time;
+
+    return cmd;
+  }
+
+  bool MPPI::made_it(Pose cur_state, double lim) const
+  {
+    const double dx = cur_state.x - goal.x, dy = cur_state.y - goal.y, dth = cur_state.th - goal.th;
+
+    return std::sqrt(dx * dx + dy * dy + dth * dth) < lim;
+  }
+
+  std::vector<Action> MPPI::get_action_sequence() const
+  {
+    std::vector<Action> action_seq;
+
+    for(int t = 1; t <= horizon; t++) action_seq.push_back(Action(right_buffers[active].at(t), left_buffers[active].at(t)));
+
+    return action_seq;
+  }
+
+  void MPPI::set_actions(const std::vector<Action> & action_seq)
+  {
+    if(static_cast<int>(action_seq.size()) != horizon) throw std::invalid_argument("The action sequence needs one action for each horizon step.");
+
+    for(int t = 0; t < horizon; t++)
+    {
+      right_buffers[active].at(t + 1) = action_seq.at(t).right;
+      left_buffers[active].at(t + 1) = action_seq.at(t).left;
+    }
+
+    a0 = action_seq.at(0);
+  }
+}
@@ -0,0 +1,77 @@
+/// \file
+/// \brief Bulk sampling of the normally distributed control pertubations
+
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "mppi_control/noise.hpp"
+#include "mppi_control/simd.hpp"
+
+namespace mppi
+{
+  /// \brief 2 pi
+  static constexpr double two_pi = 6.28318530717958647693;
+
+  NormalSampler::NormalSampler(unsigned long long seed)
+  {
+    this->seed(seed);
+  }
+
+  void NormalSampler::seed(unsigned long long seed)
+  {
+    // spread the seed over the whole state with splitmix64
+    for(auto & word : state)
+    {
+      seed += 0x9e3779b97f4a7c15ull;
+
+      unsigned long long z = seed;
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+      word = z ^ (z >> 31);
+    }
+  }
+
+  void NormalSampler::fill(double * out, int n, double sigma)
+  {
+    int i = 0;
+
+#if defined(__SSE2__)
+    // two pairs at a time
+    const __m128d minus_two_sigma2 = _mm_set1_pd(-2.0 * sigma * sigma);
+
+    for(; i + 4 <= n; i += 4)
+    {
+      const double u0 = uniform(), u1 = uniform();
+
+      // angles in [-pi, pi] keep the reduction of the sine and cosine short
+      const double a0 = two_pi * (uniform() - 0.5);
+      const double a1 = two_pi * (uniform() - 0.5);
+
+      const __m128d r = _mm_sqrt_pd(_mm_mul_pd(minus_two_sigma2, log_pd(_mm_set_pd(u1, u0))));
+
+      __m128d s, c;
+      sincos_pd(_mm_set_pd(a1, a0), s, c);
+
+      const __m128d x = _mm_mul_pd(r, c), y = _mm_mul_pd(r, s);
+
+      // interleave to x0 y0 x1 y1
+      _mm_storeu_pd(out + i, _mm_unpacklo_pd(x, y));
+      _mm_storeu_pd(out + i + 2, _mm_unpackhi_pd(x, y));
+    }
+#endif
+
+    for(; i + 2 <= n; i += 2)
+    {
+      const double r = sigma * std::sqrt(-2.0 * std::log(uniform()));
+      const double a = two_pi * (uniform() - 0.5);
+
+      out[i] = r * std::cos(a);
+      out[i + 1] = r * std::sin(a);
+    }
+
+    if(i < n) out[i] = sigma * std::sqrt(-2.0 * std::log(uniform())) * std::cos(two_pi * (uniform() - 0.5));
+  }
+}
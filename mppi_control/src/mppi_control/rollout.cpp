@@ -0,0 +1,352 @@
+/// \file
+/// \brief Backends that simulate the MPPI rollouts and reduce them to an update of the action sequence
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "mppi_control/diff_drive.hpp"
+#include "mppi_control/noise.hpp"
+#include "mppi_control/rollout.hpp"
+#include "mppi_control/simd.hpp"
+
+#ifdef MPPI_CUDA
+#include "mppi_control/rollout_cuda.hpp"
+#endif
+
+namespace mppi
+{
+  /// \brief Number of values in the per step partial sums of a chunk
+  static constexpr int sum_terms = 5;
+
+  /// \brief Weight added to every sample so the weights never sum to zero
+  static constexpr double min_weight = 1e-8;
+
+  /// \brief The cost map part of the running cost at a position
+  /// \param problem the rollouts being simulated, with a cost map
+  /// \param x x position
+  /// \param y y position
+  /// \returns the weighted obstacle and path distance costs
+  static inline double map_cost(const RolloutProblem & problem, double x, double y)
+  {
+    const CostCell & cell = problem.cost_map->at(x, y);
+
+    double progress = 0;
+    const double dist2 = problem.cost_map->path_distance2(cell, x, y, progress);
+
+    return problem.obstacle_weight * cell.obstacle + problem.path_weight * dist2;
+  }
+
+  /// \brief The cost map part of the terminal cost at a position
+  /// \param problem the rollouts being simulated, with a cost map
+  /// \param x x position
+  /// \param y y position
+  /// \returns the weighted running cost and distance left along the reference path
+  static inline double map_terminal_cost(const RolloutProblem & problem, double x, double y)
+  {
+    const CostCell & cell = problem.cost_map->at(x, y);
+
+    double progress = 0;
+    const double dist2 = problem.cost_map->path_distance2(cell, x, y, progress);
+    const double left = problem.cost_map->get_path_length() - progress;
+
+    return problem.obstacle_weight * cell.obstacle + problem.path_weight * dist2 + problem.progress_weight * left;
+  }
+
+  CpuRollouts::CpuRollouts(unsigned int threads, RolloutKernel kernel) : pool(threads), kernel(kernel), chunks(pool.size())
+  {
+    set_seed(std::random_device{}());
+  }
+
+  void CpuRollouts::set_seed(unsigned int seed)
+  {
+    for(unsigned int k = 0; k < chunks.size(); k++)
+    {
+      chunks.at(k).noise.seed((static_cast<unsigned long long>(seed) << 32) | k);
+    }
+  }
+
+  void CpuRollouts::reserve(int horizon, int samples)
+  {
+    const int K = chunks.size();
+
+    // split the samples into contiguous chunks
+    for(int k = 0; k < K; k++)
+    {
+      Chunk & chunk = chunks.at(k);
+      chunk.begin = (samples * k) / K;
+      chunk.size = (samples * (k + 1)) / K - chunk.begin;
+
+      const int m = chunk.size;
+
+      chunk.eps_right.resize(horizon * m);
+      chunk.eps_left.resize(horizon * m);
+      chunk.cost.resize((horizon + 1) * m);
+
+      chunk.x.resize(m);
+      chunk.y.resize(m);
+      chunk.th.resize(m);
+
+      chunk.min_cost.resize(horizon);
+      chunk.sums.resize(horizon * sum_terms);
+    }
+  }
+
+  void CpuRollouts::compute(const RolloutProblem & problem, double * delta_right, double * delta_left)
+  {
+    const int H = problem.horizon;
+
+    // only allocates when the problem size changes
+    reserve(H, problem.samples);
+
+    // each chunk simulates its samples and sums its weights relative to its own smallest cost
+    pool.run([&](unsigned int k)
+    {
+      Chunk & chunk = chunks[k];
+
+      if(chunk.size == 0) return;
+
+      simulate(problem, chunk);
+
+      const int m = chunk.size;
+
+      for(int t = 0; t < H; t++)
+      {
+        const double * c = chunk.cost.data() + t * m;
+        const double * er = chunk.eps_right.data() + t * m;
+        const double * el = chunk.eps_left.data() + t * m;
+
+        const double chunk_min = *std::min_element(c, c + m); // log sum exp trick
+
+        double sw = 0, sr = 0, sl = 0, tr = 0, tl = 0;
+
+        for(int n = 0; n < m; n++)
+        {
+          const double w = std::exp(-(c[n] - chunk_min) / problem.lambda);
+
+          sw += w;
+          sr += w * er[n];
+          sl += w * el[n];
+          tr += er[n];
+          tl += el[n];
+        }
+
+        double * sums = chunk.sums.data() + t * sum_terms;
+        sums[0] = sw;
+        sums[1] = sr;
+        sums[2] = sl;
+        sums[3] = tr;
+        sums[4] = tl;
+
+        chunk.min_cost[t] = chunk_min;
+      }
+    });
+
+    // merge the chunks by rescaling each to the smallest cost of all samples
+    for(int t = 0; t < H; t++)
+    {
+      double global_min = 0;
+      bool found = false;
+
+      for(const auto & chunk : chunks)
+      {
+        if(chunk.size == 0) continue;
+
+        global_min = found ? std::min(global_min, chunk.min_cost.at(t)) : chunk.min_cost.at(t);
+        found = true;
+      }
+
+      double sw = min_weight * problem.samples, sr = 0, sl = 0;
+
+      for(const auto & chunk : chunks)
+      {
+        if(chunk.size == 0) continue;
+
+        const double scale = std::exp(-(chunk.min_cost.at(t) - global_min) / problem.lambda);
+        const double * sums = chunk.sums.data() + t * sum_terms;
+
+        sw += scale * sums[0];
+        sr += scale * sums[1] + min_weight * sums[3];
+        sl += scale * sums[2] + min_weight * sums[4];
+      }
+
+      delta_right[t] = sr / sw;
+      delta_left[t] = sl / sw;
+    }
+  }
+
+  void CpuRollouts::simulate(const RolloutProblem & problem, Chunk & chunk) const
+  {
+    const int H = problem.horizon;
+    const int m = chunk.size;
+
+    std::fill(chunk.x.begin(), chunk.x.end(), problem.start.x);
+    std::fill(chunk.y.begin(), chunk.y.end(), problem.start.y);
+    std::fill(chunk.th.begin(), chunk.th.end(), problem.start.th);
+
+    // sample all of the pertubations up front
+    chunk.noise.fill(chunk.eps_right.data(), H * m, problem.sigma);
+    chunk.noise.fill(chunk.eps_left.data(), H * m, problem.sigma);
+
+    // the vectorized kernel leaves any remaining samples for the scalar kernel
+    const int done = (kernel == RolloutKernel::simd) ? simulate_simd(problem, chunk) : 0;
+
+    const Pose & goal = problem.goal;
+    double * x = chunk.x.data();
+    double * y = chunk.y.data();
+    double * th = chunk.th.data();
+
+    for(int t = 0; t < H; t++)
+    {
+      const double ar = problem.a_right[t], al = problem.a_left[t];
+      const double control_cost = problem.R[0] * ar * ar + problem.R[1] * al * al;
+
+      const double * er = chunk.eps_right.data() + t * m;
+      const double * el = chunk.eps_left.data() + t * m;
+      double * c = chunk.cost.data() + t * m;
+
+      for(int n = done; n < m; n++)
+      {
+        const double dx = x[n] - goal.x, dy = y[n] - goal.y, dth = th[n] - goal.th;
+
+        c[n] = problem.Q[0] * dx * dx + problem.Q[1] * dy * dy + problem.Q[2] * dth * dth + control_cost
+               + problem.lambda * problem.sigma * (ar * er[n] + al * el[n]);
+
+        if(problem.cost_map) c[n] += map_cost(problem, x[n], y[n]);
+
+        // euler step with the perturbed control
+        double xdot = 0, ydot = 0, thdot = 0;
+        problem.robot.model(th[n], ar + er[n], al + el[n], xdot, ydot, thdot);
+
+        x[n] += xdot * problem.dt;
+        y[n] += ydot * problem.dt;
+        th[n] += thdot * problem.dt;
+      }
+    }
+
+    // terminal cost
+    double * terminal = chunk.cost.data() + H * m;
+
+    for(int n = 0; n < m; n++)
+    {
+      const double dx = x[n] - goal.x, dy = y[n] - goal.y, dth = th[n] - goal.th;
+      terminal[n] = problem.P1[0] * dx * dx + problem.P1[1] * dy * dy + problem.P1[2] * dth * dth;
+
+      if(problem.cost_map) terminal[n] += map_terminal_cost(problem, x[n], y[n]);
+    }
+
+    // cost to go from each step
+    for(int t = H - 1; t >= 0; t--)
+    {
+      double * c = chunk.cost.data() + t * m;
+      const double * next = c + m;
+
+      for(int n = 0; n < m; n++) c[n] += next[n];
+    }
+  }
+
+  int CpuRollouts::simulate_simd(const RolloutProblem & problem, Chunk & chunk) const
+  {
+#if defined(__SSE2__)
+    const int H = problem.horizon;
+    const int m = chunk.size;
+    const int pairs = m - m % 2;
+
+    const __m128d gx = _mm_set1_pd(problem.goal.x), gy = _mm_set1_pd(problem.goal.y), gth = _mm_set1_pd(problem.goal.th);
+    const __m128d q0 = _mm_set1_pd(problem.Q[0]), q1 = _mm_set1_pd(problem.Q[1]), q2 = _mm_set1_pd(problem.Q[2]);
+    const __m128d lam_sig = _mm_set1_pd(problem.lambda * problem.sigma);
+    const __m128d dt = _mm_set1_pd(problem.dt);
+    const __m128d half_radius = _mm_set1_pd(problem.robot.get_radius() / 2.0);
+    const __m128d turn = _mm_set1_pd(problem.robot.get_radius() / problem.robot.get_wheel_base());
+
+    double * x = chunk.x.data();
+    double * y = chunk.y.data();
+    double * th = chunk.th.data();
+
+    for(int t = 0; t < H; t++)
+    {
+      const double ar = problem.a_right[t], al = problem.a_left[t];
+
+      const __m128d a_r = _mm_set1_pd(ar), a_l = _mm_set1_pd(al);
+      const __m128d control_cost = _mm_set1_pd(problem.R[0] * ar * ar + problem.R[1] * al * al);
+
+      const double * er = chunk.eps_right.data() + t * m;
+      const double * el = chunk.eps_left.data() + t * m;
+      double * c = chunk.cost.data() + t * m;
+
+      for(int n = 0; n < pairs; n += 2)
+      {
+        __m128d X = _mm_loadu_pd(x + n), Y = _mm_loadu_pd(y + n), TH = _mm_loadu_pd(th + n);
+        const __m128d ER = _mm_loadu_pd(er + n), EL = _mm_loadu_pd(el + n);
+
+        const __m128d dx = _mm_sub_pd(X, gx), dy = _mm_sub_pd(Y, gy), dth = _mm_sub_pd(TH, gth);
+
+        __m128d cost = _mm_add_pd(_mm_mul_pd(_mm_mul_pd(q0, dx), dx), _mm_mul_pd(_mm_mul_pd(q1, dy), dy));
+        cost = _mm_add_pd(cost, _mm_mul_pd(_mm_mul_pd(q2, dth), dth));
+        cost = _mm_add_pd(cost, control_cost);
+        cost = _mm_add_pd(cost, _mm_mul_pd(lam_sig, _mm_add_pd(_mm_mul_pd(a_r, ER), _mm_mul_pd(a_l, EL))));
+
+        _mm_storeu_pd(c + n, cost);
+
+        // the map lookups are gathers, so they stay scalar
+        if(problem.cost_map)
+        {
+          c[n] += map_cost(problem, x[n], y[n]);
+          c[n + 1] += map_cost(problem, x[n + 1], y[n + 1]);
+        }
+
+        // euler step with the perturbed control
+        const __m128d ur = _mm_add_pd(a_r, ER), ul = _mm_add_pd(a_l, EL);
+        const __m128d forward = _mm_mul_pd(half_radius, _mm_add_pd(ur, ul));
+
+        __m128d s, co;
+        sincos_pd(TH, s, co);
+
+        X = _mm_add_pd(X, _mm_mul_pd(_mm_mul_pd(forward, co), dt));
+        Y = _mm_add_pd(Y, _mm_mul_pd(_mm_mul_pd(forward, s), dt));
+        TH = _mm_add_pd(TH, _mm_mul_pd(_mm_mul_pd(turn, _mm_sub_pd(ur, ul)), dt));
+
+        _mm_storeu_pd(x + n, X);
+        _mm_storeu_pd(y + n, Y);
+        _mm_storeu_pd(th + n, TH);
+      }
+    }
+
+    return pairs;
+#else
+    (void)problem;
+    (void)chunk;
+    return 0;
+#endif
+  }
+
+  std::unique_ptr<RolloutBackend> make_rollouts(const std::string & name, unsigned int threads)
+  {
+    if(name == "cpu") return std::unique_ptr<RolloutBackend>(new CpuRollouts(threads, RolloutKernel::scalar));
+    if(name == "simd") return std::unique_ptr<RolloutBackend>(new CpuRollouts(threads, RolloutKernel::simd));
+
+#ifdef MPPI_CUDA
+    if(name == "cuda")
+    {
+      try
+      {
+        return std::unique_ptr<RolloutBackend>(new CudaRollouts());
+      }
+      catch(const std::runtime_error &) // no usable device
+      {
+        return nullptr;
+      }
+    }
+#endif
+
+    return nullptr;
+  }
+}
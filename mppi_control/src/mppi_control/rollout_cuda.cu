@@ -0,0 +1,392 @@
+/// \file
+/// \brief MPPI rollouts on the GPU, only built when CUDA is found
+
+#include <stdexcept>
+#include <string>
+
+#include <cuda_runtime.h>
+#include <curand_kernel.h>
+
+#include "mppi_control/rollout.hpp"
+#include "mppi_control/rollout_cuda.hpp"
+
+namespace mppi
+{
+  /// \brief Number of threads in each block of the kernels
+  static constexpr int block_threads = 256;
+
+  /// \brief Weight added to every sample so the weights never sum to zero
+  static constexpr double min_weight = 1e-8;
+
+  /// \brief The parameters of a rollout problem in a form that can be passed to a kernel
+  struct DeviceProblem
+  {
+    double sx, sy, sth; ///< the current pose of the robot
+    double gx, gy, gth; ///< target waypoint
+
+    int horizon; ///< the number of descrete steps during the time horizon
+    int samples; ///< number of rollouts
+    double dt; ///< the time between each step in the horizon
+
+    double lambda; ///< mppi parameter
+    double sigma; ///< standard deviation of the sampled control pertubations
+
+    double Q[3]; ///< diagonal of the cost function state weights
+    double R[2]; ///< diagonal of the cost function control weights
+    double P1[3]; ///< diagonal of the terminal cost function state weights
+
+    double radius; ///< wheel radius of the robot
+    double wheel_base; ///< distance between the centerline and the wheels of the robot
+
+    int map; ///< 1 if there is a cost map
+    int width, height; ///< size of the cost map in cells
+    double ox, oy; ///< lower left corner of the cost map
+    double inv_res; ///< 1 / the resolution of the cost map
+    double path_length; ///< length of the reference path
+    double obstacle_weight; ///< weight of the obstacle cost at each step
+    double path_weight; ///< weight of the squared distance to the reference path at each step
+    double progress_weight; ///< terminal weight of the distance left along the reference path
+  };
+
+  /// \brief Throw if a CUDA call failed
+  /// \param err the result of the call
+  /// \param what a description of the call
+  static void check(cudaError_t err, const char * what)
+  {
+    if(err != cudaSuccess) throw std::runtime_error(std::string("MPPI CUDA: ") + what + ": " + cudaGetErrorString(err));
+  }
+
+  /// \brief The map part of the cost at a position, same as CostMap::at and CostMap::path_distance2
+  /// \param p the problem
+  /// \param cells the cells of the cost map
+  /// \param segments the segments of the reference path
+  /// \param x x position
+  /// \param y y position
+  /// \param progress [out] distance along the path to the closest point, 0 if the cell has no segment
+  /// \returns the weighted obstacle and path distance costs
+  __device__ double map_cost(const DeviceProblem & p, const CostCell * cells, const PathSegment * segments, double x, double y,
+                             double & progress)
+  {
+    progress = 0;
+
+    const double u = (x - p.ox) * p.inv_res, v = (y - p.oy) * p.inv_res;
+
+    if(!(u >= 0 && v >= 0 && u < p.width && v < p.height)) return p.obstacle_weight;
+
+    const CostCell cell = cells[static_cast<int>(v) * p.width + static_cast<int>(u)];
+
+    double cost = p.obstacle_weight * cell.obstacle;
+
+    if(cell.segment >= 0)
+    {
+      const PathSegment seg = segments[cell.segment];
+      const double t = fmin(fmax(((x - seg.x) * seg.dx + (y - seg.y) * seg.dy) * seg.inv_len2, 0.0), 1.0);
+      const double ex = x - (seg.x + t * seg.dx), ey = y - (seg.y + t * seg.dy);
+
+      progress = seg.start + t * seg.len;
+      cost += p.path_weight * (ex * ex + ey * ey);
+    }
+
+    return cost;
+  }
+
+  /// \brief Simulate one rollout per thread and compute its cost to go
+  /// \param p the problem
+  /// \param actions the mean right then left wheel velocities, 2 x horizon
+  /// \param eps [out] the right then left wheel pertubations, 2 x horizon x samples
+  /// \param cost [out] the cost to go, (horizon + 1) x samples
+  /// \param cells the cells of the cost map, only used if p.map is set
+  /// \param segments the segments of the reference path, only used if p.map is set
+  /// \param seed seed of the random number streams
+  /// \param offset the position in the random number streams to start from
+  __global__ void rollout_kernel(DeviceProblem p, const double * actions, double * eps, double * cost, const CostCell * cells,
+                                 const PathSegment * segments, unsigned long long seed, unsigned long long offset)
+  {
+    const int n = blockIdx.x * blockDim.x + threadIdx.x;
+    if(n >= p.samples) return;
+
+    const int H = p.horizon, N = p.samples;
+
+    curandStatePhilox4_32_10_t state;
+    curand_init(seed, n, offset, &state);
+
+    double * er = eps;
+    double * el = eps + H * N;
+
+    double x = p.sx, y = p.sy, th = p.sth;
+
+    for(int t = 0; t < H; t++)
+    {
+      const double ar = actions[t], al = actions[H + t];
+
+      const double2 e = curand_normal2_double(&state);
+      const double e_r = e.x * p.sigma, e_l = e.y * p.sigma;
+
+      er[t * N + n] = e_r;
+      el[t * N + n] = e_l;
+
+      const double dx = x - p.gx, dy = y - p.gy, dth = th - p.gth;
+
+      double step_cost = p.Q[0] * dx * dx + p.Q[1] * dy * dy + p.Q[2] * dth * dth + p.R[0] * ar * ar + p.R[1] * al * al
+                         + p.lambda * p.sigma * (ar * e_r + al * e_l);
+
+      if(p.map)
+      {
+        double progress = 0;
+        step_cost += map_cost(p, cells, segments, x, y, progress);
+      }
+
+      cost[t * N + n] = step_cost;
+
+      // euler step with the perturbed control
+      const double ur = ar + e_r, ul = al + e_l;
+      const double forward = (p.radius / 2.0) * (ur + ul);
+
+      double s = 0, c = 0;
+      sincos(th, &s, &c);
+
+      x += forward * c * p.dt;
+      y += forward * s * p.dt;
+      th += (p.radius / p.wheel_base) * (ur - ul) * p.dt;
+    }
+
+    // terminal cost
+    const double dx = x - p.gx, dy = y - p.gy, dth = th - p.gth;
+    double to_go = p.P1[0] * dx * dx + p.P1[1] * dy * dy + p.P1[2] * dth * dth;
+
+    if(p.map)
+    {
+      double progress = 0;
+      to_go += map_cost(p, cells, segments, x, y, progress);
+      to_go += p.progress_weight * (p.path_length - progress);
+    }
+
+    cost[H * N + n] = to_go;
+
+    // cost to go from each step
+    for(int t = H - 1; t >= 0; t--)
+    {
+      to_go += cost[t * N + n];
+      cost[t * N + n] = to_go;
+    }
+  }
+
+  /// \brief Reduce the rollouts of one step of the horizon per block to the cost weighted average pertubation
+  /// \param p the problem
+  /// \param eps the right then left wheel pertubations, 2 x horizon x samples
+  /// \param cost the cost to go, (horizon + 1) x samples
+  /// \param delta [out] the right then left weighted average pertubations, 2 x horizon
+  __global__ void reduce_kernel(DeviceProblem p, const double * eps, const double * cost, double * delta)
+  {
+    __shared__ double s_min[block_threads];
+    __shared__ double s_w[block_threads];
+    __shared__ double s_r[block_threads];
+    __shared__ double s_l[block_threads];
+
+    const int t = blockIdx.x;
+    const int H = p.horizon, N = p.samples;
+
+    const double * c = cost + t * N;
+    const double * er = eps + t * N;
+    const double * el = eps + H * N + t * N;
+
+    // smallest cost to go, the log sum exp trick
+    double local_min = c[0];
+    for(int n = threadIdx.x; n < N; n += blockDim.x) local_min = fmin(local_min, c[n]);
+
+    s_min[threadIdx.x] = local_min;
+    __syncthreads();
+
+    for(int stride = blockDim.x / 2; stride > 0; stride /= 2)
+    {
+      if(threadIdx.x < stride) s_min[threadIdx.x] = fmin(s_min[threadIdx.x], s_min[threadIdx.x + stride]);
+      __syncthreads();
+    }
+
+    const double min_cost = s_min[0];
+
+    double sw = 0, sr = 0, sl = 0;
+
+    for(int n = threadIdx.x; n < N; n += blockDim.x)
+    {
+      const double w = exp(-(c[n] - min_cost) / p.lambda) + min_weight;
+
+      sw += w;
+      sr += w * er[n];
+      sl += w * el[n];
+    }
+
+    s_w[threadIdx.x] = sw;
+    s_r[threadIdx.x] = sr;
+    s_l[threadIdx.x] = sl;
+    __syncthreads();
+
+    for(int stride = blockDim.x / 2; stride > 0; stride /= 2)
+    {
+      if(threadIdx.x < stride)
+      {
+        s_w[threadIdx.x] += s_w[threadIdx.x + stride];
+        s_r[threadIdx.x] += s_r[threadIdx.x + stride];
+        s_l[threadIdx.x] += s_l[threadIdx.x + stride];
+      }
+      __syncthreads();
+    }
+
+    if(threadIdx.x == 0)
+    {
+      delta[t] = s_r[0] / s_w[0];
+      delta[H + t] = s_l[0] / s_w[0];
+    }
+  }
+
+  CudaRollouts::CudaRollouts()
+  {
+    int devices = 0;
+    check(cudaGetDeviceCount(&devices), "finding a device");
+
+    if(devices == 0) throw std::runtime_error("MPPI CUDA: no CUDA device found");
+  }
+
+  CudaRollouts::~CudaRollouts()
+  {
+    release();
+    cudaFree(d_cells);
+    cudaFree(d_segments);
+  }
+
+  void CudaRollouts::set_seed(unsigned int seed)
+  {
+    this->seed = seed;
+    calls = 0;
+  }
+
+  void CudaRollouts::compute(const RolloutProblem & problem, double * delta_right, double * delta_left)
+  {
+    reserve(problem.horizon, problem.samples);
+
+    const int H = problem.horizon;
+
+    DeviceProblem p;
+    p.sx = problem.start.x;
+    p.sy = problem.start.y;
+    p.sth = problem.start.th;
+    p.gx = problem.goal.x;
+    p.gy = problem.goal.y;
+    p.gth = problem.goal.th;
+    p.horizon = H;
+    p.samples = problem.samples;
+    p.dt = problem.dt;
+    p.lambda = problem.lambda;
+    p.sigma = problem.sigma;
+
+    for(int i = 0; i < 3; i++) p.Q[i] = problem.Q[i];
+    for(int i = 0; i < 2; i++) p.R[i] = problem.R[i];
+    for(int i = 0; i < 3; i++) p.P1[i] = problem.P1[i];
+
+    p.radius = problem.robot.get_radius();
+    p.wheel_base = problem.robot.get_wheel_base();
+
+    p.map = problem.cost_map ? 1 : 0;
+    p.width = p.height = 0;
+    p.ox = p.oy = p.path_length = 0;
+    p.inv_res = 1.0;
+    p.obstacle_weight = problem.obstacle_weight;
+    p.path_weight = problem.path_weight;
+    p.progress_weight = problem.progress_weight;
+
+    if(problem.cost_map)
+    {
+      upload(problem);
+
+      p.width = problem.cost_map->get_width();
+      p.height = problem.cost_map->get_height();
+      problem.cost_map->get_origin(p.ox, p.oy);
+      p.inv_res = 1.0 / problem.cost_map->get_resolution();
+      p.path_length = problem.cost_map->get_path_length();
+    }
+
+    check(cudaMemcpy(d_actions, problem.a_right, H * sizeof(double), cudaMemcpyHostToDevice), "copying the actions");
+    check(cudaMemcpy(d_actions + H, problem.a_left, H * sizeof(double), cudaMemcpyHostToDevice), "copying the actions");
+
+    // every update draws 4 values per step from each stream for the pair of normal samples
+    const unsigned long long offset = calls * 4ull * H;
+    calls++;
+
+    const int blocks = (problem.samples + block_threads - 1) / block_threads;
+
+    rollout_kernel<<<blocks, block_threads>>>(p, d_actions, d_eps, d_cost, d_cells, d_segments, seed, offset);
+    check(cudaGetLastError(), "launching the rollouts");
+
+    reduce_kernel<<<H, block_threads>>>(p, d_eps, d_cost, d_delta);
+    check(cudaGetLastError(), "launching the reduction");
+
+    check(cudaMemcpy(delta_right, d_delta, H * sizeof(double), cudaMemcpyDeviceToHost), "copying the update");
+    check(cudaMemcpy(delta_left, d_delta + H, H * sizeof(double), cudaMemcpyDeviceToHost), "copying the update");
+  }
+
+  void CudaRollouts::reserve(int horizon, int samples)
+  {
+    if(horizon == this->horizon && samples == this->samples) return;
+
+    release();
+
+    this->horizon = horizon;
+    this->samples = samples;
+
+    const size_t steps = horizon, values = static_cast<size_t>(horizon) * samples;
+
+    check(cudaMalloc(&d_actions, 2 * steps * sizeof(double)), "allocating the actions");
+    check(cudaMalloc(&d_eps, 2 * values * sizeof(double)), "allocating the pertubations");
+    check(cudaMalloc(&d_cost, (values + samples) * sizeof(double)), "allocating the costs");
+    check(cudaMalloc(&d_delta, 2 * steps * sizeof(double)), "allocating the update");
+  }
+
+  void CudaRollouts::release()
+  {
+    cudaFree(d_actions);
+    cudaFree(d_eps);
+    cudaFree(d_cost);
+    cudaFree(d_delta);
+
+    d_actions = d_eps = d_cost = d_delta = nullptr;
+    horizon = samples = 0;
+  }
+
+  void CudaRollouts::upload(const RolloutProblem & problem)
+  {
+    if(problem.cost_map_revision == cost_map_revision && d_cells) return;
+
+    const CostMap & map = *problem.cost_map;
+    const int count = map.get_width() * map.get_height();
+    const int seg_count = map.get_segments().size();
+
+    if(count > cell_count)
+    {
+      cudaFree(d_cells);
+      d_cells = nullptr;
+      cell_count = 0;
+
+      check(cudaMalloc(&d_cells, count * sizeof(CostCell)), "allocating the cost map");
+      cell_count = count;
+    }
+
+    if(seg_count > segment_count)
+    {
+      cudaFree(d_segments);
+      d_segments = nullptr;
+      segment_count = 0;
+
+      check(cudaMalloc(&d_segments, seg_count * sizeof(PathSegment)), "allocating the path");
+      segment_count = seg_count;
+    }
+
+    check(cudaMemcpy(d_cells, map.get_cells(), count * sizeof(CostCell), cudaMemcpyHostToDevice), "copying the cost map");
+
+    if(seg_count > 0)
+    {
+      check(cudaMemcpy(d_segments, map.get_segments().data(), seg_count * sizeof(PathSegment), cudaMemcpyHostToDevice), "copying the path");
+    }
+
+    cost_map_revision = problem.cost_map_revision;
+  }
+}
@@ -0,0 +1,93 @@
+/// \file
+/// \brief A fixed set of threads that are started once and reused for every control update
+
+#include <algorithm>
+#include <mutex>
+#include <thread>
+
+#include "mppi_control/thread_pool.hpp"
+
+namespace mppi
+{
+  ThreadPool::ThreadPool(unsigned int threads)
+  {
+    if(threads == 0) threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    for(unsigned int i = 1; i < threads; i++) workers.emplace_back(&ThreadPool::work, this, i);
+  }
+
+  ThreadPool::~ThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+    }
+
+    start_cv.notify_all();
+
+    for(auto & worker : workers) worker.join();
+  }
+
+  unsigned int ThreadPool::size() const
+  {
+    return workers.size() + 1;
+  }
+
+  void ThreadPool::dispatch(void (*call)(void *, unsigned int), void * task)
+  {
+    if(workers.empty())
+    {
+      call(task, 0);
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      job = call;
+      context = task;
+      pending = workers.size();
+      generation++;
+    }
+
+    start_cv.notify_all();
+
+    call(task, 0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done_cv.wait(lock, [this]{ return pending == 0; });
+
+    job = nullptr;
+    context = nullptr;
+  }
+
+  void ThreadPool::work(unsigned int index)
+  {
+    unsigned long seen = 0;
+
+    while(true)
+    {
+      void (*call)(void *, unsigned int) = nullptr;
+      void * task = nullptr;
+
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        start_cv.wait(lock, [&]{ return stop || generation != seen; });
+
+        if(stop) return;
+
+        seen = generation;
+        call = job;
+        task = context;
+      }
+
+      call(task, index);
+
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending--;
+      }
+
+      done_cv.notify_one();
+    }
+  }
+}
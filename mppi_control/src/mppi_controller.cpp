@@ -0,0 +1,407 @@
+/// \file
+/// \brief Node to perform mppi control for the turtlebot along a list of waypoints and publish a control command
+///
+/// PARAMETERS:
+///     wheel_radius (double) radius of the wheels
+///     wheel_base (double) distance between the wheels
+///     motor_lim (double) max velocity the wheels can spin
+///     sigma (double) standard deviation of the sampled control pertubations
+///     lambda (double) mppi hyperparameter
+///     limit (double) threshold for transitioning to the next waypoint
+///     Q (std::vector<double>) the diagonal for the state weight matrix in the cost function
+///     R (std::vector<double>) the diagonal for the control weight matrix in the cost function
+///     P1 (std::vector<double>) the diagonal for the state weight matrix in the terminal cost function
+///     horizon_steps (int) number of descrete steps in the horizon time
+///     horizon_time (double) number of seconds to compute the future control for
+///     N (int) number of samples or rollouts to use
+///     rollout_backend (std::string) backend that simulates the rollouts: cpu, simd or cuda
+///     rollout_threads (int) number of threads used by the cpu and simd backends, 0 uses all available cores
+///     waypoints (std::vector<std::vector<double>>) waypoints to drive to [x,y,th]
+///     obstacle_weight (double) weight of the occupancy of the map in the cost function
+///     path_weight (double) weight of the squared distance to the planned path in the cost function, only used with track_path
+///     progress_weight (double) weight of the distance left along the planned path in the terminal cost function, only used with track_path
+///     track_path (bool) drive to the end of the planned path instead of the waypoints. Without it the planned path is ignored, since its
+///         end is not the waypoint being driven to, and path_weight and progress_weight are set to 0.
+/// PUBLISHES:
+///     /cmd_vel (geometry_msgs::Twist) the velocity command for the robot
+///     /visualization_marker (visualization_msgs::Marker) the waypoints
+/// SUBSCRIBES:
+///     /odom (nav_msgs::Odometry) the pose of the robot
+///     /grip_map (nav_msgs::OccupancyGrid) occupancy data of the obstacles
+///     /grip_map_updates (map_msgs::OccupancyGridUpdate) the rectangle of occupancy data that changed
+///     /planned_path (nav_msgs::Path) the path from a global planner, only with track_path
+/// SERVICES:
+///     /start (std_srvs::Empty) Call this service to start the simulation
+
+#include <vector>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <algorithm>
+#include <mutex>
+#include <XmlRpcValue.h>
+
+#include <ros/ros.h>
+#include <ros/callback_queue.h>
+
+#include "geometry_msgs/Point.h"
+#include "geometry_msgs/Twist.h"
+#include "map_msgs/OccupancyGridUpdate.h"
+#include "nav_msgs/OccupancyGrid.h"
+#include "nav_msgs/Odometry.h"
+#include "nav_msgs/Path.h"
+#include "std_srvs/Empty.h"
+#include "visualization_msgs/Marker.h"
+
+#include "mppi_control/cost_map.hpp"
+#include "mppi_control/mppi.hpp"
+#include "mppi_control/rollout.hpp"
+
+static bool start = false; ///< true once the start service has been called
+static bool first_pass = true; ///< flag to grab the start time
+static ros::Time start_time; ///< time of the first odometry message after starting
+
+static double wheel_radius = 0.033, wheel_base = 0.16; ///< robot parameters
+static double limit = 0.2; ///< threshold for transitioning to the next waypoint
+
+static std::vector<mppi::Pose> waypoints; ///< the waypoints to drive to
+static unsigned int loc = 1; ///< index of the next waypoint
+
+static mppi::MPPI * control = nullptr; ///< the controller
+
+static double obstacle_weight = 0, path_weight = 0, progress_weight = 0; ///< cost map weights
+static bool track_path = false; ///< drive to the end of the planned path instead of the waypoints
+
+// The cost maps are built on their own thread, so the control loop only swaps in the finished costs
+static std::shared_ptr<const mppi::CostMap> grid_costs; ///< the occupancy costs of the latest map, without a path, cost thread only
+static std::vector<signed char> grid_data; ///< the occupancy data of the latest map, cost thread only
+static nav_msgs::MapMetaData grid_info; ///< the size and placement of the latest map, cost thread only
+static std::vector<mppi::PathPoint> planned_path; ///< the latest planned path, cost thread only
+
+static std::mutex pending_mutex; ///< guards the costs and goal handed from the cost thread to the control loop
+static std::shared_ptr<const mppi::CostMap> pending_costs; ///< costs built since the last control, null if there are none
+static bool pending_goal_set = false; ///< true if the end of a new path is waiting to become the goal
+static mppi::Pose pending_goal; ///< the end of the latest path, facing along its last segment
+static ros::Publisher cmd_pub, marker_pub;
+
+/// \brief Convert a number from the parameter server to a double
+/// \param value an int or double parameter
+/// \returns the value as a double
+static double to_double(XmlRpc::XmlRpcValue & value)
+{
+  if(value.getType() == XmlRpc::XmlRpcValue::TypeInt) return static_cast<int>(value);
+
+  return static_cast<double>(value);
+}
+
+/// \brief Convert wheel velocities to a body twist
+/// \param wheel_vels the right and left wheel velocities
+/// \returns the twist of the robot
+static geometry_msgs::Twist wheels_to_twist(const mppi::Action & wheel_vels)
+{
+  geometry_msgs::Twist cmd;
+
+  cmd.linear.x = wheel_radius * (0.5 * wheel_vels.right + 0.5 * wheel_vels.left);
+  cmd.angular.z = wheel_radius * (wheel_vels.right - wheel_vels.left) / wheel_base;
+
+  return cmd;
+}
+
+/// \brief Publish the waypoints as a list of spheres
+static void create_waypoint_markers()
+{
+  visualization_msgs::Marker marker;
+
+  marker.header.frame_id = "odom";
+  marker.header.stamp = ros::Time::now();
+
+  marker.id = 0;
+  marker.type = visualization_msgs::Marker::SPHERE_LIST;
+  marker.action = visualization_msgs::Marker::ADD;
+
+  marker.scale.x = 0.2;
+  marker.scale.y = 0.2;
+  marker.scale.z = 0.2;
+
+  marker.color.r = 1.0;
+  marker.color.g = 1.0;
+  marker.color.b = 1.0;
+  marker.color.a = 1.0;
+
+  marker.pose.orientation.w = 1.0;
+
+  for(const auto & goal : waypoints)
+  {
+    geometry_msgs::Point point;
+    point.x = goal.x;
+    point.y = goal.y;
+    point.z = 0;
+    marker.points.push_back(point);
+  }
+
+  marker_pub.publish(marker);
+}
+
+/// \brief Build the costs of the latest map and path and hand them to the control loop
+static void update_cost_map()
+{
+  if(!grid_costs) return;
+
+  auto costs = std::make_shared<mppi::CostMap>(*grid_costs);
+  costs->set_path(planned_path);
+
+  std::lock_guard<std::mutex> lock(pending_mutex);
+  pending_costs = std::move(costs);
+}
+
+/// \brief Give the controller the costs and goal built since the last control
+static void apply_pending()
+{
+  std::shared_ptr<const mppi::CostMap> costs;
+  bool goal_set = false;
+  mppi::Pose goal;
+
+  {
+    std::lock_guard<std::mutex> lock(pending_mutex);
+    costs = std::move(pending_costs);
+    pending_costs.reset();
+    goal_set = pending_goal_set;
+    goal = pending_goal;
+    pending_goal_set = false;
+  }
+
+  if(costs) control->set_cost_map(std::move(costs), obstacle_weight, path_weight, progress_weight);
+
+  if(goal_set)
+  {
+    waypoints = {goal};
+    loc = 1;
+    control->set_goal(goal);
+  }
+}
+
+/// \brief Start driving to the waypoints
+static bool callback_start(std_srvs::Empty::Request &, std_srvs::Empty::Response &)
+{
+  start = true;
+  ROS_INFO_STREAM("MPPI: GO!");
+  return true;
+}
+
+/// \brief Build the occupancy costs from the latest map data
+static void build_grid_costs()
+{
+  grid_costs = std::make_shared<const mppi::CostMap>(grid_data.data(), grid_info.width, grid_info.height, grid_info.resolution,
+                                                     grid_info.origin.position.x, grid_info.origin.position.y);
+  update_cost_map();
+}
+
+/// \brief Build the occupancy costs from a new map
+/// \param msg the map
+static void callback_map(const nav_msgs::OccupancyGrid::ConstPtr & msg)
+{
+  // planners send the full map again whenever a node subscribes, only changes need the costs rebuilt
+  if(grid_costs && msg->data == grid_data && msg->info.width == grid_info.width && msg->info.height == grid_info.height) return;
+
+  grid_data = msg->data;
+  grid_info = msg->info;
+  build_grid_costs();
+}
+
+/// \brief Patch the map with the rectangle that changed and rebuild the occupancy costs
+/// \param msg the changed rectangle of the map
+static void callback_map_update(const map_msgs::OccupancyGridUpdate::ConstPtr & msg)
+{
+  // an update without a full map to patch, or one that does not fit the map, waits for the next full map
+  if(grid_data.empty() || msg->x < 0 || msg->y < 0 || msg->x + msg->width > grid_info.width || msg->y + msg->height > grid_info.height ||
+     msg->data.size() != static_cast<std::size_t>(msg->width) * msg->height) return;
+
+  bool changed = false;
+
+  for(unsigned int i = 0; i < msg->height; i++)
+  {
+    const auto src = msg->data.begin() + i * msg->width;
+    const auto dst = grid_data.begin() + (msg->y + i) * grid_info.width + msg->x;
+
+    if(std::equal(src, src + msg->width, dst)) continue;
+
+    std::copy(src, src + msg->width, dst);
+    changed = true;
+  }
+
+  if(changed) build_grid_costs();
+}
+
+/// \brief Track a new planned path, only subscribed with track_path
+/// \param msg the path
+static void callback_path(const nav_msgs::Path::ConstPtr & msg)
+{
+  std::vector<mppi::PathPoint> path;
+
+  for(const auto & pose : msg->poses) path.push_back(mppi::PathPoint(pose.pose.position.x, pose.pose.position.y));
+
+  if(path.empty()) return;
+
+  const bool same = std::equal(path.begin(), path.end(), planned_path.begin(), planned_path.end(),
+                               [](const mppi::PathPoint & a, const mppi::PathPoint & b){ return a.x == b.x && a.y == b.y; });
+  if(same) return;
+
+  planned_path = path;
+  update_cost_map();
+
+  // drive to the end of the path, facing along its last segment
+  const mppi::PathPoint & end = path.back();
+  const mppi::PathPoint & before = path.at(path.size() > 1 ? path.size() - 2 : 0);
+  const double th = (path.size() > 1) ? std::atan2(end.y - before.y, end.x - before.x) : 0.0;
+
+  std::lock_guard<std::mutex> lock(pending_mutex);
+  pending_goal = mppi::Pose(end.x, end.y, th);
+  pending_goal_set = true;
+}
+
+/// \brief Compute and publish a control for the latest pose of the robot
+/// \param msg the odometry of the robot
+static void callback_odom(const nav_msgs::Odometry::ConstPtr & msg)
+{
+  geometry_msgs::Twist cmd;
+
+  apply_pending();
+
+  if(start)
+  {
+    const auto & q = msg->pose.pose.orientation;
+    const double yaw = std::atan2(2.0 * (q.w * q.z + q.x * q.y), 1.0 - 2.0 * (q.y * q.y + q.z * q.z));
+
+    const mppi::Pose cur_state(msg->pose.pose.position.x, msg->pose.pose.position.y, yaw);
+
+    if(first_pass)
+    {
+      start_time = msg->header.stamp;
+
+      create_waypoint_markers();
+      ROS_INFO_STREAM("MPPI: Going to Waypoint: " << waypoints.at(0).x << ", " << waypoints.at(0).y << ", " << waypoints.at(0).th);
+      first_pass = false;
+    }
+
+    const double t_cur = (msg->header.stamp - start_time).toSec();
+
+    // check the waypoint and advance if needed
+    if(control->made_it(cur_state, limit))
+    {
+      if(loc == waypoints.size())
+      {
+        ROS_INFO_STREAM("MPPI: Finished Path!");
+        start = false;
+        loc = 1;
+      }
+      else
+      {
+        const mppi::Pose & goal = waypoints.at(loc);
+        ROS_INFO_STREAM("MPPI: Going to Waypoint: " << goal.x << ", " << goal.y << ", " << goal.th);
+        control->set_goal(goal);
+        loc++;
+      }
+    }
+
+    if(start) cmd = wheels_to_twist(control->get_control(cur_state, t_cur));
+  }
+
+  cmd_pub.publish(cmd);
+}
+
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "mppi_controller");
+  ros::NodeHandle n;
+
+  double motor_lim = 6.35;
+  double sig = 0.25, lam = 0.2;
+  std::vector<double> Q, R, P1;
+  double horizon_time = 1.0;
+  int horizon_steps = 90;
+  int N = 5;
+  std::string rollout_backend = "simd";
+  int rollout_threads = 1;
+  XmlRpc::XmlRpcValue waypoint_data;
+
+  // loaded from nuturtle_description/config
+  n.getParam("wheel_radius", wheel_radius);
+  n.getParam("wheel_base", wheel_base);
+  n.getParam("motor_lim", motor_lim);
+
+  // loaded from mppi_control/config
+  n.getParam("sigma", sig);
+  n.getParam("lambda", lam);
+  n.getParam("limit", limit);
+  n.getParam("Q", Q);
+  n.getParam("R", R);
+  n.getParam("P1", P1);
+  n.getParam("horizon_time", horizon_time);
+  n.getParam("horizon_steps", horizon_steps);
+  n.getParam("N", N);
+  n.getParam("rollout_backend", rollout_backend);
+  n.getParam("rollout_threads", rollout_threads);
+  n.getParam("waypoints", waypoint_data);
+  n.getParam("obstacle_weight", obstacle_weight);
+  n.getParam("path_weight", path_weight);
+  n.getParam("progress_weight", progress_weight);
+  n.getParam("track_path", track_path);
+
+  // the path costs pull toward the end of the planned path, which is only the goal when the path is tracked
+  if(!track_path && (path_weight != 0 || progress_weight != 0))
+  {
+    ROS_INFO_STREAM("MPPI: Not tracking the planned path, so path_weight and progress_weight are set to 0.");
+    path_weight = progress_weight = 0;
+  }
+
+  const std::vector<double> angles = {M_PI / 2.0, 3.0 * M_PI / 4.0, -3.0 * M_PI / 4.0, -M_PI / 2.0, -M_PI / 2.0};
+
+  for(int i = 0; i < waypoint_data.size(); i++)
+  {
+    const double th = (i < static_cast<int>(angles.size())) ? angles.at(i) : to_double(waypoint_data[i][2]);
+    waypoints.push_back(mppi::Pose(to_double(waypoint_data[i][0]) / 4.0, to_double(waypoint_data[i][1]) / 4.0, th));
+  }
+
+  if(waypoints.empty())
+  {
+    ROS_FATAL_STREAM("MPPI: No waypoints to drive to.");
+    return 1;
+  }
+
+  // Create the diff drive robot object
+  const mppi::DiffDriveRobot robot(wheel_radius, wheel_base / 2.0, motor_lim);
+
+  // create the controller object
+  mppi::MPPI controller(std::vector<mppi::Action>(horizon_steps), waypoints.at(0), horizon_time, horizon_steps, lam, sig, N, Q, R, P1, robot);
+  control = &controller;
+
+  auto rollouts = mppi::make_rollouts(rollout_backend, std::max(rollout_threads, 0));
+
+  if(rollouts) controller.set_rollouts(std::move(rollouts));
+  else ROS_ERROR_STREAM("MPPI: Rollout backend " << rollout_backend << " is not available. Using simd.");
+
+  cmd_pub = n.advertise<geometry_msgs::Twist>("cmd_vel", 1);
+  marker_pub = n.advertise<visualization_msgs::Marker>("visualization_marker", 1);
+
+  ros::ServiceServer start_service = n.advertiseService("start", callback_start);
+  ros::Subscriber odom_sub = n.subscribe("odom", 1, callback_odom);
+
+  // the map and path callbacks rebuild the costs on their own queue and thread, so they never delay a control
+  ros::CallbackQueue cost_queue;
+  ros::NodeHandle cost_n;
+  cost_n.setCallbackQueue(&cost_queue);
+
+  ros::Subscriber map_sub = cost_n.subscribe("grip_map", 1, callback_map);
+  // a dropped update leaves stale cells until the next full map, so updates get a deeper queue
+  ros::Subscriber map_update_sub = cost_n.subscribe("grip_map_updates", 10, callback_map_update);
+
+  ros::Subscriber path_sub;
+  if(track_path) path_sub = cost_n.subscribe("planned_path", 1, callback_path);
+
+  ros::AsyncSpinner cost_spinner(1, &cost_queue);
+  cost_spinner.start();
+
+  ros::spin();
+
+  return 0;
+}
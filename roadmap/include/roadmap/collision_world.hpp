@@ -0,0 +1,183 @@
+#ifndef COLLISION_WORLD_INCLUDE_GUARD_HPP
+#define COLLISION_WORLD_INCLUDE_GUARD_HPP
+/// \file
+/// \brief A library to check points and line segments against a fixed set of obstacles
+
+#include <vector>
+
+#include "rigid2d/rigid2d.hpp"
+
+namespace collision
+{
+  /// \brief Result of testing a point in a batch query, ordered by severity
+  enum PointStatus : unsigned char
+  {
+    free_space = 0, ///< outside of every obstacle and buffer zone
+    buffer_zone = 1, ///< outside of every obstacle, but in the buffer zone of at least one
+    inside_obstacle = 2 ///< inside of at least one obstacle
+  };
+
+  /// \brief A set of convex obstacles prepared for repeated collision queries. The edge normals and the bounding box of
+  /// each polygon, inflated by the buffer radius, are computed once. The polygons are stored in a uniform grid of
+  /// buckets so a query only runs the exact tests for the obstacles near it. The results match looping over every
+  /// polygon with point_inside_convex and line_shape_intersection, including a point on an edge or vertex, which is inside,
+  /// and a segment that lies just outside an edge parallel to it, which line_shape_intersection reports as a collision
+  /// because it shifts the segment by 1/1000 of its end point to break the parallelism. The broad phase is widened by
+  /// that shift so it never skips an obstacle the exact tests would flag, and is skipped for a segment on a line through
+  /// the origin, where the shift does not break the parallelism. All queries are const and safe to call from
+  /// multiple threads.
+  class CollisionWorld
+  {
+  public:
+
+    /// \brief Create a world without obstacles
+    CollisionWorld() {};
+
+    /// \brief Prepare a set of obstacles for collision queries
+    /// \param polygons a vector of convex polygons, each defined by its verticies in ccw order
+    /// \param buffer_radius a buffer distance to incorporate to the polygon boundaries
+    CollisionWorld(const std::vector<std::vector<rigid2d::Vector2D>> & polygons, double buffer_radius);
+
+    /// \brief Get the number of obstacles in the world
+    /// \returns the number of polygons
+    int size() const;
+
+    /// \brief Get the buffer distance used for the queries
+    /// \returns the buffer radius
+    double buffer() const;
+
+    /// \brief Determine if a point is inside of an obstacle or its buffer zone
+    /// \param point the point to analyze
+    /// \returns a 2 element vector, first element is true if there is a collision, second element describes the cause: True for inside an obstacle,
+    /// False for outside every obstacle but in the buffer zone of at least one.
+    std::vector<bool> point_inside(const rigid2d::Vector2D & point) const;
+
+    /// \brief Determine if a point is inside of an obstacle or its buffer zone
+    /// \param point the point to analyze
+    /// \returns True if the point collides with any obstacle
+    bool point_collides(const rigid2d::Vector2D & point) const;
+
+    /// \brief Determine if a line segment intersects an obstacle or comes within the buffer radius of one. This assumes the line start and end points are
+    /// known to be outside of the buffer areas
+    /// \param line_start the point of the beginning of the line segment
+    /// \param line_end the point of the end of the line segment
+    /// \returns True if the segment collides with any obstacle
+    bool segment_collides(const rigid2d::Vector2D & line_start, const rigid2d::Vector2D & line_end) const;
+
+    /// \brief Classify a batch of points against every obstacle. The points are tested in blocks, each block is only tested against the
+    /// obstacles that overlap its bounding box, and the exact tests run on several points at a time with SIMD instructions when available.
+    /// Each point gets the same status as point_inside, the SIMD tests use the same comparisons and roundings as point_inside_convex.
+    /// \param xs the x coordinates of the points
+    /// \param ys the y coordinates of the points
+    /// \param n the number of points
+    /// \param status output buffer with room for n results, filled with a PointStatus for each point
+    void classify_points(const double * xs, const double * ys, int n, unsigned char * status) const;
+
+    /// \brief Classify a batch of points against every obstacle
+    /// \param points the points to analyze
+    /// \param status filled with a PointStatus for each point, reuse it between calls to avoid allocations
+    void classify_points(const std::vector<rigid2d::Vector2D> & points, std::vector<unsigned char> & status) const;
+
+    /// \brief Test a batch of line segments against every obstacle, see segment_collides. The segments are tested in blocks the same way as
+    /// classify_points, and each segment gets the same result as segment_collides.
+    /// \param x0 the x coordinates of the segment starts
+    /// \param y0 the y coordinates of the segment starts
+    /// \param x1 the x coordinates of the segment ends
+    /// \param y1 the y coordinates of the segment ends
+    /// \param n the number of segments
+    /// \param collides output buffer with room for n results, 1 if the segment collides with any obstacle and 0 otherwise
+    void segments_collide(const double * x0, const double * y0, const double * x1, const double * y1, int n, unsigned char * collides) const;
+
+    /// \brief Test a batch of line segments against every obstacle
+    /// \param line_starts the points of the beginning of each line segment
+    /// \param line_ends the points of the end of each line segment
+    /// \param collides filled with 1 if the segment collides with any obstacle and 0 otherwise, reuse it between calls to avoid allocations
+    void segments_collide(const std::vector<rigid2d::Vector2D> & line_starts, const std::vector<rigid2d::Vector2D> & line_ends, std::vector<unsigned char> & collides) const;
+
+  private:
+
+    /// \brief An edge of a polygon with the terms of the batch tests
+    struct Edge
+    {
+      double ax = 0; ///< x coordinate of the start vertex
+      double ay = 0; ///< y coordinate of the start vertex
+      double nx = 0; ///< x component of the unit normal pointing inward
+      double ny = 0; ///< y component of the unit normal pointing inward
+      double bx = 0; ///< x coordinate of the end vertex
+      double by = 0; ///< y coordinate of the end vertex
+      double dx = 0; ///< x component of the vector to the next vertex
+      double dy = 0; ///< y component of the vector to the next vertex
+      double len2 = 0; ///< squared edge length, rounded the same way as point_to_line_distance, 0 for a degenerate edge
+    };
+
+    /// \brief A polygon with the values needed for the collision tests
+    struct Shape
+    {
+      std::vector<rigid2d::Vector2D> verticies; ///< the verticies of the polygon in order
+      std::vector<rigid2d::Vector2D> normals; ///< unit normal pointing inward for the edge from each vertex to the next
+      std::vector<Edge> edges; ///< the edges for the batch tests
+
+      double x_min = 0; ///< lower x bound of the polygon, inflated by the buffer radius
+      double x_max = 0; ///< upper x bound of the polygon, inflated by the buffer radius
+      double y_min = 0; ///< lower y bound of the polygon, inflated by the buffer radius
+      double y_max = 0; ///< upper y bound of the polygon, inflated by the buffer radius
+
+      double reach = 1.0; ///< how far the parallelism shift of line_shape_intersection can move the boundary, per unit of shift
+    };
+
+    std::vector<Shape> shapes; ///< all of the obstacles
+
+    double buffer_radius = 0; ///< buffer distance to incorporate when detecting collisions
+    double max_reach = 1.0; ///< the largest reach of any shape
+
+    double origin_x = 0; ///< lower x bound of the bucket grid
+    double origin_y = 0; ///< lower y bound of the bucket grid
+    double cell = 1.0; ///< side length of a bucket
+
+    int n_cols = 0; ///< number of buckets in each row
+    int n_rows = 0; ///< number of rows of buckets
+
+    std::vector<std::vector<int>> buckets; ///< the indices of the shapes overlapping each bucket, in row major order
+
+    /// \brief Find the shapes whose inflated bounds may overlap a box
+    /// \param x_lo lower x bound of the box
+    /// \param x_hi upper x bound of the box
+    /// \param y_lo lower y bound of the box
+    /// \param y_hi upper y bound of the box
+    /// \returns the unique indices of the shapes in the buckets covering the box
+    std::vector<int> candidates(double x_lo, double x_hi, double y_lo, double y_hi) const;
+
+    /// \brief Exact point test for a single shape, see point_inside_convex
+    /// \param shape the obstacle to test against
+    /// \param point the point to analyze
+    /// \returns the collision status and cause
+    std::vector<bool> shape_point(const Shape & shape, const rigid2d::Vector2D & point) const;
+
+    /// \brief Exact segment test for a single shape, see line_shape_intersection
+    /// \param shape the obstacle to test against
+    /// \param line_start the point of the beginning of the line segment
+    /// \param line_end the point of the end of the line segment
+    /// \returns True if the segment collides with the shape
+    bool shape_segment(const Shape & shape, const rigid2d::Vector2D & line_start, const rigid2d::Vector2D & line_end) const;
+
+    /// \brief Batch point test for a single shape, raising the status of every point that collides with it
+    /// \param shape the obstacle to test against
+    /// \param xs the x coordinates of the points
+    /// \param ys the y coordinates of the points
+    /// \param n the number of points
+    /// \param status the PointStatus of each point so far
+    void shape_points(const Shape & shape, const double * xs, const double * ys, int n, unsigned char * status) const;
+
+    /// \brief Batch segment test for a single shape, marking every segment that collides with it
+    /// \param shape the obstacle to test against
+    /// \param x0 the x coordinates of the segment starts
+    /// \param y0 the y coordinates of the segment starts
+    /// \param x1 the x coordinates of the segment ends
+    /// \param y1 the y coordinates of the segment ends
+    /// \param n the number of segments
+    /// \param collides the collision result of each segment so far
+    void shape_segments(const Shape & shape, const double * x0, const double * y0, const double * x1, const double * y1, int n, unsigned char * collides) const;
+  };
+}
+
+#endif //COLLISION_WORLD_INCLUDE_GUARD_HPP
@@ -0,0 +1,74 @@
+#ifndef DISTANCE_FIELD_INCLUDE_GUARD_HPP
+#define DISTANCE_FIELD_INCLUDE_GUARD_HPP
+/// \file
+/// \brief A library for looking up the distance to the nearest obstacle from a precomputed field
+
+#include <vector>
+
+#include "rigid2d/rigid2d.hpp"
+#include "roadmap/grid.hpp"
+
+namespace raster
+{
+  /// \brief The distance from the centers of a grid of cells to the nearest obstacle or map boarder, computed once with an exact
+  /// euclidean distance transform. Lookups interpolate the distance and its gradient bilinearly between the cell centers,
+  /// so a query costs the same no matter how many obstacles are in the map. The distances are accurate to about a cell.
+  class DistanceField
+  {
+  public:
+
+    /// \brief Create an empty field
+    DistanceField() {};
+
+    /// \brief Compute the distance field of a map
+    /// \param map the map with the obstacles and boundaries
+    /// \param resolution the side length of each cell in the units of the map
+    /// \param threads the number of threads used to compute the field, 0 uses all available cores
+    DistanceField(const grid::Map & map, double resolution, unsigned int threads=1);
+
+    /// \brief Check if the field has been computed
+    /// \returns True if the field has no cells
+    bool empty() const;
+
+    /// \brief Get the side length of the cells
+    /// \returns the resolution of the field
+    double get_resolution() const;
+
+    /// \brief Get the distance to the nearest obstacle or map boarder
+    /// \param point the location to look up, points outside the map use the nearest cell on the boarder
+    /// \returns the interpolated distance, 0 inside the obstacles
+    double distance(const rigid2d::Vector2D & point) const;
+
+    /// \brief Get the gradient of the distance to the nearest obstacle or map boarder
+    /// \param point the location to look up, points outside the map use the nearest cell on the boarder
+    /// \returns the interpolated gradient, which points away from the nearest obstacle
+    rigid2d::Vector2D gradient(const rigid2d::Vector2D & point) const;
+
+    /// \brief Get the distance and its gradient with a single lookup
+    /// \param point the location to look up
+    /// \param grad [out] the interpolated gradient
+    /// \returns the interpolated distance
+    double distance(const rigid2d::Vector2D & point, rigid2d::Vector2D & grad) const;
+
+  private:
+    double x_origin = 0; ///< x coordinate of the lower left corner of the field
+    double y_origin = 0; ///< y coordinate of the lower left corner of the field
+    double res = 1.0; ///< side length of a cell
+
+    int width = 0; ///< number of cells in each row
+    int height = 0; ///< number of rows
+
+    std::vector<double> dist; ///< distance at each cell center in row major order
+    std::vector<double> grad_x; ///< x component of the distance gradient at each cell center
+    std::vector<double> grad_y; ///< y component of the distance gradient at each cell center
+
+    /// \brief Find the cell and the interpolation weights for a point
+    /// \param point the location to look up
+    /// \param id [out] the ID of the lower left of the 4 cells to interpolate between
+    /// \param fx [out] the weight of the cells to the right
+    /// \param fy [out] the weight of the cells above
+    void locate(const rigid2d::Vector2D & point, int & id, double & fx, double & fy) const;
+  };
+}
+
+#endif //DISTANCE_FIELD_INCLUDE_GUARD_HPP
@@ -0,0 +1,277 @@
+#ifndef GRAPH_INCLUDE_GUARD_HPP
+#define GRAPH_INCLUDE_GUARD_HPP
+/// \file
+/// \brief A compact graph representation shared by the road map, the grid and the search algorithms
+
+#include <algorithm>
+#include <vector>
+
+#include "rigid2d/rigid2d.hpp"
+
+namespace graph
+{
+  /// \brief A directed graph stored in compressed sparse row (CSR) format. The neighbors of node i are stored in
+  /// positions offsets[i] to offsets[i+1]-1 of the neighbor and weight arrays, and the node locations are stored as
+  /// separate x and y arrays. An undirected graph stores each edge once in each direction. Node IDs are the indices 0 to size()-1.
+  class CSRGraph
+  {
+  public:
+
+    /// \brief Create an empty graph
+    CSRGraph() {};
+
+    /// \brief Remove all nodes and edges
+    void clear();
+
+    /// \brief Reserve storage to avoid reallocating while building the graph
+    /// \param n_nodes the expected number of nodes
+    /// \param n_edges the expected number of directed edges
+    void reserve(int n_nodes, int n_edges);
+
+    /// \brief Add a node to the graph. Nodes must be added in ID order and all the edges of a node must be added before the next node.
+    /// \param point the x,y location of the node relative to the world
+    /// \returns the ID of the new node
+    int add_node(const rigid2d::Vector2D & point);
+
+    /// \brief Add a directed edge from the most recently added node
+    /// \param neighbor the ID of the node the edge connects to
+    /// \param weight the cost to traverse the edge
+    void add_edge(int neighbor, double weight);
+
+    /// \brief Get the number of nodes in the graph
+    /// \returns the number of nodes
+    int size() const;
+
+    /// \brief Get the number of directed edges in the graph
+    /// \returns the number of edges
+    int num_edges() const;
+
+    /// \brief Get the location of a node
+    /// \param id the ID of the node
+    /// \returns the x,y location of the node relative to the world
+    rigid2d::Vector2D point(int id) const;
+
+    /// \brief Get the x locations of all nodes
+    /// \returns the x coordinates in node ID order
+    const std::vector<double> & x_coords() const;
+
+    /// \brief Get the y locations of all nodes
+    /// \returns the y coordinates in node ID order
+    const std::vector<double> & y_coords() const;
+
+    /// \brief Get the first edge of each node
+    /// \returns size()+1 offsets into the edge arrays, the last one is num_edges()
+    const std::vector<int> & edge_offsets() const;
+
+    /// \brief Get the node each edge connects to
+    /// \returns the neighbor IDs in edge order
+    const std::vector<int> & edge_neighbors() const;
+
+    /// \brief Get the cost of each edge
+    /// \returns the edge weights in edge order
+    const std::vector<double> & edge_weights() const;
+
+    /// \brief Replace the graph with raw CSR arrays, like the arrays of a graph saved to a file
+    /// \param n_nodes the number of nodes
+    /// \param n_edges the number of directed edges
+    /// \param offsets n_nodes+1 offsets, starting at 0, never decreasing and ending at n_edges
+    /// \param neighbors n_edges neighbor IDs, each in the range 0 to n_nodes-1
+    /// \param weights n_edges edge weights
+    /// \param x_coords n_nodes x locations
+    /// \param y_coords n_nodes y locations
+    /// \returns True if the arrays form a valid graph, otherwise False and the graph is unchanged
+    bool assign(int n_nodes, int n_edges, const int * offsets, const int * neighbors, const double * weights, const double * x_coords,
+                const double * y_coords);
+
+    /// \brief Get the number of neighbors of a node
+    /// \param id the ID of the node
+    /// \returns the number of outgoing edges
+    int degree(int id) const;
+
+    /// \brief Call a function for every neighbor of a node
+    /// \param id the ID of the node
+    /// \param fn a callable taking the neighbor ID and the edge weight
+    template <typename Fn>
+    void for_each_neighbor(int id, Fn && fn) const
+    {
+      for(int e = offsets[id]; e < offsets[id + 1]; e++)
+      {
+        fn(neighbors[e], weights[e]);
+      }
+    }
+
+    /// \brief Determine if there is an edge between two nodes
+    /// \param u the ID of the first node
+    /// \param v the ID of the second node
+    /// \returns True if there is an edge from u to v
+    bool has_edge(int u, int v) const;
+
+    /// \brief Find the position of an edge in the edge arrays, which numbers the edges so data can be stored per edge
+    /// \param u the ID of the first node
+    /// \param v the ID of the second node
+    /// \returns the index of the edge from u to v, in the range 0 to num_edges()-1, or -1 if there is no such edge
+    int find_edge(int u, int v) const;
+
+  private:
+    std::vector<int> offsets = {0}; ///< the first edge of each node, with one extra entry for the end of the last node
+    std::vector<int> neighbors; ///< the node each edge connects to
+    std::vector<double> weights; ///< the cost of each edge
+
+    std::vector<double> x; ///< x location of each node
+    std::vector<double> y; ///< y location of each node
+  };
+
+  /// \brief An implicit 8 neighbor connected graph of the cell centers of a grid. Nothing is stored per node, the neighbors
+  /// and locations are calculated from the node ID, which is the row major index of the cell. The interface matches CSRGraph.
+  class GridGraph
+  {
+  public:
+
+    /// \brief Create an empty graph
+    GridGraph() {};
+
+    /// \brief Create a graph for a grid
+    /// \param width the number of cells in each row
+    /// \param height the number of rows
+    /// \param resolution the side length of a cell in meters
+    GridGraph(int width, int height, double resolution);
+
+    /// \brief Get the number of nodes in the graph
+    /// \returns the number of nodes
+    int size() const;
+
+    /// \brief Get the number of cells in each row
+    /// \returns the width of the grid
+    int width() const;
+
+    /// \brief Get the location of a node
+    /// \param id the ID of the node
+    /// \returns the x,y location of the cell center relative to the world
+    rigid2d::Vector2D point(int id) const;
+
+    /// \brief Call a function for every neighbor of a node
+    /// \param id the ID of the node
+    /// \param fn a callable taking the neighbor ID and the edge weight
+    template <typename Fn>
+    void for_each_neighbor(int id, Fn && fn) const
+    {
+      const int x = id % n_cols;
+      const int y = id / n_cols;
+
+      for(int m = -1; m < 2; m++) //y shift
+      {
+        if((y + m) < 0 || (y + m) >= n_rows) continue;
+
+        for(int n = -1; n < 2; n++) //x shift
+        {
+          // skip over the 0 shift and any shift that is out of bounds
+          if(m == 0 && n == 0) continue;
+          else if((x + n) < 0 || (x + n) >= n_cols) continue;
+
+          fn(id + m * n_cols + n, (m != 0 && n != 0) ? diagonal : straight);
+        }
+      }
+    }
+
+  private:
+    int n_cols = 0; ///< number of cells in each row
+    int n_rows = 0; ///< number of rows
+
+    double cell_length = 1.0; ///< side length of a cell in meters
+    double straight = 1.0; ///< weight of an edge to a horizontal or vertical neighbor
+    double diagonal = 1.0; ///< weight of an edge to a diagonal neighbor
+  };
+
+  /// \brief A read-only base graph with a few query nodes, like the start and goal of a search, attached on top. The base graph is
+  /// never modified, so any number of query graphs can share one base from different threads. Query node IDs follow the base node IDs,
+  /// starting at base size(). The interface matches CSRGraph.
+  class QueryGraph
+  {
+  public:
+
+    /// \brief Create a query graph without a base
+    QueryGraph() {};
+
+    /// \brief Create a query graph over a base graph
+    /// \param base_p pointer to the base graph, which must outlive the query graph and must not change while it is used
+    QueryGraph(const CSRGraph * base_p);
+
+    /// \brief Detach all of the query nodes and change the base graph
+    /// \param base_p pointer to the base graph, which must outlive the query graph and must not change while it is used
+    void reset(const CSRGraph * base_p);
+
+    /// \brief Detach all of the query nodes, keeping the base graph and the storage
+    void clear();
+
+    /// \brief Add a query node
+    /// \param point the x,y location of the node relative to the world
+    /// \returns the ID of the new node
+    int add_node(const rigid2d::Vector2D & point);
+
+    /// \brief Add an undirected edge from a query node
+    /// \param query_id the ID of the query node
+    /// \param neighbor the ID of the base or query node the edge connects to
+    /// \param weight the cost to traverse the edge
+    void add_edge(int query_id, int neighbor, double weight);
+
+    /// \brief Get the base graph
+    /// \returns pointer to the base graph
+    const CSRGraph * base() const;
+
+    /// \brief Check if a node was added to the query rather than being part of the base graph
+    /// \param id the ID of the node
+    /// \returns True if the node is a query node
+    bool is_query_node(int id) const;
+
+    /// \brief Get the number of nodes in the base graph and the query
+    /// \returns the number of nodes
+    int size() const;
+
+    /// \brief Get the location of a node
+    /// \param id the ID of the node
+    /// \returns the x,y location of the node relative to the world
+    rigid2d::Vector2D point(int id) const;
+
+    /// \brief Call a function for every neighbor of a node, including the edges to the query nodes
+    /// \param id the ID of the node
+    /// \param fn a callable taking the neighbor ID and the edge weight
+    template <typename Fn>
+    void for_each_neighbor(int id, Fn && fn) const
+    {
+      if(id < base_size) base_p->for_each_neighbor(id, fn);
+
+      if(links.empty()) return;
+
+      // the links are sorted by the node they leave from
+      auto it = std::lower_bound(links.begin(), links.end(), id, [](const Link & l, int from){ return l.from < from; });
+
+      for(; it != links.end() && it->from == id; it++)
+      {
+        fn(it->to, it->weight);
+      }
+    }
+
+  private:
+    /// \brief A directed edge that leaves from or arrives at a query node
+    struct Link
+    {
+      int from = -1; ///< the node the edge leaves from
+      int to = -1; ///< the node the edge connects to
+      double weight = 0; ///< the cost to traverse the edge
+    };
+
+    const CSRGraph * base_p = nullptr; ///< the shared base graph
+    int base_size = 0; ///< number of nodes in the base graph
+
+    std::vector<double> x; ///< x location of each query node
+    std::vector<double> y; ///< y location of each query node
+
+    std::vector<Link> links; ///< both directions of every query edge, sorted by the node they leave from
+
+    /// \brief Insert a directed edge, keeping the links sorted
+    /// \param link the edge to insert
+    void insert(const Link & link);
+  };
+}
+
+#endif //GRAPH_INCLUDE_GUARD_HPP
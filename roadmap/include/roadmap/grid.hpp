@@ -3,11 +3,15 @@
 /// \file
 /// \brief A library for building an occupancy grid.
 
+#include <cstdint>
+#include <string>
 #include <vector>
 #include <unordered_set>
 
 #include "rigid2d/rigid2d.hpp"
+#include "roadmap/graph.hpp"
 #include "roadmap/prm.hpp"
+#include "roadmap/stats.hpp"
 
 namespace grid
 {
@@ -30,6 +34,77 @@ namespace grid
     Map(std::vector<std::vector<rigid2d::Vector2D>> obs, std::vector<double> x, std::vector<double> y);
   };
 
+  /// \brief A non-owning view of the occupancy data of a Grid in row major order with the first element corresponding to the lower left corner.
+  /// The view remains valid until the grid is rebuilt or destroyed.
+  struct OccupancyView
+  {
+    const signed char * data = nullptr; ///< occupancy data, 0 is free, 50 is buffer zone, 100 is occupied
+    int width = 0; ///< number of cells in each row
+    int height = 0; ///< number of rows
+
+    /// \brief Get the row major index of a cell
+    /// \param x the x grid coordinate
+    /// \param y the y grid coordinate
+    /// \returns the cell ID
+    int id(int x, int y) const
+    {
+      return y * width + x;
+    }
+
+    /// \brief Get the occupancy of a cell
+    /// \param id the row major index of the cell
+    /// \returns the occupancy value
+    signed char at(int id) const
+    {
+      return data[id];
+    }
+
+    /// \brief Get the occupancy of a cell
+    /// \param x the x grid coordinate
+    /// \param y the y grid coordinate
+    /// \returns the occupancy value
+    signed char at(int x, int y) const
+    {
+      return data[id(x, y)];
+    }
+
+    /// \brief Get the number of cells in the grid
+    /// \returns the number of cells
+    int size() const
+    {
+      return width * height;
+    }
+
+    /// \brief Check if every cell touched by the segment between two cell centers is free. Uses a supercover line, so a segment passing
+    /// exactly through a cell corner must have both cells beside the corner free. The cost is bounded by the segment length in cells.
+    /// \param x0 the x grid coordinate of the first cell
+    /// \param y0 the y grid coordinate of the first cell
+    /// \param x1 the x grid coordinate of the second cell
+    /// \param y1 the y grid coordinate of the second cell
+    /// \returns True if all of the cells are free (0), otherwise False
+    bool line_is_free(int x0, int y0, int x1, int y1) const;
+  };
+
+  /// \brief A rectangular block of new occupancy data, like the data of a map_msgs/OccupancyGridUpdate
+  struct OccupancyPatch
+  {
+    int x = 0; ///< x grid coordinate of the lower left cell of the patch
+    int y = 0; ///< y grid coordinate of the lower left cell of the patch
+    int width = 0; ///< number of cells in each row of the patch
+    int height = 0; ///< number of rows in the patch
+    std::vector<signed char> data; ///< occupancy data in row major order with the first element at the lower left cell
+
+    /// \brief default constructor, an empty patch
+    OccupancyPatch() {};
+
+    /// \brief Create a patch of free cells
+    /// \param x x grid coordinate of the lower left cell
+    /// \param y y grid coordinate of the lower left cell
+    /// \param width number of cells in each row
+    /// \param height number of rows
+    OccupancyPatch(int x, int y, int width, int height) : x(x), y(y), width(width), height(height), data(width * height, 0) {};
+  };
+
   /// \brief Class to create a Grid overlay for provided Map information
   class Grid
   {
@@ -55,7 +130,8 @@ namespace grid
     /// \param cell_size the desired distance the distance for the cell length/height in meters
     /// \param grid_res scaling factor to create the occupancy grid with a finer resolution that the existing cell_size. Use 1 to make the grid equal to the current cell size Use 2 to double the resolution.
     /// \param robot_radius the radius to use as a buffer around the robot for collision detection
-    void build_grid(double cell_size, unsigned int grid_res, double robot_radius);
+    /// \param threads the number of threads used to rasterize the obstacles, 0 uses all available cores
+    void build_grid(double cell_size, unsigned int grid_res, double robot_radius, unsigned int threads=1);
 
     /// \brief Function to generate an 8 neighbor connected graph structure based on grid cell center locations
     ///
@@ -66,7 +142,13 @@ namespace grid
     /// \returns a vector of boolean values: True if the new point info actually caused a change in the occupancy data from free to occupied, otherwise False.
     std::vector<int> update_grid(std::vector<std::pair<rigid2d::Vector2D, signed char>> points);
 
-    /// \brief Retrive the nodes in a 2D vector in the shape of the grid
+    /// \brief Update the existing occupancy data with a rectangular patch. Unchanged cells are skipped a word at a time, so the cost of
+    /// an update that changes little is close to a memory compare of the patch. Like update_grid, this does not update the stored Map.
+    /// \param patch the new occupancy data, cells outside of the grid are ignored and so is a patch whose data does not match its size
+    /// \returns the row major IDs of the cells that changed from free to not free or back, in row major order
+    std::vector<int> update_patch(const OccupancyPatch & patch);
+
+    /// \brief Retrive the nodes in a 2D vector in the shape of the grid, this creates a copy of the graph in the expanded Node format
     /// \returns the nodes in a structure matching the grid
     std::vector<std::vector<prm::Node>> get_nodes() const;
 
@@ -78,6 +160,14 @@ namespace grid
     /// \returns all the unique edges
     std::vector<prm::Edge> get_edges() const;
 
+    /// \brief Access the graph created by generate_centers_graph. The node IDs are the row major indices of the grid cells.
+    /// \returns a reference to the graph
+    const graph::CSRGraph & get_graph() const;
+
+    /// \brief Get an implicit 8 neighbor connected graph of the cell centers, which does not require generate_centers_graph
+    /// \returns a graph with node IDs matching the row major indices of the grid cells
+    graph::GridGraph get_implicit_graph() const;
+
     /// \brief retrieve the built grid
     /// \returns grid occupancy data as a vector of vectors.
     std::vector<std::vector<signed char>> get_grid() const;
@@ -86,6 +176,14 @@ namespace grid
     /// \returns grid occupancy data in row major order
     std::vector<signed char> get_grid_flatten() const;
 
+    /// \brief access the grid data without copying it
+    /// \returns a view of the occupancy data in row major order
+    OccupancyView get_occupancy() const;
+
+    /// \brief get the side length of a grid cell
+    /// \returns the cell length in meters
+    double get_resolution() const;
+
     /// \brief get the height and width of the grid
     /// \returns the grid dimensions in number of cells
     std::vector<int> get_grid_dimensions() const;
@@ -93,12 +191,42 @@ namespace grid
     /// \brief convert from grid coordinates (integers) to world coordinates (meters)
     /// \param grid_coord grid location to convert
     /// \returns matching world coordinate
-    rigid2d::Vector2D grid_to_world(rigid2d::Vector2D grid_coord);
+    rigid2d::Vector2D grid_to_world(rigid2d::Vector2D grid_coord) const;
 
     /// \brief convert from world coordinates to grid coordinates
     /// \param world_coord world location to convert
     /// \returns matching grid coordinate
-    rigid2d::Vector2D world_to_grid(rigid2d::Vector2D world_coord);
+    rigid2d::Vector2D world_to_grid(rigid2d::Vector2D world_coord) const;
+
+    /// \brief Get the statistics of building the grid, the cells checked exactly against the obstacles and the wall time of the
+    /// occupancy and graph phases, accumulated over every call to build_grid and generate_centers_graph since the last reset
+    /// \returns the statistics
+    const stats::Stats & get_stats() const;
+
+    /// \brief Set the statistics back to 0
+    void reset_stats();
+
+    /// \brief Get the key a grid built with build_grid and these parameters is cached under, a hash of the obstacles, the bounds and the
+    /// parameters
+    /// \param cell_size the cell_size of build_grid
+    /// \param grid_res the grid_res of build_grid
+    /// \param robot_radius the robot_radius of build_grid
+    /// \returns the key
+    std::uint64_t get_cache_key(double cell_size, unsigned int grid_res, double robot_radius) const;
+
+    /// \brief Save the occupancy data, and the graph from generate_centers_graph if it was generated, to a cache file
+    /// \param file_name the path of the file
+    /// \param key the key from get_cache_key for the parameters the grid was built with
+    /// \returns True if the file was written
+    bool save(const std::string & file_name, std::uint64_t key) const;
+
+    /// \brief Load a grid from a cache file in place of build_grid, and the graph if it was saved. The file is memory mapped, so only
+    /// the arrays are copied.
+    /// \param file_name the path of the file
+    /// \param key the key from get_cache_key for the parameters the grid should be built with
+    /// \returns True if the grid was loaded, otherwise False and the grid is unchanged, like when the file is missing, has another key or
+    /// another format version, or is damaged
+    bool load(const std::string & file_name, std::uint64_t key);
 
   private:
 
@@ -111,20 +239,22 @@ namespace grid
     unsigned int grid_res = 1; ///< scale the cell size
     double cell_size = 1.0; ///< meters per grid cell
 
-    std::vector<std::vector<prm::Node>> nodes; ///< all nodes in the grid
-    std::vector<prm::Edge> all_edges; ///< all edges between the grid
+    graph::CSRGraph centers_graph; ///< 8 neighbor connected graph of the cell centers
+
+    std::vector<signed char> occ_data; ///< occupancy grid data in row major order, 0 is free, 50 is buffer zone, 100 is occupied
 
-    std::vector<std::vector<signed char>> occ_data; ///< occupancy grid data, 0 is free, 50 is buffer zone, 100 is occupied
+    stats::Stats build_stats; ///< statistics of building the grid
 
     /// \brief calculate the grid size based on the saved map and the grid resolution
     ///
     void grid_resize();
 
-    /// \brief Determine if the cell center is within the buffer radius of the map boarder
-    /// \param center location of cell to check against
+    /// \brief Determine if a cell center is within the buffer radius of the map boarder along one axis of the grid
+    /// \param center coordinate of the cell center along the axis
+    /// \param length number of cells along the axis
     /// \param threshold grid buffer distance
-    /// \returns True if the cell center is within the buffer_radius
-    bool cell_near_boarder(rigid2d::Vector2D center, double threshold);
+    /// \returns True if the cell center is within the buffer_radius of either end of the axis
+    bool cell_near_boarder(double center, int length, double threshold) const;
   };
 }
 
@@ -0,0 +1,230 @@
+#ifndef MAP_CACHE_INCLUDE_GUARD_HPP
+#define MAP_CACHE_INCLUDE_GUARD_HPP
+/// \file
+/// \brief A versioned binary file format to cache built grids and road maps, loaded by memory mapping the file
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "rigid2d/rigid2d.hpp"
+#include "roadmap/graph.hpp"
+
+namespace cache
+{
+  /// \brief Version of the file format, files written with another version are rebuilt
+  static constexpr std::uint32_t format_version = 1;
+
+  /// \brief Alignment of every section of a file, so the arrays can be read in place from the mapped file
+  static constexpr std::size_t section_alignment = 8;
+
+  /// \brief The kind of data stored in a file
+  enum class Kind : std::uint32_t
+  {
+    grid = 1, ///< a grid::Grid
+    road_map = 2 ///< a prm::RoadMap
+  };
+
+  /// \brief The first bytes of every file
+  struct Header
+  {
+    char magic[8]; ///< "MAPCACH" and a null character
+    std::uint32_t version; ///< format_version of the writer
+    std::uint32_t byte_order; ///< 0x01020304 in the byte order of the writer
+    std::uint32_t kind; ///< the Kind of data
+    std::uint32_t reserved; ///< 0, pads the header to a multiple of the section alignment
+    std::uint64_t key; ///< the hash of the parameters the data was built with
+    std::uint64_t size; ///< size of the whole file in bytes
+  };
+
+  /// \brief A 64 bit FNV-1a hash of the parameters used to build a map, so a cached map is only loaded for the same parameters
+  class Hasher
+  {
+  public:
+
+    /// \brief Start a hash, which already includes the format version
+    Hasher();
+
+    /// \brief Add raw bytes to the hash
+    /// \param data the bytes
+    /// \param size the number of bytes
+    /// \returns a reference to the hasher
+    Hasher & add(const void * data, std::size_t size);
+
+    /// \brief Add a number to the hash
+    /// \param value the number
+    /// \returns a reference to the hasher
+    Hasher & add(double value);
+
+    /// \brief Add a number to the hash
+    /// \param value the number
+    /// \returns a reference to the hasher
+    Hasher & add(std::uint64_t value);
+
+    /// \brief Add a list of numbers to the hash, including its length
+    /// \param values the numbers
+    /// \returns a reference to the hasher
+    Hasher & add(const std::vector<double> & values);
+
+    /// \brief Add a list of polygons to the hash, including the number of polygons and the number of verticies of each one
+    /// \param polygons the polygons
+    /// \returns a reference to the hasher
+    Hasher & add(const std::vector<std::vector<rigid2d::Vector2D>> & polygons);
+
+    /// \brief Get the hash of everything added so far
+    /// \returns the hash
+    std::uint64_t value() const;
+
+  private:
+    std::uint64_t hash; ///< the current hash
+  };
+
+  /// \brief A file memory mapped read only. Every process that maps the same file shares its pages.
+  class MappedFile
+  {
+  public:
+
+    /// \brief Create an empty mapping
+    MappedFile() {};
+
+    /// \brief Unmap the file
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile & operator=(const MappedFile &) = delete;
+
+    /// \brief Map a file, replacing the current mapping
+    /// \param file_name the path of the file
+    /// \returns True if the file was mapped, False if it does not exist, is empty or can not be mapped
+    bool open(const std::string & file_name);
+
+    /// \brief Unmap the file
+    void close();
+
+    /// \brief Get the contents of the file
+    /// \returns a pointer to the first byte, null if no file is mapped
+    const unsigned char * data() const;
+
+    /// \brief Get the size of the file
+    /// \returns the number of bytes
+    std::size_t size() const;
+
+  private:
+    const unsigned char * bytes = nullptr; ///< the mapped file
+    std::size_t length = 0; ///< the size of the mapping
+  };
+
+  /// \brief Collects the sections of a file in memory, then writes the file in one go
+  class Writer
+  {
+  public:
+
+    /// \brief Start a file with a header
+    /// \param kind the kind of data in the file
+    /// \param key the hash of the parameters the data was built with
+    Writer(Kind kind, std::uint64_t key);
+
+    /// \brief Add an array as a new section, aligned to the section alignment
+    /// \param values the first element of the array
+    /// \param count the number of elements
+    template <typename T>
+    void append(const T * values, std::size_t count)
+    {
+      buffer.resize((buffer.size() + section_alignment - 1) / section_alignment * section_alignment, 0);
+
+      const auto * first = reinterpret_cast<const unsigned char *>(values);
+      buffer.insert(buffer.end(), first, first + count * sizeof(T));
+    }
+
+    /// \brief Add a single value as a new section
+    /// \param value the value
+    template <typename T>
+    void append(const T & value)
+    {
+      append(&value, 1);
+    }
+
+    /// \brief Write the file, first to a temporary file which is then renamed, so readers never see a partial file
+    /// \param file_name the path of the file
+    /// \returns True if the file was written
+    bool write(const std::string & file_name);
+
+  private:
+    std::vector<unsigned char> buffer; ///< the contents of the file
+  };
+
+  /// \brief Reads the sections of a mapped file in the order they were written, without copying them
+  class Reader
+  {
+  public:
+
+    /// \brief Start reading a mapped file after checking its header
+    /// \param file the mapped file, which must outlive the reader
+    /// \param kind the expected kind of data
+    /// \param key the expected hash of the parameters
+    Reader(const MappedFile & file, Kind kind, std::uint64_t key);
+
+    /// \brief Check if the header matched and every section so far was complete
+    /// \returns True if the file can still be read
+    bool good() const;
+
+    /// \brief Read an array from the next section
+    /// \param count the number of elements
+    /// \returns a pointer to the first element in the mapped file, null if the file is too short or was not good
+    template <typename T>
+    const T * next(std::size_t count)
+    {
+      offset = (offset + section_alignment - 1) / section_alignment * section_alignment;
+
+      if(!ok || offset > file.size() || count > (file.size() - offset) / sizeof(T))
+      {
+        ok = false;
+        return nullptr;
+      }
+
+      const T * values = reinterpret_cast<const T *>(file.data() + offset);
+      offset += count * sizeof(T);
+
+      return values;
+    }
+
+    /// \brief Read a single value from the next section
+    /// \param value [out] the value, left unchanged if the file is too short or was not good
+    /// \returns True if the value was read
+    template <typename T>
+    bool next(T & value)
+    {
+      const T * p = next<T>(1);
+
+      if(p) value = *p;
+
+      return p;
+    }
+
+  private:
+    const MappedFile & file; ///< the mapped file
+    std::size_t offset = 0; ///< the position of the next section
+    bool ok = false; ///< True while the file can be read
+  };
+
+  /// \brief Add a graph to a file as a section of sizes and one section per CSR array
+  /// \param writer the file being written
+  /// \param g the graph
+  void write_graph(Writer & writer, const graph::CSRGraph & g);
+
+  /// \brief Read a graph written with write_graph
+  /// \param reader the file being read
+  /// \param g [out] the graph, left unchanged if the sections are missing or do not form a valid graph
+  /// \returns True if the graph was read
+  bool read_graph(Reader & reader, graph::CSRGraph & g);
+
+  /// \brief Get the path of a cache file for a key
+  /// \param directory the cache directory
+  /// \param prefix a name for the kind of data, like "grid"
+  /// \param key the hash of the parameters
+  /// \returns directory/prefix_key.bin with the key in hexadecimal
+  std::string cache_file(const std::string & directory, const std::string & prefix, std::uint64_t key);
+}
+
+#endif // MAP_CACHE_INCLUDE_GUARD_HPP
@@ -0,0 +1,45 @@
+#ifndef MARKER_TRACKER_INCLUDE_GUARD_HPP
+#define MARKER_TRACKER_INCLUDE_GUARD_HPP
+/// \file
+/// \brief Track the markers drawn each frame so only the markers that changed are published
+
+#include <map>
+#include <string>
+#include <utility>
+
+#include "visualization_msgs/MarkerArray.h"
+#include "visualization_msgs/Marker.h"
+
+namespace utility
+{
+  /// \brief Collects the markers of a frame and compares them to the markers of the previous frame. A marker that is drawn again
+  /// unchanged is not published again, and a marker that is no longer drawn is deleted once.
+  class MarkerTracker
+  {
+  public:
+
+    /// \brief Add a marker to the current frame, replacing any marker of this frame with the same namespace and id
+    /// \param marker the marker to draw
+    void draw(visualization_msgs::Marker marker);
+
+    /// \brief Finish the current frame and start a new, empty one
+    /// \param msg [out] an ADD for each marker that is new or changed since the previous frame, and a DELETE for each marker of the
+    /// previous frame that was not drawn in this one
+    /// \returns True if msg has any markers to publish
+    bool flush(visualization_msgs::MarkerArray & msg);
+
+    /// \brief Send every marker drawn in the current frame on the next flush, even the unchanged ones, like after a new subscriber
+    /// connects. It can be called at any point of a frame, and the markers of the previous frame that are not drawn are still deleted.
+    void reset();
+
+  private:
+    using Key = std::pair<std::string, int>; ///< namespace and id of a marker
+
+    std::map<Key, visualization_msgs::Marker> shown; ///< markers published by the previous frames
+    std::map<Key, visualization_msgs::Marker> frame; ///< markers drawn in the current frame
+
+    bool resend = false; ///< True if the next flush sends every drawn marker
+  };
+}
+
+#endif // MARKER_TRACKER_INCLUDE_GUARD_HPP
@@ -0,0 +1,65 @@
+#ifndef PARALLEL_INCLUDE_GUARD_HPP
+#define PARALLEL_INCLUDE_GUARD_HPP
+/// \file
+/// \brief Helpers to split independent work across threads
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace parallel
+{
+  /// \brief Determine the number of threads to use
+  /// \param requested the requested number of threads, 0 uses one thread per available core
+  /// \returns the number of threads, at least 1
+  inline unsigned int thread_count(unsigned int requested)
+  {
+    if(requested != 0) return requested;
+
+    const unsigned int cores = std::thread::hardware_concurrency();
+    return (cores == 0) ? 1 : cores;
+  }
+
+  /// \brief Call a function for every index in a range, splitting the range into one contiguous chunk per thread.
+  /// The calling thread processes the first chunk. The function must be safe to call concurrently for different indices.
+  /// \param begin the first index
+  /// \param end one past the last index
+  /// \param threads the number of threads to use, 0 uses one thread per available core
+  /// \param fn a callable taking the index
+  template <typename Fn>
+  void parallel_for(int begin, int end, unsigned int threads, Fn && fn)
+  {
+    const int total = end - begin;
+    if(total <= 0) return;
+
+    const int workers = std::min<int>(thread_count(threads), total);
+
+    // run in the calling thread when there is nothing to split
+    if(workers == 1)
+    {
+      for(int i = begin; i < end; i++) fn(i);
+      return;
+    }
+
+    const int chunk = (total + workers - 1) / workers;
+
+    auto run_chunk = [&](int w)
+    {
+      const int lo = begin + w * chunk;
+      const int hi = std::min(end, lo + chunk);
+
+      for(int i = lo; i < hi; i++) fn(i);
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(workers - 1);
+
+    for(int w = 1; w < workers; w++) pool.emplace_back(run_chunk, w);
+
+    run_chunk(0);
+
+    for(auto & t : pool) t.join();
+  }
+}
+
+#endif //PARALLEL_INCLUDE_GUARD_HPP
@@ -3,10 +3,16 @@
 /// \file
 /// \brief A library for building a Probabilistic Road Map
 
+#include <cstdint>
+#include <string>
 #include <vector>
 #include <unordered_set>
 
 #include "rigid2d/rigid2d.hpp"
+#include "roadmap/collision_world.hpp"
+#include "roadmap/graph.hpp"
+#include "roadmap/spatial_index.hpp"
+#include "roadmap/stats.hpp"
 
 namespace prm
 {
@@ -33,7 +39,6 @@ namespace prm
     std::unordered_set<int> id_set; ///< nodes that should be connected
 
     double weight = 0; ///< weight to determine if map is properly sampled
-    double distance = 0; ///< the distance to a node, used to find k-nearest nodes
 
     /// \brief Determine if a node is connected to this one
     /// \param node_id ID to check for a connection
@@ -43,16 +48,23 @@ namespace prm
       const auto search = id_set.find(node_id);
       return (search == id_set.end()) ? false : true;
     }
-
-    /// \brief Compares the distance value of this node object and another
-    /// \param rhs pointer to another node object
-    /// \returns True if this node has a smaller distance
-    bool operator<(const Node &rhs) const
-    {
-      return (distance < rhs.distance);
-    }
   };
 
+  /// \brief Convert a list of nodes into a compact graph
+  /// \param nodes the nodes to convert, the ID of each node must match its position in the list
+  /// \returns the graph with the edges of each node in the order they were created
+  graph::CSRGraph to_graph(const std::vector<Node> & nodes);
+
+  /// \brief Export a compact graph as a list of nodes
+  /// \param g the graph to convert
+  /// \returns a node for each node in the graph, with edges and neighbor sets populated
+  std::vector<Node> to_nodes(const graph::CSRGraph & g);
+
+  /// \brief Export the unique edges of an undirected compact graph
+  /// \param g the graph to convert
+  /// \returns one edge for each connected pair of nodes
+  std::vector<Edge> to_edges(const graph::CSRGraph & g);
+
   /// \brief A class to build a Probabilistic Road Maps based on provided Map information
   class RoadMap
   {
@@ -76,7 +88,25 @@ namespace prm
     /// \param samples the number of nodes for the road map
     /// \param k_neighbors the amount of neighbors to try and create an edge to
     /// \param robot_radius the radius to use as a buffer around the robot for collision detection
-    void build_map(unsigned int samples, unsigned int k_neighbors, double robot_radius);
+    /// \param threads (optional) the number of threads used to sample and connect the nodes, 0 uses one thread per core. The
+    /// resulting map does not depend on the number of threads.
+    void build_map(unsigned int samples, unsigned int k_neighbors, double robot_radius, unsigned int threads = 1);
+
+    /// \brief Set the seed used to sample the configuration space, so that build_map creates the same map every time.
+    /// Without a seed every call to build_map uses a new random seed.
+    /// \param sample_seed the seed for the random samples
+    void set_seed(unsigned int sample_seed);
+
+    /// \brief Build lazy road maps, which connect every node to its nearest neighbors without checking the edges for collisions. Building
+    /// is then only sampling and nearest neighbor queries, and the edges are checked at search time by a lazy search like
+    /// hsearch::LazyAStar, which only checks the edges on its candidate paths. The edges from get_edges and get_graph are then candidates
+    /// whose validity is unknown. Takes effect on the next call to build_map or add_node.
+    /// \param lazy_edges true to skip the edge collision checks
+    void set_lazy(bool lazy_edges);
+
+    /// \brief Check if the road map skips the edge collision checks
+    /// \returns True if the edges of the road map have not been checked for collisions
+    bool is_lazy() const;
 
     /// \brief Wrapper function to get the vector of nodes
     /// \returns the full node vector
@@ -86,19 +116,66 @@ namespace prm
     /// \returns the full edge vector
     std::vector<Edge> get_edges() const;
 
+    /// \brief Get the road map in the compact format used by the search algorithms
+    /// \returns the road map as a CSR graph
+    graph::CSRGraph get_graph() const;
+
     /// \brief Add a user defined node into the graph and create the edges
     /// \param point the x,y coordinates for the new node
     /// \returns True if the node was successfully added
     bool add_node(rigid2d::Vector2D point);
 
+    /// \brief Temporarily attach a point, like the start or goal of a search, to a query graph over the road map. The point is connected
+    /// to its nearest nodes and to the query nodes already attached within the same distance. The road map is only read, so queries can
+    /// be attached from several threads at once while the map is not being built or changed.
+    /// \param query a query graph whose base is the graph from get_graph, query.clear() detaches the points again
+    /// \param point the x,y coordinates of the point
+    /// \returns the ID of the point in the query graph, or -1 if the point is in collision
+    int attach(graph::QueryGraph & query, const rigid2d::Vector2D & point) const;
+
+    /// \brief Get the statistics of building the road map, the collision checks and the wall time of the sample, index and connect
+    /// phases, accumulated over every call to build_map and add_node since the last reset. Queries attached with attach are not counted,
+    /// since attach only reads the road map.
+    /// \returns the statistics
+    const stats::Stats & get_stats() const;
+
+    /// \brief Set the statistics back to 0
+    void reset_stats();
+
+    /// \brief Get the key a road map built with build_map and these parameters is cached under, a hash of the obstacles, the bounds,
+    /// the parameters, the seed and the lazy setting. Without a seed from set_seed every build is different, so the key only finds the
+    /// same road map once a seed is set.
+    /// \param samples the samples of build_map
+    /// \param k_neighbors the k_neighbors of build_map
+    /// \param robot_radius the robot_radius of build_map
+    /// \returns the key
+    std::uint64_t get_cache_key(unsigned int samples, unsigned int k_neighbors, double robot_radius) const;
+
+    /// \brief Save the nodes and edges, as a CSR graph, and the build parameters to a cache file
+    /// \param file_name the path of the file
+    /// \param key the key from get_cache_key for the parameters the road map was built with
+    /// \returns True if the file was written
+    bool save(const std::string & file_name, std::uint64_t key) const;
+
+    /// \brief Load a road map from a cache file in place of build_map. The file is memory mapped, so only the arrays are copied, and
+    /// the nodes, edges and nearest neighbor index are rebuilt from the graph without any collision checks.
+    /// \param file_name the path of the file
+    /// \param key the key from get_cache_key for the parameters the road map should be built with
+    /// \returns True if the road map was loaded, otherwise False and the road map is unchanged, like when the file is missing, has
+    /// another key or another format version, or is damaged
+    bool load(const std::string & file_name, std::uint64_t key);
+
   private:
     std::vector<std::vector<rigid2d::Vector2D>> obstacles; ///< obstacles in the map
+    collision::CollisionWorld obstacle_world; ///< obstacles prepared for collision queries with the current buffer radius
     std::vector<double> x_bounds; ///< x bounds of the map
     std::vector<double> y_bounds; ///< y bounds of the map
 
     std::vector<Node> nodes; ///< all nodes in the road map
     std::vector<Edge> all_edges; ///< all edges in the road map
 
+    spatial::BucketGrid node_index; ///< spatial index of the node locations used for nearest neighbor queries
+
     double buffer_radius = 0; ///< buffer distance to incorporate when detecting collisions
 
     unsigned int n = 100; ///< number of nodes in the map
@@ -107,32 +184,46 @@ namespace prm
     unsigned int edge_cnt = 0; ///< number of edges in the graph
     unsigned int node_cnt = 0; ///< number of nodes in the graph
 
-    /// \brief Randomly Sample the configuration space to retrieve a set of nodes for the roadmap
-    ///
-    void sample_config_space();
+    unsigned int seed = 0; ///< seed for the random samples
+    bool seeded = false; ///< true if the user provided a seed
+
+    bool lazy = false; ///< true to connect the nodes without checking the edges for collisions
+
+    stats::Stats build_stats; ///< statistics of building the road map
+
+    /// \brief Randomly Sample the configuration space to retrieve a set of nodes for the roadmap. The samples are drawn in
+    /// fixed size blocks, each with its own random stream, so the result only depends on the seed.
+    /// \param threads the number of threads used to sample and validate the nodes
+    void sample_config_space(unsigned int threads);
 
     /// \brief Determine if the node was sampled from an area inside an obstacle
     /// \param point the configuration of a new potential node
     /// \returns true if the node is valid
-    bool node_collisions(rigid2d::Vector2D point);
+    bool node_collisions(rigid2d::Vector2D point) const;
 
-    /// \brief Find nodes that are near the provided reference and connect them if possible.
+    /// \brief Find nodes that are near the provided reference and connect them if possible, without collision checks in a lazy road map.
     /// \param node reference to a node
     void connect_node(Node & node);
 
-    /// \brief Find nodes that are near each other and connect them if possible.
+    /// \brief Create an edge between two nodes and add it to both of them
+    /// \param node1 the first node
+    /// \param node2 the second node
+    /// \param distance the length of the edge
+    void create_edge(Node & node1, Node & node2, double distance);
+
+    /// \brief Rebuild the spatial index over all of the current nodes, sized for the number of nodes in the map
     ///
-    void connect_nodes();
+    void index_nodes();
+
+    /// \brief Find nodes that are near each other and connect them if possible. The neighbor queries and collision checks
+    /// run in parallel, then the valid edges are added in node order. A lazy road map skips the collision checks.
+    /// \param threads the number of threads used to find and check the edges
+    void connect_nodes(unsigned int threads);
 
     /// \brief wrapper for all of the edge collision methods
     /// \param edge the edge to compare against all polygons
     /// \returns true if the edge is valid
-    bool edge_collisions(Edge edge);
-
-    /// \brief Brute force k-nearest search
-    /// \param reference to a node object to base the search on
-    /// \returns a vector of references the k-nearest nodes to the input node
-    std::vector<std::reference_wrapper<Node>> nearest_neighbors_bf(const Node &node);
+    bool edge_collisions(Edge edge) const;
   };
 }
 
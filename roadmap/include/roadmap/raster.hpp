@@ -0,0 +1,45 @@
+#ifndef RASTER_INCLUDE_GUARD_HPP
+#define RASTER_INCLUDE_GUARD_HPP
+/// \file
+/// \brief A library for drawing obstacles into row major rasters of unit cells. Cell (x, y) covers [x, x+1] x [y, y+1], so its center is at (x + 0.5, y + 0.5).
+
+#include <vector>
+
+#include "rigid2d/rigid2d.hpp"
+
+namespace raster
+{
+  /// \brief Squared distance assigned to cells when the raster has no seed cells
+  constexpr double no_seed = 1e20;
+
+  /// \brief Find the horizontal extent of a convex polygon within a horizontal band
+  /// \param polygon the verticies of the polygon in order, either cw or ccw
+  /// \param y_lo the lower y bound of the band
+  /// \param y_hi the upper y bound of the band, equal to y_lo for a single scanline
+  /// \param x_lo [out] the smallest x coordinate of the polygon inside the band
+  /// \param x_hi [out] the largest x coordinate of the polygon inside the band
+  /// \returns True if the polygon overlaps the band
+  bool polygon_span(const std::vector<rigid2d::Vector2D> & polygon, double y_lo, double y_hi, double & x_lo, double & x_hi);
+
+  /// \brief Fill convex polygons into a raster one scanline at a time. The rows are split into stripes across threads.
+  /// \param polygons the convex polygons to draw
+  /// \param width the number of cells in each row
+  /// \param height the number of rows
+  /// \param conservative True to fill every cell the polygon touches, False to only fill the cells with their center inside the polygon
+  /// \param value the value to write to the filled cells
+  /// \param data the width * height cells of the raster in row major order
+  /// \param threads the number of threads to use, 0 uses one thread per available core
+  void fill_polygons(const std::vector<std::vector<rigid2d::Vector2D>> & polygons, int width, int height, bool conservative, signed char value,
+                     signed char * data, unsigned int threads = 1);
+
+  /// \brief Compute the exact squared euclidean distance from every cell center to the nearest seed cell center with the two pass
+  /// Felzenszwalb-Huttenlocher transform. The columns and then the rows are split into stripes across threads.
+  /// \param seeds the width * height cells of the raster in row major order, any non zero cell is a seed
+  /// \param width the number of cells in each row
+  /// \param height the number of rows
+  /// \param dist2 [out] the squared distance in cells for every cell, no_seed or larger if there are no seeds
+  /// \param threads the number of threads to use, 0 uses one thread per available core
+  void squared_distance_transform(const signed char * seeds, int width, int height, std::vector<double> & dist2, unsigned int threads = 1);
+}
+
+#endif //RASTER_INCLUDE_GUARD_HPP
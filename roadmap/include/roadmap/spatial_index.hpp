@@ -0,0 +1,87 @@
+#ifndef SPATIAL_INDEX_INCLUDE_GUARD_HPP
+#define SPATIAL_INDEX_INCLUDE_GUARD_HPP
+/// \file
+/// \brief A library for finding nearby points in the plane
+
+#include <utility>
+#include <vector>
+
+#include "rigid2d/rigid2d.hpp"
+
+namespace spatial
+{
+  /// \brief A distance to an indexed point and the ID of that point
+  using Neighbor = std::pair<double, int>;
+
+  /// \brief A uniform grid of buckets over a rectangular area used to find nearby points. Each point is stored in the
+  /// bucket containing it, so a query only has to visit the buckets near the query point. Points outside of the area
+  /// are stored in the nearest border bucket and are still found by queries.
+  class BucketGrid
+  {
+  public:
+
+    /// \brief Create an empty index
+    BucketGrid() {};
+
+    /// \brief Create an empty index over an area
+    /// \param xboundary a 2 element vector defining the x bounds of the area
+    /// \param yboundary a 2 element vector defining the y bounds of the area
+    /// \param bucket_size the side length of a bucket
+    BucketGrid(std::vector<double> xboundary, std::vector<double> yboundary, double bucket_size);
+
+    /// \brief Add a point to the index
+    /// \param id the ID of the point, returned by the queries
+    /// \param point the location of the point
+    void insert(int id, const rigid2d::Vector2D & point);
+
+    /// \brief Get the number of points in the index
+    /// \returns the number of points
+    int size() const;
+
+    /// \brief Find the k nearest points to a location
+    /// \param point the location to search around
+    /// \param k the number of points to find
+    /// \param exclude_id (optional) the ID of a point to leave out of the results, such as the point being queried
+    /// \returns up to k pairs of distance and ID, sorted from nearest to farthest with ties broken by ID
+    std::vector<Neighbor> nearest(const rigid2d::Vector2D & point, unsigned int k, int exclude_id = -1) const;
+
+    /// \brief Find all of the points within a distance of a location
+    /// \param point the location to search around
+    /// \param radius the maximum distance to a point
+    /// \param exclude_id (optional) the ID of a point to leave out of the results, such as the point being queried
+    /// \returns pairs of distance and ID, sorted from nearest to farthest with ties broken by ID
+    std::vector<Neighbor> within_radius(const rigid2d::Vector2D & point, double radius, int exclude_id = -1) const;
+
+  private:
+
+    /// \brief A point stored in a bucket
+    struct Entry
+    {
+      rigid2d::Vector2D point; ///< the location of the point
+      int id = -1; ///< the ID of the point
+    };
+
+    double x_min = 0; ///< lower x bound of the area
+    double y_min = 0; ///< lower y bound of the area
+    double cell = 1.0; ///< side length of a bucket
+
+    int n_cols = 1; ///< number of buckets in each row
+    int n_rows = 1; ///< number of rows of buckets
+
+    int n_points = 0; ///< number of points in the index
+
+    std::vector<std::vector<Entry>> buckets; ///< the points in each bucket, in row major order
+
+    /// \brief Find the column of the bucket containing an x coordinate, clamped to the grid
+    /// \param x the x coordinate
+    /// \returns the column index
+    int column(double x) const;
+
+    /// \brief Find the row of the bucket containing a y coordinate, clamped to the grid
+    /// \param y the y coordinate
+    /// \returns the row index
+    int row(double y) const;
+  };
+}
+
+#endif //SPATIAL_INDEX_INCLUDE_GUARD_HPP
@@ -0,0 +1,91 @@
+#ifndef SPSC_QUEUE_INCLUDE_GUARD_HPP
+#define SPSC_QUEUE_INCLUDE_GUARD_HPP
+/// \file
+/// \brief A bounded lock free queue to pass work from one thread to another
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+#include <vector>
+
+namespace parallel
+{
+  /// \brief Size of a cache line, used to keep the producer and consumer indices from sharing one
+  static constexpr unsigned int cache_line = 64;
+
+  /// \brief A bounded single producer, single consumer ring buffer. One thread may push and one other thread may pop at the same time
+  /// without locks, the items are moved in and out of slots allocated once when the queue is created.
+  template <typename T>
+  class SPSCQueue
+  {
+  public:
+
+    /// \brief Create an empty queue
+    /// \param capacity the maximum number of items in the queue, at least 1
+    explicit SPSCQueue(unsigned int capacity) : slots(std::max(capacity, 1u) + 1) {};
+
+    SPSCQueue(const SPSCQueue &) = delete;
+    SPSCQueue & operator=(const SPSCQueue &) = delete;
+
+    /// \brief Add an item to the back of the queue, only call from the producer thread
+    /// \param item the item to move into the queue, left unchanged if the queue is full
+    /// \returns True if the item was added, False if the queue is full
+    bool try_push(T && item)
+    {
+      const unsigned int t = tail.load(std::memory_order_relaxed);
+      const unsigned int next = increment(t);
+
+      if(next == head.load(std::memory_order_acquire)) return false;
+
+      slots[t] = std::move(item);
+      tail.store(next, std::memory_order_release);
+
+      return true;
+    }
+
+    /// \brief Remove the item at the front of the queue, only call from the consumer thread
+    /// \param item [out] the item moved out of the queue, left unchanged if the queue is empty
+    /// \returns True if an item was removed, False if the queue is empty
+    bool try_pop(T & item)
+    {
+      const unsigned int h = head.load(std::memory_order_relaxed);
+
+      if(h == tail.load(std::memory_order_acquire)) return false;
+
+      item = std::move(slots[h]);
+      head.store(increment(h), std::memory_order_release);
+
+      return true;
+    }
+
+    /// \brief Check if the queue is empty, exact when called from the consumer thread
+    /// \returns True if there are no items in the queue
+    bool empty() const
+    {
+      return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+    /// \brief Get the maximum number of items in the queue
+    /// \returns the capacity of the queue
+    unsigned int capacity() const
+    {
+      return slots.size() - 1;
+    }
+
+  private:
+    std::vector<T> slots; ///< ring buffer with one slot left empty to tell a full queue from an empty one
+
+    alignas(cache_line) std::atomic<unsigned int> head{0}; ///< slot of the next item to pop, written by the consumer
+    alignas(cache_line) std::atomic<unsigned int> tail{0}; ///< slot of the next item to push, written by the producer
+
+    /// \brief Advance a slot index around the ring
+    /// \param i the slot index
+    /// \returns the next slot index
+    unsigned int increment(unsigned int i) const
+    {
+      return (i + 1 == slots.size()) ? 0 : i + 1;
+    }
+  };
+}
+
+#endif //SPSC_QUEUE_INCLUDE_GUARD_HPP
@@ -0,0 +1,97 @@
+#ifndef STATS_INCLUDE_GUARD_HPP
+#define STATS_INCLUDE_GUARD_HPP
+/// \file
+/// \brief Lightweight counters and phase timers for the planners, which compile out of the hot loops when PLANNER_STATS is 0
+
+#include <chrono>
+#include <vector>
+
+/// \def PLANNER_STATS
+/// \brief 1 to count the planner statistics, 0 to leave every count at 0. Set by the PLANNER_STATS CMake option.
+#ifndef PLANNER_STATS
+#define PLANNER_STATS 1
+#endif
+
+#if PLANNER_STATS
+
+/// \def STATS_ADD
+/// \brief Add to a counter of a stats::Stats, compiled out when PLANNER_STATS is 0
+#define STATS_ADD(counter, n) ((counter) += (n))
+
+/// \def STATS_PHASE
+/// \brief Add the wall time until the end of the enclosing scope to a phase of a stats::Stats, compiled out when PLANNER_STATS is 0
+#define STATS_PHASE(target, name) const stats::PhaseTimer phase_timer((target), (name))
+
+#else
+
+#define STATS_ADD(counter, n) ((void)0)
+#define STATS_PHASE(target, name) ((void)0)
+
+#endif
+
+namespace stats
+{
+  /// \brief The accumulated wall time of a named phase of a planner
+  struct Phase
+  {
+    const char * name = ""; ///< name of the phase
+    unsigned long long calls = 0; ///< number of times the phase ran
+    double seconds = 0; ///< total wall time of the phase
+  };
+
+  /// \brief Statistics accumulated by a planner until they are reset. Each planner only fills in the counters that apply to it, the
+  /// rest stay 0. The layout does not depend on PLANNER_STATS, so code built with and without the counters can be mixed.
+  struct Stats
+  {
+    unsigned long long expansions = 0; ///< nodes expanded by a search
+    unsigned long long heap_pushes = 0; ///< insertions and key updates on an open list
+    unsigned long long heap_pops = 0; ///< nodes removed from an open list
+    unsigned long long collision_checks = 0; ///< points and segments checked against the obstacles
+    unsigned long long los_checks = 0; ///< line of sight tests that had to be computed
+    unsigned long long los_cache_hits = 0; ///< line of sight tests answered from a cache
+
+    std::vector<Phase> phases; ///< the wall time of each phase, in the order the phases first ran
+
+    /// \brief Add the wall time of one run of a phase
+    /// \param name the name of the phase, which must outlive the statistics, like a string literal
+    /// \param seconds the wall time of the run
+    void add_time(const char * name, double seconds);
+
+    /// \brief Get the total wall time of a phase
+    /// \param name the name of the phase
+    /// \returns the time in seconds, 0 if the phase never ran
+    double get_time(const char * name) const;
+
+    /// \brief Set every counter and phase back to 0
+    void reset();
+
+    /// \brief Add the statistics of another planner
+    /// \param rhs the statistics to add
+    /// \returns a reference to these statistics
+    Stats & operator+=(const Stats & rhs);
+  };
+
+  /// \brief Time a phase from construction until destruction, the time is added to the statistics when the timer goes out of scope
+  class PhaseTimer
+  {
+  public:
+
+    /// \brief Start timing a phase
+    /// \param target the statistics to add the time to
+    /// \param name the name of the phase, which must outlive the statistics, like a string literal
+    PhaseTimer(Stats & target, const char * name) : target(target), name(name), start(std::chrono::steady_clock::now()) {};
+
+    /// \brief Add the elapsed time to the statistics
+    ~PhaseTimer();
+
+    PhaseTimer(const PhaseTimer &) = delete;
+    PhaseTimer & operator=(const PhaseTimer &) = delete;
+
+  private:
+    Stats & target; ///< the statistics to add the time to
+    const char * name; ///< name of the phase
+    std::chrono::steady_clock::time_point start; ///< when the phase started
+  };
+}
+
+#endif //STATS_INCLUDE_GUARD_HPP
@@ -3,17 +3,22 @@
 /// \file
 /// \brief A library of utility functions for the various nodes and libraries of this package
 
+#include <string>
 #include <vector>
 
 #include <XmlRpcValue.h>
 
+#include "diagnostic_msgs/DiagnosticStatus.h"
+#include "map_msgs/OccupancyGridUpdate.h"
 #include "nav_msgs/OccupancyGrid.h"
+#include "nav_msgs/Path.h"
 
 #include "visualization_msgs/MarkerArray.h"
 #include "visualization_msgs/Marker.h"
 
 #include "roadmap/grid.hpp"
 #include "roadmap/prm.hpp"
+#include "roadmap/stats.hpp"
 #include "rigid2d/rigid2d.hpp"
 
 
@@ -43,6 +48,41 @@ namespace utility
   /// \returns an OccupancyGrid message to publish
   nav_msgs::OccupancyGrid make_grid_msg(grid::Grid *grid, double cell_size, double res);
 
+  /// \brief Patch a grid message in place to match a grid, and describe the patch as an update for subscribers of the message
+  /// \param grid the grid the message was made from
+  /// \param occ_msg [in/out] the message from make_grid_msg, only the changed cells are copied into it
+  /// \param update [out] the smallest rectangle of the message containing every changed cell, left unchanged if no cell changed
+  /// \returns True if any cell changed
+  bool update_grid_msg(const grid::Grid & grid, nav_msgs::OccupancyGrid & occ_msg, map_msgs::OccupancyGridUpdate & update);
+
+  /// \brief Convert an occupancy grid message, like a costmap, into a patch of a grid. Unknown cells (-1) are free by default, which is
+  /// the free space assumption of incremental searches like D* Lite: the path goes through unexplored space and is repaired once the
+  /// space is seen. Treating them as occupied keeps the path inside the known free space instead.
+  /// \param map the occupancy grid message, with the same resolution as the grid
+  /// \param grid the grid the patch will update
+  /// \param patch [out] the patch, with the origin of the message rounded to the nearest cell of the grid
+  /// \param threshold values at or above the threshold become occupied (100), lower values become free (0)
+  /// \param unknown_occupied true to make unknown values occupied (100), otherwise they become free (0)
+  /// \returns True if the resolutions match, otherwise False and the patch is unchanged
+  bool make_patch(const nav_msgs::OccupancyGrid & map, const grid::Grid & grid, grid::OccupancyPatch & patch, signed char threshold=50,
+                  bool unknown_occupied=false);
+
+  /// \brief Convert an update of an occupancy grid message, like a costmap update, into a patch of a grid. Unknown cells follow the same
+  /// policy as the patch of the full message.
+  /// \param update the update message, with its offsets in cells of the occupancy grid it updates
+  /// \param x_offset the x grid coordinate of the lower left cell of the occupancy grid, the x of its patch from make_patch
+  /// \param y_offset the y grid coordinate of the lower left cell of the occupancy grid, the y of its patch from make_patch
+  /// \param threshold values at or above the threshold become occupied (100), lower values become free (0)
+  /// \param unknown_occupied true to make unknown values occupied (100), otherwise they become free (0)
+  /// \returns the patch
+  grid::OccupancyPatch make_patch(const map_msgs::OccupancyGridUpdate & update, int x_offset, int y_offset, signed char threshold=50,
+                                  bool unknown_occupied=false);
+
+  /// \brief Consruct a path message for a planned path, so controllers can track it
+  /// \param path the verticies of the path in the order to drive them
+  /// \returns a Path message in the map frame to publish
+  nav_msgs::Path make_path_msg(const std::vector<rigid2d::Vector2D> & path);
+
   /// \brief Create a Cube Marker based on a point
   /// \param robot an x,y location of a robot
   /// \param scale the amount to scale the preset marker size (should be graph cell size)
@@ -80,6 +120,61 @@ namespace utility
   /// \param ns the namespace of the line segment, defaults to "Path"
   /// \returns a marker to add to the MarkerArray
   visualization_msgs::Marker make_marker(rigid2d::Vector2D pt1, rigid2d::Vector2D pt2, int marker_id, double scale, std::vector<double> color, std::string ns="Path");
+
+  /// \brief Create a single Sphere List Marker for many nodes, so a road map is drawn with one marker instead of one per node
+  /// \param nodes the nodes to vizualize
+  /// \param scale the amount to scale the preset marker size (should be graph cell size)
+  /// \param color the r,g,b color values in a vector
+  /// \param ns the namespace of the marker, defaults to "Node List"
+  /// \returns a marker to add to the MarkerArray
+  visualization_msgs::Marker make_marker(const std::vector<prm::Node> & nodes, double scale, std::vector<double> color, std::string ns="Node List");
+
+  /// \brief Create a single Line List Marker for many edges, so a road map is drawn with one marker instead of one per edge
+  /// \param edges the edges to vizualize
+  /// \param scale the amount to scale the preset marker size (should be graph cell size)
+  /// \param color the r,g,b color values in a vector
+  /// \param ns the namespace of the marker, defaults to "Edge List"
+  /// \returns a marker to add to the MarkerArray
+  visualization_msgs::Marker make_marker(const std::vector<prm::Edge> & edges, double scale, std::vector<double> color, std::string ns="Edge List");
+
+  /// \brief Create a single Line Strip Marker through the verticies of a path, instead of one line Marker per segment
+  /// \param path the verticies of the path in order
+  /// \param marker_id a unique id for the marker
+  /// \param scale the amount to scale the preset marker size (should be graph cell size)
+  /// \param color the r,g,b color values in a vector
+  /// \param ns the namespace of the path, defaults to "Path"
+  /// \returns a marker to add to the MarkerArray, which draws nothing for a path with less than 2 verticies
+  visualization_msgs::Marker make_path_marker(const std::vector<rigid2d::Vector2D> & path, int marker_id, double scale, std::vector<double> color, std::string ns="Path");
+
+  /// \brief Load a grid from the map cache, or build it and add it to the cache. A cache file that can not be written is skipped, so
+  /// the grid is built again on the next launch.
+  /// \param grid the grid to load or build
+  /// \param cache_dir the directory of the map cache, empty to always build the grid
+  /// \param cell_size the cell_size of build_grid
+  /// \param grid_res the grid_res of build_grid
+  /// \param robot_radius the robot_radius of build_grid
+  /// \param threads the threads of build_grid
+  /// \returns True if the grid was loaded from the cache, False if it was built
+  bool load_or_build(grid::Grid & grid, const std::string & cache_dir, double cell_size, unsigned int grid_res, double robot_radius,
+                     unsigned int threads);
+
+  /// \brief Load a road map from the map cache, or build it and add it to the cache. A cache file that can not be written is skipped,
+  /// so the road map is built again on the next launch.
+  /// \param road_map the road map to load or build, with the seed and lazy setting already set
+  /// \param cache_dir the directory of the map cache, empty to always build the road map
+  /// \param samples the samples of build_map
+  /// \param k_neighbors the k_neighbors of build_map
+  /// \param robot_radius the robot_radius of build_map
+  /// \param threads the threads of build_map
+  /// \returns True if the road map was loaded from the cache, False if it was built
+  bool load_or_build(prm::RoadMap & road_map, const std::string & cache_dir, unsigned int samples, unsigned int k_neighbors,
+                     double robot_radius, unsigned int threads);
+
+  /// \brief Construct a diagnostic status reporting the statistics of a planner
+  /// \param name the name of the planner
+  /// \param planner_stats the statistics of the planner
+  /// \returns a status with a key value pair for each counter, and the calls and milliseconds of each phase
+  diagnostic_msgs::DiagnosticStatus make_diagnostic_msg(const std::string & name, const stats::Stats & planner_stats);
 }
 
 #endif // UTILITY_INCLUDE_GAURD_HPP
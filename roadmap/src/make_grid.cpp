@@ -8,10 +8,13 @@
 ///     robot_radius (double) buffer radius to avoid collisions with the robot body
 ///     cell_size (double) scaling factor for the map
 ///     grid_res (double) scaling factor for the grid cell size
+///     build_threads (unsigned int) number of threads used to build the grid, 0 uses all cores
+///     map_cache_dir (std::string) directory of the binary map cache, empty to build the maps on every launch
 /// PUBLISHES:
 ///     /visualization_marker_array (visualization_msgs::MarkerArray) markers
 ///     /grid_map (nav_msgs::OccupancyGrid) occupancy data
 
+#include <string>
 #include <vector>
 #include <algorithm>
 #include <XmlRpcValue.h>
@@ -39,6 +42,8 @@ int main(int argc, char** argv)
   XmlRpc::XmlRpcValue obstacles;
   double robot_radius = 0.0;
   int grid_res = 1;
+  int build_threads = 1;
+  std::string map_cache_dir;
   std::vector<double> r, g, b;
   double cell_size = 1.0;
 
@@ -48,6 +53,8 @@ int main(int argc, char** argv)
   n.getParam("robot_radius", robot_radius);
   n.getParam("cell_size", cell_size);
   n.getParam("grid_res", grid_res);
+  n.getParam("build_threads", build_threads);
+  n.getParam("map_cache_dir", map_cache_dir);
   n.getParam("r", r);
   n.getParam("g", g);
   n.getParam("b", b);
@@ -80,7 +87,10 @@ int main(int argc, char** argv)
   // Initialize Grid
   grid::Grid grid_world(polygons, map_x_lims, map_y_lims);
 
-  grid_world.build_grid(cell_size, grid_res, robot_radius);
+  if(utility::load_or_build(grid_world, map_cache_dir, cell_size, grid_res, robot_radius, build_threads))
+  {
+    ROS_INFO_STREAM("GRID: Loaded the grid from the map cache in " << map_cache_dir);
+  }
 
   auto occ_msg = utility::make_grid_msg(&grid_world, cell_size, grid_res);
   pub_map.publish(occ_msg);
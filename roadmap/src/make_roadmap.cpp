@@ -8,12 +8,16 @@
 ///     robot_radius (double) buffer radius to avoid collisions with the robot body
 ///     k_nearest (unsigned int) number of neighboring verticies to match to
 ///     graph_size (unsigned int) number of nodes to use to build the graph
+///     build_threads (unsigned int) number of threads used to build the graph, 0 uses all cores
+///     prm_seed (int) seed for sampling the graph, -1 for a random seed
+///     map_cache_dir (std::string) directory of the binary map cache, empty to build the road map on every launch
 ///     r (std::vector<int>) color values
 ///     g (std::vector<int>) color values
 ///     b (std::vector<int>) color values
 /// PUBLISHES:
 ///     /visualization_marker_array (visualization_msgs::MarkerArray) markers
 
+#include <string>
 #include <vector>
 #include <XmlRpcValue.h>
 
@@ -43,6 +47,9 @@ int main(int argc, char** argv)
   double robot_radius = 0.0;
   int k_nearest = 5;
   int graph_size = 100;
+  int build_threads = 1;
+  int prm_seed = -1;
+  std::string map_cache_dir;
 
   n.getParam("obstacles", obstacles);
   n.getParam("map_x_lims", map_x_lims);
@@ -50,6 +57,9 @@ int main(int argc, char** argv)
   n.getParam("robot_radius", robot_radius);
   n.getParam("k_nearest", k_nearest);
   n.getParam("graph_size", graph_size);
+  n.getParam("build_threads", build_threads);
+  n.getParam("prm_seed", prm_seed);
+  n.getParam("map_cache_dir", map_cache_dir);
   n.getParam("cell_size", cell_size);
   n.getParam("r", r);
   n.getParam("g", g);
@@ -89,7 +99,19 @@ int main(int argc, char** argv)
 
   prm::RoadMap prob_road_map(polygons, map_x_lims, map_y_lims);
 
-  prob_road_map.build_map(graph_size, k_nearest, robot_radius);
+  if(prm_seed >= 0) prob_road_map.set_seed(prm_seed);
+
+  // a road map without a seed is different every launch, so there is nothing to cache
+  if(prm_seed < 0 && !map_cache_dir.empty())
+  {
+    ROS_WARN_STREAM("PRM: The map cache needs a prm_seed >= 0, building a random road map.");
+    map_cache_dir.clear();
+  }
+
+  if(utility::load_or_build(prob_road_map, map_cache_dir, graph_size, k_nearest, robot_radius, build_threads))
+  {
+    ROS_INFO_STREAM("PRM: Loaded the road map from the map cache in " << map_cache_dir);
+  }
 
   const auto all_nodes = prob_road_map.get_nodes();
   const auto all_edges = prob_road_map.get_edges();
@@ -97,17 +119,11 @@ int main(int argc, char** argv)
   std::vector<visualization_msgs::Marker> markers;
   visualization_msgs::MarkerArray pub_marks;
 
-  // Put a spherical marker at each node
-  for(auto node : all_nodes)
-  {
-    markers.push_back(utility::make_marker(node, cell_size, colors.at(0)));
-  }
+  // Put a spherical marker at each node, all in one marker
+  markers.push_back(utility::make_marker(all_nodes, cell_size, colors.at(0)));
 
-  // Draw a line to show all connections.
-  for(auto edge : all_edges)
-  {
-    markers.push_back(utility::make_marker(edge, cell_size, colors.at(2)));
-  }
+  // Draw a line to show all connections, all in one marker
+  markers.push_back(utility::make_marker(all_edges, cell_size, colors.at(2)));
 
   pub_marks.markers = markers;
   pub_markers.publish(pub_marks);
@@ -3,7 +3,6 @@
 
 #include <algorithm>
 #include <functional>
-#include <iostream>
 #include <vector>
 
 #include "roadmap/collision.hpp"
@@ -25,7 +24,7 @@ namespace collision
     point = p;
   }
 
-  DistRes point_to_line_distance(rigid2d::Vector2D line_start, rigid2d::Vector2D line_end, rigid2d::Vector2D point)
+  DistRes point_to_line_distance(const rigid2d::Vector2D & line_start, const rigid2d::Vector2D & line_end, const rigid2d::Vector2D & point)
   {
     // edge vector
     rigid2d::Vector2D s = rigid2d::Vector2D(line_end.x - line_start.x, line_end.y - line_start.y);
@@ -54,7 +53,7 @@ namespace collision
     }
   }
 
-  bool point_to_line_distance(rigid2d::Vector2D line_start, rigid2d::Vector2D line_end, rigid2d::Vector2D point, double threshold)
+  bool point_to_line_distance(const rigid2d::Vector2D & line_start, const rigid2d::Vector2D & line_end, const rigid2d::Vector2D & point, double threshold)
   {
 
     auto dist = point_to_line_distance(line_start, line_end, point);
@@ -63,7 +62,7 @@ namespace collision
     return dist.distance <= threshold ;
   }
 
-  std::vector<bool> point_inside_convex(rigid2d::Vector2D point, std::vector<rigid2d::Vector2D> polygon, double buffer_radius)
+  std::vector<bool> point_inside_convex(const rigid2d::Vector2D & point, const std::vector<rigid2d::Vector2D> & polygon, double buffer_radius)
   {
     unsigned int left = 0, right = 0;
     unsigned int poly_size = polygon.size();
@@ -72,8 +71,6 @@ namespace collision
 
     double min_dist = 10000.0;
 
-    polygon.push_back(polygon.at(0)); // add the first vertex to the end of the list
-
     // first element is the collision information, second is the cause.
     std::vector<bool> output = {true, true};
 
@@ -81,10 +78,10 @@ namespace collision
     for(unsigned int i = 0; i < poly_size; i++)
     {
       // Vertex A
-      rigid2d::Vector2D a = polygon.at(i);
+      const rigid2d::Vector2D & a = polygon.at(i);
 
-      // Vertex B
-      rigid2d::Vector2D b = polygon.at(i+1);
+      // Vertex B, the last vertex connects back to the first
+      const rigid2d::Vector2D & b = polygon.at((i+1) % poly_size);
 
       // Get direction of perpendicular vector pointing inward to the polygon
       rigid2d::Vector2D u = rigid2d::Vector2D(-(b.y - a.y), b.x - a.x);
@@ -102,7 +99,6 @@ namespace collision
       else if(r < 0) left++;
       else if(r == 0 && calc_distance.inside_segment) // the point is on the line
       {
-        // std::cout << "Point is on the line. \n";
         quit_early = true;
         break;
       }
@@ -114,12 +110,10 @@ namespace collision
     {
         if(min_dist > buffer_radius)
         {
-          // std::cout << "Point is OUTSIDE of the shape and OUTSIDE the buffer.\n";
           output.at(0) = false;
         }
         else
         {
-          // std::cout << "Point is OUTSIDE of the shape but INSIDE the buffer. \n";
           output.at(0) = true;
           output.at(1) = false;
         }
@@ -128,21 +122,20 @@ namespace collision
     return output;
   }
 
-  bool line_shape_intersection(rigid2d::Vector2D line_start, rigid2d::Vector2D line_end, std::vector<rigid2d::Vector2D> polygon)
+  bool line_shape_intersection(const rigid2d::Vector2D & line_start, const rigid2d::Vector2D & line_end, const std::vector<rigid2d::Vector2D> & polygon)
   {
-    polygon.push_back(polygon.at(0)); // add the first vertex to the end of the list
     bool collides = true;
 
     double t_e = 0.0, t_l = 1.0;
 
     // Loop through each line segment
-    for(unsigned int i = 0; i < polygon.size()-1; i++)
+    for(unsigned int i = 0; i < polygon.size(); i++)
     {
       // Vertex A
-      rigid2d::Vector2D a = polygon.at(i);
+      const rigid2d::Vector2D & a = polygon.at(i);
 
-      // Vertex B
-      rigid2d::Vector2D b = polygon.at(i+1);
+      // Vertex B, the last vertex connects back to the first
+      const rigid2d::Vector2D & b = polygon.at((i+1) % polygon.size());
 
       // Get perpendicular vector pointing outward to the polygon
       rigid2d::Vector2D u = rigid2d::Vector2D(b.y - a.y, -(b.x - a.x));
@@ -174,9 +167,8 @@ namespace collision
     return collides;
   }
 
-  bool line_shape_intersection(rigid2d::Vector2D line_start, rigid2d::Vector2D line_end, std::vector<rigid2d::Vector2D> polygon, double buffer_radius)
+  bool line_shape_intersection(const rigid2d::Vector2D & line_start, const rigid2d::Vector2D & line_end, const std::vector<rigid2d::Vector2D> & polygon, double buffer_radius)
   {
-    polygon.push_back(polygon.at(0)); // add the first vertex to the end of the list
     bool collides = true;
 
     bool intsec_test = true;
@@ -184,13 +176,13 @@ namespace collision
     double t_e = 0.0, t_l = 1.0;
 
     // Loop through each line segment
-    for(unsigned int i = 0; i < polygon.size()-1; i++)
+    for(unsigned int i = 0; i < polygon.size(); i++)
     {
       // Vertex A
-      rigid2d::Vector2D a = polygon.at(i);
+      const rigid2d::Vector2D & a = polygon.at(i);
 
-      // Vertex B
-      rigid2d::Vector2D b = polygon.at(i+1);
+      // Vertex B, the last vertex connects back to the first
+      const rigid2d::Vector2D & b = polygon.at((i+1) % polygon.size());
 
       // Get perpendicular vector pointing outward to the polygon
       rigid2d::Vector2D u = rigid2d::Vector2D(b.y - a.y, -(b.x - a.x));
@@ -0,0 +1,704 @@
+/// \file
+/// \brief A library to check points and line segments against a fixed set of obstacles
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "roadmap/collision.hpp"
+#include "roadmap/collision_world.hpp"
+#include "rigid2d/rigid2d.hpp"
+
+namespace collision
+{
+  /// \brief The maximum number of buckets along each side of the bucket grid
+  static constexpr int max_buckets = 256;
+
+  /// \brief The number of queries tested together by the batch functions
+  static constexpr int batch_block = 256;
+
+  /// \brief Extra margin on the inflated bounds, so rounding at the edge of a buffer zone never skips a shape
+  static constexpr double bounds_slack = 1e-6;
+
+  /// \brief The farthest line_shape_intersection lets a segment lie outside of an edge parallel to it. The segment vector
+  /// is shifted by 1/1000 of the end point, which moves the edge out by at most that shift along its normal.
+  /// \param end_x the x coordinate of the segment end
+  /// \param end_y the y coordinate of the segment end
+  /// \returns an upper bound of the distance
+  static double shift_tolerance(double end_x, double end_y)
+  {
+    return (std::abs(end_x) + std::abs(end_y)) / 1000.0;
+  }
+
+  /// \brief Check if a segment lies on a line through the origin. The shift of line_shape_intersection is then along the
+  /// segment, so an edge parallel to the segment no longer bounds it and the segment can collide from any distance.
+  /// \param x0 the x coordinate of the segment start
+  /// \param y0 the y coordinate of the segment start
+  /// \param x1 the x coordinate of the segment end
+  /// \param y1 the y coordinate of the segment end
+  /// \returns True if the broad phase has to be skipped for the segment
+  static bool through_origin(double x0, double y0, double x1, double y1)
+  {
+    return std::abs(x0 * y1 - y0 * x1) <= 1e-9 * (x0 * x0 + y0 * y0 + x1 * x1 + y1 * y1);
+  }
+
+  CollisionWorld::CollisionWorld(const std::vector<std::vector<rigid2d::Vector2D>> & polygons, double buffer_radius)
+  {
+    this->buffer_radius = buffer_radius;
+
+    double mean_size = 0;
+
+    // Precompute the normals and inflated bounds of each polygon
+    for(const auto & polygon : polygons)
+    {
+      if(polygon.empty()) continue;
+
+      Shape shape;
+      shape.verticies = polygon;
+
+      shape.x_min = shape.x_max = polygon.at(0).x;
+      shape.y_min = shape.y_max = polygon.at(0).y;
+
+      for(unsigned int i = 0; i < polygon.size(); i++)
+      {
+        const auto & a = polygon.at(i);
+        const auto & b = polygon.at((i + 1) % polygon.size());
+
+        // perpendicular vector pointing inward to the polygon
+        shape.normals.push_back(rigid2d::Vector2D(-(b.y - a.y), b.x - a.x).normalize());
+
+        Edge edge;
+        edge.ax = a.x;
+        edge.ay = a.y;
+        edge.bx = b.x;
+        edge.by = b.y;
+        edge.dx = b.x - a.x;
+        edge.dy = b.y - a.y;
+
+        const double len = rigid2d::Vector2D(edge.dx, edge.dy).length();
+
+        // a repeated vertex does not constrain the side tests and is handled as a point by the distance tests
+        if(len > 0)
+        {
+          edge.nx = shape.normals.back().x;
+          edge.ny = shape.normals.back().y;
+          edge.len2 = len * len;
+        }
+
+        shape.edges.push_back(edge);
+
+        shape.x_min = std::min(shape.x_min, a.x);
+        shape.x_max = std::max(shape.x_max, a.x);
+        shape.y_min = std::min(shape.y_min, a.y);
+        shape.y_max = std::max(shape.y_max, a.y);
+      }
+
+      shape.x_min -= buffer_radius + bounds_slack;
+      shape.x_max += buffer_radius + bounds_slack;
+      shape.y_min -= buffer_radius + bounds_slack;
+      shape.y_max += buffer_radius + bounds_slack;
+
+      // Moving an edge out also moves its ends along the neighboring edges, which is farther than the move itself
+      // next to an acute corner
+      std::vector<rigid2d::Vector2D> sides;
+      for(const auto & edge : shape.edges)
+      {
+        if(edge.len2 > 0) sides.push_back(rigid2d::Vector2D(edge.dx, edge.dy).normalize());
+      }
+
+      for(unsigned int i = 0; i < sides.size(); i++)
+      {
+        const auto & u = sides.at(i);
+        const auto & v = sides.at((i + 1) % sides.size());
+
+        const double sin_angle = std::abs(u.x * v.y - u.y * v.x);
+        if(-u.dot(v) > 0 && sin_angle > 0) shape.reach = std::max(shape.reach, 1.0 / sin_angle);
+      }
+
+      max_reach = std::max(max_reach, shape.reach);
+
+      mean_size += std::max(shape.x_max - shape.x_min, shape.y_max - shape.y_min);
+
+      shapes.push_back(shape);
+    }
+
+    if(shapes.empty()) return;
+
+    // Size the buckets to match the average obstacle and cover the bounds of every obstacle
+    origin_x = shapes.at(0).x_min;
+    origin_y = shapes.at(0).y_min;
+    double far_x = shapes.at(0).x_max, far_y = shapes.at(0).y_max;
+
+    for(const auto & shape : shapes)
+    {
+      origin_x = std::min(origin_x, shape.x_min);
+      origin_y = std::min(origin_y, shape.y_min);
+      far_x = std::max(far_x, shape.x_max);
+      far_y = std::max(far_y, shape.y_max);
+    }
+
+    cell = std::max({mean_size / shapes.size(), (far_x - origin_x) / max_buckets, (far_y - origin_y) / max_buckets, 1e-6});
+
+    n_cols = std::max(1, static_cast<int>(std::ceil((far_x - origin_x) / cell)));
+    n_rows = std::max(1, static_cast<int>(std::ceil((far_y - origin_y) / cell)));
+
+    buckets.resize(n_cols * n_rows);
+
+    // Add each shape to every bucket its inflated bounds overlap
+    for(unsigned int s = 0; s < shapes.size(); s++)
+    {
+      const auto & shape = shapes.at(s);
+
+      const int c_lo = std::min(n_cols - 1, static_cast<int>((shape.x_min - origin_x) / cell));
+      const int c_hi = std::min(n_cols - 1, static_cast<int>((shape.x_max - origin_x) / cell));
+      const int r_lo = std::min(n_rows - 1, static_cast<int>((shape.y_min - origin_y) / cell));
+      const int r_hi = std::min(n_rows - 1, static_cast<int>((shape.y_max - origin_y) / cell));
+
+      for(int r = r_lo; r <= r_hi; r++)
+      {
+        for(int c = c_lo; c <= c_hi; c++)
+        {
+          buckets.at(r * n_cols + c).push_back(s);
+        }
+      }
+    }
+  }
+
+  int CollisionWorld::size() const
+  {
+    return shapes.size();
+  }
+
+  double CollisionWorld::buffer() const
+  {
+    return buffer_radius;
+  }
+
+  std::vector<bool> CollisionWorld::point_inside(const rigid2d::Vector2D & point) const
+  {
+    // first element is the collision information, second is the cause.
+    std::vector<bool> output = {false, true};
+
+    for(const auto s : candidates(point.x, point.x, point.y, point.y))
+    {
+      const auto & shape = shapes[s];
+
+      // the point is outside of the inflated bounds, so it is too far away to collide
+      if(point.x < shape.x_min || point.x > shape.x_max || point.y < shape.y_min || point.y > shape.y_max) continue;
+
+      const auto result = shape_point(shape, point);
+
+      if(result.at(0) && result.at(1)) return result; // inside an obstacle
+      else if(result.at(0)) output = result; // in a buffer zone, but could still be inside another obstacle
+    }
+
+    return output;
+  }
+
+  bool CollisionWorld::point_collides(const rigid2d::Vector2D & point) const
+  {
+    return point_inside(point).at(0);
+  }
+
+  bool CollisionWorld::segment_collides(const rigid2d::Vector2D & line_start, const rigid2d::Vector2D & line_end) const
+  {
+    if(through_origin(line_start.x, line_start.y, line_end.x, line_end.y))
+    {
+      for(const auto & shape : shapes)
+      {
+        if(shape_segment(shape, line_start, line_end)) return true;
+      }
+
+      return false;
+    }
+
+    const double x_lo = std::min(line_start.x, line_end.x), x_hi = std::max(line_start.x, line_end.x);
+    const double y_lo = std::min(line_start.y, line_end.y), y_hi = std::max(line_start.y, line_end.y);
+
+    // a segment parallel to an edge can collide from just outside of the inflated bounds
+    const double tolerance = shift_tolerance(line_end.x, line_end.y);
+    const double m = tolerance * max_reach;
+
+    for(const auto s : candidates(x_lo - m, x_hi + m, y_lo - m, y_hi + m))
+    {
+      const auto & shape = shapes[s];
+      const double margin = tolerance * shape.reach;
+
+      // the bounding box of the segment does not reach the inflated bounds
+      if(x_hi < shape.x_min - margin || x_lo > shape.x_max + margin || y_hi < shape.y_min - margin || y_lo > shape.y_max + margin) continue;
+
+      if(shape_segment(shape, line_start, line_end)) return true;
+    }
+
+    return false;
+  }
+
+  void CollisionWorld::classify_points(const double * xs, const double * ys, int n, unsigned char * status) const
+  {
+    std::fill(status, status + n, free_space);
+
+    for(int start = 0; start < n; start += batch_block)
+    {
+      const int cnt = std::min(batch_block, n - start);
+
+      // bounding box of the block
+      const auto x_range = std::minmax_element(xs + start, xs + start + cnt);
+      const auto y_range = std::minmax_element(ys + start, ys + start + cnt);
+
+      for(const auto & shape : shapes)
+      {
+        if(*x_range.second < shape.x_min || *x_range.first > shape.x_max || *y_range.second < shape.y_min || *y_range.first > shape.y_max) continue;
+
+        shape_points(shape, xs + start, ys + start, cnt, status + start);
+      }
+    }
+  }
+
+  void CollisionWorld::classify_points(const std::vector<rigid2d::Vector2D> & points, std::vector<unsigned char> & status) const
+  {
+    status.resize(points.size());
+
+    double xs[batch_block], ys[batch_block];
+
+    for(unsigned int start = 0; start < points.size(); start += batch_block)
+    {
+      const int cnt = std::min<int>(batch_block, points.size() - start);
+
+      for(int i = 0; i < cnt; i++)
+      {
+        xs[i] = points[start + i].x;
+        ys[i] = points[start + i].y;
+      }
+
+      classify_points(xs, ys, cnt, status.data() + start);
+    }
+  }
+
+  void CollisionWorld::segments_collide(const double * x0, const double * y0, const double * x1, const double * y1, int n, unsigned char * collides) const
+  {
+    std::fill(collides, collides + n, 0);
+
+    for(int start = 0; start < n; start += batch_block)
+    {
+      const int cnt = std::min(batch_block, n - start);
+
+      // bounding box of the block
+      const auto x0_range = std::minmax_element(x0 + start, x0 + start + cnt);
+      const auto x1_range = std::minmax_element(x1 + start, x1 + start + cnt);
+      const auto y0_range = std::minmax_element(y0 + start, y0 + start + cnt);
+      const auto y1_range = std::minmax_element(y1 + start, y1 + start + cnt);
+
+      const double x_lo = std::min(*x0_range.first, *x1_range.first), x_hi = std::max(*x0_range.second, *x1_range.second);
+      const double y_lo = std::min(*y0_range.first, *y1_range.first), y_hi = std::max(*y0_range.second, *y1_range.second);
+
+      // the largest shift of a segment parallel to an edge in the block, see segment_collides
+      double tolerance = 0;
+      bool unbounded = false;
+
+      for(int i = start; i < start + cnt; i++)
+      {
+        tolerance = std::max(tolerance, shift_tolerance(x1[i], y1[i]));
+        unbounded = unbounded || through_origin(x0[i], y0[i], x1[i], y1[i]);
+      }
+
+      for(const auto & shape : shapes)
+      {
+        const double margin = tolerance * shape.reach;
+
+        if(!unbounded && (x_hi < shape.x_min - margin || x_lo > shape.x_max + margin || y_hi < shape.y_min - margin || y_lo > shape.y_max + margin)) continue;
+
+        shape_segments(shape, x0 + start, y0 + start, x1 + start, y1 + start, cnt, collides + start);
+      }
+    }
+  }
+
+  void CollisionWorld::segments_collide(const std::vector<rigid2d::Vector2D> & line_starts, const std::vector<rigid2d::Vector2D> & line_ends, std::vector<unsigned char> & collides) const
+  {
+    collides.resize(line_starts.size());
+
+    double x0[batch_block], y0[batch_block], x1[batch_block], y1[batch_block];
+
+    for(unsigned int start = 0; start < line_starts.size(); start += batch_block)
+    {
+      const int cnt = std::min<int>(batch_block, line_starts.size() - start);
+
+      for(int i = 0; i < cnt; i++)
+      {
+        x0[i] = line_starts[start + i].x;
+        y0[i] = line_starts[start + i].y;
+        x1[i] = line_ends[start + i].x;
+        y1[i] = line_ends[start + i].y;
+      }
+
+      segments_collide(x0, y0, x1, y1, cnt, collides.data() + start);
+    }
+  }
+
+  // Private Functions =========================================================
+
+  std::vector<int> CollisionWorld::candidates(double x_lo, double x_hi, double y_lo, double y_hi) const
+  {
+    std::vector<int> output;
+
+    if(buckets.empty()) return output;
+
+    // the box does not overlap the bucket grid
+    if(x_hi < origin_x || y_hi < origin_y || x_lo > origin_x + n_cols * cell || y_lo > origin_y + n_rows * cell) return output;
+
+    // a box touching the upper bound of the grid falls one past the last bucket
+    const int c_lo = std::clamp(static_cast<int>(std::floor((x_lo - origin_x) / cell)), 0, n_cols - 1);
+    const int c_hi = std::clamp(static_cast<int>(std::floor((x_hi - origin_x) / cell)), 0, n_cols - 1);
+    const int r_lo = std::clamp(static_cast<int>(std::floor((y_lo - origin_y) / cell)), 0, n_rows - 1);
+    const int r_hi = std::clamp(static_cast<int>(std::floor((y_hi - origin_y) / cell)), 0, n_rows - 1);
+
+    for(int r = r_lo; r <= r_hi; r++)
+    {
+      for(int c = c_lo; c <= c_hi; c++)
+      {
+        const auto & bucket = buckets[r * n_cols + c];
+        output.insert(output.end(), bucket.begin(), bucket.end());
+      }
+    }
+
+    // a shape can overlap more than one of the buckets
+    if(r_lo != r_hi || c_lo != c_hi)
+    {
+      std::sort(output.begin(), output.end());
+      output.erase(std::unique(output.begin(), output.end()), output.end());
+    }
+
+    return output;
+  }
+
+  std::vector<bool> CollisionWorld::shape_point(const Shape & shape, const rigid2d::Vector2D & point) const
+  {
+    const unsigned int poly_size = shape.verticies.size();
+    unsigned int left = 0, right = 0;
+
+    // first element is the collision information, second is the cause.
+    std::vector<bool> output = {true, true};
+
+    // Loop through each edge and determine which side the point is on
+    for(unsigned int i = 0; i < poly_size; i++)
+    {
+      const auto & a = shape.verticies[i];
+      const auto & n = shape.normals[i];
+
+      // Dot product of the inward normal and the vector from vertex A to point
+      const double r = (point.x - a.x) * n.x + (point.y - a.y) * n.y;
+
+      if(r > 0) right++;
+      else if(r < 0) left++;
+      else if(point_to_line_distance(a, shape.verticies[(i + 1) % poly_size], point).inside_segment) return output; // the point is on the line
+    }
+
+    if(left < poly_size && right < poly_size) // this means the point is outside the shape
+    {
+      double min_dist = 10000.0;
+
+      for(unsigned int i = 0; i < poly_size; i++)
+      {
+        min_dist = std::min(point_to_line_distance(shape.verticies[i], shape.verticies[(i + 1) % poly_size], point).distance, min_dist);
+      }
+
+      if(min_dist > buffer_radius) output.at(0) = false;
+      else output.at(1) = false;
+    }
+
+    return output;
+  }
+
+  bool CollisionWorld::shape_segment(const Shape & shape, const rigid2d::Vector2D & line_start, const rigid2d::Vector2D & line_end) const
+  {
+    bool collides = true;
+    bool intsec_test = true;
+
+    double t_e = 0.0, t_l = 1.0;
+
+    for(unsigned int i = 0; i < shape.verticies.size(); i++)
+    {
+      const auto & a = shape.verticies[i];
+
+      // perpendicular vector pointing outward to the polygon
+      const rigid2d::Vector2D n(-shape.normals[i].x, -shape.normals[i].y);
+
+      // edge vector
+      rigid2d::Vector2D s = rigid2d::Vector2D(line_end.x - line_start.x, line_end.y - line_start.y);
+
+      // vector between edge and obstalce line starts
+      const rigid2d::Vector2D p0_vi = rigid2d::Vector2D(line_start.x - a.x, line_start.y - a.y);
+
+      const double num = - n.dot(p0_vi);
+      double den = n.dot(s);
+
+      if(den == 0)  // Test for paralellism between the edge and obstacle line segment
+      {
+        // Shift the s vector slightly to break parallelism
+        s += rigid2d::Vector2D(line_end.x/1000.0, line_end.y/1000.0);
+        den = n.dot(s);
+      }
+
+      const double t = num/den;
+
+      if(den < 0) {t_e = std::max(t_e, t);} // segment is potentially entering the polygon
+      else {t_l = std::min(t_l, t);} // segment is potentially leaving the polygon
+
+      if(t_l < t_e && intsec_test) // means the edge cannot intersect a convex polygon
+      {
+        collides = false;
+        intsec_test = false;
+      }
+
+      // check the line enters the buffer radius
+      if(point_to_line_distance(line_start, line_end, a, buffer_radius)) return true;
+    }
+
+    return collides;
+  }
+
+  void CollisionWorld::shape_points(const Shape & shape, const double * xs, const double * ys, int n, unsigned char * status) const
+  {
+    int i = 0;
+
+#if defined(__SSE2__)
+    // test two points at a time
+    const __m128d zero = _mm_setzero_pd(), one = _mm_set1_pd(1.0), buffer = _mm_set1_pd(buffer_radius);
+    const __m128d all = _mm_castsi128_pd(_mm_set1_epi32(-1)), far = _mm_set1_pd(10000.0 * 10000.0);
+
+    for(; i + 1 < n; i += 2)
+    {
+      const __m128d px = _mm_loadu_pd(xs + i), py = _mm_loadu_pd(ys + i);
+
+      // only the points inside the inflated bounds can collide
+      const __m128d bounds = _mm_and_pd(_mm_and_pd(_mm_cmpge_pd(px, _mm_set1_pd(shape.x_min)), _mm_cmple_pd(px, _mm_set1_pd(shape.x_max))),
+                                        _mm_and_pd(_mm_cmpge_pd(py, _mm_set1_pd(shape.y_min)), _mm_cmple_pd(py, _mm_set1_pd(shape.y_max))));
+
+      if(_mm_movemask_pd(bounds) == 0) continue;
+
+      __m128d right = all, left = all, on_line = _mm_setzero_pd(), min_d2 = far;
+
+      for(const auto & e : shape.edges)
+      {
+        const __m128d ax = _mm_set1_pd(e.ax), ay = _mm_set1_pd(e.ay), dx = _mm_set1_pd(e.dx), dy = _mm_set1_pd(e.dy);
+        const __m128d rx = _mm_sub_pd(px, ax), ry = _mm_sub_pd(py, ay);
+
+        // side of the edge the point is on, a point on the edge is inside
+        const __m128d r = _mm_add_pd(_mm_mul_pd(rx, _mm_set1_pd(e.nx)), _mm_mul_pd(ry, _mm_set1_pd(e.ny)));
+        right = _mm_and_pd(right, _mm_cmpgt_pd(r, zero));
+        left = _mm_and_pd(left, _mm_cmplt_pd(r, zero));
+
+        // projection onto the edge, not a number for a degenerate edge
+        const __m128d c = _mm_div_pd(_mm_add_pd(_mm_mul_pd(rx, dx), _mm_mul_pd(ry, dy)), _mm_set1_pd(e.len2));
+        const __m128d within = _mm_and_pd(_mm_cmpge_pd(c, zero), _mm_cmple_pd(c, one));
+
+        on_line = _mm_or_pd(on_line, _mm_and_pd(within, _mm_cmpeq_pd(r, zero)));
+
+        // squared distance to the projection, or to the closest vertex
+        const __m128d ex = _mm_sub_pd(_mm_add_pd(ax, _mm_mul_pd(c, dx)), px), ey = _mm_sub_pd(_mm_add_pd(ay, _mm_mul_pd(c, dy)), py);
+        const __m128d fx = _mm_sub_pd(px, _mm_set1_pd(e.bx)), fy = _mm_sub_pd(py, _mm_set1_pd(e.by));
+
+        const __m128d d_line = _mm_add_pd(_mm_mul_pd(ex, ex), _mm_mul_pd(ey, ey));
+        const __m128d d_end = _mm_min_pd(_mm_add_pd(_mm_mul_pd(rx, rx), _mm_mul_pd(ry, ry)), _mm_add_pd(_mm_mul_pd(fx, fx), _mm_mul_pd(fy, fy)));
+
+        min_d2 = _mm_min_pd(_mm_or_pd(_mm_and_pd(within, d_line), _mm_andnot_pd(within, d_end)), min_d2);
+      }
+
+      const int inside = _mm_movemask_pd(_mm_and_pd(bounds, _mm_or_pd(on_line, _mm_or_pd(right, left))));
+      const int near = _mm_movemask_pd(_mm_and_pd(bounds, _mm_cmple_pd(_mm_sqrt_pd(min_d2), buffer)));
+
+      for(int lane = 0; lane < 2; lane++)
+      {
+        const unsigned char result = (inside & (1 << lane)) ? inside_obstacle : ((near & (1 << lane)) ? buffer_zone : free_space);
+        status[i + lane] = std::max(status[i + lane], result);
+      }
+    }
+#endif
+
+    for(; i < n; i++)
+    {
+      const double px = xs[i], py = ys[i];
+
+      if(px < shape.x_min || px > shape.x_max || py < shape.y_min || py > shape.y_max) continue;
+
+      bool right = true, left = true, on_line = false;
+      double min_d2 = 10000.0 * 10000.0;
+
+      for(const auto & e : shape.edges)
+      {
+        const double rx = px - e.ax, ry = py - e.ay;
+
+        // side of the edge the point is on, a point on the edge is inside
+        const double r = rx * e.nx + ry * e.ny;
+        right = right && r > 0;
+        left = left && r < 0;
+
+        // projection onto the edge, not a number for a degenerate edge
+        const double c = (rx * e.dx + ry * e.dy) / e.len2;
+        const bool within = c >= 0 && c <= 1;
+
+        on_line = on_line || (within && r == 0);
+
+        // squared distance to the projection, or to the closest vertex
+        double d2;
+
+        if(within)
+        {
+          const double ex = (e.ax + c * e.dx) - px, ey = (e.ay + c * e.dy) - py;
+          d2 = ex * ex + ey * ey;
+        }
+        else
+        {
+          const double fx = px - e.bx, fy = py - e.by;
+          d2 = std::min(rx * rx + ry * ry, fx * fx + fy * fy);
+        }
+
+        min_d2 = std::min(d2, min_d2);
+      }
+
+      const unsigned char result = (on_line || right || left) ? inside_obstacle : ((std::sqrt(min_d2) <= buffer_radius) ? buffer_zone : free_space);
+      status[i] = std::max(status[i], result);
+    }
+  }
+
+  void CollisionWorld::shape_segments(const Shape & shape, const double * x0, const double * y0, const double * x1, const double * y1, int n, unsigned char * collides) const
+  {
+    int i = 0;
+
+#if defined(__SSE2__)
+    // test two segments at a time
+    const __m128d zero = _mm_setzero_pd(), one = _mm_set1_pd(1.0), buffer = _mm_set1_pd(buffer_radius), shift = _mm_set1_pd(1000.0);
+    const __m128d sign = _mm_set1_pd(-0.0), reach = _mm_set1_pd(shape.reach / 1000.0), origin = _mm_set1_pd(1e-9);
+
+    for(; i + 1 < n; i += 2)
+    {
+      const __m128d sx0 = _mm_loadu_pd(x0 + i), sy0 = _mm_loadu_pd(y0 + i);
+      const __m128d sx1 = _mm_loadu_pd(x1 + i), sy1 = _mm_loadu_pd(y1 + i);
+
+      // only the segments whose bounding box reaches the inflated bounds, widened by the parallelism shift, can collide
+      const __m128d lo_x = _mm_min_pd(sx0, sx1), hi_x = _mm_max_pd(sx0, sx1);
+      const __m128d lo_y = _mm_min_pd(sy0, sy1), hi_y = _mm_max_pd(sy0, sy1);
+
+      const __m128d margin = _mm_mul_pd(_mm_add_pd(_mm_andnot_pd(sign, sx1), _mm_andnot_pd(sign, sy1)), reach);
+
+      const __m128d cross = _mm_sub_pd(_mm_mul_pd(sx0, sy1), _mm_mul_pd(sy0, sx1));
+      const __m128d norms = _mm_add_pd(_mm_add_pd(_mm_mul_pd(sx0, sx0), _mm_mul_pd(sy0, sy0)), _mm_add_pd(_mm_mul_pd(sx1, sx1), _mm_mul_pd(sy1, sy1)));
+      const __m128d unbounded = _mm_cmple_pd(_mm_andnot_pd(sign, cross), _mm_mul_pd(origin, norms));
+
+      const __m128d bounds = _mm_or_pd(unbounded,
+        _mm_and_pd(_mm_and_pd(_mm_cmpge_pd(_mm_add_pd(hi_x, margin), _mm_set1_pd(shape.x_min)), _mm_cmple_pd(_mm_sub_pd(lo_x, margin), _mm_set1_pd(shape.x_max))),
+                   _mm_and_pd(_mm_cmpge_pd(_mm_add_pd(hi_y, margin), _mm_set1_pd(shape.y_min)), _mm_cmple_pd(_mm_sub_pd(lo_y, margin), _mm_set1_pd(shape.y_max)))));
+
+      if(_mm_movemask_pd(bounds) == 0) continue;
+
+      // segment vector and its squared length, rounded the same way as point_to_line_distance
+      const __m128d sx = _mm_sub_pd(sx1, sx0), sy = _mm_sub_pd(sy1, sy0);
+      const __m128d len = _mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(sx, sx), _mm_mul_pd(sy, sy)));
+      const __m128d len2 = _mm_mul_pd(len, len);
+
+      // the parallelism shift of line_shape_intersection
+      const __m128d shift_x = _mm_add_pd(sx, _mm_div_pd(sx1, shift)), shift_y = _mm_add_pd(sy, _mm_div_pd(sy1, shift));
+
+      __m128d t_e = zero, t_l = one, min_d2 = _mm_set1_pd(std::numeric_limits<double>::infinity());
+
+      for(const auto & e : shape.edges)
+      {
+        const __m128d ax = _mm_set1_pd(e.ax), ay = _mm_set1_pd(e.ay);
+
+        // perpendicular vector pointing outward to the polygon
+        const __m128d nx = _mm_set1_pd(-e.nx), ny = _mm_set1_pd(-e.ny);
+
+        const __m128d num = _mm_xor_pd(sign, _mm_add_pd(_mm_mul_pd(nx, _mm_sub_pd(sx0, ax)), _mm_mul_pd(ny, _mm_sub_pd(sy0, ay))));
+        __m128d den = _mm_add_pd(_mm_mul_pd(nx, sx), _mm_mul_pd(ny, sy));
+
+        const __m128d parallel = _mm_cmpeq_pd(den, zero);
+        const __m128d den_shift = _mm_add_pd(_mm_mul_pd(nx, shift_x), _mm_mul_pd(ny, shift_y));
+        den = _mm_or_pd(_mm_and_pd(parallel, den_shift), _mm_andnot_pd(parallel, den));
+
+        const __m128d t = _mm_div_pd(num, den);
+
+        // the segment is potentially entering the polygon when den < 0 and leaving it otherwise, a t that is not a number is ignored
+        const __m128d entering = _mm_cmplt_pd(den, zero);
+        t_e = _mm_or_pd(_mm_and_pd(entering, _mm_max_pd(t, t_e)), _mm_andnot_pd(entering, t_e));
+        t_l = _mm_or_pd(_mm_and_pd(entering, t_l), _mm_andnot_pd(entering, _mm_min_pd(t, t_l)));
+
+        // squared distance from the vertex to its projection onto the segment, or to the closest end of the segment
+        const __m128d wx = _mm_sub_pd(ax, sx0), wy = _mm_sub_pd(ay, sy0);
+        const __m128d c = _mm_div_pd(_mm_add_pd(_mm_mul_pd(wx, sx), _mm_mul_pd(wy, sy)), len2);
+        const __m128d within = _mm_and_pd(_mm_cmpge_pd(c, zero), _mm_cmple_pd(c, one));
+
+        const __m128d ex = _mm_sub_pd(_mm_add_pd(sx0, _mm_mul_pd(c, sx)), ax), ey = _mm_sub_pd(_mm_add_pd(sy0, _mm_mul_pd(c, sy)), ay);
+        const __m128d fx = _mm_sub_pd(ax, sx1), fy = _mm_sub_pd(ay, sy1);
+
+        const __m128d d_line = _mm_add_pd(_mm_mul_pd(ex, ex), _mm_mul_pd(ey, ey));
+        const __m128d d_end = _mm_min_pd(_mm_add_pd(_mm_mul_pd(wx, wx), _mm_mul_pd(wy, wy)), _mm_add_pd(_mm_mul_pd(fx, fx), _mm_mul_pd(fy, fy)));
+
+        min_d2 = _mm_min_pd(_mm_or_pd(_mm_and_pd(within, d_line), _mm_andnot_pd(within, d_end)), min_d2);
+      }
+
+      // the segment cannot intersect a convex polygon if it leaves before it enters
+      const __m128d near = _mm_cmple_pd(_mm_sqrt_pd(min_d2), buffer);
+      const __m128d hit = _mm_or_pd(near, _mm_cmpnlt_pd(t_l, t_e));
+      const int mask = _mm_movemask_pd(_mm_and_pd(bounds, hit));
+
+      if(mask & 1) collides[i] = 1;
+      if(mask & 2) collides[i + 1] = 1;
+    }
+#endif
+
+    for(; i < n; i++)
+    {
+      const double margin = shift_tolerance(x1[i], y1[i]) * shape.reach;
+
+      if(!through_origin(x0[i], y0[i], x1[i], y1[i]) &&
+         (std::max(x0[i], x1[i]) + margin < shape.x_min || std::min(x0[i], x1[i]) - margin > shape.x_max ||
+          std::max(y0[i], y1[i]) + margin < shape.y_min || std::min(y0[i], y1[i]) - margin > shape.y_max)) continue;
+
+      // segment vector and its squared length, rounded the same way as point_to_line_distance
+      const double sx = x1[i] - x0[i], sy = y1[i] - y0[i];
+      const double len = std::sqrt(sx * sx + sy * sy);
+      const double len2 = len * len;
+
+      double t_e = 0.0, t_l = 1.0;
+      double min_d2 = std::numeric_limits<double>::infinity();
+
+      for(const auto & e : shape.edges)
+      {
+        // perpendicular vector pointing outward to the polygon
+        const double nx = -e.nx, ny = -e.ny;
+
+        const double num = -(nx * (x0[i] - e.ax) + ny * (y0[i] - e.ay));
+        double den = nx * sx + ny * sy;
+
+        // Shift the segment vector slightly to break parallelism
+        if(den == 0) den = nx * (sx + x1[i] / 1000.0) + ny * (sy + y1[i] / 1000.0);
+
+        const double t = num / den;
+
+        if(den < 0) t_e = std::max(t_e, t); // segment is potentially entering the polygon
+        else t_l = std::min(t_l, t); // segment is potentially leaving the polygon
+
+        // squared distance from the vertex to its projection onto the segment, or to the closest end of the segment
+        const double wx = e.ax - x0[i], wy = e.ay - y0[i];
+        const double c = (wx * sx + wy * sy) / len2;
+
+        if(c >= 0 && c <= 1)
+        {
+          const double ex = (x0[i] + c * sx) - e.ax, ey = (y0[i] + c * sy) - e.ay;
+          min_d2 = std::min(ex * ex + ey * ey, min_d2);
+        }
+        else
+        {
+          const double fx = e.ax - x1[i], fy = e.ay - y1[i];
+          min_d2 = std::min({wx * wx + wy * wy, fx * fx + fy * fy, min_d2});
+        }
+      }
+
+      if(std::sqrt(min_d2) <= buffer_radius || !(t_l < t_e)) collides[i] = 1;
+    }
+  }
+}
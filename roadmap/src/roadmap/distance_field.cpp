@@ -0,0 +1,141 @@
+/// \file
+/// \brief A library for looking up the distance to the nearest obstacle from a precomputed field
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "roadmap/distance_field.hpp"
+#include "roadmap/grid.hpp"
+#include "roadmap/parallel.hpp"
+#include "roadmap/raster.hpp"
+#include "rigid2d/rigid2d.hpp"
+
+namespace raster
+{
+  DistanceField::DistanceField(const grid::Map & map, double resolution, unsigned int threads)
+  {
+    res = resolution;
+
+    // pad the map with a ring of cells outside of the boundaries, which act as an obstacle around the map
+    x_origin = map.x_bounds.at(0) - res;
+    y_origin = map.y_bounds.at(0) - res;
+
+    width = static_cast<int>(std::ceil((map.x_bounds.at(1) - map.x_bounds.at(0)) / res)) + 2;
+    height = static_cast<int>(std::ceil((map.y_bounds.at(1) - map.y_bounds.at(0)) / res)) + 2;
+
+    std::vector<signed char> seeds(width * height, 0);
+
+    for(int j = 0; j < width; j++)
+    {
+      seeds.at(j) = 1;
+      seeds.at((height - 1) * width + j) = 1;
+    }
+
+    for(int i = 0; i < height; i++)
+    {
+      seeds.at(i * width) = 1;
+      seeds.at(i * width + width - 1) = 1;
+    }
+
+    // every cell an obstacle touches, in cell coordinates
+    std::vector<std::vector<rigid2d::Vector2D>> polygons;
+
+    for(const auto & obstacle : map.obstacles)
+    {
+      std::vector<rigid2d::Vector2D> polygon;
+
+      for(const auto & v : obstacle) polygon.push_back(rigid2d::Vector2D((v.x - x_origin) / res, (v.y - y_origin) / res));
+
+      polygons.push_back(polygon);
+    }
+
+    fill_polygons(polygons, width, height, true, 1, seeds.data(), threads);
+
+    std::vector<double> dist2;
+    squared_distance_transform(seeds.data(), width, height, dist2, threads);
+
+    // distances between the cell centers in the units of the map
+    dist.resize(dist2.size());
+
+    for(unsigned int k = 0; k < dist2.size(); k++)
+    {
+      dist.at(k) = std::sqrt(dist2.at(k)) * res;
+    }
+
+    // central differences in the interior, one sided differences along the edges
+    grad_x.resize(dist.size());
+    grad_y.resize(dist.size());
+
+    parallel::parallel_for(0, height, threads, [&](int i)
+    {
+      const int i_lo = std::max(i - 1, 0), i_hi = std::min(i + 1, height - 1);
+
+      for(int j = 0; j < width; j++)
+      {
+        const int j_lo = std::max(j - 1, 0), j_hi = std::min(j + 1, width - 1);
+
+        grad_x[i * width + j] = (j_hi == j_lo) ? 0.0 : (dist[i * width + j_hi] - dist[i * width + j_lo]) / ((j_hi - j_lo) * res);
+        grad_y[i * width + j] = (i_hi == i_lo) ? 0.0 : (dist[i_hi * width + j] - dist[i_lo * width + j]) / ((i_hi - i_lo) * res);
+      }
+    });
+  }
+
+  bool DistanceField::empty() const
+  {
+    return dist.empty();
+  }
+
+  double DistanceField::get_resolution() const
+  {
+    return res;
+  }
+
+  double DistanceField::distance(const rigid2d::Vector2D & point) const
+  {
+    int id = 0;
+    double fx = 0, fy = 0;
+    locate(point, id, fx, fy);
+
+    const double bottom = dist[id] + fx * (dist[id + 1] - dist[id]);
+    const double top = dist[id + width] + fx * (dist[id + width + 1] - dist[id + width]);
+
+    return bottom + fy * (top - bottom);
+  }
+
+  rigid2d::Vector2D DistanceField::gradient(const rigid2d::Vector2D & point) const
+  {
+    rigid2d::Vector2D grad;
+    distance(point, grad);
+    return grad;
+  }
+
+  double DistanceField::distance(const rigid2d::Vector2D & point, rigid2d::Vector2D & grad) const
+  {
+    int id = 0;
+    double fx = 0, fy = 0;
+    locate(point, id, fx, fy);
+
+    // bilinear weights of the 4 surrounding cell centers
+    const double w00 = (1 - fx) * (1 - fy), w10 = fx * (1 - fy), w01 = (1 - fx) * fy, w11 = fx * fy;
+
+    grad.x = w00 * grad_x[id] + w10 * grad_x[id + 1] + w01 * grad_x[id + width] + w11 * grad_x[id + width + 1];
+    grad.y = w00 * grad_y[id] + w10 * grad_y[id + 1] + w01 * grad_y[id + width] + w11 * grad_y[id + width + 1];
+
+    return w00 * dist[id] + w10 * dist[id + 1] + w01 * dist[id + width] + w11 * dist[id + width + 1];
+  }
+
+  void DistanceField::locate(const rigid2d::Vector2D & point, int & id, double & fx, double & fy) const
+  {
+    // position relative to the center of the lower left cell
+    const double u = std::min(std::max((point.x - x_origin) / res - 0.5, 0.0), width - 1.0);
+    const double v = std::min(std::max((point.y - y_origin) / res - 0.5, 0.0), height - 1.0);
+
+    const int j = std::min(static_cast<int>(u), width - 2);
+    const int i = std::min(static_cast<int>(v), height - 2);
+
+    id = i * width + j;
+    fx = u - j;
+    fy = v - i;
+  }
+}
@@ -0,0 +1,230 @@
+/// \file
+/// \brief A compact graph representation shared by the road map, the grid and the search algorithms
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "roadmap/graph.hpp"
+#include "rigid2d/rigid2d.hpp"
+
+namespace graph
+{
+  void CSRGraph::clear()
+  {
+    offsets.assign(1, 0);
+    neighbors.clear();
+    weights.clear();
+    x.clear();
+    y.clear();
+  }
+
+  void CSRGraph::reserve(int n_nodes, int n_edges)
+  {
+    offsets.reserve(n_nodes + 1);
+    x.reserve(n_nodes);
+    y.reserve(n_nodes);
+
+    neighbors.reserve(n_edges);
+    weights.reserve(n_edges);
+  }
+
+  int CSRGraph::add_node(const rigid2d::Vector2D & point)
+  {
+    x.push_back(point.x);
+    y.push_back(point.y);
+
+    // the new node starts with no edges
+    offsets.push_back(neighbors.size());
+
+    return x.size() - 1;
+  }
+
+  void CSRGraph::add_edge(int neighbor, double weight)
+  {
+    neighbors.push_back(neighbor);
+    weights.push_back(weight);
+
+    // extend the edge range of the last node
+    offsets.back() = neighbors.size();
+  }
+
+  int CSRGraph::size() const
+  {
+    return x.size();
+  }
+
+  int CSRGraph::num_edges() const
+  {
+    return neighbors.size();
+  }
+
+  rigid2d::Vector2D CSRGraph::point(int id) const
+  {
+    return rigid2d::Vector2D(x.at(id), y.at(id));
+  }
+
+  const std::vector<double> & CSRGraph::x_coords() const
+  {
+    return x;
+  }
+
+  const std::vector<double> & CSRGraph::y_coords() const
+  {
+    return y;
+  }
+
+  const std::vector<int> & CSRGraph::edge_offsets() const
+  {
+    return offsets;
+  }
+
+  const std::vector<int> & CSRGraph::edge_neighbors() const
+  {
+    return neighbors;
+  }
+
+  const std::vector<double> & CSRGraph::edge_weights() const
+  {
+    return weights;
+  }
+
+  bool CSRGraph::assign(int n_nodes, int n_edges, const int * offsets, const int * neighbors, const double * weights,
+                        const double * x_coords, const double * y_coords)
+  {
+    if(n_nodes < 0 || n_edges < 0 || offsets[0] != 0 || offsets[n_nodes] != n_edges) return false;
+
+    for(int i = 0; i < n_nodes; i++)
+    {
+      if(offsets[i] > offsets[i + 1]) return false;
+    }
+
+    for(int e = 0; e < n_edges; e++)
+    {
+      if(neighbors[e] < 0 || neighbors[e] >= n_nodes) return false;
+    }
+
+    this->offsets.assign(offsets, offsets + n_nodes + 1);
+    this->neighbors.assign(neighbors, neighbors + n_edges);
+    this->weights.assign(weights, weights + n_edges);
+    x.assign(x_coords, x_coords + n_nodes);
+    y.assign(y_coords, y_coords + n_nodes);
+
+    return true;
+  }
+
+  int CSRGraph::degree(int id) const
+  {
+    return offsets.at(id + 1) - offsets.at(id);
+  }
+
+  bool CSRGraph::has_edge(int u, int v) const
+  {
+    return find_edge(u, v) != -1;
+  }
+
+  int CSRGraph::find_edge(int u, int v) const
+  {
+    for(int e = offsets.at(u); e < offsets.at(u + 1); e++)
+    {
+      if(neighbors[e] == v) return e;
+    }
+
+    return -1;
+  }
+
+  GridGraph::GridGraph(int width, int height, double resolution)
+  {
+    n_cols = width;
+    n_rows = height;
+
+    cell_length = resolution;
+    straight = resolution;
+    diagonal = std::sqrt(2.0) * resolution;
+  }
+
+  int GridGraph::size() const
+  {
+    return n_cols * n_rows;
+  }
+
+  int GridGraph::width() const
+  {
+    return n_cols;
+  }
+
+  rigid2d::Vector2D GridGraph::point(int id) const
+  {
+    // the cell centers are offset by half a cell from the grid coordinates
+    return rigid2d::Vector2D((id % n_cols + 0.5) * cell_length, (id / n_cols + 0.5) * cell_length);
+  }
+
+  QueryGraph::QueryGraph(const CSRGraph * base_p)
+  {
+    reset(base_p);
+  }
+
+  void QueryGraph::reset(const CSRGraph * base_p)
+  {
+    this->base_p = base_p;
+    base_size = base_p ? base_p->size() : 0;
+    clear();
+  }
+
+  void QueryGraph::clear()
+  {
+    x.clear();
+    y.clear();
+    links.clear();
+  }
+
+  int QueryGraph::add_node(const rigid2d::Vector2D & point)
+  {
+    x.push_back(point.x);
+    y.push_back(point.y);
+
+    return base_size + x.size() - 1;
+  }
+
+  void QueryGraph::add_edge(int query_id, int neighbor, double weight)
+  {
+    Link link;
+    link.from = query_id;
+    link.to = neighbor;
+    link.weight = weight;
+    insert(link);
+
+    std::swap(link.from, link.to);
+    insert(link);
+  }
+
+  const CSRGraph * QueryGraph::base() const
+  {
+    return base_p;
+  }
+
+  bool QueryGraph::is_query_node(int id) const
+  {
+    return id >= base_size;
+  }
+
+  int QueryGraph::size() const
+  {
+    return base_size + x.size();
+  }
+
+  rigid2d::Vector2D QueryGraph::point(int id) const
+  {
+    if(id < base_size) return base_p->point(id);
+
+    return rigid2d::Vector2D(x.at(id - base_size), y.at(id - base_size));
+  }
+
+  void QueryGraph::insert(const Link & link)
+  {
+    // after any links from the same node, so the edges keep the order they were added in
+    auto it = std::upper_bound(links.begin(), links.end(), link.from, [](int from, const Link & l){ return from < l.from; });
+    links.insert(it, link);
+  }
+}
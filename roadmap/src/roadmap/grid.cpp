@@ -2,20 +2,30 @@
 /// \brief A library for building an occupied grid
 
 #include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <functional>
-#include <iostream>
+#include <numeric>
 #include <random>
 #include <unordered_set>
 #include <vector>
 
-#include "roadmap/collision.hpp"
+#include "roadmap/collision_world.hpp"
+#include "roadmap/graph.hpp"
 #include "roadmap/grid.hpp"
+#include "roadmap/map_cache.hpp"
+#include "roadmap/parallel.hpp"
 #include "roadmap/prm.hpp"
+#include "roadmap/raster.hpp"
+#include "roadmap/stats.hpp"
 #include "roadmap/utility.hpp"
 #include "rigid2d/rigid2d.hpp"
 
 namespace grid
 {
+  /// \brief Number of cells compared at once when diffing a patch against the occupancy data, the size of a machine word
+  static constexpr int diff_word = sizeof(unsigned long long);
 
   Map::Map(std::vector<std::vector<rigid2d::Vector2D>> obs, std::vector<double> x, std::vector<double> y)
   {
@@ -26,6 +36,81 @@ namespace grid
     map_vector = utility::create_map_vector(x_bounds, y_bounds);
   }
 
+  bool OccupancyView::line_is_free(int x0, int y0, int x1, int y1) const
+  {
+    auto is_free = [&](int x, int y){ return x >= 0 && y >= 0 && x < width && y < height && at(x, y) == 0; };
+
+    if(!is_free(x0, y0)) return false;
+
+    const int x_step = (x1 >= x0) ? 1 : -1, y_step = (y1 >= y0) ? 1 : -1;
+    const int dx = std::abs(x1 - x0), dy = std::abs(y1 - y0);
+
+    // step along the major axis, tracking twice the error of the minor axis so cell corners are exact
+    if(dx >= dy)
+    {
+      int error = dx, prev_error = dx;
+      int y = y0;
+
+      for(int x = x0 + x_step, i = 0; i < dx; x += x_step, i++)
+      {
+        error += 2 * dy;
+
+        if(error > 2 * dx)
+        {
+          y += y_step;
+          error -= 2 * dx;
+
+          // the segment also enters the cell below or beside the diagonal step, or both when it passes through the corner
+          if(error + prev_error < 2 * dx)
+          {
+            if(!is_free(x, y - y_step)) return false;
+          }
+          else if(error + prev_error > 2 * dx)
+          {
+            if(!is_free(x - x_step, y)) return false;
+          }
+          else if(!is_free(x, y - y_step) || !is_free(x - x_step, y)) return false;
+        }
+
+        if(!is_free(x, y)) return false;
+
+        prev_error = error;
+      }
+    }
+    else
+    {
+      int error = dy, prev_error = dy;
+      int x = x0;
+
+      for(int y = y0 + y_step, i = 0; i < dy; y += y_step, i++)
+      {
+        error += 2 * dx;
+
+        if(error > 2 * dy)
+        {
+          x += x_step;
+          error -= 2 * dy;
+
+          if(error + prev_error < 2 * dy)
+          {
+            if(!is_free(x - x_step, y)) return false;
+          }
+          else if(error + prev_error > 2 * dy)
+          {
+            if(!is_free(x, y - y_step)) return false;
+          }
+          else if(!is_free(x - x_step, y) || !is_free(x, y - y_step)) return false;
+        }
+
+        if(!is_free(x, y)) return false;
+
+        prev_error = error;
+      }
+    }
+
+    return true;
+  }
+
   // ===========================================================================
   // Grid CLASS ================================================================
   // ===========================================================================
@@ -56,8 +141,10 @@ namespace grid
     og_map.map_vector = utility::create_map_vector(og_map.x_bounds, og_map.y_bounds);
   }
 
-  void Grid::build_grid(double cell_size, unsigned int grid_res, double buffer_radius)
+  void Grid::build_grid(double cell_size, unsigned int grid_res, double buffer_radius, unsigned int threads)
   {
+    STATS_PHASE(build_stats, "occupancy");
+
     this->cell_size = cell_size;
     this->grid_res = grid_res;
     this->buffer_radius = buffer_radius;
@@ -65,147 +152,194 @@ namespace grid
     // update the map dimensions and obstacle coordinates based on the grid resolution
     grid_resize();
 
+    const int width = grid_dimensions.at(0);
+    const int height = grid_dimensions.at(1);
+
     // scale buffer radius to the integer grid size and add half of cell diagonal to stay conservative
     double grid_buffer = (buffer_radius/cell_size)*grid_res + (std::sqrt(2) * 0.5);
 
-    rigid2d::Vector2D cell_center;
-
     int occupied = 100, in_buffer = 50, free = 0;
 
-    std::vector<signed char> grid_row;
+    // without a buffer, the buffer zone is part of the obstacles
+    const signed char band_value = (buffer_radius == 0) ? occupied : in_buffer;
 
-    // Loop through each cell on the grid and determine if the center is inside a polygon or inside the buffer zone
-    for(int i = 0; i < grid_dimensions.at(1); i++) // y coord
-    {
-      for(int j = 0; j < grid_dimensions.at(0); j++) // x coord
-      {
+    occ_data.assign(width * height, free);
 
-        cell_center.x = j + 0.5;
-        cell_center.y = i + 0.5;
+    // distance from each cell center to the nearest center of a cell that an obstacle touches
+    std::vector<signed char> touched(width * height, 0);
+    raster::fill_polygons(scaled_map.obstacles, width, height, true, 1, touched.data(), threads);
 
-        grid_row.push_back(free); // add the cell to the array
+    std::vector<double> dist2;
+    raster::squared_distance_transform(touched.data(), width, height, dist2, threads);
 
-        std::vector<bool> occ_result = {false, false}; // assume no collision
+    // A touched cell has part of an obstacle within half of a cell diagonal of its center, so the distance to the nearest obstacle
+    // is within half of a cell diagonal of the transform. Only the cells in between these bounds need the exact test.
+    const double half_diagonal = std::sqrt(2) * 0.5;
+    const double inner = std::max(grid_buffer - half_diagonal, 0.0), outer = grid_buffer + half_diagonal;
 
-        for(auto obstacle : scaled_map.obstacles)
-        {
-          occ_result = collision::point_inside_convex(cell_center, obstacle, grid_buffer);
+    const collision::CollisionWorld obstacle_world(scaled_map.obstacles, grid_buffer);
 
-          if(occ_result.at(0) && occ_result.at(1)) // if the point is inside the obstacle
-          {
-            grid_row.at(j) = occupied;
-            break;
-          }
-          else if(occ_result.at(0) && !occ_result.at(1)) // if the point is outside the obstacle, but in the buffer zone
-          {
-            if(buffer_radius == 0) grid_row.at(j) = occupied; // apply the correct color
-            else grid_row.at(j) = in_buffer;
-          }
-        }
+    std::vector<unsigned int> checked(height, 0);
 
-        // if there was no obstacle collision and a buffer has been set, check the map boarder
-        if(!occ_result.at(0) && buffer_radius != 0)
-        {
-          auto boarder_res = cell_near_boarder(cell_center, grid_buffer);
-          if(boarder_res) grid_row.at(j) = in_buffer;
-        }
-      }
+    parallel::parallel_for(0, height, threads, [&](int i) // y coord
+    {
+      // the cells of the current row
+      signed char * grid_row = &occ_data[i * width];
+      const double * dist_row = &dist2[i * width];
 
-      // add the row to the 2D list
-      occ_data.push_back(grid_row);
-      grid_row.clear();
-    }
-  }
+      // the whole row is within the buffer distance of the bottom or top of the map
+      const bool row_near_boarder = cell_near_boarder(i + 0.5, height, grid_buffer);
 
-  void Grid::generate_centers_graph()
-  {
+      for(int j = 0; j < width; j++) // x coord
+      {
+        bool collides = false;
 
-    int cnt= 0;
+        if(dist_row[j] <= inner * inner) // the cell center is in the buffer zone
+        {
+          grid_row[j] = band_value;
+          collides = true;
+        }
+        else if(dist_row[j] <= outer * outer) // the cell center is close to the edge of the buffer zone
+        {
+          const auto occ_result = obstacle_world.point_inside(rigid2d::Vector2D(j + 0.5, i + 0.5));
+          checked[i]++;
 
-    nodes.clear();
-    all_edges.clear();
+          if(occ_result.at(0) && occ_result.at(1)) grid_row[j] = occupied;
+          else if(occ_result.at(0)) grid_row[j] = band_value;
 
-    // Loop through each cell on the grid and create the node corresponding to it
-    for(int i = 0; i < grid_dimensions.at(1); i++) // y coord
-    {
-      std::vector<prm::Node> row;
-      for(int j = 0; j < grid_dimensions.at(0); j++) // x coord
-      {
-        rigid2d::Vector2D grid_coord(j,i);
+          collides = occ_result.at(0);
+        }
 
-        rigid2d::Vector2D world_coord = grid_to_world(grid_coord);
+        // if there was no obstacle collision and a buffer has been set, check the map boarder
+        if(!collides && buffer_radius != 0 && (row_near_boarder || cell_near_boarder(j + 0.5, width, grid_buffer))) grid_row[j] = in_buffer;
+      }
+    });
 
-        prm::Node buf;
+    STATS_ADD(build_stats.collision_checks, std::accumulate(checked.begin(), checked.end(), 0ull));
 
-        buf.id = cnt;
-        buf.point = world_coord;
+    // the cells with their center inside an obstacle are occupied
+    raster::fill_polygons(scaled_map.obstacles, width, height, false, occupied, occ_data.data(), threads);
+  }
 
-        row.push_back(buf);
+  void Grid::generate_centers_graph()
+  {
+    STATS_PHASE(build_stats, "graph");
 
-        cnt++;
-      }
-      nodes.push_back(row);
-    }
+    const int width = grid_dimensions.at(0);
+    const int height = grid_dimensions.at(1);
 
-    cnt = 0;
+    centers_graph.clear();
+    centers_graph.reserve(width * height, 8 * width * height);
 
-    // Loop through each node and create edges to the 8 neighbors connections
-    for(int i = 0; i < grid_dimensions.at(1); i++) // y coord
+    // Loop through each cell on the grid in row major order and create the node corresponding to it
+    for(int i = 0; i < height; i++) // y coord
     {
-      for(int j = 0; j < grid_dimensions.at(0); j++) // x coord
+      for(int j = 0; j < width; j++) // x coord
       {
+        const auto point = grid_to_world(rigid2d::Vector2D(j, i));
+        centers_graph.add_node(point);
 
-        prm::Node& node = nodes.at(i).at(j);
-
-        // Check the 8 Neighboring Nodes
+        // Create edges to the 8 neighbors
         for(int m = -1; m < 2; m++) //y shift
         {
           for(int n = -1; n < 2; n++) //x shift
           {
             // skip over the 0 shift and any shift that is out of bounds
             if(m == 0 && n == 0) continue;
-            else if((j + n) < 0 || (j + n) >= grid_dimensions.at(0)) continue;
-            else if((i + m) < 0 || (i + m) >= grid_dimensions.at(1)) continue;
+            else if((j + n) < 0 || (j + n) >= width) continue;
+            else if((i + m) < 0 || (i + m) >= height) continue;
             else
             {
-              prm::Node& neighbor = nodes.at(i+m).at(j+n); // get the reference to the neighbor node
+              const auto neighbor = grid_to_world(rigid2d::Vector2D(j + n, i + m));
+              centers_graph.add_edge((i + m) * width + (j + n), point.distance(neighbor));
+            }
+          }
+        }
+      }
+    }
+  }
 
-              if(!node.IsConnected(neighbor.id))
-              {
-                prm::Edge buf_edge;
+  const stats::Stats & Grid::get_stats() const
+  {
+    return build_stats;
+  }
 
-                buf_edge.edge_id = cnt;
+  void Grid::reset_stats()
+  {
+    build_stats.reset();
+  }
 
-                buf_edge.node1_id = node.id;
-                buf_edge.node1 = node.point;
-                buf_edge.node2_id = neighbor.id;
-                buf_edge.node2 = neighbor.point;
+  std::uint64_t Grid::get_cache_key(double cell_size, unsigned int grid_res, double robot_radius) const
+  {
+    cache::Hasher hasher;
 
-                buf_edge.distance = node.point.distance(neighbor.point);
+    hasher.add(static_cast<std::uint64_t>(cache::Kind::grid));
+    hasher.add(og_map.obstacles).add(og_map.x_bounds).add(og_map.y_bounds);
+    hasher.add(cell_size).add(static_cast<std::uint64_t>(grid_res)).add(robot_radius);
 
-                // add to main list
-                all_edges.push_back(buf_edge);
+    return hasher.value();
+  }
 
-                // Add to Node
-                node.edges.push_back(buf_edge);
-                node.id_set.insert(neighbor.id);
+  bool Grid::save(const std::string & file_name, std::uint64_t key) const
+  {
+    cache::Writer writer(cache::Kind::grid, key);
 
-                // switch 1 and 2 and add to second node
-                buf_edge.node1_id = buf_edge.node2_id;
-                buf_edge.node1 = buf_edge.node2;
-                buf_edge.node2_id = node.id;
-                buf_edge.node2 = node.point;
+    const std::int32_t dims[2] = {grid_dimensions.at(0), grid_dimensions.at(1)};
+    writer.append(dims, 2);
 
-                neighbor.edges.push_back(buf_edge);
-                neighbor.id_set.insert(node.id);
+    writer.append(cell_size);
+    writer.append(static_cast<std::uint32_t>(grid_res));
+    writer.append(buffer_radius);
 
-                cnt++;
-              }
-            }
-          }
-        }
-      }
-    }
+    writer.append(occ_data.data(), occ_data.size());
+
+    cache::write_graph(writer, centers_graph);
+
+    return writer.write(file_name);
+  }
+
+  bool Grid::load(const std::string & file_name, std::uint64_t key)
+  {
+    STATS_PHASE(build_stats, "load");
+
+    cache::MappedFile file;
+
+    if(!file.open(file_name)) return false;
+
+    cache::Reader reader(file, cache::Kind::grid, key);
+
+    const std::int32_t * dims = reader.next<std::int32_t>(2);
+
+    double file_cell_size = 0, file_buffer_radius = 0;
+    std::uint32_t file_grid_res = 0;
+
+    reader.next(file_cell_size);
+    reader.next(file_grid_res);
+    reader.next(file_buffer_radius);
+
+    if(!reader.good() || dims[0] < 0 || dims[1] < 0 || file_grid_res < 1) return false;
+
+    const signed char * occ = reader.next<signed char>(static_cast<std::size_t>(dims[0]) * dims[1]);
+
+    graph::CSRGraph graph;
+
+    if(!cache::read_graph(reader, graph)) return false;
+
+    // the dimensions must match the ones grid_resize finds for the stored resolution
+    const int width = og_map.x_bounds.at(1) * file_grid_res - og_map.x_bounds.at(0) * file_grid_res;
+    const int height = og_map.y_bounds.at(1) * file_grid_res - og_map.y_bounds.at(0) * file_grid_res;
+
+    if(width != dims[0] || height != dims[1]) return false;
+
+    cell_size = file_cell_size;
+    grid_res = file_grid_res;
+    buffer_radius = file_buffer_radius;
+    grid_resize();
+
+    occ_data.assign(occ, occ + static_cast<std::size_t>(dims[0]) * dims[1]);
+    centers_graph = std::move(graph);
+
+    return true;
   }
 
   std::vector<int> Grid::update_grid(std::vector<std::pair<rigid2d::Vector2D, signed char>> points)
@@ -214,11 +348,12 @@ namespace grid
 
     for (const auto & point : points)
     {
-      const auto cur = occ_data.at(point.first.y).at(point.first.x);
+      auto & cell = occ_data.at(point.first.y * grid_dimensions.at(0) + point.first.x);
+      const auto cur = cell;
 
       if(cur != point.second)
       {
-        occ_data.at(point.first.y).at(point.first.x) = point.second;
+        cell = point.second;
 
         if(cur == 0 && point.second != 0) output.push_back(1);
         else if(cur !=0 && point.second == 0) output.push_back(1);
@@ -230,59 +365,130 @@ namespace grid
     return output;
   }
 
-  std::vector<std::vector<prm::Node>> Grid::get_nodes() const
+  std::vector<int> Grid::update_patch(const OccupancyPatch & patch)
   {
-    return nodes;
-  }
+    std::vector<int> flipped;
 
-  std::vector<prm::Node> Grid::get_nodes_flatten() const
-  {
-    // collapse 2d vector into row major order
-    std::vector<prm::Node> output;
+    if(patch.width <= 0 || patch.height <= 0 || patch.data.size() != static_cast<unsigned int>(patch.width * patch.height)) return flipped;
+
+    const int width = grid_dimensions.at(0);
 
-    for(const auto row : nodes)
+    // clip the patch to the grid
+    const int x_lo = std::max(patch.x, 0);
+    const int x_hi = std::min(patch.x + patch.width, width);
+    const int y_lo = std::max(patch.y, 0);
+    const int y_hi = std::min(patch.y + patch.height, grid_dimensions.at(1));
+
+    const int n = x_hi - x_lo;
+
+    for(int i = y_lo; i < y_hi; i++)
     {
-      for(const auto point : row)
+      const signed char * src = patch.data.data() + (i - patch.y) * patch.width + (x_lo - patch.x);
+      signed char * dst = occ_data.data() + i * width + x_lo;
+
+      int j = 0;
+
+      while(j < n)
       {
-        output.push_back(point);
+        // skip a whole word of unchanged cells
+        if(j + diff_word <= n && std::memcmp(src + j, dst + j, diff_word) == 0)
+        {
+          j += diff_word;
+          continue;
+        }
+
+        // otherwise compare the cells of the word one at a time
+        const int word_end = std::min(j + diff_word, n);
+
+        for(; j < word_end; j++)
+        {
+          if(src[j] == dst[j]) continue;
+
+          if((src[j] == 0) != (dst[j] == 0)) flipped.push_back(i * width + x_lo + j);
+          dst[j] = src[j];
+        }
       }
     }
 
+    return flipped;
+  }
+
+  std::vector<std::vector<prm::Node>> Grid::get_nodes() const
+  {
+    // reshape the row major nodes to match the grid
+    const auto flat = get_nodes_flatten();
+    std::vector<std::vector<prm::Node>> output;
+
+    for(int i = 0; i < grid_dimensions.at(1); i++)
+    {
+      auto row_start = flat.begin() + i * grid_dimensions.at(0);
+      output.emplace_back(row_start, row_start + grid_dimensions.at(0));
+    }
+
     return output;
   }
 
+  std::vector<prm::Node> Grid::get_nodes_flatten() const
+  {
+    return prm::to_nodes(centers_graph);
+  }
+
   std::vector<prm::Edge> Grid::get_edges() const
   {
-    return all_edges;
+    return prm::to_edges(centers_graph);
   }
 
-  std::vector<std::vector<signed char>> Grid::get_grid() const
+  const graph::CSRGraph & Grid::get_graph() const
   {
-    return occ_data;
+    return centers_graph;
   }
 
-  std::vector<signed char> Grid::get_grid_flatten() const
+  graph::GridGraph Grid::get_implicit_graph() const
   {
-    // collapse 2d vector into row major order
-    std::vector<signed char> output;
+    return graph::GridGraph(grid_dimensions.at(0), grid_dimensions.at(1), get_resolution());
+  }
 
-    for(const auto row : occ_data)
+  std::vector<std::vector<signed char>> Grid::get_grid() const
+  {
+    // expand the row major data into a 2D vector
+    std::vector<std::vector<signed char>> output;
+
+    for(int i = 0; i < grid_dimensions.at(1); i++)
     {
-      for(const auto point : row)
-      {
-        output.push_back(point);
-      }
+      auto row_start = occ_data.begin() + i * grid_dimensions.at(0);
+      output.emplace_back(row_start, row_start + grid_dimensions.at(0));
     }
 
     return output;
   }
 
+  std::vector<signed char> Grid::get_grid_flatten() const
+  {
+    return occ_data;
+  }
+
+  OccupancyView Grid::get_occupancy() const
+  {
+    OccupancyView view;
+
+    view.data = occ_data.data();
+    view.width = grid_dimensions.at(0);
+    view.height = grid_dimensions.at(1);
+
+    return view;
+  }
+
+  double Grid::get_resolution() const
+  {
+    return cell_size/ static_cast<double>(grid_res);
+  }
+
   std::vector<int> Grid::get_grid_dimensions() const
   {
     return grid_dimensions;
   }
 
-  rigid2d::Vector2D Grid::grid_to_world(rigid2d::Vector2D grid_coord)
+  rigid2d::Vector2D Grid::grid_to_world(rigid2d::Vector2D grid_coord) const
   {
     double ratio = cell_size/ static_cast<double>(grid_res);
     double shift = 0.5;
@@ -290,7 +496,7 @@ namespace grid
     return rigid2d::Vector2D((grid_coord.x + shift) * ratio, (grid_coord.y + shift) * ratio);
   }
 
-  rigid2d::Vector2D Grid::world_to_grid(rigid2d::Vector2D world_coord)
+  rigid2d::Vector2D Grid::world_to_grid(rigid2d::Vector2D world_coord) const
   {
     double ratio = cell_size/ static_cast<double>(grid_res);
 
@@ -317,25 +523,14 @@ namespace grid
     }
 
     // get grid dimensions
+    grid_dimensions.clear();
     grid_dimensions.push_back(scaled_map.x_bounds.at(1) - scaled_map.x_bounds.at(0));
     grid_dimensions.push_back(scaled_map.y_bounds.at(1) - scaled_map.y_bounds.at(0));
   }
 
-  bool Grid::cell_near_boarder(rigid2d::Vector2D center, double threshold)
+  bool Grid::cell_near_boarder(double center, int length, double threshold) const
   {
-    bool collides = false;
-
-    auto boarder = scaled_map.map_vector;
-
-    boarder.push_back(scaled_map.map_vector.at(0));
-
-    for(unsigned int i = 0; i < scaled_map.map_vector.size(); i++)
-    {
-      collides = collision::point_to_line_distance(boarder.at(i), boarder.at(i+1), center, threshold);
-      if(collides) return collides;
-    }
-
-    return collides;
+    return center <= threshold || (length - center) <= threshold;
   }
 
 }
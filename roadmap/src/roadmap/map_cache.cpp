@@ -0,0 +1,247 @@
+/// \file
+/// \brief A versioned binary file format to cache built grids and road maps, loaded by memory mapping the file
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "roadmap/graph.hpp"
+#include "roadmap/map_cache.hpp"
+
+namespace cache
+{
+  /// \brief The magic string at the start of every file
+  static constexpr char magic[8] = "MAPCACH";
+
+  /// \brief Marks the byte order of the writer
+  static constexpr std::uint32_t byte_order = 0x01020304;
+
+  /// \brief FNV-1a 64 bit offset basis
+  static constexpr std::uint64_t fnv_offset = 14695981039346656037ull;
+
+  /// \brief FNV-1a 64 bit prime
+  static constexpr std::uint64_t fnv_prime = 1099511628211ull;
+
+  Hasher::Hasher() : hash(fnv_offset)
+  {
+    add(static_cast<std::uint64_t>(format_version));
+  }
+
+  Hasher & Hasher::add(const void * data, std::size_t size)
+  {
+    const auto * bytes = static_cast<const unsigned char *>(data);
+
+    for(std::size_t i = 0; i < size; i++)
+    {
+      hash ^= bytes[i];
+      hash *= fnv_prime;
+    }
+
+    return *this;
+  }
+
+  Hasher & Hasher::add(double value)
+  {
+    // -0 and 0 build the same map
+    if(value == 0) value = 0;
+
+    return add(&value, sizeof(value));
+  }
+
+  Hasher & Hasher::add(std::uint64_t value)
+  {
+    return add(&value, sizeof(value));
+  }
+
+  Hasher & Hasher::add(const std::vector<double> & values)
+  {
+    add(static_cast<std::uint64_t>(values.size()));
+
+    for(const auto value : values) add(value);
+
+    return *this;
+  }
+
+  Hasher & Hasher::add(const std::vector<std::vector<rigid2d::Vector2D>> & polygons)
+  {
+    add(static_cast<std::uint64_t>(polygons.size()));
+
+    for(const auto & polygon : polygons)
+    {
+      add(static_cast<std::uint64_t>(polygon.size()));
+
+      for(const auto & vertex : polygon) add(vertex.x).add(vertex.y);
+    }
+
+    return *this;
+  }
+
+  std::uint64_t Hasher::value() const
+  {
+    return hash;
+  }
+
+  MappedFile::~MappedFile()
+  {
+    close();
+  }
+
+  bool MappedFile::open(const std::string & file_name)
+  {
+    close();
+
+    const int fd = ::open(file_name.c_str(), O_RDONLY);
+
+    if(fd < 0) return false;
+
+    struct stat info;
+
+    if(::fstat(fd, &info) != 0 || info.st_size <= 0)
+    {
+      ::close(fd);
+      return false;
+    }
+
+    void * mapped = ::mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+    // the mapping stays valid after the file is closed
+    ::close(fd);
+
+    if(mapped == MAP_FAILED) return false;
+
+    bytes = static_cast<const unsigned char *>(mapped);
+    length = info.st_size;
+
+    return true;
+  }
+
+  void MappedFile::close()
+  {
+    if(bytes) ::munmap(const_cast<unsigned char *>(bytes), length);
+
+    bytes = nullptr;
+    length = 0;
+  }
+
+  const unsigned char * MappedFile::data() const
+  {
+    return bytes;
+  }
+
+  std::size_t MappedFile::size() const
+  {
+    return length;
+  }
+
+  Writer::Writer(Kind kind, std::uint64_t key)
+  {
+    Header header;
+
+    std::memcpy(header.magic, magic, sizeof(header.magic));
+    header.version = format_version;
+    header.byte_order = byte_order;
+    header.kind = static_cast<std::uint32_t>(kind);
+    header.reserved = 0;
+    header.key = key;
+    header.size = 0;
+
+    append(header);
+  }
+
+  bool Writer::write(const std::string & file_name)
+  {
+    // record the final size, so a truncated file is never read
+    const std::uint64_t size = buffer.size();
+    std::memcpy(buffer.data() + offsetof(Header, size), &size, sizeof(size));
+
+    const std::string temp_name = file_name + ".tmp" + std::to_string(::getpid());
+
+    {
+      std::ofstream out(temp_name, std::ios::binary | std::ios::trunc);
+
+      if(!out) return false;
+
+      out.write(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+
+      if(!out)
+      {
+        std::remove(temp_name.c_str());
+        return false;
+      }
+    }
+
+    if(std::rename(temp_name.c_str(), file_name.c_str()) != 0)
+    {
+      std::remove(temp_name.c_str());
+      return false;
+    }
+
+    return true;
+  }
+
+  Reader::Reader(const MappedFile & file, Kind kind, std::uint64_t key) : file(file)
+  {
+    if(!file.data() || file.size() < sizeof(Header)) return;
+
+    Header header;
+    std::memcpy(&header, file.data(), sizeof(Header));
+
+    ok = std::memcmp(header.magic, magic, sizeof(header.magic)) == 0 && header.version == format_version && header.byte_order == byte_order
+         && header.kind == static_cast<std::uint32_t>(kind) && header.key == key && header.size == file.size();
+
+    offset = sizeof(Header);
+  }
+
+  bool Reader::good() const
+  {
+    return ok;
+  }
+
+  void write_graph(Writer & writer, const graph::CSRGraph & g)
+  {
+    const std::int32_t sizes[2] = {g.size(), g.num_edges()};
+    writer.append(sizes, 2);
+
+    writer.append(g.edge_offsets().data(), g.edge_offsets().size());
+    writer.append(g.edge_neighbors().data(), g.edge_neighbors().size());
+    writer.append(g.edge_weights().data(), g.edge_weights().size());
+    writer.append(g.x_coords().data(), g.x_coords().size());
+    writer.append(g.y_coords().data(), g.y_coords().size());
+  }
+
+  bool read_graph(Reader & reader, graph::CSRGraph & g)
+  {
+    const std::int32_t * sizes = reader.next<std::int32_t>(2);
+
+    if(!sizes || sizes[0] < 0 || sizes[1] < 0) return false;
+
+    const int n_nodes = sizes[0], n_edges = sizes[1];
+
+    const auto * offsets = reader.next<std::int32_t>(static_cast<std::size_t>(n_nodes) + 1);
+    const auto * neighbors = reader.next<std::int32_t>(n_edges);
+    const auto * weights = reader.next<double>(n_edges);
+    const auto * x = reader.next<double>(n_nodes);
+    const auto * y = reader.next<double>(n_nodes);
+
+    if(!reader.good()) return false;
+
+    return g.assign(n_nodes, n_edges, offsets, neighbors, weights, x, y);
+  }
+
+  std::string cache_file(const std::string & directory, const std::string & prefix, std::uint64_t key)
+  {
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(key));
+
+    return directory + "/" + prefix + "_" + hex + ".bin";
+  }
+}
@@ -0,0 +1,117 @@
+/// \file
+/// \brief Track the markers drawn each frame so only the markers that changed are published
+
+#include <utility>
+#include <vector>
+
+#include "geometry_msgs/Point.h"
+#include "roadmap/marker_tracker.hpp"
+
+namespace utility
+{
+  /// \brief Compare two points exactly
+  /// \param a the first point
+  /// \param b the second point
+  /// \returns True if the coordinates are equal
+  static bool same_point(const geometry_msgs::Point & a, const geometry_msgs::Point & b)
+  {
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+  }
+
+  /// \brief Compare two colors exactly
+  /// \param a the first color
+  /// \param b the second color
+  /// \returns True if the color values are equal
+  static bool same_color(const std_msgs::ColorRGBA & a, const std_msgs::ColorRGBA & b)
+  {
+    return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+  }
+
+  /// \brief Compare everything rviz draws for two markers, the time stamps are ignored
+  /// \param a the first marker
+  /// \param b the second marker
+  /// \returns True if both markers look the same
+  static bool same_marker(const visualization_msgs::Marker & a, const visualization_msgs::Marker & b)
+  {
+    if(a.type != b.type || a.action != b.action || a.header.frame_id != b.header.frame_id) return false;
+
+    if(!same_point(a.pose.position, b.pose.position)) return false;
+
+    const auto & qa = a.pose.orientation, & qb = b.pose.orientation;
+    if(qa.x != qb.x || qa.y != qb.y || qa.z != qb.z || qa.w != qb.w) return false;
+
+    if(a.scale.x != b.scale.x || a.scale.y != b.scale.y || a.scale.z != b.scale.z) return false;
+
+    if(!same_color(a.color, b.color)) return false;
+
+    if(a.points.size() != b.points.size() || a.colors.size() != b.colors.size()) return false;
+
+    for(unsigned int i = 0; i < a.points.size(); i++)
+    {
+      if(!same_point(a.points[i], b.points[i])) return false;
+    }
+
+    for(unsigned int i = 0; i < a.colors.size(); i++)
+    {
+      if(!same_color(a.colors[i], b.colors[i])) return false;
+    }
+
+    return true;
+  }
+
+  /// \brief Create a marker that deletes a published marker
+  /// \param marker the published marker
+  /// \returns a DELETE marker with the frame, namespace, and id of the marker
+  static visualization_msgs::Marker make_delete(const visualization_msgs::Marker & marker)
+  {
+    visualization_msgs::Marker buf;
+
+    buf.header = marker.header;
+    buf.ns = marker.ns;
+    buf.id = marker.id;
+    buf.action = visualization_msgs::Marker::DELETE;
+
+    return buf;
+  }
+
+  void MarkerTracker::draw(visualization_msgs::Marker marker)
+  {
+    Key key(marker.ns, marker.id);
+
+    frame[std::move(key)] = std::move(marker);
+  }
+
+  bool MarkerTracker::flush(visualization_msgs::MarkerArray & msg)
+  {
+    msg.markers.clear();
+
+    // both maps are sorted by namespace and id, so walk them together
+    auto old_it = shown.begin();
+
+    for(const auto & drawn : frame)
+    {
+      // delete the markers that were skipped this frame
+      for(; old_it != shown.end() && old_it->first < drawn.first; old_it++) msg.markers.push_back(make_delete(old_it->second));
+
+      const bool found = old_it != shown.end() && old_it->first == drawn.first;
+
+      if(resend || !found || !same_marker(old_it->second, drawn.second)) msg.markers.push_back(drawn.second);
+
+      if(found) old_it++;
+    }
+
+    for(; old_it != shown.end(); old_it++) msg.markers.push_back(make_delete(old_it->second));
+
+    shown.swap(frame);
+    frame.clear();
+    resend = false;
+
+    return !msg.markers.empty();
+  }
+
+  void MarkerTracker::reset()
+  {
+    // the published markers are kept, so the markers that are not drawn again are still deleted
+    resend = true;
+  }
+}
@@ -2,39 +2,133 @@
 /// \brief A library for building a Probabilistic Road Map
 
 #include <algorithm>
-#include <functional>
-#include <iostream>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
 #include <random>
 #include <unordered_set>
 #include <vector>
 
 #include "roadmap/prm.hpp"
 #include "roadmap/collision.hpp"
+#include "roadmap/collision_world.hpp"
+#include "roadmap/graph.hpp"
+#include "roadmap/map_cache.hpp"
+#include "roadmap/parallel.hpp"
+#include "roadmap/spatial_index.hpp"
+#include "roadmap/stats.hpp"
 #include "rigid2d/rigid2d.hpp"
 
 namespace prm
 {
 
-  /// \brief Create a twister for random sampling
-  /// \returns a twister for random sampling
-  static std::mt19937 & get_random()
+  /// \brief The number of candidate samples drawn from each random stream when sampling the configuration space
+  static constexpr unsigned int sample_block = 256;
+
+  graph::CSRGraph to_graph(const std::vector<Node> & nodes)
+  {
+    graph::CSRGraph output;
+
+    int edge_total = 0;
+    for(const auto & node : nodes) edge_total += node.edges.size();
+
+    output.reserve(nodes.size(), edge_total);
+
+    for(const auto & node : nodes)
+    {
+      output.add_node(node.point);
+
+      // the edges of each node are stored with the node as node1
+      for(const auto & edge : node.edges)
+      {
+        output.add_edge(edge.node2_id, edge.distance);
+      }
+    }
+
+    return output;
+  }
+
+  std::vector<Node> to_nodes(const graph::CSRGraph & g)
   {
-      // static variables inside a function are created once and persist for the remainder of the program
-      static std::random_device rd{};
-      static std::mt19937 mt{rd()};
-      // we return a reference to the pseudo-random number genrator object. This is always the
-      // same object every time get_random is called
-      return mt;
+    std::vector<Node> output(g.size());
+
+    for(int i = 0; i < g.size(); i++)
+    {
+      output.at(i).id = i;
+      output.at(i).point = g.point(i);
+    }
+
+    // number the edges in the same order as to_edges, so both directions of an edge share an ID
+    int edge_cnt = 0;
+    std::vector<std::vector<int>> edge_ids(g.size());
+
+    for(int i = 0; i < g.size(); i++)
+    {
+      auto & node = output.at(i);
+
+      node.edges.reserve(g.degree(i));
+      node.id_set.reserve(g.degree(i));
+      edge_ids.at(i).reserve(g.degree(i));
+
+      g.for_each_neighbor(i, [&](int j, double w)
+      {
+        Edge buf_edge;
+
+        if(i < j) buf_edge.edge_id = edge_cnt++;
+        else
+        {
+          // find the ID assigned when the reverse edge was numbered
+          const auto & rev_ids = edge_ids.at(j);
+          int k = 0;
+          g.for_each_neighbor(j, [&](int n, double)
+          {
+            if(n == i) buf_edge.edge_id = rev_ids.at(k);
+            k++;
+          });
+        }
+
+        edge_ids.at(i).push_back(buf_edge.edge_id);
+
+        buf_edge.node1_id = i;
+        buf_edge.node1 = node.point;
+        buf_edge.node2_id = j;
+        buf_edge.node2 = output.at(j).point;
+        buf_edge.distance = w;
+
+        node.edges.push_back(buf_edge);
+        node.id_set.insert(j);
+      });
+    }
+
+    return output;
   }
 
-  /// \brief Sample a random value between the provided limits
-  /// \param llim the lower bound of the range
-  /// \param ulim the upper bound of the range
-  /// \returns a random value
-  double sampleUniformDistribution(double llim, double ulim)
+  std::vector<Edge> to_edges(const graph::CSRGraph & g)
   {
-    std::uniform_real_distribution<> d(llim, ulim);
-    return d(get_random());
+    std::vector<Edge> output;
+
+    for(int i = 0; i < g.size(); i++)
+    {
+      g.for_each_neighbor(i, [&](int j, double w)
+      {
+        if(i < j)
+        {
+          Edge buf_edge;
+
+          buf_edge.edge_id = output.size();
+          buf_edge.node1_id = i;
+          buf_edge.node1 = g.point(i);
+          buf_edge.node2_id = j;
+          buf_edge.node2 = g.point(j);
+          buf_edge.distance = w;
+
+          output.push_back(buf_edge);
+        }
+      });
+    }
+
+    return output;
   }
 
   // ===========================================================================
@@ -45,12 +139,14 @@ namespace prm
   {
     x_bounds = {0, 10};
     y_bounds = {0, 10};
+    index_nodes();
   }
 
   RoadMap::RoadMap(std::vector<double> xboundary,std::vector<double> yboundary)
   {
     x_bounds = xboundary;
     y_bounds = yboundary;
+    index_nodes();
   }
 
   RoadMap::RoadMap(std::vector<std::vector<rigid2d::Vector2D>> polygon_verticies, std::vector<double> xboundary,std::vector<double> yboundary)
@@ -58,27 +154,61 @@ namespace prm
     x_bounds = xboundary;
     y_bounds = yboundary;
     obstacles = polygon_verticies;
+    obstacle_world = collision::CollisionWorld(obstacles, buffer_radius);
+    index_nodes();
   }
 
-  void RoadMap::build_map(unsigned int samples, unsigned int k_neighbors, double robot_radius)
+  void RoadMap::build_map(unsigned int samples, unsigned int k_neighbors, double robot_radius, unsigned int threads)
   {
     buffer_radius = robot_radius;
     k = k_neighbors;
     n = samples;
-    sample_config_space();
 
-    for(auto & node : nodes)
+    // prepare the obstacles for the new buffer radius
+    obstacle_world = collision::CollisionWorld(obstacles, buffer_radius);
+
+    if(!seeded) seed = std::random_device{}();
+
+    {
+      STATS_PHASE(build_stats, "sample");
+      sample_config_space(threads);
+    }
+
+    // index all of the samples before connecting them
     {
-      connect_node(node);
+      STATS_PHASE(build_stats, "index");
+      index_nodes();
     }
+
+    STATS_PHASE(build_stats, "connect");
+    connect_nodes(threads);
+  }
+
+  void RoadMap::set_seed(unsigned int sample_seed)
+  {
+    seed = sample_seed;
+    seeded = true;
+  }
+
+  void RoadMap::set_lazy(bool lazy_edges)
+  {
+    lazy = lazy_edges;
+  }
+
+  bool RoadMap::is_lazy() const
+  {
+    return lazy;
   }
 
   bool RoadMap::add_node(rigid2d::Vector2D point)
   {
+    STATS_PHASE(build_stats, "add_node");
+
     Node output;
 
     // check if provided point is valid
     bool valid = node_collisions(point);
+    STATS_ADD(build_stats.collision_checks, 1);
 
     // Add Node to the Road Map or return false
     if(valid)
@@ -90,14 +220,124 @@ namespace prm
       connect_node(output);
 
       nodes.push_back(output);
-      
+      node_index.insert(output.id, output.point);
+
       return true;
     }
-    else
+    else return false;
+  }
+
+  int RoadMap::attach(graph::QueryGraph & query, const rigid2d::Vector2D & point) const
+  {
+    if(!node_collisions(point)) return -1;
+
+    const int first_query = query.base() ? query.base()->size() : 0;
+    const int id = query.add_node(point);
+
+    // candidate edges to the nearest nodes of the map
+    const auto knn = node_index.nearest(point, k);
+
+    std::vector<spatial::Neighbor> candidates(knn.begin(), knn.end());
+    const double reach = knn.empty() ? std::numeric_limits<double>::infinity() : knn.back().first;
+
+    // and to the other query points in the same range, so a start and goal in sight of each other connect directly
+    for(int q = first_query; q < id; q++)
+    {
+      const double d = point.distance(query.point(q));
+      if(d <= reach) candidates.push_back(spatial::Neighbor(d, q));
+    }
+
+    std::vector<rigid2d::Vector2D> starts, ends;
+
+    for(const auto & match : candidates)
     {
-      std::cout << "Provided Point is invalid!" << std::endl;
-      return false;
+      starts.push_back(point);
+      ends.push_back(query.point(match.second));
     }
+
+    // check all of the candidate edges for collisions at once
+    std::vector<unsigned char> collides;
+    obstacle_world.segments_collide(starts, ends, collides);
+
+    for(unsigned int c = 0; c < candidates.size(); c++)
+    {
+      if(!collides.at(c)) query.add_edge(id, candidates.at(c).second, candidates.at(c).first);
+    }
+
+    return id;
+  }
+
+  const stats::Stats & RoadMap::get_stats() const
+  {
+    return build_stats;
+  }
+
+  void RoadMap::reset_stats()
+  {
+    build_stats.reset();
+  }
+
+  std::uint64_t RoadMap::get_cache_key(unsigned int samples, unsigned int k_neighbors, double robot_radius) const
+  {
+    cache::Hasher hasher;
+
+    hasher.add(static_cast<std::uint64_t>(cache::Kind::road_map));
+    hasher.add(obstacles).add(x_bounds).add(y_bounds);
+    hasher.add(static_cast<std::uint64_t>(samples)).add(static_cast<std::uint64_t>(k_neighbors)).add(robot_radius);
+    hasher.add(static_cast<std::uint64_t>(seeded)).add(static_cast<std::uint64_t>(seed)).add(static_cast<std::uint64_t>(lazy));
+
+    return hasher.value();
+  }
+
+  bool RoadMap::save(const std::string & file_name, std::uint64_t key) const
+  {
+    cache::Writer writer(cache::Kind::road_map, key);
+
+    const std::uint32_t params[4] = {n, k, seed, lazy};
+    writer.append(params, 4);
+    writer.append(buffer_radius);
+
+    cache::write_graph(writer, to_graph(nodes));
+
+    return writer.write(file_name);
+  }
+
+  bool RoadMap::load(const std::string & file_name, std::uint64_t key)
+  {
+    STATS_PHASE(build_stats, "load");
+
+    cache::MappedFile file;
+
+    if(!file.open(file_name)) return false;
+
+    cache::Reader reader(file, cache::Kind::road_map, key);
+
+    const std::uint32_t * params = reader.next<std::uint32_t>(4);
+
+    double file_buffer_radius = 0;
+    reader.next(file_buffer_radius);
+
+    graph::CSRGraph graph;
+
+    if(!reader.good() || !cache::read_graph(reader, graph)) return false;
+
+    n = params[0];
+    k = params[1];
+    seed = params[2];
+    lazy = params[3];
+    buffer_radius = file_buffer_radius;
+
+    nodes = to_nodes(graph);
+    all_edges = to_edges(graph);
+
+    node_cnt = nodes.size();
+    edge_cnt = all_edges.size();
+
+    // prepare the obstacles for attach and add_node
+    obstacle_world = collision::CollisionWorld(obstacles, buffer_radius);
+    index_nodes();
+
+    return true;
   }
 
   std::vector<Node> RoadMap::get_nodes() const
@@ -110,144 +350,222 @@ namespace prm
     return all_edges;
   }
 
+  graph::CSRGraph RoadMap::get_graph() const
+  {
+    return to_graph(nodes);
+  }
+
   // PRIVATE MEMBER FUNCTIONS
-  void RoadMap::sample_config_space()
+  void RoadMap::sample_config_space(unsigned int threads)
   {
-    Node buf_node;
-    rigid2d::Vector2D buf_point;
-    bool valid = true;
+    unsigned int block_cnt = 0;
 
     // Sample Configuration space until n valid nodes are created
     while(node_cnt < n)
     {
-      buf_point.x = sampleUniformDistribution(x_bounds.at(0) + buffer_radius, x_bounds.at(1) - buffer_radius);
-      buf_point.y = sampleUniformDistribution(y_bounds.at(0) + buffer_radius, y_bounds.at(1) - buffer_radius);
+      const unsigned int n_blocks = (n - node_cnt + sample_block - 1) / sample_block;
 
-      // Check if the node is inside an obstacle
-      valid = node_collisions(buf_point);
+      std::vector<std::vector<rigid2d::Vector2D>> valid_points(n_blocks);
 
-      // Add Node to the Road Map
-      if(valid)
+      // each block draws from a stream seeded by the map seed and the block number, so the samples do not depend on the thread count
+      parallel::parallel_for(0, n_blocks, threads, [&](int b)
       {
-        buf_node.id = node_cnt;
-        buf_node.point = buf_point;
-        node_cnt++;
+        std::seed_seq block_seed{seed, block_cnt + b};
+        std::mt19937 mt(block_seed);
 
-        nodes.push_back(buf_node);
-      }
+        std::uniform_real_distribution<> x_dist(x_bounds.at(0) + buffer_radius, x_bounds.at(1) - buffer_radius);
+        std::uniform_real_distribution<> y_dist(y_bounds.at(0) + buffer_radius, y_bounds.at(1) - buffer_radius);
 
-    }
-  }
+        double xs[sample_block], ys[sample_block];
+        unsigned char status[sample_block];
 
-  bool RoadMap::node_collisions(rigid2d::Vector2D point)
-  {
-    bool valid_node = true;
+        for(unsigned int i = 0; i < sample_block; i++)
+        {
+          xs[i] = x_dist(mt);
+          ys[i] = y_dist(mt);
+        }
 
-    // Loop through each line segments
-    for(auto obstacle : obstacles)
-    {
-      auto collides = collision::point_inside_convex(point, obstacle, buffer_radius);
+        // Check which of the nodes are inside an obstacle
+        obstacle_world.classify_points(xs, ys, sample_block, status);
 
-      if(collides.at(0))
+        for(unsigned int i = 0; i < sample_block; i++)
+        {
+          if(status[i] == collision::free_space) valid_points.at(b).push_back(rigid2d::Vector2D(xs[i], ys[i]));
+        }
+      });
+
+      block_cnt += n_blocks;
+      STATS_ADD(build_stats.collision_checks, n_blocks * sample_block);
+
+      // Add the valid samples to the Road Map in block order
+      for(const auto & block : valid_points)
       {
-        valid_node = false;
-        break;
+        for(const auto & point : block)
+        {
+          if(node_cnt >= n) break;
+
+          Node buf_node;
+          buf_node.id = node_cnt;
+          buf_node.point = point;
+          node_cnt++;
+
+          nodes.push_back(buf_node);
+        }
       }
     }
-
-    return valid_node;
   }
 
+  bool RoadMap::node_collisions(rigid2d::Vector2D point) const
+  {
+    return !obstacle_world.point_collides(point);
+  }
 
   void RoadMap::connect_node(Node &node)
   {
     // Find k nearest neighbors
-    const auto knn = nearest_neighbors_bf(node);
+    const auto knn = node_index.nearest(node.point, k, node.id);
 
     // Evaluate each match
-    for(auto & qp : knn)
+    for(const auto & match : knn)
     {
+      Node & qp = nodes.at(match.second);
+
       // If the edge does not exist and if the two nodes are atleast 15cm apart, create an edge
-      if(!node.IsConnected(qp.get().id) && qp.get().distance > buffer_radius)
+      if(!node.IsConnected(qp.id) && match.first > buffer_radius)
       {
-
         // Create a temporary edge
         Edge buf_edge;
 
-        buf_edge.edge_id = edge_cnt;
-
         buf_edge.node1_id = node.id;
         buf_edge.node1 = node.point;
 
-        buf_edge.node2_id = qp.get().id;
-        buf_edge.node2 = qp.get().point;
+        buf_edge.node2_id = qp.id;
+        buf_edge.node2 = qp.point;
 
-        buf_edge.distance = qp.get().distance;
+        // check for path collisions with the obstacles, a lazy map leaves the check to the search
+        if(!lazy) STATS_ADD(build_stats.collision_checks, 1);
+        if(lazy || edge_collisions(buf_edge)) create_edge(node, qp, match.first);
+      }
+    }
+  }
 
-        // check for path collisions with the obstacles
-        bool valid_edge = edge_collisions(buf_edge);
+  void RoadMap::connect_nodes(unsigned int threads)
+  {
+    const int total = nodes.size();
 
-        // check for robot collision with the obstacles
+    // Find the k nearest neighbors of every node, the index is only read so the queries can run at the same time
+    std::vector<std::vector<spatial::Neighbor>> knn(total);
 
-        if(valid_edge)
-        {
-          all_edges.push_back(buf_edge);
+    parallel::parallel_for(0, total, threads, [&](int i)
+    {
+      knn.at(i) = node_index.nearest(nodes.at(i).point, k, i);
+    });
+
+    // Check each potential edge for collisions, storing the valid ones per node
+    std::vector<std::vector<spatial::Neighbor>> valid_edges(total);
+    std::vector<unsigned int> checked(total, 0);
+
+    parallel::parallel_for(0, total, threads, [&](int i)
+    {
+      std::vector<spatial::Neighbor> candidates;
+      std::vector<rigid2d::Vector2D> starts, ends;
+
+      for(const auto & match : knn.at(i))
+      {
+        const int j = match.second;
 
-          // add edge to node
-          node.edges.push_back(buf_edge);
+        // If the edge does not exist and if the two nodes are atleast 15cm apart, consider an edge
+        if(nodes.at(i).IsConnected(j) || match.first <= buffer_radius) continue;
 
-          // switch 1 and 2 and add to second node
-          buf_edge.node1_id = buf_edge.node2_id;
-          buf_edge.node1 = buf_edge.node2;
-          buf_edge.node2_id = node.id;
-          buf_edge.node2 = node.point;
+        // A pair found by both nodes is only checked by the lower ID
+        if(j < i && std::any_of(knn.at(j).begin(), knn.at(j).end(), [i](const spatial::Neighbor & m){ return m.second == i; })) continue;
 
-          qp.get().edges.push_back(buf_edge);
+        candidates.push_back(match);
+      }
 
-          // add connected node ids to the unordered sets
-          node.id_set.insert(qp.get().id);
-          qp.get().id_set.insert(node.id);
+      // check all of the candidate edges of the node for collisions at once, a lazy map leaves the checks to the search
+      std::vector<unsigned char> collides(candidates.size(), 0);
 
-          edge_cnt++;
+      if(!lazy)
+      {
+        for(const auto & match : candidates)
+        {
+          starts.push_back(nodes.at(i).point);
+          ends.push_back(nodes.at(match.second).point);
         }
+
+        obstacle_world.segments_collide(starts, ends, collides);
+        checked.at(i) = candidates.size();
+      }
+
+      for(unsigned int c = 0; c < candidates.size(); c++)
+      {
+        if(!collides.at(c)) valid_edges.at(i).push_back(candidates.at(c));
+      }
+    });
+
+    STATS_ADD(build_stats.collision_checks, std::accumulate(checked.begin(), checked.end(), 0ull));
+
+    // Add the edges in node order so the edge IDs do not depend on the thread count
+    for(int i = 0; i < total; i++)
+    {
+      for(const auto & match : valid_edges.at(i))
+      {
+        create_edge(nodes.at(i), nodes.at(match.second), match.first);
       }
     }
   }
 
-  std::vector<std::reference_wrapper<Node>> RoadMap::nearest_neighbors_bf(const Node &node)
+  void RoadMap::create_edge(Node & node1, Node & node2, double distance)
   {
-    // calculate the distance between all nodes
-    for(auto & qp : nodes)
-    {
-      qp.distance = node.point.distance(qp.point);
-    }
+    Edge buf_edge;
 
-    // create a vector of references to the elements of the nodes vector
-    std::vector<std::reference_wrapper<Node>> input(nodes.begin(), nodes.end());
+    buf_edge.edge_id = edge_cnt;
 
-    // Sort the references by the calculated distance
-    std::sort(input.begin(), input.end(), [](std::reference_wrapper<Node> lhs, std::reference_wrapper<Node> rhs) {return lhs.get().distance < rhs.get().distance;});
+    buf_edge.node1_id = node1.id;
+    buf_edge.node1 = node1.point;
 
-    std::vector<std::reference_wrapper<Node>> output(input.begin()+1, input.begin()+1+k);
+    buf_edge.node2_id = node2.id;
+    buf_edge.node2 = node2.point;
 
-    return output;
+    buf_edge.distance = distance;
+
+    all_edges.push_back(buf_edge);
+
+    // add edge to node
+    node1.edges.push_back(buf_edge);
+
+    // switch 1 and 2 and add to second node
+    buf_edge.node1_id = node2.id;
+    buf_edge.node1 = node2.point;
+    buf_edge.node2_id = node1.id;
+    buf_edge.node2 = node1.point;
+
+    node2.edges.push_back(buf_edge);
+
+    // add connected node ids to the unordered sets
+    node1.id_set.insert(node2.id);
+    node2.id_set.insert(node1.id);
+
+    edge_cnt++;
   }
 
-  bool RoadMap::edge_collisions(Edge edge)
+  void RoadMap::index_nodes()
   {
-    bool valid_edge = true;
-    bool collides = true;
-    // Loop through each obstacle
-    for(auto obstacle : obstacles)
-    {
-      collides = collision::line_shape_intersection(edge.node1, edge.node2, obstacle, buffer_radius);
+    // size the buckets to hold about 2 nodes each when the map is fully sampled
+    const double area = (x_bounds.at(1) - x_bounds.at(0)) * (y_bounds.at(1) - y_bounds.at(0));
+    const double expected = std::max<double>({static_cast<double>(n), static_cast<double>(nodes.size()), 1.0});
 
-      if(collides)
-      {
-        valid_edge = false;
-        break;
-      }
+    node_index = spatial::BucketGrid(x_bounds, y_bounds, std::sqrt(2.0 * area / expected));
+
+    for(const auto & node : nodes)
+    {
+      node_index.insert(node.id, node.point);
     }
-    return valid_edge;
+  }
+
+  bool RoadMap::edge_collisions(Edge edge) const
+  {
+    return !obstacle_world.segment_collides(edge.node1, edge.node2);
   }
 }
@@ -0,0 +1,184 @@
+/// \file
+/// \brief A library for drawing obstacles into row major rasters of unit cells
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "roadmap/parallel.hpp"
+#include "roadmap/raster.hpp"
+#include "rigid2d/rigid2d.hpp"
+
+namespace raster
+{
+  /// \brief One dimensional squared distance transform of a sampled function, the lower envelope of the parabolas rooted at each sample
+  /// \param f the sampled function
+  /// \param n the number of samples
+  /// \param d [out] the transformed values
+  /// \param v scratch space for n parabola locations
+  /// \param z scratch space for n + 1 parabola boundaries
+  static void distance_transform_1d(const double * f, int n, double * d, int * v, double * z)
+  {
+    int k = 0;
+    v[0] = 0;
+    z[0] = -std::numeric_limits<double>::infinity();
+    z[1] = std::numeric_limits<double>::infinity();
+
+    // build the lower envelope
+    for(int q = 1; q < n; q++)
+    {
+      double s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0 * (q - v[k]));
+
+      while(s <= z[k])
+      {
+        k--;
+        s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0 * (q - v[k]));
+      }
+
+      k++;
+      v[k] = q;
+      z[k] = s;
+      z[k + 1] = std::numeric_limits<double>::infinity();
+    }
+
+    // sample the lower envelope
+    k = 0;
+
+    for(int q = 0; q < n; q++)
+    {
+      while(z[k + 1] < q) k++;
+      d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+    }
+  }
+
+  bool polygon_span(const std::vector<rigid2d::Vector2D> & polygon, double y_lo, double y_hi, double & x_lo, double & x_hi)
+  {
+    bool found = false;
+
+    auto include = [&](double x)
+    {
+      if(!found)
+      {
+        x_lo = x_hi = x;
+        found = true;
+      }
+      else
+      {
+        x_lo = std::min(x_lo, x);
+        x_hi = std::max(x_hi, x);
+      }
+    };
+
+    // the part of a convex polygon inside the band is bounded by the verticies in the band and the edge crossings of the band limits
+    for(unsigned int i = 0; i < polygon.size(); i++)
+    {
+      const rigid2d::Vector2D & a = polygon.at(i);
+      const rigid2d::Vector2D & b = polygon.at((i + 1) % polygon.size());
+
+      if(a.y >= y_lo && a.y <= y_hi) include(a.x);
+
+      for(const double y : {y_lo, y_hi})
+      {
+        if((a.y - y) * (b.y - y) < 0) include(a.x + (y - a.y) * (b.x - a.x) / (b.y - a.y));
+      }
+    }
+
+    return found;
+  }
+
+  void fill_polygons(const std::vector<std::vector<rigid2d::Vector2D>> & polygons, int width, int height, bool conservative, signed char value,
+                     signed char * data, unsigned int threads)
+  {
+    // y bounds of each polygon to skip the rows it does not cover
+    std::vector<double> y_min, y_max;
+
+    for(const auto & polygon : polygons)
+    {
+      const auto range = std::minmax_element(polygon.begin(), polygon.end(),
+                                             [](const rigid2d::Vector2D & a, const rigid2d::Vector2D & b){ return a.y < b.y; });
+
+      y_min.push_back(polygon.empty() ? 0.0 : range.first->y);
+      y_max.push_back(polygon.empty() ? -1.0 : range.second->y);
+    }
+
+    parallel::parallel_for(0, height, threads, [&](int i)
+    {
+      signed char * row = data + static_cast<long>(i) * width;
+
+      // a conservative fill covers the whole row, otherwise only the scanline through the cell centers
+      const double band_lo = conservative ? i : i + 0.5;
+      const double band_hi = conservative ? i + 1.0 : i + 0.5;
+
+      for(unsigned int p = 0; p < polygons.size(); p++)
+      {
+        if(y_max.at(p) < band_lo || y_min.at(p) > band_hi) continue;
+
+        double x_lo = 0, x_hi = 0;
+        if(!polygon_span(polygons.at(p), band_lo, band_hi, x_lo, x_hi)) continue;
+
+        int j_lo = 0, j_hi = 0;
+
+        if(conservative) // every cell overlapping the span
+        {
+          j_lo = static_cast<int>(std::floor(x_lo));
+          j_hi = std::max(j_lo, static_cast<int>(std::ceil(x_hi)) - 1);
+        }
+        else // every cell center inside the span
+        {
+          j_lo = static_cast<int>(std::ceil(x_lo - 0.5));
+          j_hi = static_cast<int>(std::floor(x_hi - 0.5));
+        }
+
+        j_lo = std::max(j_lo, 0);
+        j_hi = std::min(j_hi, width - 1);
+
+        if(j_lo <= j_hi) std::fill(row + j_lo, row + j_hi + 1, value);
+      }
+    });
+  }
+
+  void squared_distance_transform(const signed char * seeds, int width, int height, std::vector<double> & dist2, unsigned int threads)
+  {
+    dist2.resize(static_cast<long>(width) * height);
+
+    if(width <= 0 || height <= 0) return;
+
+    const int stripes = parallel::thread_count(threads);
+
+    // transform each column, each stripe of columns has its own scratch space
+    const int col_chunk = (width + stripes - 1) / stripes;
+
+    parallel::parallel_for(0, stripes, stripes, [&](int s)
+    {
+      std::vector<double> f(height), d(height), z(height + 1);
+      std::vector<int> v(height);
+
+      for(int j = s * col_chunk; j < std::min(width, (s + 1) * col_chunk); j++)
+      {
+        for(int i = 0; i < height; i++) f[i] = seeds[static_cast<long>(i) * width + j] ? 0.0 : no_seed;
+
+        distance_transform_1d(f.data(), height, d.data(), v.data(), z.data());
+
+        for(int i = 0; i < height; i++) dist2[static_cast<long>(i) * width + j] = d[i];
+      }
+    });
+
+    // transform each row of the column results
+    const int row_chunk = (height + stripes - 1) / stripes;
+
+    parallel::parallel_for(0, stripes, stripes, [&](int s)
+    {
+      std::vector<double> d(width), z(width + 1);
+      std::vector<int> v(width);
+
+      for(int i = s * row_chunk; i < std::min(height, (s + 1) * row_chunk); i++)
+      {
+        double * row = dist2.data() + static_cast<long>(i) * width;
+
+        distance_transform_1d(row, width, d.data(), v.data(), z.data());
+        std::copy(d.begin(), d.end(), row);
+      }
+    });
+  }
+}
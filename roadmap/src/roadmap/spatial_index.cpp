@@ -0,0 +1,137 @@
+/// \file
+/// \brief A library for finding nearby points in the plane
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "roadmap/spatial_index.hpp"
+#include "rigid2d/rigid2d.hpp"
+
+namespace spatial
+{
+  BucketGrid::BucketGrid(std::vector<double> xboundary, std::vector<double> yboundary, double bucket_size)
+  {
+    x_min = xboundary.at(0);
+    y_min = yboundary.at(0);
+
+    cell = (bucket_size > 0) ? bucket_size : 1.0;
+
+    n_cols = std::max(1, static_cast<int>(std::ceil((xboundary.at(1) - xboundary.at(0)) / cell)));
+    n_rows = std::max(1, static_cast<int>(std::ceil((yboundary.at(1) - yboundary.at(0)) / cell)));
+
+    buckets.resize(n_cols * n_rows);
+  }
+
+  void BucketGrid::insert(int id, const rigid2d::Vector2D & point)
+  {
+    Entry buf;
+    buf.point = point;
+    buf.id = id;
+
+    buckets.at(row(point.y) * n_cols + column(point.x)).push_back(buf);
+    n_points++;
+  }
+
+  int BucketGrid::size() const
+  {
+    return n_points;
+  }
+
+  std::vector<Neighbor> BucketGrid::nearest(const rigid2d::Vector2D & point, unsigned int k, int exclude_id) const
+  {
+    // max heap of the best matches so far, the top is the farthest of the k nearest
+    std::priority_queue<Neighbor> best;
+
+    if(k > 0)
+    {
+      const int cx = column(point.x);
+      const int cy = row(point.y);
+
+      const int max_ring = std::max(n_cols, n_rows);
+
+      // visit the buckets in square rings of increasing size around the bucket of the query point
+      for(int r = 0; r <= max_ring; r++)
+      {
+        for(int by = cy - r; by <= cy + r; by++)
+        {
+          if(by < 0 || by >= n_rows) continue;
+
+          // only the first and last rows of the ring are full, the others only have the two ends
+          const int step = (by == cy - r || by == cy + r) ? 1 : std::max(1, 2 * r);
+
+          for(int bx = cx - r; bx <= cx + r; bx += step)
+          {
+            if(bx < 0 || bx >= n_cols) continue;
+
+            for(const auto & entry : buckets[by * n_cols + bx])
+            {
+              if(entry.id == exclude_id) continue;
+
+              const Neighbor candidate(point.distance(entry.point), entry.id);
+
+              if(best.size() < k) best.push(candidate);
+              else if(candidate < best.top())
+              {
+                best.pop();
+                best.push(candidate);
+              }
+            }
+          }
+        }
+
+        // every bucket outside of ring r is at least r buckets away from the query point
+        if(best.size() == k && best.top().first < r * cell) break;
+      }
+    }
+
+    // empty the heap from farthest to nearest
+    std::vector<Neighbor> output(best.size());
+
+    for(auto it = output.rbegin(); it != output.rend(); it++)
+    {
+      *it = best.top();
+      best.pop();
+    }
+
+    return output;
+  }
+
+  std::vector<Neighbor> BucketGrid::within_radius(const rigid2d::Vector2D & point, double radius, int exclude_id) const
+  {
+    std::vector<Neighbor> output;
+
+    // visit every bucket overlapping the square around the circle
+    for(int by = row(point.y - radius); by <= row(point.y + radius); by++)
+    {
+      for(int bx = column(point.x - radius); bx <= column(point.x + radius); bx++)
+      {
+        for(const auto & entry : buckets[by * n_cols + bx])
+        {
+          if(entry.id == exclude_id) continue;
+
+          const double d = point.distance(entry.point);
+          if(d <= radius) output.emplace_back(d, entry.id);
+        }
+      }
+    }
+
+    std::sort(output.begin(), output.end());
+
+    return output;
+  }
+
+  int BucketGrid::column(double x) const
+  {
+    const int c = static_cast<int>(std::floor((x - x_min) / cell));
+    return std::min(std::max(c, 0), n_cols - 1);
+  }
+
+  int BucketGrid::row(double y) const
+  {
+    const int r = static_cast<int>(std::floor((y - y_min) / cell));
+    return std::min(std::max(r, 0), n_rows - 1);
+  }
+}
@@ -0,0 +1,78 @@
+/// \file
+/// \brief Lightweight counters and phase timers for the planners
+
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+#include "roadmap/stats.hpp"
+
+namespace stats
+{
+  /// \brief Find a phase by name, adding it if it has not run yet
+  /// \param phases the phases to search
+  /// \param name the name of the phase
+  /// \returns a reference to the phase
+  static Phase & find_phase(std::vector<Phase> & phases, const char * name)
+  {
+    for(auto & phase : phases)
+    {
+      if(std::strcmp(phase.name, name) == 0) return phase;
+    }
+
+    Phase buf;
+    buf.name = name;
+
+    phases.push_back(buf);
+
+    return phases.back();
+  }
+
+  void Stats::add_time(const char * name, double seconds)
+  {
+    Phase & phase = find_phase(phases, name);
+
+    phase.calls++;
+    phase.seconds += seconds;
+  }
+
+  double Stats::get_time(const char * name) const
+  {
+    for(const auto & phase : phases)
+    {
+      if(std::strcmp(phase.name, name) == 0) return phase.seconds;
+    }
+
+    return 0;
+  }
+
+  void Stats::reset()
+  {
+    *this = Stats();
+  }
+
+  Stats & Stats::operator+=(const Stats & rhs)
+  {
+    expansions += rhs.expansions;
+    heap_pushes += rhs.heap_pushes;
+    heap_pops += rhs.heap_pops;
+    collision_checks += rhs.collision_checks;
+    los_checks += rhs.los_checks;
+    los_cache_hits += rhs.los_cache_hits;
+
+    for(const auto & other : rhs.phases)
+    {
+      Phase & phase = find_phase(phases, other.name);
+
+      phase.calls += other.calls;
+      phase.seconds += other.seconds;
+    }
+
+    return *this;
+  }
+
+  PhaseTimer::~PhaseTimer()
+  {
+    target.add_time(name, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+  }
+}
@@ -1,8 +1,15 @@
 
+#include <algorithm>
+#include <cmath>
 #include <vector>
+#include <string>
 #include <iostream>
 #include <XmlRpcValue.h>
+#include "diagnostic_msgs/DiagnosticStatus.h"
+#include "diagnostic_msgs/KeyValue.h"
+#include "map_msgs/OccupancyGridUpdate.h"
 #include "rigid2d/rigid2d.hpp"
+#include "roadmap/map_cache.hpp"
 #include "roadmap/utility.hpp"
 
 
@@ -73,8 +80,7 @@ namespace utility
 
   nav_msgs::OccupancyGrid make_grid_msg(grid::Grid *grid, double cell_size, double res)
   {
-    auto occ_grid = grid->get_grid_flatten();
-    auto grid_dims = grid->get_grid_dimensions();
+    const auto occ_grid = grid->get_occupancy();
 
     nav_msgs::OccupancyGrid occ_msg;
 
@@ -83,8 +89,8 @@ namespace utility
 
     occ_msg.info.map_load_time = ros::Time::now();
     occ_msg.info.resolution = cell_size/res;
-    occ_msg.info.height = grid_dims.at(1);
-    occ_msg.info.width = grid_dims.at(0);
+    occ_msg.info.height = occ_grid.height;
+    occ_msg.info.width = occ_grid.width;
 
     occ_msg.info.origin.position.x = 0;
     occ_msg.info.origin.position.y = 0;
@@ -94,11 +100,135 @@ namespace utility
     occ_msg.info.origin.orientation.z = 0;
     occ_msg.info.origin.orientation.w = 1;
 
-    occ_msg.data = occ_grid;
+    // copy straight from the grid, without a flattened copy in between
+    occ_msg.data.assign(occ_grid.data, occ_grid.data + occ_grid.size());
 
     return occ_msg;
   }
 
+  bool update_grid_msg(const grid::Grid & grid, nav_msgs::OccupancyGrid & occ_msg, map_msgs::OccupancyGridUpdate & update)
+  {
+    const auto occ_grid = grid.get_occupancy();
+    const int width = occ_grid.width;
+
+    int x_lo = width, x_hi = -1, y_lo = occ_grid.height, y_hi = -1;
+
+    if(occ_msg.data.size() != static_cast<unsigned int>(occ_grid.size()) || static_cast<int>(occ_msg.info.width) != width)
+    {
+      // the grid was rebuilt with a new size, so the whole message changes
+      occ_msg.info.width = width;
+      occ_msg.info.height = occ_grid.height;
+      occ_msg.data.assign(occ_grid.data, occ_grid.data + occ_grid.size());
+
+      x_lo = 0;
+      x_hi = width - 1;
+      y_lo = 0;
+      y_hi = occ_grid.height - 1;
+    }
+    else
+    {
+      for(int i = 0; i < occ_grid.height; i++)
+      {
+        const signed char * src = occ_grid.data + occ_grid.id(0, i);
+        auto * dst = occ_msg.data.data() + occ_grid.id(0, i);
+
+        if(std::equal(src, src + width, dst)) continue;
+
+        // find the changed span of the row and copy only it
+        int lo = 0, hi = width - 1;
+
+        while(src[lo] == dst[lo]) lo++;
+        while(src[hi] == dst[hi]) hi--;
+
+        std::copy(src + lo, src + hi + 1, dst + lo);
+
+        x_lo = std::min(x_lo, lo);
+        x_hi = std::max(x_hi, hi);
+        y_lo = std::min(y_lo, i);
+        y_hi = i;
+      }
+    }
+
+    if(y_hi < 0) return false;
+
+    occ_msg.header.stamp = ros::Time::now();
+
+    update.header = occ_msg.header;
+    update.x = x_lo;
+    update.y = y_lo;
+    update.width = x_hi - x_lo + 1;
+    update.height = y_hi - y_lo + 1;
+
+    update.data.resize(update.width * update.height);
+
+    for(int i = y_lo; i <= y_hi; i++)
+    {
+      const auto * row = occ_msg.data.data() + occ_grid.id(x_lo, i);
+      std::copy(row, row + update.width, update.data.begin() + (i - y_lo) * update.width);
+    }
+
+    return true;
+  }
+
+  /// \brief Convert an occupancy value from a message into the values used by a grid
+  /// \param value the occupancy value, -1 for unknown
+  /// \param threshold values at or above the threshold are occupied
+  /// \param unknown_occupied true if unknown values are occupied
+  /// \returns 100 if the value is occupied, otherwise 0
+  static signed char patch_value(signed char value, signed char threshold, bool unknown_occupied)
+  {
+    if(value < 0) return unknown_occupied ? 100 : 0;
+    else return (value >= threshold) ? 100 : 0;
+  }
+
+  bool make_patch(const nav_msgs::OccupancyGrid & map, const grid::Grid & grid, grid::OccupancyPatch & patch, signed char threshold,
+                  bool unknown_occupied)
+  {
+    const double res = grid.get_resolution();
+
+    if(std::fabs(map.info.resolution - res) > 1e-3 * res) return false;
+
+    patch = grid::OccupancyPatch(std::round(map.info.origin.position.x / res), std::round(map.info.origin.position.y / res),
+                                 map.info.width, map.info.height);
+
+    std::transform(map.data.begin(), map.data.begin() + std::min(map.data.size(), patch.data.size()), patch.data.begin(),
+                   [threshold, unknown_occupied](signed char value){ return patch_value(value, threshold, unknown_occupied); });
+
+    return true;
+  }
+
+  grid::OccupancyPatch make_patch(const map_msgs::OccupancyGridUpdate & update, int x_offset, int y_offset, signed char threshold,
+                                  bool unknown_occupied)
+  {
+    grid::OccupancyPatch patch(x_offset + update.x, y_offset + update.y, update.width, update.height);
+
+    std::transform(update.data.begin(), update.data.begin() + std::min(update.data.size(), patch.data.size()), patch.data.begin(),
+                   [threshold, unknown_occupied](signed char value){ return patch_value(value, threshold, unknown_occupied); });
+
+    return patch;
+  }
+
+  nav_msgs::Path make_path_msg(const std::vector<rigid2d::Vector2D> & path)
+  {
+    nav_msgs::Path path_msg;
+
+    path_msg.header.frame_id = "map";
+    path_msg.header.stamp = ros::Time::now();
+
+    for(const auto & pt : path)
+    {
+      geometry_msgs::PoseStamped pose;
+
+      pose.header = path_msg.header;
+      pose.pose.position = Vec2D_to_GeoPt(pt);
+      pose.pose.orientation.w = 1;
+
+      path_msg.poses.push_back(pose);
+    }
+
+    return path_msg;
+  }
+
   visualization_msgs::Marker make_marker(rigid2d::Vector2D robot, double scale, std::vector<double> color)
   {
     visualization_msgs::Marker marker;
@@ -286,4 +416,191 @@ namespace utility
 
     return marker;
   }
+
+  visualization_msgs::Marker make_marker(const std::vector<prm::Node> & nodes, double scale, std::vector<double> color, std::string ns)
+  {
+    visualization_msgs::Marker marker;
+
+    marker.header.frame_id = "map";
+    marker.header.stamp = ros::Time::now();
+
+    marker.ns = ns;
+    marker.id = 0;
+
+    marker.type = visualization_msgs::Marker::SPHERE_LIST;
+    marker.action = visualization_msgs::Marker::ADD;
+
+    marker.pose.orientation.x = 0;
+    marker.pose.orientation.y = 0;
+    marker.pose.orientation.z = 0;
+    marker.pose.orientation.w = 1;
+
+    marker.points.reserve(nodes.size());
+
+    for(const auto & node : nodes)
+    {
+      marker.points.push_back(Vec2D_to_GeoPt(node.point));
+    }
+
+    marker.scale.x = 0.3 * scale;
+    marker.scale.y = 0.3 * scale;
+    marker.scale.z = 0.3 * scale;
+
+    marker.color.r = color.at(0);
+    marker.color.g = color.at(1);
+    marker.color.b = color.at(2);
+    marker.color.a = 1.0;
+
+    marker.lifetime = ros::Duration();
+
+    return marker;
+  }
+
+  visualization_msgs::Marker make_marker(const std::vector<prm::Edge> & edges, double scale, std::vector<double> color, std::string ns)
+  {
+    visualization_msgs::Marker marker;
+
+    marker.header.frame_id = "map";
+    marker.header.stamp = ros::Time::now();
+
+    marker.ns = ns;
+    marker.id = 0;
+
+    marker.type = visualization_msgs::Marker::LINE_LIST;
+    marker.action = visualization_msgs::Marker::ADD;
+
+    marker.pose.orientation.x = 0;
+    marker.pose.orientation.y = 0;
+    marker.pose.orientation.z = 0;
+    marker.pose.orientation.w = 1;
+
+    // each pair of points is one line
+    marker.points.reserve(2 * edges.size());
+
+    for(const auto & edge : edges)
+    {
+      marker.points.push_back(Vec2D_to_GeoPt(edge.node1));
+      marker.points.push_back(Vec2D_to_GeoPt(edge.node2));
+    }
+
+    marker.scale.x = 0.1 * scale;
+
+    marker.color.r = color.at(0);
+    marker.color.g = color.at(1);
+    marker.color.b = color.at(2);
+    marker.color.a = 1.0;
+
+    marker.lifetime = ros::Duration();
+
+    return marker;
+  }
+
+  visualization_msgs::Marker make_path_marker(const std::vector<rigid2d::Vector2D> & path, int marker_id, double scale, std::vector<double> color, std::string ns)
+  {
+    visualization_msgs::Marker marker;
+
+    marker.header.frame_id = "map";
+    marker.header.stamp = ros::Time::now();
+
+    marker.ns = ns;
+    marker.id = marker_id;
+
+    marker.type = visualization_msgs::Marker::LINE_STRIP;
+    marker.action = visualization_msgs::Marker::ADD;
+
+    marker.pose.position.z = 0.03;
+    marker.pose.orientation.x = 0;
+    marker.pose.orientation.y = 0;
+    marker.pose.orientation.z = 0;
+    marker.pose.orientation.w = 1;
+
+    // rviz warns about a line strip with a single point
+    if(path.size() > 1)
+    {
+      marker.points.reserve(path.size());
+
+      for(const auto & pt : path)
+      {
+        marker.points.push_back(Vec2D_to_GeoPt(pt));
+      }
+    }
+
+    marker.scale.x = 0.1 * scale;
+
+    marker.color.r = color.at(0);
+    marker.color.g = color.at(1);
+    marker.color.b = color.at(2);
+    marker.color.a = 1.0;
+
+    marker.lifetime = ros::Duration();
+
+    return marker;
+  }
+
+  bool load_or_build(grid::Grid & grid, const std::string & cache_dir, double cell_size, unsigned int grid_res, double robot_radius,
+                     unsigned int threads)
+  {
+    const auto key = grid.get_cache_key(cell_size, grid_res, robot_radius);
+    const auto file_name = cache::cache_file(cache_dir, "grid", key);
+
+    if(!cache_dir.empty() && grid.load(file_name, key)) return true;
+
+    grid.build_grid(cell_size, grid_res, robot_radius, threads);
+
+    if(!cache_dir.empty()) grid.save(file_name, key);
+
+    return false;
+  }
+
+  bool load_or_build(prm::RoadMap & road_map, const std::string & cache_dir, unsigned int samples, unsigned int k_neighbors,
+                     double robot_radius, unsigned int threads)
+  {
+    const auto key = road_map.get_cache_key(samples, k_neighbors, robot_radius);
+    const auto file_name = cache::cache_file(cache_dir, "roadmap", key);
+
+    if(!cache_dir.empty() && road_map.load(file_name, key)) return true;
+
+    road_map.build_map(samples, k_neighbors, robot_radius, threads);
+
+    if(!cache_dir.empty()) road_map.save(file_name, key);
+
+    return false;
+  }
+
+  /// \brief Create a key value pair for a diagnostic status
+  /// \param key the name of the value
+  /// \param value the value
+  /// \returns the key value pair
+  static diagnostic_msgs::KeyValue make_key_value(const std::string & key, const std::string & value)
+  {
+    diagnostic_msgs::KeyValue pair;
+    pair.key = key;
+    pair.value = value;
+
+    return pair;
+  }
+
+  diagnostic_msgs::DiagnosticStatus make_diagnostic_msg(const std::string & name, const stats::Stats & planner_stats)
+  {
+    diagnostic_msgs::DiagnosticStatus status;
+
+    status.level = diagnostic_msgs::DiagnosticStatus::OK;
+    status.name = name;
+    status.message = PLANNER_STATS ? "Planner statistics" : "Planner statistics were compiled out";
+
+    status.values.push_back(make_key_value("expansions", std::to_string(planner_stats.expansions)));
+    status.values.push_back(make_key_value("heap_pushes", std::to_string(planner_stats.heap_pushes)));
+    status.values.push_back(make_key_value("heap_pops", std::to_string(planner_stats.heap_pops)));
+    status.values.push_back(make_key_value("collision_checks", std::to_string(planner_stats.collision_checks)));
+    status.values.push_back(make_key_value("los_checks", std::to_string(planner_stats.los_checks)));
+    status.values.push_back(make_key_value("los_cache_hits", std::to_string(planner_stats.los_cache_hits)));
+
+    for(const auto & phase : planner_stats.phases)
+    {
+      status.values.push_back(make_key_value(std::string(phase.name) + "_calls", std::to_string(phase.calls)));
+      status.values.push_back(make_key_value(std::string(phase.name) + "_ms", std::to_string(1e3 * phase.seconds)));
+    }
+
+    return status;
+  }
 }
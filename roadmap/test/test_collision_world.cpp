@@ -0,0 +1,388 @@
+/// \file
+/// \brief Tests that the CollisionWorld queries give the same results as looping over every polygon with point_inside_convex and
+/// line_shape_intersection, and that the batch queries give the same results as the single queries
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "rigid2d/rigid2d.hpp"
+#include "roadmap/collision.hpp"
+#include "roadmap/collision_world.hpp"
+
+/// \brief Build a convex polygon from the convex hull of random points with integer coordinates, so the queries can land exactly
+/// on its verticies and edges
+/// \param rng the random number generator
+/// \param keep_collinear true to keep the points on the straight parts of the hull as verticies
+/// \returns the verticies of the polygon in ccw order
+static std::vector<rigid2d::Vector2D> random_polygon(std::mt19937 & rng, bool keep_collinear)
+{
+  std::uniform_int_distribution<int> corner(0, 30), size(1, 5), count(3, 8);
+
+  const int x0 = corner(rng), y0 = corner(rng), w = size(rng), h = size(rng);
+  std::uniform_int_distribution<int> dx(0, w), dy(0, h);
+
+  std::vector<rigid2d::Vector2D> points;
+  const int n = count(rng);
+  for(int i = 0; i < n; i++) points.push_back(rigid2d::Vector2D(x0 + dx(rng), y0 + dy(rng)));
+
+  std::sort(points.begin(), points.end(), [](const auto & a, const auto & b){ return a.x < b.x || (a.x == b.x && a.y < b.y); });
+  points.erase(std::unique(points.begin(), points.end(), [](const auto & a, const auto & b){ return a.x == b.x && a.y == b.y; }), points.end());
+
+  if(points.size() < 3) return {};
+
+  auto cross = [](const auto & o, const auto & a, const auto & b){ return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x); };
+
+  // monotone chain, each half drops the points that turn the wrong way
+  std::vector<rigid2d::Vector2D> hull;
+  for(int pass = 0; pass < 2; pass++)
+  {
+    const auto start = hull.size();
+
+    for(const auto & p : points)
+    {
+      while(hull.size() >= start + 2)
+      {
+        const double turn = cross(hull.at(hull.size() - 2), hull.back(), p);
+        if(turn < 0 || (turn == 0 && !keep_collinear)) hull.pop_back();
+        else break;
+      }
+      hull.push_back(p);
+    }
+
+    hull.pop_back();
+    std::reverse(points.begin(), points.end());
+  }
+
+  // all of the points were on one line
+  for(unsigned int i = 0; i < hull.size(); i++)
+  {
+    if(cross(hull.at(i), hull.at((i + 1) % hull.size()), hull.at((i + 2) % hull.size())) > 0) return hull;
+  }
+
+  return {};
+}
+
+/// \brief Build a set of random convex polygons. Some are in cw order or repeat a vertex, which the per polygon tests also accept.
+/// \param rng the random number generator
+/// \returns the polygons
+static std::vector<std::vector<rigid2d::Vector2D>> random_polygons(std::mt19937 & rng)
+{
+  std::vector<std::vector<rigid2d::Vector2D>> polygons;
+  std::bernoulli_distribution collinear(0.5), odd(0.2);
+
+  while(polygons.size() < 8)
+  {
+    auto polygon = random_polygon(rng, collinear(rng));
+    if(polygon.empty()) continue;
+
+    if(odd(rng)) std::reverse(polygon.begin(), polygon.end());
+    if(odd(rng)) polygon.insert(polygon.begin() + 1, polygon.at(1));
+
+    polygons.push_back(polygon);
+  }
+
+  return polygons;
+}
+
+/// \brief Build query points on and around the polygons: every vertex, points along every edge, points one buffer radius
+/// away from the verticies, lattice points and random points
+/// \param polygons the obstacles
+/// \param buffer the buffer radius
+/// \param rng the random number generator
+/// \returns the points
+static std::vector<rigid2d::Vector2D> query_points(const std::vector<std::vector<rigid2d::Vector2D>> & polygons, double buffer, std::mt19937 & rng)
+{
+  std::vector<rigid2d::Vector2D> points;
+  std::uniform_real_distribution<double> coord(-1.0, 38.0), fraction(0.0, 1.0);
+
+  for(const auto & polygon : polygons)
+  {
+    for(unsigned int i = 0; i < polygon.size(); i++)
+    {
+      const auto & a = polygon.at(i);
+      const auto & b = polygon.at((i + 1) % polygon.size());
+
+      points.push_back(a);
+      points.push_back(a + 0.5 * (b - a));
+      points.push_back(a + fraction(rng) * (b - a));
+
+      if(a.x == b.x && a.y == b.y) continue;
+
+      // one buffer radius out from the middle of the edge
+      const auto normal = rigid2d::Vector2D(b.y - a.y, -(b.x - a.x)).normalize();
+      points.push_back(a + 0.5 * (b - a) + buffer * normal);
+
+      for(const double x : {-buffer, 0.0, buffer})
+      {
+        for(const double y : {-buffer, 0.0, buffer}) points.push_back(a + rigid2d::Vector2D(x, y));
+      }
+
+      // a few steps of rounding either side of the buffer radius, where comparing squared distances would disagree
+      double x_in = a.x + buffer, x_out = x_in, y_in = a.y - buffer, y_out = y_in;
+      for(int k = 0; k < 4; k++)
+      {
+        x_in = std::nextafter(x_in, a.x);
+        x_out = std::nextafter(x_out, x_out + 1.0);
+        y_in = std::nextafter(y_in, a.y);
+        y_out = std::nextafter(y_out, y_out - 1.0);
+
+        for(const double x : {x_in, x_out}) points.push_back(rigid2d::Vector2D(x, a.y));
+        for(const double y : {y_in, y_out}) points.push_back(rigid2d::Vector2D(a.x, y));
+      }
+    }
+  }
+
+  for(int i = 0; i <= 76; i++)
+  {
+    for(int j = 0; j <= 76; j++) points.push_back(rigid2d::Vector2D(-1.0 + 0.5 * i, -1.0 + 0.5 * j));
+  }
+
+  for(int i = 0; i < 5000; i++) points.push_back(rigid2d::Vector2D(coord(rng), coord(rng)));
+
+  return points;
+}
+
+/// \brief Build query segments between the points, along with segments parallel to the polygon edges just inside and outside of them
+/// \param polygons the obstacles
+/// \param points the query points
+/// \param rng the random number generator
+/// \returns the segment starts and ends
+static std::pair<std::vector<rigid2d::Vector2D>, std::vector<rigid2d::Vector2D>> query_segments(const std::vector<std::vector<rigid2d::Vector2D>> & polygons,
+                                                                                                const std::vector<rigid2d::Vector2D> & points, std::mt19937 & rng)
+{
+  std::vector<rigid2d::Vector2D> starts, ends;
+  std::uniform_int_distribution<int> pick(0, points.size() - 1);
+  std::uniform_real_distribution<double> offset(-0.05, 0.05), length(-12.0, 12.0);
+
+  for(int i = 0; i < 5000; i++)
+  {
+    starts.push_back(points.at(pick(rng)));
+    ends.push_back(points.at(pick(rng)));
+  }
+
+  for(const auto & polygon : polygons)
+  {
+    for(unsigned int i = 0; i < polygon.size(); i++)
+    {
+      const auto & a = polygon.at(i);
+      const auto & b = polygon.at((i + 1) % polygon.size());
+
+      for(int k = 0; k < 10; k++)
+      {
+        const double o = (k == 0) ? 0.0 : offset(rng);
+        const double l0 = length(rng), l1 = length(rng);
+
+        // the same direction as the edge, which is exactly parallel for the axis aligned edges
+        if(a.x == b.x)
+        {
+          starts.push_back(rigid2d::Vector2D(a.x + o, a.y + l0));
+          ends.push_back(rigid2d::Vector2D(a.x + o, a.y + l1));
+        }
+        else if(a.y == b.y)
+        {
+          starts.push_back(rigid2d::Vector2D(a.x + l0, a.y + o));
+          ends.push_back(rigid2d::Vector2D(a.x + l1, a.y + o));
+        }
+        else
+        {
+          const auto shift = rigid2d::Vector2D(o, o);
+          starts.push_back(a + shift + 0.1 * l0 * (b - a));
+          ends.push_back(a + shift + 0.1 * l1 * (b - a));
+        }
+      }
+    }
+  }
+
+  return {starts, ends};
+}
+
+/// \brief Classify a point by looping over every polygon
+/// \param polygons the obstacles
+/// \param point the point to analyze
+/// \param buffer the buffer radius
+/// \returns the PointStatus of the point
+static unsigned char reference_point(const std::vector<std::vector<rigid2d::Vector2D>> & polygons, const rigid2d::Vector2D & point, double buffer)
+{
+  unsigned char status = collision::free_space;
+
+  for(const auto & polygon : polygons)
+  {
+    const auto result = collision::point_inside_convex(point, polygon, buffer);
+
+    if(result.at(0) && result.at(1)) return collision::inside_obstacle;
+    else if(result.at(0)) status = collision::buffer_zone;
+  }
+
+  return status;
+}
+
+/// \brief Test a segment by looping over every polygon
+/// \param polygons the obstacles
+/// \param start the point of the beginning of the line segment
+/// \param end the point of the end of the line segment
+/// \param buffer the buffer radius
+/// \returns True if the segment collides with any polygon
+static bool reference_segment(const std::vector<std::vector<rigid2d::Vector2D>> & polygons, const rigid2d::Vector2D & start, const rigid2d::Vector2D & end, double buffer)
+{
+  for(const auto & polygon : polygons)
+  {
+    if(collision::line_shape_intersection(start, end, polygon, buffer)) return true;
+  }
+
+  return false;
+}
+
+/// \brief Get the PointStatus of a point_inside result
+/// \param result the collision information and cause
+/// \returns the status
+static unsigned char to_status(const std::vector<bool> & result)
+{
+  if(!result.at(0)) return collision::free_space;
+  return result.at(1) ? collision::inside_obstacle : collision::buffer_zone;
+}
+
+TEST(CollisionWorld, PointsMatchPerPolygonTests)
+{
+  std::mt19937 rng(41);
+
+  for(int trial = 0; trial < 20; trial++)
+  {
+    const auto polygons = random_polygons(rng);
+
+    for(const double buffer : {0.0, 0.3, 0.6})
+    {
+      const collision::CollisionWorld world(polygons, buffer);
+
+      for(const auto & point : query_points(polygons, buffer, rng))
+      {
+        const auto expected = reference_point(polygons, point, buffer);
+
+        ASSERT_EQ(to_status(world.point_inside(point)), expected) << "point " << point << " buffer " << buffer << " trial " << trial;
+        ASSERT_EQ(world.point_collides(point), expected != collision::free_space) << "point " << point << " buffer " << buffer;
+      }
+    }
+  }
+}
+
+TEST(CollisionWorld, SegmentsMatchPerPolygonTests)
+{
+  std::mt19937 rng(43);
+
+  for(int trial = 0; trial < 20; trial++)
+  {
+    const auto polygons = random_polygons(rng);
+
+    for(const double buffer : {0.0, 0.3, 0.6})
+    {
+      const collision::CollisionWorld world(polygons, buffer);
+      const auto [starts, ends] = query_segments(polygons, query_points(polygons, buffer, rng), rng);
+
+      for(unsigned int i = 0; i < starts.size(); i++)
+      {
+        ASSERT_EQ(world.segment_collides(starts.at(i), ends.at(i)), reference_segment(polygons, starts.at(i), ends.at(i), buffer))
+          << "segment " << starts.at(i) << " " << ends.at(i) << " buffer " << buffer << " trial " << trial;
+      }
+    }
+  }
+}
+
+TEST(CollisionWorld, BatchPointsMatchSinglePoints)
+{
+  std::mt19937 rng(47);
+
+  for(int trial = 0; trial < 20; trial++)
+  {
+    const auto polygons = random_polygons(rng);
+
+    for(const double buffer : {0.0, 0.3, 0.6})
+    {
+      const collision::CollisionWorld world(polygons, buffer);
+
+      // an odd count so the last point of each batch goes through the scalar path
+      auto points = query_points(polygons, buffer, rng);
+      if(points.size() % 2 == 0) points.pop_back();
+
+      std::vector<unsigned char> status;
+      world.classify_points(points, status);
+
+      ASSERT_EQ(status.size(), points.size());
+
+      for(unsigned int i = 0; i < points.size(); i++)
+      {
+        ASSERT_EQ(status.at(i), to_status(world.point_inside(points.at(i)))) << "point " << points.at(i) << " buffer " << buffer << " trial " << trial;
+      }
+
+      // each point on its own takes the scalar path
+      for(unsigned int i = 0; i < points.size(); i += 97)
+      {
+        unsigned char single = 0;
+        world.classify_points(&points.at(i).x, &points.at(i).y, 1, &single);
+
+        ASSERT_EQ(single, status.at(i)) << "point " << points.at(i) << " buffer " << buffer;
+      }
+    }
+  }
+}
+
+TEST(CollisionWorld, BatchSegmentsMatchSingleSegments)
+{
+  std::mt19937 rng(53);
+
+  for(int trial = 0; trial < 20; trial++)
+  {
+    const auto polygons = random_polygons(rng);
+
+    for(const double buffer : {0.0, 0.3, 0.6})
+    {
+      const collision::CollisionWorld world(polygons, buffer);
+      auto [starts, ends] = query_segments(polygons, query_points(polygons, buffer, rng), rng);
+
+      if(starts.size() % 2 == 0)
+      {
+        starts.pop_back();
+        ends.pop_back();
+      }
+
+      std::vector<unsigned char> collides;
+      world.segments_collide(starts, ends, collides);
+
+      ASSERT_EQ(collides.size(), starts.size());
+
+      for(unsigned int i = 0; i < starts.size(); i++)
+      {
+        ASSERT_EQ(collides.at(i) != 0, world.segment_collides(starts.at(i), ends.at(i)))
+          << "segment " << starts.at(i) << " " << ends.at(i) << " buffer " << buffer << " trial " << trial;
+      }
+
+      for(unsigned int i = 0; i < starts.size(); i += 97)
+      {
+        unsigned char single = 0;
+        world.segments_collide(&starts.at(i).x, &starts.at(i).y, &ends.at(i).x, &ends.at(i).y, 1, &single);
+
+        ASSERT_EQ(single, collides.at(i)) << "segment " << starts.at(i) << " " << ends.at(i) << " buffer " << buffer;
+      }
+    }
+  }
+}
+
+TEST(CollisionWorld, BoundaryCases)
+{
+  // a point on a vertex at the upper corner of the bucket grid
+  const collision::CollisionWorld chain({{{6, 29}, {5, 30}, {4, 30}, {4, 29}, {4, 28}, {5, 28}}}, 0.0);
+  EXPECT_EQ(to_status(chain.point_inside(rigid2d::Vector2D(4, 30))), collision::inside_obstacle);
+
+  const collision::CollisionWorld triangle({{{9, 6}, {6, 6}, {8, 4}}}, 0.0);
+  EXPECT_EQ(to_status(triangle.point_inside(rigid2d::Vector2D(9, 6))), collision::inside_obstacle);
+
+  // a segment parallel to an edge and just outside of it
+  const std::vector<std::vector<rigid2d::Vector2D>> polygon = {{{26, 6}, {24, 7}, {22, 5}, {22, 3}, {24, 2}, {26, 2}, {27, 4}}};
+  const collision::CollisionWorld world(polygon, 0.0);
+
+  const rigid2d::Vector2D start(21.987, 11.966), end(21.987, 1.701);
+  EXPECT_EQ(world.segment_collides(start, end), reference_segment(polygon, start, end, 0.0));
+}